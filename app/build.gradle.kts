@@ -1,8 +1,53 @@
+import javax.inject.Inject
+import org.gradle.process.ExecOperations
+
 plugins {
     alias(libs.plugins.android.application)
     alias(libs.plugins.jetbrains.kotlin.android)
 }
 
+/**
+ * Builds assets.pack from src/main/assets with the host asset_packer, see
+ * src/main/cpp/tools/CMakeLists.txt, which also compresses the textures to ETC2 when libpng is
+ * found. Needs a host C++ compiler; CMake comes from the SDK when it's installed there.
+ */
+abstract class PackAssetsTask : DefaultTask() {
+    // the assets and the tools that pack them
+    @get:InputFiles
+    @get:PathSensitive(PathSensitivity.RELATIVE)
+    abstract val sources: ConfigurableFileCollection
+
+    @get:Input
+    abstract val cmake: Property<String>
+
+    @get:Internal
+    abstract val cppDir: DirectoryProperty
+
+    @get:Internal
+    abstract val hostBuildDir: DirectoryProperty
+
+    @get:OutputDirectory
+    abstract val outputDir: DirectoryProperty
+
+    @get:Inject
+    abstract val execOperations: ExecOperations
+
+    @TaskAction
+    fun pack() {
+        val build = hostBuildDir.get().asFile
+        execOperations.exec {
+            commandLine(cmake.get(), "-S", cppDir.get().asFile, "-B", build, "-DCMAKE_BUILD_TYPE=Release")
+        }
+        execOperations.exec {
+            commandLine(cmake.get(), "--build", build, "--target", "asset_pack")
+        }
+        val out = outputDir.get().asFile
+        out.deleteRecursively()
+        out.mkdirs()
+        build.resolve("tools/assets.pack").copyTo(out.resolve("assets.pack"))
+    }
+}
+
 android {
     namespace = "com.example.cube"
     compileSdk = 34
@@ -38,6 +83,17 @@ android {
     buildFeatures {
         prefab = true
     }
+    androidResources {
+        // stored, so AAsset_getBuffer maps the asset pack and compressed textures out of the APK
+        // instead of inflating them
+        noCompress += listOf("pack", "ktx2")
+    }
+    sourceSets {
+        getByName("main") {
+            // the loose files only go in through assets.pack, see packAssets below
+            assets.setSrcDirs(emptyList<String>())
+        }
+    }
     externalNativeBuild {
         cmake {
             path = file("src/main/cpp/CMakeLists.txt")
@@ -46,6 +102,24 @@ android {
     }
 }
 
+val packAssets = tasks.register<PackAssetsTask>("packAssets") {
+    sources.from(fileTree("src/main/assets"), fileTree("src/main/cpp") {
+        include("*.h", "*.cpp", "CMakeLists.txt", "tools/**")
+    })
+    val sdkCmake = android.sdkDirectory.resolve("cmake/3.22.1/bin/cmake")
+    cmake.set(if (sdkCmake.exists()) sdkCmake.path else "cmake")
+    cppDir.set(layout.projectDirectory.dir("src/main/cpp"))
+    hostBuildDir.set(layout.buildDirectory.dir("hostTools"))
+    outputDir.set(layout.buildDirectory.dir("generated/assetPack"))
+}
+
+// every variant's assets are the pack, merged in by mergeAssets like any other asset directory
+androidComponents {
+    onVariants { variant ->
+        variant.sources.assets?.addGeneratedSourceDirectory(packAssets, PackAssetsTask::outputDir)
+    }
+}
+
 dependencies {
 
     implementation(libs.androidx.core.ktx)
@@ -0,0 +1,50 @@
+package com.example.cube
+
+import androidx.test.platform.app.InstrumentationRegistry
+import androidx.test.ext.junit.runners.AndroidJUnit4
+
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+import org.junit.Test
+import org.junit.runner.RunWith
+
+import org.junit.Assert.*
+
+/**
+ * Checks the APK carries the asset pack the way AndroidAssetLoader::openPack maps it, so the game
+ * reads from the pack instead of falling back to loose files.
+ */
+@RunWith(AndroidJUnit4::class)
+class AssetPackTest {
+    private val assets = InstrumentationRegistry.getInstrumentation().targetContext.assets
+
+    @Test
+    fun packIsStoredUncompressed() {
+        // openFd only works for stored assets, which AAsset_getBuffer can map in place
+        assets.openFd("assets.pack").use { descriptor ->
+            assertTrue(descriptor.length > 0)
+        }
+    }
+
+    @Test
+    fun packHasAValidHeader() {
+        val header = ByteArray(16)
+        assets.open("assets.pack").use { stream ->
+            assertEquals(header.size, stream.read(header))
+        }
+        val fields = ByteBuffer.wrap(header).order(ByteOrder.LITTLE_ENDIAN)
+        // AssetPack::kMagic and kVersion
+        assertEquals(0x4b415043, fields.getInt(0))
+        assertEquals(1, fields.getInt(4))
+        assertTrue(fields.getInt(8) > 0)
+    }
+
+    @Test
+    fun looseAssetsAreOnlyInThePack() {
+        val root = assets.list("")!!.toList()
+        assertTrue(root.contains("assets.pack"))
+        assertFalse(root.contains("cube_shader.vs"))
+        assertFalse(root.contains("b2s_upscaled.png"))
+    }
+}
@@ -4,11 +4,50 @@ out vec4 color;
 
 in vec3 FragPos;
 in vec3 Normal;
+in vec3 ViewPos;
+in vec3 ObjectColor;
+#if defined(CLUSTERED_LIGHTS) || defined(FOG)
+in highp float ViewDepth;
+#endif
 
 uniform vec3 lightPos;
-uniform vec3 viewPos;
 uniform vec3 lightColor;
-uniform vec3 objectColor;
+
+#ifdef CLUSTERED_LIGHTS
+// Clustered point lights, see LightClusters.h. The lights are in world space, the array sizes
+// must match LightClusters::kMaxLights
+layout(std140) uniform Lights {
+    highp vec4 lightPositionRadius[256];
+    highp vec4 lightColors[256];
+};
+// per cluster, the offset and count of its lights in clusterLights
+uniform highp usampler3D clusterGrid;
+// light indices, one row after the other
+uniform highp usampler2D clusterLights;
+// xy: clusters per pixel, the slice of a depth z is log(z) * clusterScale.z + clusterScale.w
+uniform highp vec4 clusterScale;
+#endif
+
+#ifdef FOG
+uniform vec3 fogColor;
+// per unit of view depth, squared exponential falloff
+uniform float fogDensity;
+#endif
+
+const float specularStrength = 0.5f;
+
+/*!
+ * Diffuse and specular from one light
+ */
+vec3 shade(vec3 norm, vec3 viewDir, vec3 lightDir, vec3 radiance) {
+    float diff = max(dot(norm, lightDir), 0.0f);
+    vec3 diffuse = diff * radiance;
+
+    vec3 reflectDir = reflect(-lightDir, norm);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0f), 32.0f);
+    vec3 specular = specularStrength * spec * radiance;
+    return diffuse + specular;
+}
 
 void main()
 {
@@ -16,16 +55,33 @@ void main()
     vec3 ambient = ambientStrength * lightColor;
 
     vec3 norm = normalize(Normal);
-    vec3 lightDir = normalize(lightPos - FragPos);
-    float diff = max(dot(norm, lightDir), 0.0f);
-    vec3 diffuse = diff * lightColor;
+    vec3 viewDir = normalize(ViewPos - FragPos);
+    vec3 lighting = ambient + shade(norm, viewDir, normalize(lightPos - FragPos), lightColor);
 
-    float specularStrength = 0.5f;
-    vec3 viewDir = normalize(viewPos - FragPos);
-    vec3 reflectDir = reflect(-lightDir, norm);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0f), 32.0f);
-    vec3 specular = specularStrength * spec * lightColor;
+#ifdef CLUSTERED_LIGHTS
+    // only the lights of this fragment's cluster can reach it
+    ivec3 gridSize = textureSize(clusterGrid, 0);
+    ivec3 cell = ivec3(ivec2(gl_FragCoord.xy * clusterScale.xy),
+                       int(log(ViewDepth) * clusterScale.z + clusterScale.w));
+    uvec2 cluster = texelFetch(clusterGrid, clamp(cell, ivec3(0), gridSize - 1), 0).rg;
+    int rowLength = textureSize(clusterLights, 0).x;
+    for (uint i = 0u; i < cluster.y; i++) {
+        int index = int(cluster.x + i);
+        uint light = texelFetch(clusterLights, ivec2(index % rowLength, index / rowLength), 0).r;
+        highp vec4 positionRadius = lightPositionRadius[light];
+        highp vec3 toLight = positionRadius.xyz - FragPos;
+        highp float distance = length(toLight);
+        // windowed so it's exactly zero at the radius the light was clustered with
+        float window = clamp(1.0f - pow(distance / positionRadius.w, 4.0f), 0.0f, 1.0f);
+        float attenuation = window * window / (distance * distance + 1.0f);
+        lighting += attenuation * shade(norm, viewDir, toLight / distance, lightColors[light].rgb);
+    }
+#endif
 
-    vec3 result = (ambient + diffuse + specular) * objectColor;
+    vec3 result = lighting * ObjectColor;
+#ifdef FOG
+    float fog = exp2(-fogDensity * fogDensity * ViewDepth * ViewDepth * 1.442695f);
+    result = mix(fogColor, result, clamp(fog, 0.0f, 1.0f));
+#endif
     color = vec4(result, 1.0f);
-}
\ No newline at end of file
+}
@@ -1,17 +1,45 @@
 #version 300 es
-in vec3 position;
-in vec3 normal;
+// see ShaderVariants.h
+#pragma features CLUSTERED_LIGHTS FOG
+
+// fixed locations, every variant uses the same vertex arrays
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal;
+
+// per instance
+layout(location = 2) in mat4 instanceModel;
+layout(location = 6) in vec4 instanceColor;
 
 out vec3 Normal;
 out vec3 FragPos;
+out vec3 ViewPos;
+out vec3 ObjectColor;
+#if defined(CLUSTERED_LIGHTS) || defined(FOG)
+// distance in front of the camera, picks the cluster depth slice and thickens the fog
+out float ViewDepth;
+#endif
+
+// expands quantized positions, identity for float positions
+uniform vec3 positionScale;
+uniform vec3 positionBias;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout(std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+};
 
 void main()
 {
-    gl_Position = projection * view *  model * vec4(position, 1.0f);
-    FragPos = vec3(model * vec4(position, 1.0f));
-    Normal = mat3(transpose(inverse(model))) * normal;
-}
\ No newline at end of file
+    vec4 worldPos = instanceModel * vec4(position * positionScale + positionBias, 1.0f);
+    vec4 viewSpacePos = view * worldPos;
+    gl_Position = projection * viewSpacePos;
+#if defined(CLUSTERED_LIGHTS) || defined(FOG)
+    ViewDepth = -viewSpacePos.z;
+#endif
+    FragPos = worldPos.xyz;
+    // instances are rotated and uniformly scaled only, so the model matrix works for normals too
+    Normal = mat3(instanceModel) * normal;
+    ViewPos = viewPos.xyz;
+    ObjectColor = instanceColor.rgb;
+}
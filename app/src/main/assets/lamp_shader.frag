@@ -3,7 +3,19 @@ precision mediump float;
 
 out vec4 color;
 
+#ifdef FOG
+in highp float ViewDepth;
+
+uniform vec3 fogColor;
+uniform float fogDensity;
+#endif
+
 void main()
 {
-    color = vec4(1.0f, 1.0f, 1.0f, 1.0f);
+    vec3 result = vec3(1.0f, 1.0f, 1.0f);
+#ifdef FOG
+    float fog = exp2(-fogDensity * fogDensity * ViewDepth * ViewDepth * 1.442695f);
+    result = mix(fogColor, result, clamp(fog, 0.0f, 1.0f));
+#endif
+    color = vec4(result, 1.0f);
 }
\ No newline at end of file
@@ -1,10 +1,29 @@
 #version 300 es
-in vec3 position;
+// see ShaderVariants.h
+#pragma features FOG
+
+layout(location = 0) in vec3 position;
 
-uniform mat4 projection;
 uniform mat4 model;
-uniform mat4 view;
+
+// expands quantized positions, identity for float positions
+uniform vec3 positionScale;
+uniform vec3 positionBias;
+
+layout(std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+};
+
+#ifdef FOG
+out float ViewDepth;
+#endif
 
 void main() {
-    gl_Position = projection * view * model * vec4(position, 1.0f);
+    vec4 viewSpacePos = view * model * vec4(position * positionScale + positionBias, 1.0f);
+    gl_Position = projection * viewSpacePos;
+#ifdef FOG
+    ViewDepth = -viewSpacePos.z;
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,29 @@
+#include "AndroidAssetLoader.h"
+
+bool AndroidAssetLoader::read(const std::string &path, std::string &contents) const {
+    auto asset = AAssetManager_open(assetManager_, path.c_str(), AASSET_MODE_BUFFER);
+    if (!asset) {
+        return false;
+    }
+    off_t size = AAsset_getLength(asset);
+    contents.resize(size);
+    int read = AAsset_read(asset, &contents.front(), size);
+    AAsset_close(asset);
+    return read == size;
+}
+
+std::unique_ptr<AssetPack> AndroidAssetLoader::openPack(const std::string &path) const {
+    auto asset = AAssetManager_open(assetManager_, path.c_str(), AASSET_MODE_BUFFER);
+    if (!asset) {
+        return nullptr;
+    }
+    const auto size = static_cast<size_t>(AAsset_getLength64(asset));
+    const void *buffer = AAsset_getBuffer(asset);
+    if (!buffer) {
+        AAsset_close(asset);
+        return nullptr;
+    }
+    // the asset owns the mapping, so it stays open as long as the pack
+    auto pack = std::make_unique<AssetPack>(buffer, size, [asset]() { AAsset_close(asset); });
+    return pack->isValid() ? std::move(pack) : nullptr;
+}
@@ -0,0 +1,30 @@
+#ifndef ANDROIDGLINVESTIGATIONS_ANDROIDASSETLOADER_H
+#define ANDROIDGLINVESTIGATIONS_ANDROIDASSETLOADER_H
+
+#include <android/asset_manager.h>
+#include <memory>
+
+#include "AssetLoader.h"
+#include "AssetPack.h"
+
+/*!
+ * Reads assets packed into the APK
+ */
+class AndroidAssetLoader : public AssetLoader {
+public:
+    inline explicit AndroidAssetLoader(AAssetManager *assetManager) : assetManager_(assetManager) {}
+
+    bool read(const std::string &path, std::string &contents) const override;
+
+    /*!
+     * Opens a pack built by tools/AssetPacker.cpp. Stored uncompressed, the APK's copy is mapped
+     * and read in place; a compressed one is inflated into memory once.
+     * @return the pack, or null if the APK has no valid pack by that name
+     */
+    std::unique_ptr<AssetPack> openPack(const std::string &path) const;
+
+private:
+    AAssetManager *assetManager_;
+};
+
+#endif //ANDROIDGLINVESTIGATIONS_ANDROIDASSETLOADER_H
@@ -0,0 +1,24 @@
+#include "AndroidImageDecoder.h"
+
+#include <android/imagedecoder.h>
+
+bool AndroidImageDecoder::decode(std::string_view encoded, DecodedImage &image) const {
+    AImageDecoder *decoder = nullptr;
+    if (AImageDecoder_createFromBuffer(encoded.data(), encoded.size(), &decoder) != ANDROID_IMAGE_DECODER_SUCCESS) {
+        return false;
+    }
+
+    // make sure we get 8 bits per channel out. RGBA order.
+    AImageDecoder_setAndroidBitmapFormat(decoder, ANDROID_BITMAP_FORMAT_RGBA_8888);
+
+    const AImageDecoderHeaderInfo *header = AImageDecoder_getHeaderInfo(decoder);
+    image.width = AImageDecoderHeaderInfo_getWidth(header);
+    image.height = AImageDecoderHeaderInfo_getHeight(header);
+
+    // tightly packed rows, which is also what GL expects with the default unpack alignment
+    const size_t stride = size_t(image.width) * 4;
+    image.pixels.resize(stride * image.height);
+    auto result = AImageDecoder_decodeImage(decoder, image.pixels.data(), stride, image.pixels.size());
+    AImageDecoder_delete(decoder);
+    return result == ANDROID_IMAGE_DECODER_SUCCESS;
+}
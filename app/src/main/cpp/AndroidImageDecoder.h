@@ -0,0 +1,15 @@
+#ifndef ANDROIDGLINVESTIGATIONS_ANDROIDIMAGEDECODER_H
+#define ANDROIDGLINVESTIGATIONS_ANDROIDIMAGEDECODER_H
+
+#include "ImageDecoder.h"
+
+/*!
+ * Decodes whatever AImageDecoder supports (PNG, JPEG, WebP, ...). Every call makes its own
+ * decoder, so any number of threads can decode at once.
+ */
+class AndroidImageDecoder : public ImageDecoder {
+public:
+    bool decode(std::string_view encoded, DecodedImage &image) const override;
+};
+
+#endif //ANDROIDGLINVESTIGATIONS_ANDROIDIMAGEDECODER_H
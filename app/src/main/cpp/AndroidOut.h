@@ -1,7 +1,11 @@
 #ifndef ANDROIDGLINVESTIGATIONS_ANDROIDOUT_H
 #define ANDROIDGLINVESTIGATIONS_ANDROIDOUT_H
 
+#ifdef __ANDROID__
 #include <android/log.h>
+#else
+#include <cstdio>
+#endif
 #include <sstream>
 
 /*!
@@ -9,12 +13,15 @@
  *
  * ex:
  *  aout << "Hello World" << std::endl;
+ *
+ * Every thread has an aout of its own, so the game and render threads can log at the same time
+ * without mixing up their lines.
  */
-extern std::ostream aout;
+extern thread_local std::ostream aout;
 
 /*!
  * Use this class to create an output stream that writes to logcat. By default, a global one is
- * defined as @a aout
+ * defined as @a aout. Host builds write to stderr instead.
  */
 class AndroidOut: public std::stringbuf {
 public:
@@ -26,7 +33,11 @@ public:
 
 protected:
     virtual int sync() override {
+#ifdef __ANDROID__
         __android_log_print(ANDROID_LOG_DEBUG, logTag_, "%s", str().c_str());
+#else
+        fprintf(stderr, "%s: %s", logTag_, str().c_str());
+#endif
         str("");
         return 0;
     }
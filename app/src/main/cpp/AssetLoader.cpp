@@ -0,0 +1,21 @@
+#include "AssetLoader.h"
+
+#include <fstream>
+#include <sstream>
+
+FileAssetLoader::FileAssetLoader(std::string directory) : directory_(std::move(directory)) {
+    if (!directory_.empty() && directory_.back() != '/') {
+        directory_ += '/';
+    }
+}
+
+bool FileAssetLoader::read(const std::string &path, std::string &contents) const {
+    std::ifstream file(directory_ + path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    std::ostringstream buffer;
+    buffer << file.rdbuf();
+    contents = buffer.str();
+    return true;
+}
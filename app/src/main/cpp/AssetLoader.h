@@ -0,0 +1,44 @@
+#ifndef ANDROIDGLINVESTIGATIONS_ASSETLOADER_H
+#define ANDROIDGLINVESTIGATIONS_ASSETLOADER_H
+
+#include <string>
+#include <string_view>
+
+/*!
+ * Where shaders and textures come from. The app reads the APK's assets through
+ * AndroidAssetLoader, host tools read the same files from the source tree with FileAssetLoader.
+ */
+class AssetLoader {
+public:
+    virtual ~AssetLoader() = default;
+
+    /*!
+     * Reads a whole asset
+     * @param path relative to the assets/ directory
+     * @param contents receives the bytes, which needn't be text
+     * @return false if there's no such asset
+     */
+    virtual bool read(const std::string &path, std::string &contents) const = 0;
+
+    /*!
+     * Points @a contents at an asset the loader already has in memory, without copying it. The
+     * view stays valid as long as the loader. Callers fall back to @a read when this fails.
+     * @return false if there's no such asset or the loader can't hand out views
+     */
+    virtual bool view(const std::string &path, std::string_view &contents) const { return false; }
+};
+
+/*!
+ * Reads assets from a directory on disk
+ */
+class FileAssetLoader : public AssetLoader {
+public:
+    explicit FileAssetLoader(std::string directory);
+
+    bool read(const std::string &path, std::string &contents) const override;
+
+private:
+    std::string directory_;
+};
+
+#endif //ANDROIDGLINVESTIGATIONS_ASSETLOADER_H
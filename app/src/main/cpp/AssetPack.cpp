@@ -0,0 +1,129 @@
+#include "AssetPack.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+#include "AndroidOut.h"
+
+static_assert(sizeof(AssetPackHeader) == 32, "the header layout is part of the file format");
+static_assert(sizeof(AssetPackEntry) == 32, "the entry layout is part of the file format");
+
+AssetPack::AssetPack(const void *data, size_t size, std::function<void()> release)
+        : data_(static_cast<const uint8_t *>(data)),
+          size_(size),
+          release_(std::move(release)),
+          names_(nullptr) {
+    if (!load()) {
+        aout << "Not a valid asset pack" << std::endl;
+    }
+}
+
+AssetPack::~AssetPack() {
+    if (release_) {
+        release_();
+    }
+}
+
+std::unique_ptr<AssetPack> AssetPack::openFile(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat info{};
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        close(fd);
+        return nullptr;
+    }
+    const auto size = static_cast<size_t>(info.st_size);
+    void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps the file alive on its own
+    close(fd);
+    if (data == MAP_FAILED) {
+        aout << "Couldn't map " << path << std::endl;
+        return nullptr;
+    }
+
+    auto pack = std::make_unique<AssetPack>(data, size, [data, size]() { munmap(data, size); });
+    if (!pack->isValid()) {
+        return nullptr;
+    }
+    return pack;
+}
+
+bool AssetPack::read(const std::string &path, std::string &contents) const {
+    std::string_view view;
+    if (!this->view(path, view)) {
+        return false;
+    }
+    contents.assign(view.data(), view.size());
+    return true;
+}
+
+bool AssetPack::view(const std::string &path, std::string_view &contents) const {
+    const AssetPackEntry *entry = find(path);
+    if (!entry) {
+        return false;
+    }
+    contents = std::string_view(reinterpret_cast<const char *>(data_ + entry->offset), entry->size);
+    return true;
+}
+
+std::string_view AssetPack::getName(size_t index) const {
+    return {names_ + entries_[index].nameOffset, entries_[index].nameLength};
+}
+
+bool AssetPack::load() {
+    // the data is only as aligned as the pack is in the APK, 4 bytes, so the header and table are
+    // copied out rather than read in place
+    AssetPackHeader header{};
+    if (!data_ || size_ < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, data_, sizeof(header));
+    if (header.magic != kMagic || header.version != kVersion
+        || header.tocOffset % kTocAlignment != 0 || header.tocOffset > size_
+        || header.entryCount > (size_ - header.tocOffset) / sizeof(AssetPackEntry)
+        || header.namesOffset > size_) {
+        return false;
+    }
+    std::vector<AssetPackEntry> entries(header.entryCount);
+    memcpy(entries.data(), data_ + header.tocOffset, entries.size() * sizeof(AssetPackEntry));
+
+    // every lookup trusts these, so check them all once up front
+    auto *names = reinterpret_cast<const char *>(data_ + header.namesOffset);
+    const size_t namesSize = size_ - header.namesOffset;
+    std::string_view previous;
+    for (size_t i = 0; i < entries.size(); i++) {
+        const AssetPackEntry &entry = entries[i];
+        if (entry.offset > size_ || entry.size > size_ - entry.offset
+            || entry.alignment == 0 || entry.offset % entry.alignment != 0
+            || entry.nameOffset > namesSize || entry.nameLength > namesSize - entry.nameOffset) {
+            return false;
+        }
+        std::string_view name(names + entry.nameOffset, entry.nameLength);
+        if (i > 0 && !(previous < name)) {
+            return false;
+        }
+        previous = name;
+    }
+    entries_ = std::move(entries);
+    names_ = names;
+    return true;
+}
+
+const AssetPackEntry *AssetPack::find(std::string_view path) const {
+    auto *end = entries_.data() + entries_.size();
+    auto *entry = std::lower_bound(entries_.data(), end, path,
+                                   [this](const AssetPackEntry &entry, std::string_view value) {
+                                       return std::string_view(names_ + entry.nameOffset, entry.nameLength) < value;
+                                   });
+    if (entry == end || std::string_view(names_ + entry->nameOffset, entry->nameLength) != path) {
+        return nullptr;
+    }
+    return entry;
+}
@@ -0,0 +1,110 @@
+#ifndef ANDROIDGLINVESTIGATIONS_ASSETPACK_H
+#define ANDROIDGLINVESTIGATIONS_ASSETPACK_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "AssetLoader.h"
+
+/*!
+ * Starts an asset pack. Everything in the file is little endian, at the offsets given here:
+ *
+ *  header                  AssetPackHeader, at 0
+ *  table of contents       entryCount AssetPackEntry, at tocOffset, kTocAlignment aligned
+ *  names                   every entry's path, back to back without terminators, at namesOffset
+ *  data                    each entry's bytes, aligned to that entry's alignment
+ *
+ * The table is sorted by path so lookups are a binary search.
+ */
+struct AssetPackHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+    uint64_t tocOffset;
+    uint64_t namesOffset;
+};
+
+struct AssetPackEntry {
+    // from the start of the pack, a multiple of alignment. Where the pack is loaded decides how
+    // aligned that is in memory
+    uint64_t offset;
+    uint64_t size;
+    // the path relative to assets/, in the names block
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    uint32_t alignment;
+    uint32_t reserved;
+};
+
+/*!
+ * Every asset in one file, read in place. The pack is mapped once and assets are handed out as
+ * views into the mapping, so there is no per asset open, read or copy. tools/AssetPacker.cpp
+ * builds packs from a directory.
+ *
+ * On a device the pack ships uncompressed in the APK and is mapped with AAsset_getBuffer, see
+ * AndroidAssetLoader::openPack. Elsewhere @a openFile maps a file. Only the table of contents is
+ * copied, so the data may start at any address; offsets and alignments are from the start of the
+ * pack.
+ */
+class AssetPack : public AssetLoader {
+public:
+    static constexpr uint32_t kMagic = 0x4b415043; // "CPAK"
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uint32_t kTocAlignment = 64;
+
+    /*!
+     * Reads the pack in @a data, which must stay valid until @a release is called
+     * @param release called from the destructor, e.g. to unmap the data
+     */
+    AssetPack(const void *data, size_t size, std::function<void()> release = {});
+
+    ~AssetPack() override;
+
+    AssetPack(const AssetPack &) = delete;
+
+    AssetPack &operator=(const AssetPack &) = delete;
+
+    /*!
+     * Maps a pack file read only
+     * @return the pack, or null if the file is missing or isn't a valid pack
+     */
+    static std::unique_ptr<AssetPack> openFile(const std::string &path);
+
+    /*!
+     * @return false if the data wasn't a pack this version understands, it then has no entries
+     */
+    inline bool isValid() const { return names_ != nullptr; }
+
+    bool read(const std::string &path, std::string &contents) const override;
+
+    bool view(const std::string &path, std::string_view &contents) const override;
+
+    inline size_t getEntryCount() const { return entries_.size(); }
+
+    /*!
+     * @return the path of entry @a index, entries are sorted by path
+     */
+    std::string_view getName(size_t index) const;
+
+private:
+    /*!
+     * Copies the table of contents out, once the header and every entry are checked to be in bounds
+     */
+    bool load();
+
+    const AssetPackEntry *find(std::string_view path) const;
+
+    const uint8_t *data_;
+    size_t size_;
+    std::function<void()> release_;
+    std::vector<AssetPackEntry> entries_;
+    // in the data, null unless the pack is valid
+    const char *names_;
+};
+
+#endif //ANDROIDGLINVESTIGATIONS_ASSETPACK_H
@@ -0,0 +1,78 @@
+#include "Camera.h"
+
+#include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+Camera::Camera()
+        : eye_(0.0f, 0.0f, 3.0f),
+          target_(0.0f),
+          up_(0.0f, 1.0f, 0.0f),
+          fovY_(glm::radians(60.0f)),
+          aspect_(1.0f),
+          near_(0.1f),
+          far_(100.0f),
+          viewDirty_(true),
+          projectionDirty_(true),
+          view_(1.0f),
+          projection_(1.0f),
+          viewProjection_(1.0f),
+          inverseView_(1.0f),
+          inverseProjection_(1.0f),
+          inverseViewProjection_(1.0f) {}
+
+void Camera::lookAt(const glm::vec3 &eye, const glm::vec3 &target, const glm::vec3 &up) {
+    if (eye == eye_ && target == target_ && up == up_) {
+        return;
+    }
+    eye_ = eye;
+    target_ = target;
+    up_ = up;
+    viewDirty_ = true;
+}
+
+void Camera::setPerspective(float fovY, float near, float far) {
+    if (fovY == fovY_ && near == near_ && far == far_) {
+        return;
+    }
+    fovY_ = fovY;
+    near_ = near;
+    far_ = far;
+    projectionDirty_ = true;
+}
+
+void Camera::setViewport(int width, int height) {
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+    float aspect = (float) width / (float) height;
+    if (aspect != aspect_) {
+        aspect_ = aspect;
+        projectionDirty_ = true;
+    }
+}
+
+bool Camera::update() {
+    stats_.updates++;
+    if (!viewDirty_ && !projectionDirty_) {
+        return false;
+    }
+
+    if (viewDirty_) {
+        view_ = glm::lookAt(eye_, target_, up_);
+        // a view matrix is rigid, no need for a general inverse
+        inverseView_ = glm::affineInverse(view_);
+        stats_.viewRebuilds++;
+    }
+    if (projectionDirty_) {
+        projection_ = glm::perspective(fovY_, aspect_, near_, far_);
+        inverseProjection_ = glm::inverse(projection_);
+        stats_.projectionRebuilds++;
+    }
+    viewProjection_ = projection_ * view_;
+    inverseViewProjection_ = inverseView_ * inverseProjection_;
+    stats_.viewProjectionRebuilds++;
+
+    viewDirty_ = false;
+    projectionDirty_ = false;
+    return true;
+}
@@ -0,0 +1,94 @@
+#ifndef ANDROIDGLINVESTIGATIONS_CAMERA_H
+#define ANDROIDGLINVESTIGATIONS_CAMERA_H
+
+#include <cstdint>
+#include <glm/glm.hpp>
+
+/*!
+ * A perspective camera that caches its matrices. Setters only mark what changed, @a update
+ * rebuilds just the dirty matrices once per frame and says whether anything needs re-uploading,
+ * so a static camera costs nothing after the first frame.
+ */
+class Camera {
+public:
+    /*!
+     * How much work the camera has done, to check that steady-state frames do none
+     */
+    struct Stats {
+        // calls to update()
+        uint64_t updates = 0;
+        // times the view and its inverse were rebuilt
+        uint64_t viewRebuilds = 0;
+        // times the projection and its inverse were rebuilt
+        uint64_t projectionRebuilds = 0;
+        // times the combined view-projection and its inverse were rebuilt
+        uint64_t viewProjectionRebuilds = 0;
+    };
+
+    Camera();
+
+    void lookAt(const glm::vec3 &eye, const glm::vec3 &target, const glm::vec3 &up);
+
+    /*!
+     * @param fovY vertical field of view in radians
+     */
+    void setPerspective(float fovY, float near, float far);
+
+    /*!
+     * Updates the aspect ratio. Only dirties the projection if the aspect actually changed.
+     */
+    void setViewport(int width, int height);
+
+    /*!
+     * Rebuilds whatever was dirtied since the last call.
+     * @return true if any matrix changed and has to be uploaded again
+     */
+    bool update();
+
+    inline const glm::vec3 &getPosition() const { return eye_; }
+
+    inline float getFovY() const { return fovY_; }
+
+    inline float getAspect() const { return aspect_; }
+
+    inline float getNear() const { return near_; }
+
+    inline float getFar() const { return far_; }
+
+    inline const glm::mat4 &getView() const { return view_; }
+
+    inline const glm::mat4 &getProjection() const { return projection_; }
+
+    inline const glm::mat4 &getViewProjection() const { return viewProjection_; }
+
+    inline const glm::mat4 &getInverseView() const { return inverseView_; }
+
+    inline const glm::mat4 &getInverseProjection() const { return inverseProjection_; }
+
+    inline const glm::mat4 &getInverseViewProjection() const { return inverseViewProjection_; }
+
+    inline const Stats &getStats() const { return stats_; }
+
+private:
+    glm::vec3 eye_;
+    glm::vec3 target_;
+    glm::vec3 up_;
+    float fovY_;
+    float aspect_;
+    float near_;
+    float far_;
+
+    bool viewDirty_;
+    bool projectionDirty_;
+
+    glm::mat4 view_;
+    glm::mat4 projection_;
+    glm::mat4 viewProjection_;
+    glm::mat4 inverseView_;
+    glm::mat4 inverseProjection_;
+    glm::mat4 inverseViewProjection_;
+
+    Stats stats_;
+};
+
+#endif //ANDROIDGLINVESTIGATIONS_CAMERA_H
@@ -0,0 +1,88 @@
+#include "ClusteredLighting.h"
+
+#include <algorithm>
+
+static_assert(LightClusters::kMaxLightIndices % ClusteredLighting::kIndexTextureWidth == 0,
+              "the index texture holds whole rows");
+
+ClusteredLighting::ClusteredLighting()
+        : block_{},
+          gridTexture_(0),
+          indexTexture_(0) {
+    lightRing_ = std::make_unique<UniformRing>(sizeof(LightsBlock));
+
+    // integer textures can't be filtered, every lookup is a texelFetch anyway
+    glGenTextures(1, &gridTexture_);
+    glActiveTexture(GL_TEXTURE0 + kClusterGridUnit);
+    glBindTexture(GL_TEXTURE_3D, gridTexture_);
+    glTexStorage3D(GL_TEXTURE_3D, 1, GL_RG32UI,
+                   LightClusters::kTilesX, LightClusters::kTilesY, LightClusters::kSlices);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glGenTextures(1, &indexTexture_);
+    glActiveTexture(GL_TEXTURE0 + kClusterLightsUnit);
+    glBindTexture(GL_TEXTURE_2D, indexTexture_);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_R8UI, kIndexTextureWidth,
+                   LightClusters::kMaxLightIndices / kIndexTextureWidth);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+ClusteredLighting::~ClusteredLighting() {
+    glDeleteTextures(1, &gridTexture_);
+    glDeleteTextures(1, &indexTexture_);
+}
+
+void ClusteredLighting::update(const Camera &camera, const std::vector<PointLight> &lights) {
+    if (camera.getFovY() != fovY_ || camera.getAspect() != aspect_
+        || camera.getNear() != near_ || camera.getFar() != far_) {
+        fovY_ = camera.getFovY();
+        aspect_ = camera.getAspect();
+        near_ = camera.getNear();
+        far_ = camera.getFar();
+        clusters_.setProjection(fovY_, aspect_, near_, far_);
+    }
+    clusters_.assign(camera.getView(), lights.data(), lights.size());
+
+    const size_t lightCount = std::min(lights.size(), LightClusters::kMaxLights);
+    for (size_t i = 0; i < lightCount; i++) {
+        block_.positionRadius[i] = glm::vec4(lights[i].position, lights[i].radius);
+        block_.color[i] = glm::vec4(lights[i].color * lights[i].intensity, 1.0f);
+    }
+    lightRing_->write(kLightsBinding, block_);
+
+    // Cluster is two uint32s, exactly an RG32UI texel
+    static_assert(sizeof(LightClusters::Cluster) == 2 * sizeof(GLuint), "one texel per cluster");
+    glActiveTexture(GL_TEXTURE0 + kClusterGridUnit);
+    glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0,
+                    LightClusters::kTilesX, LightClusters::kTilesY, LightClusters::kSlices,
+                    GL_RG_INTEGER, GL_UNSIGNED_INT, clusters_.getClusters().data());
+
+    // whole rows, then what's left over in a short one
+    const std::vector<uint8_t> &indices = clusters_.getLightIndices();
+    const auto rows = static_cast<GLsizei>(indices.size() / kIndexTextureWidth);
+    const auto remainder = static_cast<GLsizei>(indices.size() % kIndexTextureWidth);
+    glActiveTexture(GL_TEXTURE0 + kClusterLightsUnit);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (rows > 0) {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, kIndexTextureWidth, rows,
+                        GL_RED_INTEGER, GL_UNSIGNED_BYTE, indices.data());
+    }
+    if (remainder > 0) {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, rows, remainder, 1,
+                        GL_RED_INTEGER, GL_UNSIGNED_BYTE, indices.data() + size_t(rows) * kIndexTextureWidth);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void ClusteredLighting::endFrame() {
+    lightRing_->endFrame();
+}
+
+glm::vec4 ClusteredLighting::getClusterScale(int width, int height) const {
+    return glm::vec4(float(LightClusters::kTilesX) / width, float(LightClusters::kTilesY) / height,
+                     clusters_.getSliceScale(), clusters_.getSliceBias());
+}
@@ -0,0 +1,94 @@
+#ifndef ANDROIDGLINVESTIGATIONS_CLUSTEREDLIGHTING_H
+#define ANDROIDGLINVESTIGATIONS_CLUSTEREDLIGHTING_H
+
+#include <memory>
+#include <vector>
+#include <GLES3/gl3.h>
+#include <glm/glm.hpp>
+
+#include "Camera.h"
+#include "LightClusters.h"
+#include "UniformRing.h"
+
+/*!
+ * Texture units the cluster textures stay bound to, unit 0 is left to the draws
+ */
+enum ClusterTextureUnit : GLint {
+    kClusterGridUnit = 1,
+    kClusterLightsUnit = 2,
+};
+
+/*!
+ * Every light as the shaders see it. The layout follows std140 and must match the Lights block in
+ * cube_shader.frag:
+ *
+ *  layout(std140) uniform Lights {
+ *      highp vec4 lightPositionRadius[256];
+ *      highp vec4 lightColor[256];
+ *  };
+ */
+struct LightsBlock {
+    // xyz is the position in world space, w the radius
+    glm::vec4 positionRadius[LightClusters::kMaxLights];
+    // rgb is the color times the intensity, a is unused
+    glm::vec4 color[LightClusters::kMaxLights];
+};
+
+/*!
+ * The GL side of clustered forward lighting. Assigns the lights to clusters with LightClusters and
+ * hands the result to the fragment shader:
+ *  - the lights themselves in a uniform buffer, see LightsBlock
+ *  - the cluster grid in an RG32UI 3D texture, one texel per cluster with the offset and count of
+ *    its lights in the index list
+ *  - the index list in an R8UI 2D texture, kIndexTextureWidth indices per row
+ * The textures stay bound to their ClusterTextureUnit.
+ */
+class ClusteredLighting {
+public:
+    static constexpr GLsizei kIndexTextureWidth = 1024;
+
+    /*!
+     * Needs a current context
+     */
+    ClusteredLighting();
+
+    ~ClusteredLighting();
+
+    ClusteredLighting(const ClusteredLighting &) = delete;
+
+    ClusteredLighting &operator=(const ClusteredLighting &) = delete;
+
+    /*!
+     * Assigns @a lights to the clusters of @a camera's frustum and uploads everything. Only needed
+     * when the camera or the lights changed, the last upload stays in use until then.
+     */
+    void update(const Camera &camera, const std::vector<PointLight> &lights);
+
+    /*!
+     * Fences the light buffer, call once per frame after the draws
+     */
+    void endFrame();
+
+    /*!
+     * @return the clusterScale uniform for a scene drawn at @a width by @a height: tiles per pixel
+     * in x and y, then the slice scale and bias
+     */
+    glm::vec4 getClusterScale(int width, int height) const;
+
+    inline const LightClusters &getClusters() const { return clusters_; }
+
+private:
+    LightClusters clusters_;
+    // the projection the cluster bounds were built for
+    float fovY_ = 0.0f;
+    float aspect_ = 0.0f;
+    float near_ = 0.0f;
+    float far_ = 0.0f;
+
+    LightsBlock block_;
+    std::unique_ptr<UniformRing> lightRing_;
+    GLuint gridTexture_;
+    GLuint indexTexture_;
+};
+
+#endif //ANDROIDGLINVESTIGATIONS_CLUSTEREDLIGHTING_H
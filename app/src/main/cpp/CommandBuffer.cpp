@@ -0,0 +1,187 @@
+#include "CommandBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr uint64_t kStateMask = (1ull << 12) - 1;
+constexpr uint64_t kDepthMask = (1ull << 24) - 1;
+
+// bound state is unknown at the start of a submit
+constexpr uint32_t kUnbound = ~0u;
+
+constexpr int kDigitBits = 8;
+constexpr int kDigitCount = 64 / kDigitBits;
+constexpr size_t kBuckets = 1u << kDigitBits;
+
+} // namespace
+
+uint64_t CommandBuffer::makeKey(RenderPass pass, uint32_t program, uint32_t vertexArray,
+                                uint32_t texture, float depth) {
+    uint64_t quantized = static_cast<uint64_t>(std::clamp(depth, 0.0f, 1.0f) * float(kDepthMask));
+    uint64_t state = (uint64_t(program) & kStateMask) << 24
+                     | (uint64_t(vertexArray) & kStateMask) << 12
+                     | (uint64_t(texture) & kStateMask);
+    uint64_t key = uint64_t(pass) << 60;
+    if (pass == RenderPass::Transparent) {
+        // blending needs back to front before anything else
+        key |= (kDepthMask - quantized) << 36 | state;
+    } else {
+        key |= state << 24 | quantized;
+    }
+    return key;
+}
+
+UniformValue &CommandBuffer::pushUniform(int32_t location, UniformValue::Type type) {
+    pendingUniforms_++;
+    uniforms_.push_back({location, type, {}});
+    return uniforms_.back();
+}
+
+void CommandBuffer::uniform(int32_t location, float value) {
+    pushUniform(location, UniformValue::Type::Float).data[0] = value;
+}
+
+void CommandBuffer::uniform(int32_t location, const glm::vec3 &value) {
+    memcpy(pushUniform(location, UniformValue::Type::Vec3).data, &value, sizeof(value));
+}
+
+void CommandBuffer::uniform(int32_t location, const glm::vec4 &value) {
+    memcpy(pushUniform(location, UniformValue::Type::Vec4).data, &value, sizeof(value));
+}
+
+void CommandBuffer::uniform(int32_t location, const glm::mat4 &value) {
+    memcpy(pushUniform(location, UniformValue::Type::Mat4).data, &value, sizeof(value));
+}
+
+void CommandBuffer::draw(RenderPass pass, float depth, const DrawCommand &command) {
+    DrawCommand recorded = command;
+    recorded.firstUniform = static_cast<uint32_t>(uniforms_.size() - pendingUniforms_);
+    recorded.uniformCount = pendingUniforms_;
+    pendingUniforms_ = 0;
+
+    order_.push_back(static_cast<uint32_t>(commands_.size()));
+    keys_.push_back(makeKey(pass, command.program, command.vertexArray, command.texture, depth));
+    commands_.push_back(recorded);
+}
+
+void CommandBuffer::submit(CommandBackend &backend) {
+    radixSort(keys_, order_, keyScratch_, orderScratch_);
+
+    stats_ = Stats();
+    uint32_t program = kUnbound;
+    uint32_t vertexArray = kUnbound;
+    uint32_t texture = kUnbound;
+    for (uint32_t index: order_) {
+        const DrawCommand &command = commands_[index];
+        if (command.program != program) {
+            program = command.program;
+            backend.bindProgram(program);
+            stats_.programBinds++;
+        }
+        if (command.vertexArray != vertexArray) {
+            vertexArray = command.vertexArray;
+            backend.bindVertexArray(vertexArray);
+            stats_.vertexArrayBinds++;
+        }
+        if (command.texture != texture) {
+            texture = command.texture;
+            backend.bindTexture(texture);
+            stats_.textureBinds++;
+        }
+        for (uint32_t i = 0; i < command.uniformCount; i++) {
+            backend.setUniform(uniforms_[command.firstUniform + i]);
+        }
+        backend.draw(command);
+        stats_.draws++;
+    }
+    clear();
+}
+
+void CommandBuffer::clear() {
+    commands_.clear();
+    keys_.clear();
+    order_.clear();
+    uniforms_.clear();
+    pendingUniforms_ = 0;
+}
+
+void CommandBuffer::radixSort(std::vector<uint64_t> &keys, std::vector<uint32_t> &indices,
+                              std::vector<uint64_t> &keyScratch,
+                              std::vector<uint32_t> &indexScratch) {
+    const size_t count = keys.size();
+    if (count < 2) {
+        return;
+    }
+
+    // one pass over the keys builds the histogram of every digit
+    size_t histograms[kDigitCount][kBuckets] = {};
+    for (uint64_t key: keys) {
+        for (int digit = 0; digit < kDigitCount; digit++) {
+            histograms[digit][(key >> (digit * kDigitBits)) & (kBuckets - 1)]++;
+        }
+    }
+
+    keyScratch.resize(count);
+    indexScratch.resize(count);
+    uint64_t *keysIn = keys.data();
+    uint64_t *keysOut = keyScratch.data();
+    uint32_t *indicesIn = indices.data();
+    uint32_t *indicesOut = indexScratch.data();
+
+    for (int digit = 0; digit < kDigitCount; digit++) {
+        size_t *histogram = histograms[digit];
+        const int shift = digit * kDigitBits;
+        // every key shares this digit, the pass wouldn't move anything
+        if (histogram[(keysIn[0] >> shift) & (kBuckets - 1)] == count) {
+            continue;
+        }
+
+        size_t offsets[kBuckets];
+        size_t sum = 0;
+        for (size_t bucket = 0; bucket < kBuckets; bucket++) {
+            offsets[bucket] = sum;
+            sum += histogram[bucket];
+        }
+        for (size_t i = 0; i < count; i++) {
+            size_t slot = offsets[(keysIn[i] >> shift) & (kBuckets - 1)]++;
+            keysOut[slot] = keysIn[i];
+            indicesOut[slot] = indicesIn[i];
+        }
+        std::swap(keysIn, keysOut);
+        std::swap(indicesIn, indicesOut);
+    }
+
+    // an odd number of passes leaves the result in the scratch buffers
+    if (keysIn != keys.data()) {
+        keys.swap(keyScratch);
+        indices.swap(indexScratch);
+    }
+}
+
+void RecordingCommandBackend::bindProgram(uint32_t program) {
+    records_.push_back({Call::BindProgram, program});
+}
+
+void RecordingCommandBackend::bindVertexArray(uint32_t vertexArray) {
+    records_.push_back({Call::BindVertexArray, vertexArray});
+}
+
+void RecordingCommandBackend::bindTexture(uint32_t texture) {
+    records_.push_back({Call::BindTexture, texture});
+}
+
+void RecordingCommandBackend::setUniform(const UniformValue &value) {
+    records_.push_back({Call::SetUniform, static_cast<uint32_t>(value.location)});
+}
+
+void RecordingCommandBackend::draw(const DrawCommand &command) {
+    records_.push_back({Call::Draw, command.program});
+    draws_.push_back(command);
+}
+
+void RecordingCommandBackend::clear() {
+    records_.clear();
+    draws_.clear();
+}
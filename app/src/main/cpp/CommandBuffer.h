@@ -0,0 +1,196 @@
+#ifndef ANDROIDGLINVESTIGATIONS_COMMANDBUFFER_H
+#define ANDROIDGLINVESTIGATIONS_COMMANDBUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+/*!
+ * Passes run in this order. Within Opaque and Emissive draws are grouped by state and go front to
+ * back, Transparent draws go back to front.
+ */
+enum class RenderPass : uint8_t {
+    Opaque,
+    Emissive,
+    Transparent,
+};
+
+/*!
+ * A uniform value recorded with a draw. @a type says how many floats of @a data are used.
+ */
+struct UniformValue {
+    enum class Type : uint8_t {
+        Float,
+        Vec3,
+        Vec4,
+        Mat4,
+    };
+
+    int32_t location;
+    Type type;
+    float data[16];
+};
+
+/*!
+ * One indexed draw, plain data so recording is a copy. GL objects are stored by name, which keeps
+ * this header free of GL so the sorting can be exercised on a host.
+ */
+struct DrawCommand {
+    uint32_t program;
+    uint32_t vertexArray;
+    uint32_t texture;
+    // GL primitive mode and index type
+    uint32_t mode;
+    uint32_t indexType;
+    int32_t indexCount;
+    // 1 for a plain draw
+    int32_t instanceCount;
+    // range in the buffer's uniform list set before this draw
+    uint32_t firstUniform;
+    uint32_t uniformCount;
+};
+
+/*!
+ * Executes sorted commands. The command buffer only forwards state that actually changes, so a
+ * backend binds exactly what it's told.
+ */
+class CommandBackend {
+public:
+    virtual ~CommandBackend() = default;
+
+    virtual void bindProgram(uint32_t program) = 0;
+
+    virtual void bindVertexArray(uint32_t vertexArray) = 0;
+
+    virtual void bindTexture(uint32_t texture) = 0;
+
+    virtual void setUniform(const UniformValue &value) = 0;
+
+    virtual void draw(const DrawCommand &command) = 0;
+};
+
+/*!
+ * Draws recorded over a frame with a 64 bit sort key each, radix sorted and replayed through a
+ * CommandBackend with redundant program, VAO and texture binds dropped.
+ *
+ * Key layout, most significant first:
+ *  opaque/emissive: pass:4 program:12 vertexArray:12 texture:12 depth:24
+ *  transparent:     pass:4 inverted depth:24 program:12 vertexArray:12 texture:12
+ * GL names are truncated to 12 bits, which at worst splits a state group.
+ */
+class CommandBuffer {
+public:
+    struct Stats {
+        size_t draws = 0;
+        size_t programBinds = 0;
+        size_t vertexArrayBinds = 0;
+        size_t textureBinds = 0;
+    };
+
+    /*!
+     * @param depth the draw's depth in [0, 1], 0 nearest, e.g. its center in normalized device
+     * depth. Clamped.
+     */
+    static uint64_t makeKey(RenderPass pass, uint32_t program, uint32_t vertexArray,
+                            uint32_t texture, float depth);
+
+    /*!
+     * Records a uniform for the next @a draw. Uniforms are set right before the draw they were
+     * recorded for, after its program is bound.
+     */
+    void uniform(int32_t location, float value);
+
+    void uniform(int32_t location, const glm::vec3 &value);
+
+    void uniform(int32_t location, const glm::vec4 &value);
+
+    void uniform(int32_t location, const glm::mat4 &value);
+
+    /*!
+     * Records a draw, taking the uniforms recorded since the last one
+     */
+    void draw(RenderPass pass, float depth, const DrawCommand &command);
+
+    /*!
+     * Sorts everything recorded and plays it into @a backend, then empties the buffer
+     */
+    void submit(CommandBackend &backend);
+
+    /*!
+     * Drops everything recorded without executing it
+     */
+    void clear();
+
+    inline size_t size() const { return commands_.size(); }
+
+    /*!
+     * @return what the last @a submit executed
+     */
+    inline const Stats &getStats() const { return stats_; }
+
+    /*!
+     * LSD radix sort of @a keys, 8 bits per pass, skipping passes where every key has the same
+     * digit. @a indices is permuted along with the keys. Stable.
+     */
+    static void radixSort(std::vector<uint64_t> &keys, std::vector<uint32_t> &indices,
+                          std::vector<uint64_t> &keyScratch, std::vector<uint32_t> &indexScratch);
+
+private:
+    UniformValue &pushUniform(int32_t location, UniformValue::Type type);
+
+    std::vector<DrawCommand> commands_;
+    std::vector<uint64_t> keys_;
+    std::vector<uint32_t> order_;
+    std::vector<UniformValue> uniforms_;
+    uint32_t pendingUniforms_ = 0;
+
+    // sort scratch, kept to avoid reallocating every frame
+    std::vector<uint64_t> keyScratch_;
+    std::vector<uint32_t> orderScratch_;
+
+    Stats stats_;
+};
+
+/*!
+ * A backend that executes nothing and records every call, for checking sort order and state
+ * changes without a GPU
+ */
+class RecordingCommandBackend : public CommandBackend {
+public:
+    enum class Call : uint8_t {
+        BindProgram,
+        BindVertexArray,
+        BindTexture,
+        SetUniform,
+        Draw,
+    };
+
+    struct Record {
+        Call call;
+        // the bound name, the uniform location, or the draw's program
+        uint32_t value;
+    };
+
+    void bindProgram(uint32_t program) override;
+
+    void bindVertexArray(uint32_t vertexArray) override;
+
+    void bindTexture(uint32_t texture) override;
+
+    void setUniform(const UniformValue &value) override;
+
+    void draw(const DrawCommand &command) override;
+
+    inline const std::vector<Record> &getRecords() const { return records_; }
+
+    inline const std::vector<DrawCommand> &getDraws() const { return draws_; }
+
+    void clear();
+
+private:
+    std::vector<Record> records_;
+    std::vector<DrawCommand> draws_;
+};
+
+#endif //ANDROIDGLINVESTIGATIONS_COMMANDBUFFER_H
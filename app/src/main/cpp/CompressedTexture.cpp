@@ -0,0 +1,147 @@
+#include "CompressedTexture.h"
+
+#include <cassert>
+#include <cstring>
+#include <GLES2/gl2ext.h>
+
+#include "AndroidOut.h"
+
+static_assert(sizeof(Ktx2Header) == 80, "the header layout is part of the file format");
+static_assert(sizeof(Ktx2Level) == 24, "the level index layout is part of the file format");
+
+namespace {
+
+const CompressedTexture::Format kFormats[] = {
+        {CompressedTexture::kEtc2Rgb8, GL_COMPRESSED_RGB8_ETC2, 4, 4, 8, false, false},
+        {CompressedTexture::kEtc2Rgb8Srgb, GL_COMPRESSED_SRGB8_ETC2, 4, 4, 8, true, false},
+        {CompressedTexture::kEtc2Rgba8, GL_COMPRESSED_RGBA8_ETC2_EAC, 4, 4, 16, false, false},
+        {CompressedTexture::kEtc2Rgba8Srgb, GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC, 4, 4, 16, true, false},
+        {CompressedTexture::kAstc4x4, GL_COMPRESSED_RGBA_ASTC_4x4_KHR, 4, 4, 16, false, true},
+        {CompressedTexture::kAstc4x4Srgb, GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR, 4, 4, 16, true, true},
+        {CompressedTexture::kAstc6x6, GL_COMPRESSED_RGBA_ASTC_6x6_KHR, 6, 6, 16, false, true},
+        {CompressedTexture::kAstc6x6Srgb, GL_COMPRESSED_SRGB8_ALPHA8_ASTC_6x6_KHR, 6, 6, 16, true, true},
+        {CompressedTexture::kAstc8x8, GL_COMPRESSED_RGBA_ASTC_8x8_KHR, 8, 8, 16, false, true},
+        {CompressedTexture::kAstc8x8Srgb, GL_COMPRESSED_SRGB8_ALPHA8_ASTC_8x8_KHR, 8, 8, 16, true, true},
+};
+
+constexpr char kExtension[] = ".ktx2";
+
+bool hasGlExtension(const char *name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        const auto *extension = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+        if (extension && strcmp(extension, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+const CompressedTexture::Format *CompressedTexture::findFormat(uint32_t vkFormat) {
+    for (const auto &format: kFormats) {
+        if (format.vkFormat == vkFormat) {
+            return &format;
+        }
+    }
+    return nullptr;
+}
+
+bool CompressedTexture::isCompressedPath(const std::string &path) {
+    const size_t length = sizeof(kExtension) - 1;
+    return path.size() > length && path.compare(path.size() - length, length, kExtension) == 0;
+}
+
+CompressedTexture::CompressedTexture() : format_(nullptr), width_(0), height_(0) {}
+
+CompressedTexture::CompressedTexture(std::string_view file)
+        : CompressedTexture() {
+    // the file may come from a plain read, so nothing in it is assumed to be aligned
+    Ktx2Header header{};
+    if (file.size() < sizeof(header)) {
+        return;
+    }
+    memcpy(&header, file.data(), sizeof(header));
+    const Format *format = findFormat(header.vkFormat);
+    if (memcmp(header.identifier, kIdentifier, sizeof(kIdentifier)) != 0 || !format
+        || header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth != 0
+        || header.layerCount > 1 || header.faceCount != 1 || header.supercompressionScheme != 0
+        || header.levelCount == 0 || header.levelCount > 32
+        || (header.pixelWidth | header.pixelHeight) >> (header.levelCount - 1) == 0) {
+        // a level count of 0 asks for the mips to be generated on load, which this doesn't do
+        aout << "Not a KTX2 texture this can load" << std::endl;
+        return;
+    }
+    if (file.size() < sizeof(header) + header.levelCount * sizeof(Ktx2Level)) {
+        aout << "Truncated KTX2 level index" << std::endl;
+        return;
+    }
+
+    width_ = header.pixelWidth;
+    height_ = header.pixelHeight;
+    format_ = format;
+    levels_.resize(header.levelCount);
+    for (uint32_t level = 0; level < header.levelCount; level++) {
+        Ktx2Level index{};
+        memcpy(&index, file.data() + sizeof(header) + level * sizeof(index), sizeof(index));
+        if (index.byteOffset > file.size() || index.byteLength > file.size() - index.byteOffset
+            || index.byteLength != expectedSize(level)) {
+            aout << "KTX2 level " << level << " is out of bounds or the wrong size" << std::endl;
+            format_ = nullptr;
+            levels_.clear();
+            return;
+        }
+        levels_[level] = file.substr(index.byteOffset, index.byteLength);
+    }
+}
+
+bool CompressedTexture::isSupported() const {
+    assert(isValid());
+    if (!format_->astc) {
+        // part of GLES 3.0
+        return true;
+    }
+    static const bool astc = hasGlExtension("GL_KHR_texture_compression_astc_ldr");
+    return astc;
+}
+
+uint32_t CompressedTexture::getBlockRows(uint32_t level) const {
+    return (getLevelHeight(level) + format_->blockHeight - 1) / format_->blockHeight;
+}
+
+size_t CompressedTexture::getBlockRowSize(uint32_t level) const {
+    return size_t((getLevelWidth(level) + format_->blockWidth - 1) / format_->blockWidth) * format_->blockBytes;
+}
+
+size_t CompressedTexture::expectedSize(uint32_t level) const {
+    return getBlockRowSize(level) * getBlockRows(level);
+}
+
+GLuint CompressedTexture::upload() const {
+    assert(isValid());
+    if (!isSupported()) {
+        return 0;
+    }
+
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                    levels_.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    // the chain comes precomputed, so no glGenerateMipmap, which can't work on compressed data anyway
+    const auto levelCount = static_cast<GLsizei>(levels_.size());
+    glTexStorage2D(GL_TEXTURE_2D, levelCount, format_->glFormat, width_, height_);
+    for (GLint level = 0; level < levelCount; level++) {
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, getLevelWidth(level), getLevelHeight(level),
+                                  format_->glFormat, static_cast<GLsizei>(levels_[level].size()),
+                                  levels_[level].data());
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
@@ -0,0 +1,160 @@
+#ifndef ANDROIDGLINVESTIGATIONS_COMPRESSEDTEXTURE_H
+#define ANDROIDGLINVESTIGATIONS_COMPRESSEDTEXTURE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <GLES3/gl3.h>
+
+/*!
+ * Starts a KTX2 file. Everything is little endian, at the offsets given here:
+ *
+ *  header                  Ktx2Header, at 0
+ *  level index             levelCount Ktx2Level, at 80, level 0 first
+ *  data format descriptor  at dfdByteOffset, read by other tools, ignored here
+ *  key/value data          at kvdByteOffset, ignored here
+ *  levels                  the blocks of each level, smallest level first
+ *
+ * See the KTX 2.0 specification for the rest. Only the part texture_encoder writes is read: one
+ * 2D image with no array layers, faces or supercompression, in one of the formats in the table in
+ * CompressedTexture.cpp.
+ */
+struct Ktx2Header {
+    uint8_t identifier[12];
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+
+struct Ktx2Level {
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+/*!
+ * A block compressed texture with its whole mip chain, read in place from a KTX2 file. The blocks
+ * go to GL exactly as they are stored, there is no decoding on the device. tools/TextureEncoder.cpp
+ * makes these from PNGs.
+ *
+ * ETC2 is core in GLES 3.0, so those files load everywhere. ASTC needs
+ * GL_KHR_texture_compression_astc_ldr, see @a isSupported.
+ */
+class CompressedTexture {
+public:
+    // the formats are identified by their VkFormat, as KTX2 does
+    static constexpr uint32_t kEtc2Rgb8 = 147;
+    static constexpr uint32_t kEtc2Rgb8Srgb = 148;
+    static constexpr uint32_t kEtc2Rgba8 = 151;
+    static constexpr uint32_t kEtc2Rgba8Srgb = 152;
+    static constexpr uint32_t kAstc4x4 = 157;
+    static constexpr uint32_t kAstc4x4Srgb = 158;
+    static constexpr uint32_t kAstc6x6 = 165;
+    static constexpr uint32_t kAstc6x6Srgb = 166;
+    static constexpr uint32_t kAstc8x8 = 171;
+    static constexpr uint32_t kAstc8x8Srgb = 172;
+
+    static constexpr uint8_t kIdentifier[12] = {0xab, 'K', 'T', 'X', ' ', '2', '0', 0xbb, '\r', '\n', 0x1a, '\n'};
+
+    struct Format {
+        uint32_t vkFormat;
+        GLenum glFormat;
+        uint32_t blockWidth;
+        uint32_t blockHeight;
+        uint32_t blockBytes;
+        bool srgb;
+        bool astc;
+    };
+
+    /*!
+     * @return the format for @a vkFormat, or null if it's not one this reads
+     */
+    static const Format *findFormat(uint32_t vkFormat);
+
+    /*!
+     * @return true if @a path names a KTX2 file, which is loaded with this rather than decoded
+     */
+    static bool isCompressedPath(const std::string &path);
+
+    /*!
+     * An invalid texture, with no levels
+     */
+    CompressedTexture();
+
+    /*!
+     * Reads the file in @a file, which must outlive this. Only looks at the header and level
+     * index, the levels are views into @a file.
+     */
+    explicit CompressedTexture(std::string_view file);
+
+    /*!
+     * @return false if @a file wasn't a KTX2 file this understands
+     */
+    inline bool isValid() const { return format_ != nullptr; }
+
+    /*!
+     * Needs a current context
+     * @return true if the GPU can sample the format
+     */
+    bool isSupported() const;
+
+    inline const Format &getFormat() const { return *format_; }
+
+    inline uint32_t getWidth() const { return width_; }
+
+    inline uint32_t getHeight() const { return height_; }
+
+    inline uint32_t getLevelCount() const { return static_cast<uint32_t>(levels_.size()); }
+
+    inline uint32_t getLevelWidth(uint32_t level) const { return std::max<uint32_t>(width_ >> level, 1); }
+
+    inline uint32_t getLevelHeight(uint32_t level) const { return std::max<uint32_t>(height_ >> level, 1); }
+
+    /*!
+     * @return the blocks of @a level, rows of blocks top row first
+     */
+    inline std::string_view getLevel(uint32_t level) const { return levels_[level]; }
+
+    /*!
+     * @return how many rows of blocks @a level has
+     */
+    uint32_t getBlockRows(uint32_t level) const;
+
+    /*!
+     * @return the bytes in one row of blocks of @a level
+     */
+    size_t getBlockRowSize(uint32_t level) const;
+
+    /*!
+     * Creates a texture with immutable storage and uploads every level. Needs a current context.
+     * @return the texture, or 0 if the format isn't supported
+     */
+    GLuint upload() const;
+
+private:
+    /*!
+     * @return the bytes @a level must have at this texture's size and format
+     */
+    size_t expectedSize(uint32_t level) const;
+
+    const Format *format_;
+    uint32_t width_;
+    uint32_t height_;
+    std::vector<std::string_view> levels_;
+};
+
+#endif //ANDROIDGLINVESTIGATIONS_COMPRESSEDTEXTURE_H
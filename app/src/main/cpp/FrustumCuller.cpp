@@ -0,0 +1,243 @@
+#include "FrustumCuller.h"
+
+#include <cmath>
+
+#if GLM_ARCH & GLM_ARCH_AVX_BIT
+#include <immintrin.h>
+#endif
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+#include <glm/simd/common.h>
+#elif GLM_ARCH & GLM_ARCH_NEON_BIT
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// boxes are processed in blocks this size, the storage is padded to match
+constexpr size_t kBlock = 8;
+
+// padding boxes sit here with no extent, far outside any sane frustum
+constexpr float kFarAway = 1e30f;
+
+/*!
+ * @return a mask of the lanes in the block starting at @a first that hold real boxes, so padding
+ * never ends up in the visible list. 4 wide paths step past @a count into the padding, those
+ * blocks get no lanes at all.
+ */
+inline unsigned laneLimit(size_t count, size_t first) {
+    size_t remaining = first >= count ? 0 : count - first;
+    return remaining >= kBlock ? ~0u : (1u << remaining) - 1u;
+}
+
+} // namespace
+
+Frustum Frustum::fromMatrix(const glm::mat4 &m) {
+    // Gribb & Hartmann: each plane is the last row of the matrix plus or minus another row
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    Frustum frustum;
+    frustum.planes[kLeft] = row3 + row0;
+    frustum.planes[kRight] = row3 - row0;
+    frustum.planes[kBottom] = row3 + row1;
+    frustum.planes[kTop] = row3 - row1;
+    frustum.planes[kNear] = row3 + row2;
+    frustum.planes[kFar] = row3 - row2;
+    for (auto &plane: frustum.planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    return frustum;
+}
+
+uint32_t BoundingBoxes::add(const glm::vec3 &center, const glm::vec3 &extents) {
+    auto index = static_cast<uint32_t>(count_++);
+    pad();
+    set(index, center, extents);
+    return index;
+}
+
+void BoundingBoxes::set(uint32_t index, const glm::vec3 &center, const glm::vec3 &extents) {
+    centerX_[index] = center.x;
+    centerY_[index] = center.y;
+    centerZ_[index] = center.z;
+    extentX_[index] = extents.x;
+    extentY_[index] = extents.y;
+    extentZ_[index] = extents.z;
+}
+
+void BoundingBoxes::clear() {
+    count_ = 0;
+    centerX_.clear();
+    centerY_.clear();
+    centerZ_.clear();
+    extentX_.clear();
+    extentY_.clear();
+    extentZ_.clear();
+}
+
+void BoundingBoxes::pad() {
+    size_t padded = (count_ + kBlock - 1) / kBlock * kBlock;
+    if (padded == centerX_.size()) {
+        return;
+    }
+    centerX_.resize(padded, kFarAway);
+    centerY_.resize(padded, kFarAway);
+    centerZ_.resize(padded, kFarAway);
+    extentX_.resize(padded, 0.0f);
+    extentY_.resize(padded, 0.0f);
+    extentZ_.resize(padded, 0.0f);
+}
+
+void BoundingBoxes::transform(const glm::mat4 &model, const glm::vec3 &center,
+                              const glm::vec3 &extents, glm::vec3 &worldCenter,
+                              glm::vec3 &worldExtents) {
+    worldCenter = glm::vec3(model * glm::vec4(center, 1.0f));
+    // Arvo: the new extents are the old ones through the absolute value of the linear part
+    glm::mat3 linear(model);
+    worldExtents = glm::abs(linear[0]) * extents.x
+                   + glm::abs(linear[1]) * extents.y
+                   + glm::abs(linear[2]) * extents.z;
+}
+
+size_t FrustumCuller::cullScalar(const Frustum &frustum, const BoundingBoxes &boxes,
+                                 uint32_t *visible) {
+    size_t written = 0;
+    for (size_t i = 0; i < boxes.count_; i++) {
+        bool inside = true;
+        for (const auto &plane: frustum.planes) {
+            float distance = plane.x * boxes.centerX_[i] + plane.y * boxes.centerY_[i]
+                             + plane.z * boxes.centerZ_[i] + plane.w;
+            float radius = std::abs(plane.x) * boxes.extentX_[i]
+                           + std::abs(plane.y) * boxes.extentY_[i]
+                           + std::abs(plane.z) * boxes.extentZ_[i];
+            if (distance + radius < 0.0f) {
+                inside = false;
+                break;
+            }
+        }
+        visible[written] = static_cast<uint32_t>(i);
+        written += inside;
+    }
+    return written;
+}
+
+size_t FrustumCuller::cull(const Frustum &frustum, const BoundingBoxes &boxes, uint32_t *visible) {
+    const size_t count = boxes.count_;
+    const size_t padded = boxes.centerX_.size();
+    const float *cx = boxes.centerX_.data();
+    const float *cy = boxes.centerY_.data();
+    const float *cz = boxes.centerZ_.data();
+    const float *ex = boxes.extentX_.data();
+    const float *ey = boxes.extentY_.data();
+    const float *ez = boxes.extentZ_.data();
+    size_t written = 0;
+
+    // a box is outside if it's fully behind any plane: distance + projected radius < 0. Each
+    // lane of the mask collects that over all six planes, then visible lanes are compacted out.
+#if GLM_ARCH & GLM_ARCH_AVX_BIT
+    __m256 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+    for (int p = 0; p < 6; p++) {
+        const glm::vec4 &plane = frustum.planes[p];
+        planeX[p] = _mm256_set1_ps(plane.x);
+        planeY[p] = _mm256_set1_ps(plane.y);
+        planeZ[p] = _mm256_set1_ps(plane.z);
+        planeW[p] = _mm256_set1_ps(plane.w);
+        absX[p] = _mm256_set1_ps(std::abs(plane.x));
+        absY[p] = _mm256_set1_ps(std::abs(plane.y));
+        absZ[p] = _mm256_set1_ps(std::abs(plane.z));
+    }
+    const __m256 zero = _mm256_setzero_ps();
+    for (size_t i = 0; i < padded; i += 8) {
+        __m256 x = _mm256_loadu_ps(cx + i), y = _mm256_loadu_ps(cy + i), z = _mm256_loadu_ps(cz + i);
+        __m256 rx = _mm256_loadu_ps(ex + i), ry = _mm256_loadu_ps(ey + i), rz = _mm256_loadu_ps(ez + i);
+        __m256 outside = _mm256_setzero_ps();
+        for (int p = 0; p < 6; p++) {
+            __m256 distance = _mm256_add_ps(
+                    _mm256_add_ps(_mm256_mul_ps(planeX[p], x), _mm256_mul_ps(planeY[p], y)),
+                    _mm256_add_ps(_mm256_mul_ps(planeZ[p], z), planeW[p]));
+            __m256 radius = _mm256_add_ps(
+                    _mm256_add_ps(_mm256_mul_ps(absX[p], rx), _mm256_mul_ps(absY[p], ry)),
+                    _mm256_mul_ps(absZ[p], rz));
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_LT_OQ));
+        }
+        unsigned mask = ~static_cast<unsigned>(_mm256_movemask_ps(outside)) & 0xffu & laneLimit(count, i);
+        while (mask) {
+            unsigned lane = __builtin_ctz(mask);
+            visible[written++] = static_cast<uint32_t>(i + lane);
+            mask &= mask - 1;
+        }
+    }
+#elif GLM_ARCH & GLM_ARCH_SSE2_BIT
+    glm_vec4 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+    for (int p = 0; p < 6; p++) {
+        const glm::vec4 &plane = frustum.planes[p];
+        planeX[p] = _mm_set1_ps(plane.x);
+        planeY[p] = _mm_set1_ps(plane.y);
+        planeZ[p] = _mm_set1_ps(plane.z);
+        planeW[p] = _mm_set1_ps(plane.w);
+        absX[p] = glm_vec4_abs(planeX[p]);
+        absY[p] = glm_vec4_abs(planeY[p]);
+        absZ[p] = glm_vec4_abs(planeZ[p]);
+    }
+    const glm_vec4 zero = _mm_setzero_ps();
+    for (size_t i = 0; i < padded; i += 4) {
+        glm_vec4 x = _mm_loadu_ps(cx + i), y = _mm_loadu_ps(cy + i), z = _mm_loadu_ps(cz + i);
+        glm_vec4 rx = _mm_loadu_ps(ex + i), ry = _mm_loadu_ps(ey + i), rz = _mm_loadu_ps(ez + i);
+        glm_vec4 outside = _mm_setzero_ps();
+        for (int p = 0; p < 6; p++) {
+            glm_vec4 distance = glm_vec4_fma(planeX[p], x, glm_vec4_fma(planeY[p], y,
+                                             glm_vec4_fma(planeZ[p], z, planeW[p])));
+            glm_vec4 reach = glm_vec4_fma(absX[p], rx, glm_vec4_fma(absY[p], ry,
+                                          glm_vec4_fma(absZ[p], rz, distance)));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(reach, zero));
+        }
+        unsigned mask = ~static_cast<unsigned>(_mm_movemask_ps(outside)) & 0xfu & laneLimit(count, i);
+        while (mask) {
+            unsigned lane = __builtin_ctz(mask);
+            visible[written++] = static_cast<uint32_t>(i + lane);
+            mask &= mask - 1;
+        }
+    }
+#elif GLM_ARCH & GLM_ARCH_NEON_BIT
+    float32x4_t planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+    for (int p = 0; p < 6; p++) {
+        const glm::vec4 &plane = frustum.planes[p];
+        planeX[p] = vdupq_n_f32(plane.x);
+        planeY[p] = vdupq_n_f32(plane.y);
+        planeZ[p] = vdupq_n_f32(plane.z);
+        planeW[p] = vdupq_n_f32(plane.w);
+        absX[p] = vabsq_f32(planeX[p]);
+        absY[p] = vabsq_f32(planeY[p]);
+        absZ[p] = vabsq_f32(planeZ[p]);
+    }
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const uint32x4_t laneBits = {1, 2, 4, 8};
+    for (size_t i = 0; i < padded; i += 4) {
+        float32x4_t x = vld1q_f32(cx + i), y = vld1q_f32(cy + i), z = vld1q_f32(cz + i);
+        float32x4_t rx = vld1q_f32(ex + i), ry = vld1q_f32(ey + i), rz = vld1q_f32(ez + i);
+        uint32x4_t outside = vdupq_n_u32(0);
+        for (int p = 0; p < 6; p++) {
+            float32x4_t distance = vmlaq_f32(vmlaq_f32(vmlaq_f32(planeW[p], planeZ[p], z), planeY[p], y), planeX[p], x);
+            float32x4_t reach = vmlaq_f32(vmlaq_f32(vmlaq_f32(distance, absZ[p], rz), absY[p], ry), absX[p], rx);
+            outside = vorrq_u32(outside, vcltq_f32(reach, zero));
+        }
+        // NEON has no movemask, fold the lanes into a 4 bit mask by hand
+        uint32x4_t bits = vandq_u32(vmvnq_u32(outside), laneBits);
+        uint32x2_t folded = vorr_u32(vget_low_u32(bits), vget_high_u32(bits));
+        unsigned mask = (vget_lane_u32(folded, 0) | vget_lane_u32(folded, 1)) & laneLimit(count, i);
+        while (mask) {
+            unsigned lane = __builtin_ctz(mask);
+            visible[written++] = static_cast<uint32_t>(i + lane);
+            mask &= mask - 1;
+        }
+    }
+#else
+    (void) count;
+    (void) padded;
+    (void) cx; (void) cy; (void) cz; (void) ex; (void) ey; (void) ez;
+    written = cullScalar(frustum, boxes, visible);
+#endif
+    return written;
+}
@@ -0,0 +1,77 @@
+#ifndef ANDROIDGLINVESTIGATIONS_FRUSTUMCULLER_H
+#define ANDROIDGLINVESTIGATIONS_FRUSTUMCULLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+/*!
+ * The six planes of a view frustum, pointing inwards. A point p is inside a plane when
+ * dot(plane.xyz, p) + plane.w >= 0.
+ */
+struct Frustum {
+    enum Plane {
+        kLeft, kRight, kBottom, kTop, kNear, kFar, kPlaneCount
+    };
+
+    glm::vec4 planes[kPlaneCount];
+
+    /*!
+     * Extracts the planes from a view-projection matrix as built by glm::perspective and
+     * glm::lookAt (GL clip space, z from -w to w). Planes come out normalized.
+     */
+    static Frustum fromMatrix(const glm::mat4 &viewProjection);
+};
+
+/*!
+ * Axis aligned boxes stored as structure of arrays, so four or eight of them can be tested against
+ * a plane with one set of SIMD instructions. The arrays are padded to a multiple of eight with
+ * empty boxes far outside any frustum.
+ */
+class BoundingBoxes {
+public:
+    /*!
+     * @return the index of the new box
+     */
+    uint32_t add(const glm::vec3 &center, const glm::vec3 &extents);
+
+    void set(uint32_t index, const glm::vec3 &center, const glm::vec3 &extents);
+
+    void clear();
+
+    inline size_t size() const { return count_; }
+
+    /*!
+     * Bounds of a box transformed by @a model, given its bounds in model space
+     */
+    static void transform(const glm::mat4 &model, const glm::vec3 &center, const glm::vec3 &extents,
+                          glm::vec3 &worldCenter, glm::vec3 &worldExtents);
+
+private:
+    friend class FrustumCuller;
+
+    void pad();
+
+    std::vector<float> centerX_, centerY_, centerZ_;
+    std::vector<float> extentX_, extentY_, extentZ_;
+    size_t count_ = 0;
+};
+
+class FrustumCuller {
+public:
+    /*!
+     * Tests every box against @a frustum with the widest SIMD available (AVX, SSE or NEON).
+     * @param visible receives the indices of the boxes that intersect the frustum, in order. Must
+     * have room for boxes.size() entries.
+     * @return how many indices were written to @a visible
+     */
+    static size_t cull(const Frustum &frustum, const BoundingBoxes &boxes, uint32_t *visible);
+
+    /*!
+     * Scalar reference version of @a cull
+     */
+    static size_t cullScalar(const Frustum &frustum, const BoundingBoxes &boxes, uint32_t *visible);
+};
+
+#endif //ANDROIDGLINVESTIGATIONS_FRUSTUMCULLER_H
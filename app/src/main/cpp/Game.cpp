@@ -0,0 +1,155 @@
+#include "Game.h"
+
+#include <algorithm>
+#include <jni.h>
+
+#include <game-activity/native_app_glue/android_native_app_glue.h>
+
+#include "AndroidImageDecoder.h"
+#include "AndroidOut.h"
+#include "Profiler.h"
+#include "Renderer.h"
+
+namespace {
+
+/*!
+ * @return the app's cache directory from Context.getCacheDir(), or the internal data path if that
+ * can't be had. The system may clear it when storage runs low, so only put things there that can
+ * be rebuilt.
+ */
+std::string cacheDirectory(android_app *pApp) {
+    GameActivity *activity = pApp->activity;
+    std::string path = activity->internalDataPath;
+
+    // the native app thread isn't attached to the VM unless someone did it already
+    JNIEnv *env = nullptr;
+    bool attached = false;
+    if (activity->vm->GetEnv(reinterpret_cast<void **>(&env), JNI_VERSION_1_6) == JNI_EDETACHED) {
+        if (activity->vm->AttachCurrentThread(&env, nullptr) != JNI_OK) {
+            return path;
+        }
+        attached = true;
+    }
+
+    jclass activityClass = env->GetObjectClass(activity->javaGameActivity);
+    jmethodID getCacheDir = env->GetMethodID(activityClass, "getCacheDir", "()Ljava/io/File;");
+    jobject file = getCacheDir ? env->CallObjectMethod(activity->javaGameActivity, getCacheDir) : nullptr;
+    if (file) {
+        jclass fileClass = env->GetObjectClass(file);
+        jmethodID getPath = env->GetMethodID(fileClass, "getAbsolutePath", "()Ljava/lang/String;");
+        auto string = static_cast<jstring>(env->CallObjectMethod(file, getPath));
+        if (string) {
+            const char *chars = env->GetStringUTFChars(string, nullptr);
+            path = chars;
+            env->ReleaseStringUTFChars(string, chars);
+            env->DeleteLocalRef(string);
+        }
+        env->DeleteLocalRef(fileClass);
+        env->DeleteLocalRef(file);
+    }
+    if (env->ExceptionCheck()) {
+        env->ExceptionClear();
+    }
+    env->DeleteLocalRef(activityClass);
+
+    if (attached) {
+        activity->vm->DetachCurrentThread();
+    }
+    return path;
+}
+
+} // namespace
+
+Game::Game(android_app *pApp)
+        : app_(pApp),
+          assets_(pApp->activity->assetManager),
+          assetPack_(assets_.openPack("assets.pack")),
+          programCacheDirectory_(cacheDirectory(pApp) + "/programs"),
+          renderThread_([this]() {
+              // the APK only carries the pack, loose files are for builds that skipped packAssets
+              if (assetPack_) {
+                  aout << "assets from assets.pack, " << assetPack_->getEntryCount() << " entries" << std::endl;
+              } else {
+                  aout << "assets.pack is missing or invalid, falling back to loose assets" << std::endl;
+              }
+              const AssetLoader &assets = assetPack_ ? static_cast<const AssetLoader &>(*assetPack_) : assets_;
+              auto renderer = std::make_unique<Renderer>(assets, app_->window, programCacheDirectory_);
+              // trade resolution for frame rate once the device heats up
+              renderer->setDynamicResolution(kTargetFps);
+              // textures decode on worker threads and stream in over a few frames
+              renderer->setTextureSource(assets, std::make_unique<AndroidImageDecoder>());
+              return std::unique_ptr<RenderBackend>(std::move(renderer));
+          }) {}
+
+bool Game::update() {
+    PROFILE_SCOPE("simulate");
+    FrameSnapshot *snapshot = renderThread_.beginFrame();
+    if (!snapshot) {
+        return false;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    simulation_.step(*snapshot, std::chrono::duration<float>(now - lastStep_).count());
+    lastStep_ = now;
+    renderThread_.publishFrame();
+    return true;
+}
+
+void Game::handleInput() {
+    PROFILE_SCOPE("handleInput");
+    // handle all queued inputs
+    auto *inputBuffer = android_app_swap_input_buffers(app_);
+    if (!inputBuffer) {
+        // no inputs yet.
+        return;
+    }
+
+    // handle motion events (motionEventsCounts can be 0).
+    for (auto i = 0; i < inputBuffer->motionEventsCount; i++) {
+        auto &motionEvent = inputBuffer->motionEvents[i];
+        auto action = motionEvent.action;
+
+        // Find the pointer index, mask and bitshift to turn it into a readable value.
+        auto pointerIndex = (action & AMOTION_EVENT_ACTION_POINTER_INDEX_MASK)
+                >> AMOTION_EVENT_ACTION_POINTER_INDEX_SHIFT;
+        aout << "Pointer(s): ";
+
+        // get the x and y position of this event if it is not ACTION_MOVE.
+        auto &pointer = motionEvent.pointers[pointerIndex];
+        auto x = GameActivityPointerAxes_getX(&pointer);
+        auto y = GameActivityPointerAxes_getY(&pointer);
+
+        // determine the action type and process the event accordingly.
+        switch (action & AMOTION_EVENT_ACTION_MASK) {
+            case AMOTION_EVENT_ACTION_DOWN:
+            case AMOTION_EVENT_ACTION_POINTER_DOWN:
+                simulation_.setSpeed(0);
+                touchStartTime_ = std::time(nullptr);
+                break;
+            case AMOTION_EVENT_ACTION_UP:
+            case AMOTION_EVENT_ACTION_POINTER_UP:
+                aout << "(" << pointer.id << ", " << x << ", " << y << ") "
+                     << "Pointer Down";
+                break;
+
+            case AMOTION_EVENT_ACTION_MOVE:
+                // There is no pointer index for ACTION_MOVE, only a snapshot of
+                // all active pointers; app needs to cache previous active pointers
+                // to figure out which ones are actually moved.
+                for (auto index = 0; index < motionEvent.pointerCount; index++) {
+                    pointer = motionEvent.pointers[index];
+                    // whole seconds, a swipe inside the first one would divide by zero
+                    auto elapsed = std::max<time_t>(std::time(nullptr) - touchStartTime_, 1);
+                    simulation_.setSpeed((pointer.rawY - y) / elapsed);
+                    if (index != (motionEvent.pointerCount - 1)) aout << ",";
+                    aout << " ";
+                }
+                aout << "Pointer Move";
+                break;
+            default:
+                aout << "Unknown MotionEvent Action: " << action;
+        }
+        aout << std::endl;
+    }
+    // clear the motion input count in this buffer for main thread to re-use.
+    android_app_clear_motion_events(inputBuffer);
+}
@@ -0,0 +1,60 @@
+#ifndef ANDROIDGLINVESTIGATIONS_GAME_H
+#define ANDROIDGLINVESTIGATIONS_GAME_H
+
+#include <chrono>
+#include <ctime>
+#include <memory>
+#include <string>
+
+#include "AndroidAssetLoader.h"
+#include "RenderThread.h"
+#include "Simulation.h"
+
+struct android_app;
+
+/*!
+ * The game thread's side of the app: input and simulation run here on the looper thread, while the
+ * Renderer draws on its own thread from the snapshots this publishes.
+ */
+class Game {
+public:
+    /*!
+     * Starts the render thread, which creates the Renderer for the window of @a pApp
+     */
+    explicit Game(android_app *pApp);
+
+    /*!
+     * Handles input from the android_app.
+     *
+     * Note: this will clear the input queue
+     */
+    void handleInput();
+
+    /*!
+     * Steps the simulation and publishes a frame, if the render thread has a snapshot free
+     * @return false if the render thread is behind and nothing was published
+     */
+    bool update();
+
+private:
+    // the frame rate the Renderer scales its resolution to hold
+    static constexpr float kTargetFps = 60.0f;
+
+    android_app *app_;
+    // read by the Renderer on the render thread while it starts up
+    AndroidAssetLoader assets_;
+    // assets.pack from the APK, built by the packAssets Gradle task. The loose files are only read
+    // if it's missing
+    std::unique_ptr<AssetPack> assetPack_;
+    // linked programs are kept here between launches
+    std::string programCacheDirectory_;
+    Simulation simulation_;
+    // when the simulation last stepped, it advances by the time since
+    std::chrono::steady_clock::time_point lastStep_ = std::chrono::steady_clock::now();
+    // when the current touch started, for the swipe speed
+    time_t touchStartTime_ = 0;
+    // last so it stops, and destroys the Renderer, before anything else goes away
+    RenderThread renderThread_;
+};
+
+#endif //ANDROIDGLINVESTIGATIONS_GAME_H
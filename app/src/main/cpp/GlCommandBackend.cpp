@@ -0,0 +1,42 @@
+#include "GlCommandBackend.h"
+
+#include <GLES3/gl3.h>
+
+void GlCommandBackend::bindProgram(uint32_t program) {
+    glUseProgram(program);
+}
+
+void GlCommandBackend::bindVertexArray(uint32_t vertexArray) {
+    glBindVertexArray(vertexArray);
+}
+
+void GlCommandBackend::bindTexture(uint32_t texture) {
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+void GlCommandBackend::setUniform(const UniformValue &value) {
+    switch (value.type) {
+        case UniformValue::Type::Float:
+            glUniform1f(value.location, value.data[0]);
+            break;
+        case UniformValue::Type::Vec3:
+            glUniform3fv(value.location, 1, value.data);
+            break;
+        case UniformValue::Type::Vec4:
+            glUniform4fv(value.location, 1, value.data);
+            break;
+        case UniformValue::Type::Mat4:
+            glUniformMatrix4fv(value.location, 1, GL_FALSE, value.data);
+            break;
+    }
+}
+
+void GlCommandBackend::draw(const DrawCommand &command) {
+    if (command.instanceCount == 1) {
+        glDrawElements(command.mode, command.indexCount, command.indexType, nullptr);
+    } else if (command.instanceCount > 1) {
+        glDrawElementsInstanced(command.mode, command.indexCount, command.indexType, nullptr,
+                                command.instanceCount);
+    }
+}
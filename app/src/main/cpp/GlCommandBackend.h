@@ -0,0 +1,22 @@
+#ifndef ANDROIDGLINVESTIGATIONS_GLCOMMANDBACKEND_H
+#define ANDROIDGLINVESTIGATIONS_GLCOMMANDBACKEND_H
+
+#include "CommandBuffer.h"
+
+/*!
+ * Executes commands with GLES3 calls on the current context. Textures go to unit 0.
+ */
+class GlCommandBackend : public CommandBackend {
+public:
+    void bindProgram(uint32_t program) override;
+
+    void bindVertexArray(uint32_t vertexArray) override;
+
+    void bindTexture(uint32_t texture) override;
+
+    void setUniform(const UniformValue &value) override;
+
+    void draw(const DrawCommand &command) override;
+};
+
+#endif //ANDROIDGLINVESTIGATIONS_GLCOMMANDBACKEND_H
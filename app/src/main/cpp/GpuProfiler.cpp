@@ -0,0 +1,113 @@
+#include "GpuProfiler.h"
+
+#include <cassert>
+#include <cstring>
+#include <EGL/egl.h>
+
+#include "AndroidOut.h"
+
+GpuProfiler::GpuProfiler()
+        : getQueryObjectui64v_(nullptr),
+          frames_{},
+          current_(0),
+          open_(false),
+          track_(0),
+          frameTime_(0) {
+    auto extensions = reinterpret_cast<const char *>(glGetString(GL_EXTENSIONS));
+    if (!extensions || !strstr(extensions, "GL_EXT_disjoint_timer_query")) {
+        aout << "GL_EXT_disjoint_timer_query not supported, no GPU timings" << std::endl;
+        return;
+    }
+    getQueryObjectui64v_ = reinterpret_cast<PFNGLGETQUERYOBJECTUI64VEXTPROC>(
+            eglGetProcAddress("glGetQueryObjectui64vEXT"));
+    if (!getQueryObjectui64v_) {
+        return;
+    }
+    // ES3 has the query objects themselves, the extension adds the timer target and 64 bit reads
+    for (auto &frame: frames_) {
+        glGenQueries(kQueriesPerFrame, frame.queries);
+    }
+#ifdef PROFILER_ENABLED
+    track_ = Profiler::track("GPU");
+#endif
+}
+
+GpuProfiler::~GpuProfiler() {
+    if (!isSupported()) {
+        return;
+    }
+    for (auto &frame: frames_) {
+        glDeleteQueries(kQueriesPerFrame, frame.queries);
+    }
+}
+
+void GpuProfiler::beginFrame() {
+    if (!isSupported()) {
+        return;
+    }
+    assert(!open_);
+    current_ = (current_ + 1) % kFrameCount;
+    collect(frames_[current_]);
+}
+
+void GpuProfiler::collect(Frame &frame) {
+    frame.skip = false;
+    if (frame.count == 0) {
+        return;
+    }
+    // queries finish in order, if the last one is done they all are
+    GLuint available = GL_FALSE;
+    glGetQueryObjectuiv(frame.queries[frame.count - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        frame.skip = true;
+        return;
+    }
+
+    GLint disjoint = GL_FALSE;
+    glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+    uint64_t total = 0;
+    for (int i = 0; i < frame.count; i++) {
+        GLuint64 elapsed = 0;
+        getQueryObjectui64v_(frame.queries[i], GL_QUERY_RESULT, &elapsed);
+        total += elapsed;
+#ifdef PROFILER_ENABLED
+        if (!disjoint) {
+            Profiler::recordOnTrack(track_, frame.names[i], frame.cpuBegin[i], frame.cpuBegin[i] + elapsed);
+        }
+#endif
+    }
+    if (!disjoint) {
+        frameTime_ = total;
+    }
+    frame.count = 0;
+}
+
+bool GpuProfiler::takeFrameTime(float &ms) {
+    if (frameTime_ == 0) {
+        return false;
+    }
+    ms = static_cast<float>(frameTime_) * 1e-6f;
+    frameTime_ = 0;
+    return true;
+}
+
+void GpuProfiler::begin(const char *name) {
+    Frame &frame = frames_[current_];
+    if (!isSupported() || frame.skip || frame.count == kQueriesPerFrame) {
+        return;
+    }
+    assert(!open_);
+    open_ = true;
+    frame.names[frame.count] = name;
+    frame.cpuBegin[frame.count] = Profiler::now();
+    glBeginQuery(GL_TIME_ELAPSED_EXT, frame.queries[frame.count]);
+}
+
+void GpuProfiler::end() {
+    if (!open_) {
+        return;
+    }
+    glEndQuery(GL_TIME_ELAPSED_EXT);
+    frames_[current_].count++;
+    open_ = false;
+}
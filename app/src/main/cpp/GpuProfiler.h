@@ -0,0 +1,110 @@
+#ifndef ANDROIDGLINVESTIGATIONS_GPUPROFILER_H
+#define ANDROIDGLINVESTIGATIONS_GPUPROFILER_H
+
+#include <cstdint>
+#include <GLES3/gl3.h>
+#include <GLES2/gl2ext.h>
+
+#include "Profiler.h"
+
+/*!
+ * GPU timings from GL_EXT_disjoint_timer_query, written to the Profiler on a "GPU" track. Results
+ * are read a few frames late so nothing stalls; frames the GPU hasn't finished yet, or that were
+ * disjoint (clock change, power event), are dropped. Does nothing where the extension is missing.
+ *
+ * Each collected frame's total is also kept for @a takeFrameTime, the dynamic resolution governor
+ * runs on it. The Renderer therefore always has one and times its passes directly, the events
+ * only reach the Profiler when it's compiled in.
+ *
+ * Time elapsed queries can't nest, so GPU scopes mustn't either. Each event is placed at the CPU
+ * time its commands were issued, with the GPU duration.
+ *
+ * Like the CPU markers this is used through macros that vanish without PROFILER_ENABLED:
+ *
+ *  PROFILE_GPU_FRAME(gpuProfiler);          // once per frame, before any scope
+ *  PROFILE_GPU_SCOPE(gpuProfiler, "scene");
+ */
+class GpuProfiler {
+public:
+    /*!
+     * Needs a current context
+     */
+    GpuProfiler();
+
+    ~GpuProfiler();
+
+    GpuProfiler(const GpuProfiler &) = delete;
+
+    GpuProfiler &operator=(const GpuProfiler &) = delete;
+
+    inline bool isSupported() const { return getQueryObjectui64v_ != nullptr; }
+
+    /*!
+     * Collects the results of the oldest frame in flight and starts a new frame
+     */
+    void beginFrame();
+
+    void begin(const char *name);
+
+    void end();
+
+    /*!
+     * Hands out the GPU time of the most recently collected frame, once
+     * @param ms receives the summed duration of the frame's scopes in milliseconds
+     * @return false if no frame finished since the last call
+     */
+    bool takeFrameTime(float &ms);
+
+private:
+    static constexpr int kFrameCount = 4;
+    static constexpr int kQueriesPerFrame = 8;
+
+    struct Frame {
+        GLuint queries[kQueriesPerFrame];
+        const char *names[kQueriesPerFrame];
+        uint64_t cpuBegin[kQueriesPerFrame];
+        int count;
+        // set when the frame's queries were still busy, nothing is timed this frame
+        bool skip;
+    };
+
+    void collect(Frame &frame);
+
+    PFNGLGETQUERYOBJECTUI64VEXTPROC getQueryObjectui64v_;
+    Frame frames_[kFrameCount];
+    int current_;
+    bool open_;
+    int track_;
+    // summed scope durations of the last collected frame, 0 once taken
+    uint64_t frameTime_;
+};
+
+/*!
+ * Times the GPU work issued in a scope, use PROFILE_GPU_SCOPE rather than this directly
+ */
+class GpuProfileScope {
+public:
+    inline GpuProfileScope(GpuProfiler &profiler, const char *name) : profiler_(profiler) {
+        profiler_.begin(name);
+    }
+
+    inline ~GpuProfileScope() { profiler_.end(); }
+
+    GpuProfileScope(const GpuProfileScope &) = delete;
+
+    GpuProfileScope &operator=(const GpuProfileScope &) = delete;
+
+private:
+    GpuProfiler &profiler_;
+};
+
+#ifdef PROFILER_ENABLED
+#define PROFILE_GPU_FRAME(profiler) (profiler).beginFrame()
+#define PROFILE_GPU_SCOPE(profiler, name) \
+    GpuProfileScope PROFILER_CONCAT(gpuProfileScope, __LINE__)(profiler, name)
+#else
+#define PROFILE_GPU_FRAME(profiler) do {} while (0)
+#define PROFILE_GPU_SCOPE(profiler, name) do {} while (0)
+#endif
+
+#endif //ANDROIDGLINVESTIGATIONS_GPUPROFILER_H
@@ -0,0 +1,21 @@
+#ifndef ANDROIDGLINVESTIGATIONS_HASH_H
+#define ANDROIDGLINVESTIGATIONS_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*!
+ * FNV-1a, 64 bit. Continues from @a hash, so several pieces of data can be chained into one hash.
+ * Quick on the short keys it's used for, paths, names and shader sources; not meant to stand up to
+ * keys made to collide.
+ */
+inline uint64_t hashBytes(const void *data, size_t size, uint64_t hash = 14695981039346656037ull) {
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+#endif //ANDROIDGLINVESTIGATIONS_HASH_H
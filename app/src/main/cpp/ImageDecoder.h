@@ -0,0 +1,33 @@
+#ifndef ANDROIDGLINVESTIGATIONS_IMAGEDECODER_H
+#define ANDROIDGLINVESTIGATIONS_IMAGEDECODER_H
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/*!
+ * A decoded image, RGBA with 8 bits per channel, rows packed top row first
+ */
+struct DecodedImage {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> pixels;
+};
+
+/*!
+ * Turns encoded image files into pixels. The app decodes with AImageDecoder, see
+ * AndroidImageDecoder, host tools plug in their own so texture loading runs off the device too.
+ */
+class ImageDecoder {
+public:
+    virtual ~ImageDecoder() = default;
+
+    /*!
+     * Called from worker threads, possibly several at once
+     * @param encoded the whole file, e.g. a PNG
+     * @return false if the data couldn't be decoded
+     */
+    virtual bool decode(std::string_view encoded, DecodedImage &image) const = 0;
+};
+
+#endif //ANDROIDGLINVESTIGATIONS_IMAGEDECODER_H
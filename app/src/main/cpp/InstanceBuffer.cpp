@@ -0,0 +1,53 @@
+#include "InstanceBuffer.h"
+
+#include <algorithm>
+#include <cstddef>
+
+InstanceBuffer::InstanceBuffer() : buffer_(0), count_(0), capacity_(0) {
+    glGenBuffers(1, &buffer_);
+}
+
+InstanceBuffer::~InstanceBuffer() {
+    if (buffer_) {
+        glDeleteBuffers(1, &buffer_);
+        buffer_ = 0;
+    }
+}
+
+void InstanceBuffer::bindAttributes(GLint modelLocation, GLint colorLocation) const {
+    glBindBuffer(GL_ARRAY_BUFFER, buffer_);
+    if (modelLocation >= 0) {
+        for (GLint column = 0; column < 4; column++) {
+            GLuint location = modelLocation + column;
+            glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(CubeInstance),
+                                  (GLvoid *) (offsetof(CubeInstance, model) + column * sizeof(glm::vec4)));
+            glVertexAttribDivisor(location, 1);
+            glEnableVertexAttribArray(location);
+        }
+    }
+    if (colorLocation >= 0) {
+        glVertexAttribPointer(colorLocation, 4, GL_FLOAT, GL_FALSE, sizeof(CubeInstance),
+                              (GLvoid *) offsetof(CubeInstance, color));
+        glVertexAttribDivisor(colorLocation, 1);
+        glEnableVertexAttribArray(colorLocation);
+    }
+}
+
+void InstanceBuffer::upload(const std::vector<CubeInstance> &instances, size_t first, size_t last) {
+    count_ = static_cast<GLsizei>(instances.size());
+    glBindBuffer(GL_ARRAY_BUFFER, buffer_);
+
+    if (instances.size() > capacity_) {
+        // grow geometrically so adding a few cubes at a time doesn't reallocate every frame
+        capacity_ = instances.size() + instances.size() / 2;
+        glBufferData(GL_ARRAY_BUFFER, capacity_ * sizeof(CubeInstance), nullptr, GL_DYNAMIC_DRAW);
+        first = 0;
+        last = instances.size();
+    }
+    last = std::min(last, instances.size());
+    if (first < last) {
+        glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(CubeInstance),
+                        (last - first) * sizeof(CubeInstance), instances.data() + first);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
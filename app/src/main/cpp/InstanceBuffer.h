@@ -0,0 +1,57 @@
+#ifndef ANDROIDGLINVESTIGATIONS_INSTANCEBUFFER_H
+#define ANDROIDGLINVESTIGATIONS_INSTANCEBUFFER_H
+
+#include <vector>
+#include <GLES3/gl3.h>
+#include <glm/glm.hpp>
+
+/*!
+ * Everything that differs between two cubes drawn by the same instanced draw call. This is the
+ * exact layout of one element of the per-instance vertex buffer.
+ */
+struct CubeInstance {
+    glm::mat4 model;
+    glm::vec4 color;
+};
+
+/*!
+ * A per-instance vertex buffer. The CPU keeps the instance list, this only owns the GL side: it
+ * grows the buffer as needed, re-uploads the list when asked to and wires the per-instance
+ * attributes into a VAO.
+ */
+class InstanceBuffer {
+public:
+    InstanceBuffer();
+
+    ~InstanceBuffer();
+
+    InstanceBuffer(const InstanceBuffer &) = delete;
+
+    InstanceBuffer &operator=(const InstanceBuffer &) = delete;
+
+    /*!
+     * Sets up the per-instance attributes on the currently bound VAO. A mat4 attribute takes four
+     * consecutive locations starting at @a modelLocation.
+     * @param modelLocation location of the mat4 model attribute, or -1 to skip it
+     * @param colorLocation location of the vec4 color attribute, or -1 to skip it
+     */
+    void bindAttributes(GLint modelLocation, GLint colorLocation) const;
+
+    /*!
+     * Uploads the changed part of the instance list. When the list outgrew the buffer the storage
+     * is reallocated and everything is uploaded, otherwise only [first, last) is written.
+     * @param instances the full instance list
+     * @param first the first instance that changed
+     * @param last one past the last instance that changed
+     */
+    void upload(const std::vector<CubeInstance> &instances, size_t first, size_t last);
+
+    inline GLsizei getCount() const { return count_; }
+
+private:
+    GLuint buffer_;
+    GLsizei count_;
+    size_t capacity_;
+};
+
+#endif //ANDROIDGLINVESTIGATIONS_INSTANCEBUFFER_H
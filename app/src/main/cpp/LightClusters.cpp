@@ -0,0 +1,238 @@
+#include "LightClusters.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if GLM_ARCH & GLM_ARCH_AVX_BIT
+#include <immintrin.h>
+#endif
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+#include <glm/simd/common.h>
+#elif GLM_ARCH & GLM_ARCH_NEON_BIT
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+static_assert(LightClusters::kClustersPerSlice % 8 == 0, "a slice is tested in whole blocks of eight");
+static_assert(LightClusters::kMaxLights <= 256, "light indices are bytes");
+static_assert(LightClusters::kClusterCount < (1 << 24), "pairs keep the cluster in 24 bits");
+
+/*!
+ * Appends the pair for every cluster of a slice whose x/y bounds come within reach of the light.
+ * Squared distance from the light's center to each box, with the slice's share of it (depth)
+ * already taken off @a reach2.
+ */
+void testSliceScalar(const float *minX, const float *minY, const float *maxX, const float *maxY,
+                     float cx, float cy, float reach2, uint32_t pair, std::vector<uint32_t> &pairs) {
+    for (int i = 0; i < LightClusters::kClustersPerSlice; i++) {
+        float dx = std::max(std::max(minX[i] - cx, cx - maxX[i]), 0.0f);
+        float dy = std::max(std::max(minY[i] - cy, cy - maxY[i]), 0.0f);
+        if (dx * dx + dy * dy <= reach2) {
+            pairs.push_back(pair + (uint32_t(i) << 8));
+        }
+    }
+}
+
+/*!
+ * @a testSliceScalar, four or eight clusters at a time. Same operations in the same order, so the
+ * results are identical.
+ */
+void testSlice(const float *minX, const float *minY, const float *maxX, const float *maxY,
+               float cx, float cy, float reach2, uint32_t pair, std::vector<uint32_t> &pairs) {
+#if GLM_ARCH & GLM_ARCH_AVX_BIT
+    const __m256 x = _mm256_set1_ps(cx), y = _mm256_set1_ps(cy);
+    const __m256 limit = _mm256_set1_ps(reach2);
+    const __m256 zero = _mm256_setzero_ps();
+    for (int i = 0; i < LightClusters::kClustersPerSlice; i += 8) {
+        __m256 dx = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_loadu_ps(minX + i), x),
+                                                _mm256_sub_ps(x, _mm256_loadu_ps(maxX + i))), zero);
+        __m256 dy = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_loadu_ps(minY + i), y),
+                                                _mm256_sub_ps(y, _mm256_loadu_ps(maxY + i))), zero);
+        __m256 distance2 = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_ps(_mm256_cmp_ps(distance2, limit, _CMP_LE_OQ)));
+        while (mask) {
+            unsigned lane = __builtin_ctz(mask);
+            pairs.push_back(pair + ((uint32_t(i) + lane) << 8));
+            mask &= mask - 1;
+        }
+    }
+#elif GLM_ARCH & GLM_ARCH_SSE2_BIT
+    const glm_vec4 x = _mm_set1_ps(cx), y = _mm_set1_ps(cy);
+    const glm_vec4 limit = _mm_set1_ps(reach2);
+    const glm_vec4 zero = _mm_setzero_ps();
+    for (int i = 0; i < LightClusters::kClustersPerSlice; i += 4) {
+        glm_vec4 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(minX + i), x),
+                                            _mm_sub_ps(x, _mm_loadu_ps(maxX + i))), zero);
+        glm_vec4 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(minY + i), y),
+                                            _mm_sub_ps(y, _mm_loadu_ps(maxY + i))), zero);
+        glm_vec4 distance2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_ps(_mm_cmple_ps(distance2, limit)));
+        while (mask) {
+            unsigned lane = __builtin_ctz(mask);
+            pairs.push_back(pair + ((uint32_t(i) + lane) << 8));
+            mask &= mask - 1;
+        }
+    }
+#elif GLM_ARCH & GLM_ARCH_NEON_BIT
+    const float32x4_t x = vdupq_n_f32(cx), y = vdupq_n_f32(cy);
+    const float32x4_t limit = vdupq_n_f32(reach2);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const uint32x4_t laneBits = {1, 2, 4, 8};
+    for (int i = 0; i < LightClusters::kClustersPerSlice; i += 4) {
+        float32x4_t dx = vmaxq_f32(vmaxq_f32(vsubq_f32(vld1q_f32(minX + i), x),
+                                             vsubq_f32(x, vld1q_f32(maxX + i))), zero);
+        float32x4_t dy = vmaxq_f32(vmaxq_f32(vsubq_f32(vld1q_f32(minY + i), y),
+                                             vsubq_f32(y, vld1q_f32(maxY + i))), zero);
+        // no fused multiply-add, that would round differently from the scalar version
+        float32x4_t distance2 = vaddq_f32(vmulq_f32(dx, dx), vmulq_f32(dy, dy));
+        // NEON has no movemask, fold the lanes into a 4 bit mask by hand
+        uint32x4_t bits = vandq_u32(vcleq_f32(distance2, limit), laneBits);
+        uint32x2_t folded = vorr_u32(vget_low_u32(bits), vget_high_u32(bits));
+        unsigned mask = vget_lane_u32(folded, 0) | vget_lane_u32(folded, 1);
+        while (mask) {
+            unsigned lane = __builtin_ctz(mask);
+            pairs.push_back(pair + ((uint32_t(i) + lane) << 8));
+            mask &= mask - 1;
+        }
+    }
+#else
+    testSliceScalar(minX, minY, maxX, maxY, cx, cy, reach2, pair, pairs);
+#endif
+}
+
+} // namespace
+
+LightClusters::LightClusters()
+        : clusters_(kClusterCount, Cluster{0, 0}) {
+    setProjection(glm::radians(60.0f), 1.0f, near_, far_);
+}
+
+void LightClusters::setProjection(float fovY, float aspect, float near, float far) {
+    near_ = near;
+    far_ = far;
+    const float logRange = std::log(far / near);
+    sliceScale_ = kSlices / logRange;
+    sliceBias_ = -kSlices * std::log(near) / logRange;
+
+    sliceDepth_.resize(kSlices + 1);
+    for (int slice = 0; slice <= kSlices; slice++) {
+        sliceDepth_[slice] = near * std::pow(far / near, float(slice) / kSlices);
+    }
+    sliceDepth_.back() = far;
+
+    // A tile's sides fan out from the eye, so its widest extent in a slice is at one of the slice's
+    // two depths
+    const float tanY = std::tan(fovY * 0.5f);
+    const float tanX = tanY * aspect;
+    minX_.resize(kClusterCount);
+    minY_.resize(kClusterCount);
+    maxX_.resize(kClusterCount);
+    maxY_.resize(kClusterCount);
+    for (int slice = 0; slice < kSlices; slice++) {
+        const float depths[2] = {sliceDepth_[slice], sliceDepth_[slice + 1]};
+        for (int tileY = 0; tileY < kTilesY; tileY++) {
+            const float bottom = (-1.0f + 2.0f * tileY / kTilesY) * tanY;
+            const float top = (-1.0f + 2.0f * (tileY + 1) / kTilesY) * tanY;
+            for (int tileX = 0; tileX < kTilesX; tileX++) {
+                const float left = (-1.0f + 2.0f * tileX / kTilesX) * tanX;
+                const float right = (-1.0f + 2.0f * (tileX + 1) / kTilesX) * tanX;
+                const int index = clusterIndex(tileX, tileY, slice);
+                minX_[index] = std::min(left * depths[0], left * depths[1]);
+                maxX_[index] = std::max(right * depths[0], right * depths[1]);
+                minY_[index] = std::min(bottom * depths[0], bottom * depths[1]);
+                maxY_[index] = std::max(top * depths[0], top * depths[1]);
+            }
+        }
+    }
+}
+
+int LightClusters::sliceOf(float depth) const {
+    int slice = static_cast<int>(std::floor(std::log(depth) * sliceScale_ + sliceBias_));
+    return std::clamp(slice, 0, kSlices - 1);
+}
+
+bool LightClusters::sliceRange(const glm::vec3 &center, float radius, int &first, int &last) const {
+    if (center.z + radius < near_ || center.z - radius > far_) {
+        return false;
+    }
+    first = sliceOf(std::max(center.z - radius, near_));
+    last = sliceOf(std::min(center.z + radius, far_));
+    return true;
+}
+
+void LightClusters::assign(const glm::mat4 &view, const PointLight *lights, size_t count) {
+    assign(view, lights, count, true);
+}
+
+void LightClusters::assignScalar(const glm::mat4 &view, const PointLight *lights, size_t count) {
+    assign(view, lights, count, false);
+}
+
+void LightClusters::assign(const glm::mat4 &view, const PointLight *lights, size_t count, bool simd) {
+    count = std::min(count, kMaxLights);
+    pairs_.clear();
+    for (size_t light = 0; light < count; light++) {
+        // view space looks down -z, flip it so depth grows away from the camera like the slices
+        glm::vec4 viewPosition = view * glm::vec4(lights[light].position, 1.0f);
+        glm::vec3 center(viewPosition.x, viewPosition.y, -viewPosition.z);
+        const float radius = lights[light].radius;
+        int first, last;
+        if (!sliceRange(center, radius, first, last)) {
+            continue;
+        }
+        for (int slice = first; slice <= last; slice++) {
+            // every cluster in the slice shares its depth range, take that part of the distance
+            // off the radius once instead of per cluster
+            float dz = std::max(std::max(sliceDepth_[slice] - center.z, center.z - sliceDepth_[slice + 1]), 0.0f);
+            float reach2 = radius * radius - dz * dz;
+            if (reach2 < 0.0f) {
+                continue;
+            }
+            const size_t base = size_t(slice) * kClustersPerSlice;
+            const uint32_t pair = (uint32_t(base) << 8) | uint32_t(light);
+            if (simd) {
+                testSlice(&minX_[base], &minY_[base], &maxX_[base], &maxY_[base],
+                          center.x, center.y, reach2, pair, pairs_);
+            } else {
+                testSliceScalar(&minX_[base], &minY_[base], &maxX_[base], &maxY_[base],
+                                center.x, center.y, reach2, pair, pairs_);
+            }
+        }
+    }
+    buildLists(count);
+}
+
+void LightClusters::buildLists(size_t lightCount) {
+    stats_ = Stats();
+    if (pairs_.size() > kMaxLightIndices) {
+        stats_.dropped = pairs_.size() - kMaxLightIndices;
+        pairs_.resize(kMaxLightIndices);
+    }
+
+    // a counting sort by cluster. Pairs were made in light order and the sort is stable, so every
+    // list comes out sorted by light
+    for (auto &cluster: clusters_) {
+        cluster.count = 0;
+    }
+    bool lit[kMaxLights] = {};
+    for (uint32_t pair: pairs_) {
+        clusters_[pair >> 8].count++;
+        lit[pair & 0xffu] = true;
+    }
+    uint32_t offset = 0;
+    for (auto &cluster: clusters_) {
+        cluster.offset = offset;
+        offset += cluster.count;
+        stats_.busiestCluster = std::max(stats_.busiestCluster, size_t(cluster.count));
+        // reused as the write position below, put back after
+        cluster.count = 0;
+    }
+    lightIndices_.resize(pairs_.size());
+    for (uint32_t pair: pairs_) {
+        Cluster &cluster = clusters_[pair >> 8];
+        lightIndices_[cluster.offset + cluster.count++] = static_cast<uint8_t>(pair & 0xffu);
+    }
+    stats_.indices = pairs_.size();
+    stats_.lights = static_cast<size_t>(std::count(lit, lit + lightCount, true));
+}
@@ -0,0 +1,148 @@
+#ifndef ANDROIDGLINVESTIGATIONS_LIGHTCLUSTERS_H
+#define ANDROIDGLINVESTIGATIONS_LIGHTCLUSTERS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+/*!
+ * A point light in world space. It reaches exactly @a radius, the falloff is windowed to zero there
+ * so it can be left out of every cluster further away.
+ */
+struct PointLight {
+    glm::vec3 position;
+    float radius;
+    glm::vec3 color;
+    float intensity;
+};
+
+/*!
+ * Clustered light assignment. The view frustum is cut into kTilesX by kTilesY tiles on screen and
+ * kSlices depth slices, spaced exponentially between the near and far plane so clusters stay
+ * roughly cube shaped. Every light is tested against the clusters it could touch and ends up in
+ * their lists, so a fragment only has to loop over the lights of its own cluster.
+ *
+ * Cluster bounds are axis aligned boxes in view space (x right, y up, z the distance in front of the
+ * camera). They only depend on the projection and are kept as structure of arrays, so a slice's
+ * clusters are tested against a light's sphere four or eight at a time.
+ *
+ * The lists are packed for the GPU: each cluster has an offset and count into one shared array of
+ * 8 bit light indices.
+ */
+class LightClusters {
+public:
+    static constexpr int kTilesX = 16;
+    static constexpr int kTilesY = 9;
+    static constexpr int kSlices = 24;
+    static constexpr int kClustersPerSlice = kTilesX * kTilesY;
+    static constexpr int kClusterCount = kClustersPerSlice * kSlices;
+    // light indices are stored in a byte
+    static constexpr size_t kMaxLights = 256;
+    // room in the shared index array, lights past it are left out of their clusters
+    static constexpr size_t kMaxLightIndices = 64 * 1024;
+
+    /*!
+     * Where a cluster's lights are in the index array
+     */
+    struct Cluster {
+        uint32_t offset;
+        uint32_t count;
+    };
+
+    struct Stats {
+        // lights that touched at least one cluster
+        size_t lights = 0;
+        // light indices written, over all clusters
+        size_t indices = 0;
+        // the most lights in any one cluster
+        size_t busiestCluster = 0;
+        // light to cluster assignments dropped because the index array was full
+        size_t dropped = 0;
+    };
+
+    LightClusters();
+
+    /*!
+     * Rebuilds the cluster bounds. Only needed when the projection changes.
+     * @param fovY vertical field of view in radians
+     */
+    void setProjection(float fovY, float aspect, float near, float far);
+
+    /*!
+     * Assigns @a lights to clusters with the widest SIMD available (AVX, SSE or NEON). At most
+     * kMaxLights are used.
+     * @param view the camera's view matrix
+     */
+    void assign(const glm::mat4 &view, const PointLight *lights, size_t count);
+
+    /*!
+     * Scalar reference version of @a assign, gives the exact same lists
+     */
+    void assignScalar(const glm::mat4 &view, const PointLight *lights, size_t count);
+
+    /*!
+     * @return the index of the cluster at the given tile and slice
+     */
+    static inline int clusterIndex(int tileX, int tileY, int slice) {
+        return (slice * kTilesY + tileY) * kTilesX + tileX;
+    }
+
+    /*!
+     * The slice of a view depth z is floor(log(z) * scale + bias), for the fragment shader
+     */
+    inline float getSliceScale() const { return sliceScale_; }
+
+    inline float getSliceBias() const { return sliceBias_; }
+
+    /*!
+     * @return kClusterCount clusters, in clusterIndex order
+     */
+    inline const std::vector<Cluster> &getClusters() const { return clusters_; }
+
+    inline const std::vector<uint8_t> &getLightIndices() const { return lightIndices_; }
+
+    inline const Stats &getStats() const { return stats_; }
+
+private:
+    /*!
+     * @return the slice @a depth falls in, clamped to the grid
+     */
+    int sliceOf(float depth) const;
+
+    /*!
+     * Works out which slices a sphere around the view space @a center covers
+     * @return false if it's entirely in front of the near or behind the far plane
+     */
+    bool sliceRange(const glm::vec3 &center, float radius, int &first, int &last) const;
+
+    /*!
+     * Tests every light against the clusters of the slices it covers, collecting the hits in pairs_,
+     * then builds the lists from them
+     */
+    void assign(const glm::mat4 &view, const PointLight *lights, size_t count, bool simd);
+
+    /*!
+     * Turns the (cluster, light) pairs collected in pairs_ into the per-cluster lists
+     */
+    void buildLists(size_t lightCount);
+
+    float near_ = 0.1f;
+    float far_ = 100.0f;
+    float sliceScale_ = 0.0f;
+    float sliceBias_ = 0.0f;
+
+    // where each slice starts, kSlices + 1 depths from near to far
+    std::vector<float> sliceDepth_;
+    // view space x and y bounds of every cluster, all of a slice's clusters share its depth range
+    std::vector<float> minX_, minY_;
+    std::vector<float> maxX_, maxY_;
+
+    // cluster << 8 | light for every hit, in light order
+    std::vector<uint32_t> pairs_;
+    std::vector<Cluster> clusters_;
+    std::vector<uint8_t> lightIndices_;
+    Stats stats_;
+};
+
+#endif //ANDROIDGLINVESTIGATIONS_LIGHTCLUSTERS_H
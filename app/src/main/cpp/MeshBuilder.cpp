@@ -0,0 +1,408 @@
+#include "MeshBuilder.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+
+/*!
+ * FIFO post-transform cache simulation. A vertex is in the cache if fewer than cacheSize misses
+ * happened since it was last transformed, which makes resetting the cache O(1).
+ */
+class FifoCache {
+public:
+    FifoCache(size_t vertexCount, unsigned cacheSize)
+            : stamps_(vertexCount, 0), cacheSize_(cacheSize), time_(cacheSize + 1) {}
+
+    /*!
+     * @return how many of the triangle's vertices had to be transformed
+     */
+    unsigned addTriangle(uint32_t a, uint32_t b, uint32_t c) {
+        return add(a) + add(b) + add(c);
+    }
+
+    void reset() {
+        time_ += cacheSize_ + 1;
+    }
+
+private:
+    unsigned add(uint32_t vertex) {
+        if (time_ - stamps_[vertex] > cacheSize_) {
+            stamps_[vertex] = time_++;
+            return 1;
+        }
+        return 0;
+    }
+
+    std::vector<unsigned> stamps_;
+    unsigned cacheSize_;
+    unsigned time_;
+};
+
+// Forsyth's tuning constants, see "Linear-Speed Vertex Cache Optimisation"
+constexpr int kForsythCacheSize = 32;
+constexpr float kCacheDecayPower = 1.5f;
+constexpr float kLastTriangleScore = 0.75f;
+constexpr float kValenceBoostScale = 2.0f;
+constexpr float kValenceBoostPower = 0.5f;
+
+float forsythVertexScore(int cachePosition, uint32_t remainingTriangles) {
+    if (remainingTriangles == 0) {
+        // nothing left to draw with this vertex
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        if (cachePosition < 3) {
+            // it was used by the last triangle, a fixed score avoids favouring one of the three
+            score = kLastTriangleScore;
+        } else {
+            const float scaler = 1.0f / (kForsythCacheSize - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scaler, kCacheDecayPower);
+        }
+    }
+
+    // boost vertices with few triangles left so they're finished off and stop being candidates
+    score += kValenceBoostScale * std::pow((float) remainingTriangles, -kValenceBoostPower);
+    return score;
+}
+
+struct VertexHash {
+    size_t operator()(const MeshVertex &vertex) const {
+        uint32_t words[sizeof(MeshVertex) / sizeof(uint32_t)];
+        memcpy(words, &vertex, sizeof(words));
+        uint32_t hash = 2166136261u;
+        for (uint32_t word: words) {
+            hash = (hash ^ word) * 16777619u;
+        }
+        return hash;
+    }
+};
+
+struct VertexEqual {
+    bool operator()(const MeshVertex &a, const MeshVertex &b) const {
+        return memcmp(&a, &b, sizeof(MeshVertex)) == 0;
+    }
+};
+
+} // namespace
+
+static_assert(sizeof(MeshVertex) == 8 * sizeof(float), "MeshVertex is hashed bitwise, no padding allowed");
+
+MeshData MeshBuilder::build(const MeshVertex *vertices, size_t count) {
+    MeshData mesh = weld(vertices, count);
+    optimizeVertexCache(mesh.indices, mesh.vertices.size());
+    optimizeOverdraw(mesh.indices, mesh.vertices);
+    optimizeVertexFetch(mesh);
+    return mesh;
+}
+
+MeshData MeshBuilder::weld(const MeshVertex *vertices, size_t count) {
+    assert(count % 3 == 0);
+
+    MeshData mesh;
+    mesh.indices.reserve(count);
+    std::unordered_map<MeshVertex, uint32_t, VertexHash, VertexEqual> unique;
+    unique.reserve(count);
+
+    for (size_t i = 0; i < count; i++) {
+        auto inserted = unique.emplace(vertices[i], static_cast<uint32_t>(mesh.vertices.size()));
+        if (inserted.second) {
+            mesh.vertices.push_back(vertices[i]);
+        }
+        mesh.indices.push_back(inserted.first->second);
+    }
+    return mesh;
+}
+
+void MeshBuilder::optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount) {
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // triangle adjacency per vertex, packed into one array. The first remaining[v] entries of a
+    // vertex's range are the triangles it still has to be drawn with.
+    std::vector<uint32_t> remaining(vertexCount, 0);
+    for (uint32_t index: indices) {
+        remaining[index]++;
+    }
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) {
+        offsets[v + 1] = offsets[v] + remaining[v];
+    }
+    std::vector<uint32_t> adjacency(indices.size());
+    {
+        std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++) {
+            adjacency[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        vertexScore[v] = forsythVertexScore(-1, remaining[v]);
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+    int best = -1;
+    float bestScore = -1.0f;
+    for (size_t t = 0; t < triangleCount; t++) {
+        float score = vertexScore[indices[t * 3]]
+                      + vertexScore[indices[t * 3 + 1]]
+                      + vertexScore[indices[t * 3 + 2]];
+        if (score > bestScore) {
+            bestScore = score;
+            best = static_cast<int>(t);
+        }
+    }
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+
+    uint32_t cache[kForsythCacheSize + 3];
+    int cacheCount = 0;
+    size_t scanCursor = 0;
+
+    while (best >= 0) {
+        const uint32_t *triangle = &indices[best * 3];
+        emitted[best] = true;
+        output.insert(output.end(), triangle, triangle + 3);
+
+        for (int corner = 0; corner < 3; corner++) {
+            uint32_t v = triangle[corner];
+            uint32_t *begin = &adjacency[offsets[v]];
+            uint32_t *end = begin + remaining[v];
+            auto *it = std::find(begin, end, static_cast<uint32_t>(best));
+            assert(it != end);
+            std::swap(*it, *(end - 1));
+            remaining[v]--;
+        }
+
+        // the triangle's vertices move to the front, everything else is pushed back
+        uint32_t newCache[kForsythCacheSize + 3];
+        int newCount = 0;
+        for (int corner = 0; corner < 3; corner++) {
+            newCache[newCount++] = triangle[corner];
+        }
+        for (int i = 0; i < cacheCount; i++) {
+            uint32_t v = cache[i];
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+                newCache[newCount++] = v;
+            }
+        }
+
+        for (int i = 0; i < newCount; i++) {
+            uint32_t v = newCache[i];
+            cachePosition[v] = i < kForsythCacheSize ? i : -1;
+            vertexScore[v] = forsythVertexScore(cachePosition[v], remaining[v]);
+        }
+
+        // only triangles touching the cache changed score, the next one is picked among them
+        best = -1;
+        bestScore = -1.0f;
+        for (int i = 0; i < newCount; i++) {
+            uint32_t v = newCache[i];
+            for (uint32_t j = 0; j < remaining[v]; j++) {
+                uint32_t t = adjacency[offsets[v] + j];
+                float score = vertexScore[indices[t * 3]]
+                              + vertexScore[indices[t * 3 + 1]]
+                              + vertexScore[indices[t * 3 + 2]];
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = static_cast<int>(t);
+                }
+            }
+        }
+
+        cacheCount = std::min(newCount, kForsythCacheSize);
+        std::copy(newCache, newCache + cacheCount, cache);
+
+        if (best < 0) {
+            // the cache ran dry, continue with the next triangle in input order
+            while (scanCursor < triangleCount && emitted[scanCursor]) {
+                scanCursor++;
+            }
+            if (scanCursor < triangleCount) {
+                best = static_cast<int>(scanCursor);
+            }
+        }
+    }
+
+    indices.swap(output);
+}
+
+void MeshBuilder::optimizeOverdraw(std::vector<uint32_t> &indices,
+                                   const std::vector<MeshVertex> &vertices,
+                                   float threshold) {
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2) {
+        return;
+    }
+    constexpr unsigned kCacheSize = 16;
+
+    // hard boundaries: a triangle missing on all three vertices starts over with a cold cache, so
+    // cutting the order there costs nothing
+    std::vector<size_t> hardClusters{0};
+    {
+        FifoCache cache(vertices.size(), kCacheSize);
+        for (size_t t = 0; t < triangleCount; t++) {
+            if (cache.addTriangle(indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2]) == 3 && t > 0) {
+                hardClusters.push_back(t);
+            }
+        }
+    }
+    hardClusters.push_back(triangleCount);
+
+    // soft boundaries: inside a hard cluster, cut again whenever restarting with a cold cache keeps
+    // the ACMR within the threshold of what the cluster had in one piece
+    std::vector<size_t> clusters;
+    {
+        FifoCache cache(vertices.size(), kCacheSize);
+        for (size_t c = 0; c + 1 < hardClusters.size(); c++) {
+            size_t begin = hardClusters[c];
+            size_t end = hardClusters[c + 1];
+
+            cache.reset();
+            unsigned misses = 0;
+            for (size_t t = begin; t < end; t++) {
+                misses += cache.addTriangle(indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2]);
+            }
+            float clusterAcmr = float(misses) / float(end - begin);
+
+            cache.reset();
+            clusters.push_back(begin);
+            unsigned runMisses = 0;
+            size_t runStart = begin;
+            for (size_t t = begin; t < end; t++) {
+                runMisses += cache.addTriangle(indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2]);
+                float runAcmr = float(runMisses) / float(t + 1 - runStart);
+                if (t + 1 < end && runAcmr <= clusterAcmr * threshold) {
+                    clusters.push_back(t + 1);
+                    cache.reset();
+                    runMisses = 0;
+                    runStart = t + 1;
+                }
+            }
+        }
+    }
+    clusters.push_back(triangleCount);
+
+    // area weighted centroid of the whole mesh, clusters facing away from it are drawn first
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    std::vector<glm::vec3> clusterCentroid(clusters.size() - 1, glm::vec3(0.0f));
+    std::vector<glm::vec3> clusterNormal(clusters.size() - 1, glm::vec3(0.0f));
+    for (size_t c = 0; c + 1 < clusters.size(); c++) {
+        float clusterArea = 0.0f;
+        for (size_t t = clusters[c]; t < clusters[c + 1]; t++) {
+            const glm::vec3 &p0 = vertices[indices[t * 3]].position;
+            const glm::vec3 &p1 = vertices[indices[t * 3 + 1]].position;
+            const glm::vec3 &p2 = vertices[indices[t * 3 + 2]].position;
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(normal);
+            glm::vec3 center = (p0 + p1 + p2) * (1.0f / 3.0f);
+
+            clusterCentroid[c] += center * area;
+            clusterNormal[c] += normal;
+            clusterArea += area;
+        }
+        meshCentroid += clusterCentroid[c];
+        meshArea += clusterArea;
+        if (clusterArea > 0.0f) {
+            clusterCentroid[c] /= clusterArea;
+        }
+    }
+    if (meshArea > 0.0f) {
+        meshCentroid /= meshArea;
+    }
+
+    std::vector<float> sortKey(clusters.size() - 1);
+    for (size_t c = 0; c < sortKey.size(); c++) {
+        float length = glm::length(clusterNormal[c]);
+        glm::vec3 normal = length > 0.0f ? clusterNormal[c] / length : glm::vec3(0.0f);
+        sortKey[c] = glm::dot(clusterCentroid[c] - meshCentroid, normal);
+    }
+
+    std::vector<size_t> order(sortKey.size());
+    for (size_t c = 0; c < order.size(); c++) {
+        order[c] = c;
+    }
+    std::stable_sort(order.begin(), order.end(), [&sortKey](size_t a, size_t b) {
+        return sortKey[a] > sortKey[b];
+    });
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    for (size_t c: order) {
+        output.insert(output.end(),
+                      indices.begin() + clusters[c] * 3,
+                      indices.begin() + clusters[c + 1] * 3);
+    }
+    indices.swap(output);
+}
+
+void MeshBuilder::optimizeVertexFetch(MeshData &mesh) {
+    constexpr uint32_t kUnused = ~0u;
+    std::vector<uint32_t> remap(mesh.vertices.size(), kUnused);
+    std::vector<MeshVertex> vertices;
+    vertices.reserve(mesh.vertices.size());
+
+    for (uint32_t &index: mesh.indices) {
+        if (remap[index] == kUnused) {
+            remap[index] = static_cast<uint32_t>(vertices.size());
+            vertices.push_back(mesh.vertices[index]);
+        }
+        index = remap[index];
+    }
+    mesh.vertices.swap(vertices);
+}
+
+size_t MeshBuilder::packIndices(const MeshData &mesh, std::vector<uint8_t> &packed) {
+    // 0xffff is left unused, it's the restart index should GL_PRIMITIVE_RESTART_FIXED_INDEX, off by
+    // default and never enabled here, be turned on for strips later
+    if (mesh.vertices.size() < 0xffff) {
+        packed.resize(mesh.indices.size() * sizeof(uint16_t));
+        for (size_t i = 0; i < mesh.indices.size(); i++) {
+            const auto index = static_cast<uint16_t>(mesh.indices[i]);
+            memcpy(&packed[i * sizeof(index)], &index, sizeof(index));
+        }
+        return sizeof(uint16_t);
+    }
+    packed.resize(mesh.indices.size() * sizeof(uint32_t));
+    memcpy(packed.data(), mesh.indices.data(), packed.size());
+    return sizeof(uint32_t);
+}
+
+VertexCacheStats MeshBuilder::analyzeVertexCache(const std::vector<uint32_t> &indices,
+                                                 size_t vertexCount,
+                                                 unsigned cacheSize) {
+    VertexCacheStats stats{0.0f, 0.0f};
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return stats;
+    }
+
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<bool> referenced(vertexCount, false);
+    size_t uniqueVertices = 0;
+    unsigned misses = 0;
+    for (size_t t = 0; t < triangleCount; t++) {
+        misses += cache.addTriangle(indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2]);
+    }
+    for (uint32_t index: indices) {
+        if (!referenced[index]) {
+            referenced[index] = true;
+            uniqueVertices++;
+        }
+    }
+
+    stats.acmr = float(misses) / float(triangleCount);
+    stats.atvr = float(misses) / float(uniqueVertices);
+    return stats;
+}
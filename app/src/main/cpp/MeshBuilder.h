@@ -0,0 +1,92 @@
+#ifndef ANDROIDGLINVESTIGATIONS_MESHBUILDER_H
+#define ANDROIDGLINVESTIGATIONS_MESHBUILDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+/*!
+ * One vertex as authored. The builder compares vertices bit for bit, so two vertices only weld if
+ * every attribute matches exactly.
+ */
+struct MeshVertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 uv;
+};
+
+/*!
+ * An indexed triangle list ready to upload
+ */
+struct MeshData {
+    std::vector<MeshVertex> vertices;
+    std::vector<uint32_t> indices;
+};
+
+/*!
+ * Post-transform vertex cache statistics of an index buffer, from a FIFO cache simulation
+ */
+struct VertexCacheStats {
+    // average cache miss ratio: transformed vertices per triangle. 0.5 is the ideal for large
+    // meshes, 3 means no reuse at all
+    float acmr;
+    // average transform to vertex ratio: transformed vertices per unique vertex, 1 is ideal
+    float atvr;
+};
+
+/*!
+ * Turns a flat triangle soup into an indexed mesh that is friendly to mobile GPUs. @a build runs
+ * every step; they're also exposed one by one so tools can measure each of them.
+ */
+class MeshBuilder {
+public:
+    /*!
+     * Welds, then optimizes for vertex cache, overdraw and vertex fetch, in that order.
+     * @param vertices three vertices per triangle
+     * @param count the number of vertices, a multiple of three
+     */
+    static MeshData build(const MeshVertex *vertices, size_t count);
+
+    /*!
+     * Merges bit-identical vertices into an indexed mesh. Triangle order is kept.
+     */
+    static MeshData weld(const MeshVertex *vertices, size_t count);
+
+    /*!
+     * Reorders triangles for post-transform vertex cache reuse using Tom Forsyth's linear-speed
+     * vertex cache optimization.
+     */
+    static void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount);
+
+    /*!
+     * Reorders clusters of triangles so that the ones facing outwards are drawn first, which cuts
+     * overdraw from most view directions. Run after @a optimizeVertexCache: clusters are split at
+     * cache boundaries and are only merged while ACMR stays within @a threshold times the input's.
+     */
+    static void optimizeOverdraw(std::vector<uint32_t> &indices,
+                                 const std::vector<MeshVertex> &vertices,
+                                 float threshold = 1.05f);
+
+    /*!
+     * Reorders vertices in the order they are first referenced so fetches walk memory linearly.
+     * Vertices no triangle references are dropped.
+     */
+    static void optimizeVertexFetch(MeshData &mesh);
+
+    /*!
+     * Packs @a mesh's indices for upload, 16 bit while every vertex can be reached with them and
+     * 32 bit otherwise
+     * @return the bytes of each index in @a packed, 2 or 4
+     */
+    static size_t packIndices(const MeshData &mesh, std::vector<uint8_t> &packed);
+
+    /*!
+     * Simulates a FIFO post-transform cache of @a cacheSize entries
+     */
+    static VertexCacheStats analyzeVertexCache(const std::vector<uint32_t> &indices,
+                                               size_t vertexCount,
+                                               unsigned cacheSize = 16);
+};
+
+#endif //ANDROIDGLINVESTIGATIONS_MESHBUILDER_H
@@ -0,0 +1,602 @@
+#include "MipGenerator.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <glm/gtc/color_space.hpp>
+#include <glm/gtc/constants.hpp>
+
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+#include <glm/simd/common.h>
+#elif GLM_ARCH & GLM_ARCH_NEON_BIT
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+constexpr size_t kChannels = 4;
+
+// linear values go back to sRGB through a table this long, fine enough for 8 bit results
+constexpr size_t kEncodeTableSize = 4096;
+
+// the sinc filters reach this many texels of the new level either side
+constexpr float kSincSupport = 3.0f;
+// the Kaiser window's shape, larger is smoother and blurrier
+constexpr float kKaiserAlpha = 4.0f;
+
+/*!
+ * RGBA floats, premultiplied and linear for sRGB images
+ */
+struct FloatImage {
+    uint32_t width;
+    uint32_t height;
+    std::vector<float> texels;
+};
+
+/*!
+ * Which texels of the level above, and how much of each, make up every texel of the new level
+ * along one axis. Each new texel has @a count taps, the short ones padded with zero weights.
+ */
+struct Taps {
+    size_t count = 0;
+    std::vector<uint32_t> indices;
+    std::vector<float> weights;
+};
+
+float sinc(float x) {
+    x *= glm::pi<float>();
+    return std::abs(x) < 1e-5f ? 1.0f : std::sin(x) / x;
+}
+
+/*!
+ * The zeroth order modified Bessel function of the first kind, for the Kaiser window
+ */
+float besselI0(float x) {
+    float sum = 1.0f;
+    float term = 1.0f;
+    for (int k = 1; term > sum * 1e-7f; k++) {
+        term *= (x * x) / (4.0f * k * k);
+        sum += term;
+    }
+    return sum;
+}
+
+float filterSupport(MipFilter filter) {
+    return filter == MipFilter::Box ? 0.5f : kSincSupport;
+}
+
+/*!
+ * @param x distance from the center of the new texel, in its texels
+ */
+float filterWeight(MipFilter filter, float x) {
+    x = std::abs(x);
+    switch (filter) {
+        case MipFilter::Box:
+            return x <= 0.5f ? 1.0f : 0.0f;
+        case MipFilter::Kaiser: {
+            if (x >= kSincSupport) {
+                return 0.0f;
+            }
+            const float t = x / kSincSupport;
+            return sinc(x) * besselI0(kKaiserAlpha * std::sqrt(1.0f - t * t)) / besselI0(kKaiserAlpha);
+        }
+        case MipFilter::Lanczos:
+            return x >= kSincSupport ? 0.0f : sinc(x) * sinc(x / kSincSupport);
+    }
+    return 0.0f;
+}
+
+Taps makeTaps(uint32_t source, uint32_t destination, MipFilter filter) {
+    const float scale = float(source) / float(destination);
+    const float reach = filterSupport(filter) * scale;
+
+    std::vector<std::vector<std::pair<uint32_t, float>>> texels(destination);
+    Taps taps;
+    for (uint32_t i = 0; i < destination; i++) {
+        const float center = (i + 0.5f) * scale;
+        const auto first = static_cast<int>(std::floor(center - reach));
+        const auto last = static_cast<int>(std::ceil(center + reach));
+        float sum = 0.0f;
+        for (int j = first; j <= last; j++) {
+            const float weight = filterWeight(filter, (j + 0.5f - center) / scale);
+            if (weight == 0.0f) {
+                continue;
+            }
+            // clamped at the edges, like the textures are sampled
+            texels[i].emplace_back(std::clamp(j, 0, static_cast<int>(source) - 1), weight);
+            sum += weight;
+        }
+        for (auto &tap: texels[i]) {
+            tap.second /= sum;
+        }
+        taps.count = std::max(taps.count, texels[i].size());
+    }
+
+    taps.indices.assign(destination * taps.count, 0);
+    taps.weights.assign(destination * taps.count, 0.0f);
+    for (uint32_t i = 0; i < destination; i++) {
+        for (size_t k = 0; k < texels[i].size(); k++) {
+            taps.indices[i * taps.count + k] = texels[i][k].first;
+            taps.weights[i * taps.count + k] = texels[i][k].second;
+        }
+    }
+    return taps;
+}
+
+void gatherScalar(const float *texels, const uint32_t *indices, const float *weights, size_t count, float *out) {
+    float sum[kChannels] = {};
+    for (size_t k = 0; k < count; k++) {
+        for (size_t c = 0; c < kChannels; c++) {
+            sum[c] = weights[k] * texels[indices[k] * kChannels + c] + sum[c];
+        }
+    }
+    std::copy(sum, sum + kChannels, out);
+}
+
+/*!
+ * One texel of the horizontal pass: the weighted sum of the texels at @a indices
+ */
+inline void gather(const float *texels, const uint32_t *indices, const float *weights, size_t count, float *out,
+                   bool simd) {
+    if (!simd) {
+        gatherScalar(texels, indices, weights, count, out);
+        return;
+    }
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+    glm_vec4 sum = _mm_setzero_ps();
+    for (size_t k = 0; k < count; k++) {
+        sum = glm_vec4_fma(_mm_set1_ps(weights[k]), _mm_loadu_ps(texels + indices[k] * kChannels), sum);
+    }
+    _mm_storeu_ps(out, sum);
+#elif GLM_ARCH & GLM_ARCH_NEON_BIT
+    float32x4_t sum = vdupq_n_f32(0.0f);
+    for (size_t k = 0; k < count; k++) {
+        sum = vmlaq_n_f32(sum, vld1q_f32(texels + indices[k] * kChannels), weights[k]);
+    }
+    vst1q_f32(out, sum);
+#else
+    gatherScalar(texels, indices, weights, count, out);
+#endif
+}
+
+void accumulateScalar(float *out, const float *const *rows, const float *weights, size_t count, size_t floats) {
+    std::fill(out, out + floats, 0.0f);
+    for (size_t k = 0; k < count; k++) {
+        for (size_t i = 0; i < floats; i++) {
+            out[i] = weights[k] * rows[k][i] + out[i];
+        }
+    }
+}
+
+/*!
+ * The vertical pass for one new row: the weighted sum of whole @a rows into @a out. The scalar
+ * version adds a tap at a time, going through @a out once per tap. The SIMD one keeps two texels'
+ * sums in registers across every tap, so @a out is written once, in the same order of operations.
+ */
+inline void accumulate(float *out, const float *const *rows, const float *weights, size_t count, size_t floats,
+                       bool simd) {
+    if (!simd) {
+        accumulateScalar(out, rows, weights, count, floats);
+        return;
+    }
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+    size_t i = 0;
+    for (; i + 2 * kChannels <= floats; i += 2 * kChannels) {
+        glm_vec4 first = _mm_setzero_ps();
+        glm_vec4 second = _mm_setzero_ps();
+        for (size_t k = 0; k < count; k++) {
+            const glm_vec4 weight = _mm_set1_ps(weights[k]);
+            first = glm_vec4_fma(weight, _mm_loadu_ps(rows[k] + i), first);
+            second = glm_vec4_fma(weight, _mm_loadu_ps(rows[k] + i + kChannels), second);
+        }
+        _mm_storeu_ps(out + i, first);
+        _mm_storeu_ps(out + i + kChannels, second);
+    }
+    if (i < floats) {
+        glm_vec4 sum = _mm_setzero_ps();
+        for (size_t k = 0; k < count; k++) {
+            sum = glm_vec4_fma(_mm_set1_ps(weights[k]), _mm_loadu_ps(rows[k] + i), sum);
+        }
+        _mm_storeu_ps(out + i, sum);
+    }
+#elif GLM_ARCH & GLM_ARCH_NEON_BIT
+    size_t i = 0;
+    for (; i + 2 * kChannels <= floats; i += 2 * kChannels) {
+        float32x4_t first = vdupq_n_f32(0.0f);
+        float32x4_t second = vdupq_n_f32(0.0f);
+        for (size_t k = 0; k < count; k++) {
+            first = vmlaq_n_f32(first, vld1q_f32(rows[k] + i), weights[k]);
+            second = vmlaq_n_f32(second, vld1q_f32(rows[k] + i + kChannels), weights[k]);
+        }
+        vst1q_f32(out + i, first);
+        vst1q_f32(out + i + kChannels, second);
+    }
+    if (i < floats) {
+        float32x4_t sum = vdupq_n_f32(0.0f);
+        for (size_t k = 0; k < count; k++) {
+            sum = vmlaq_n_f32(sum, vld1q_f32(rows[k] + i), weights[k]);
+        }
+        vst1q_f32(out + i, sum);
+    }
+#else
+    accumulateScalar(out, rows, weights, count, floats);
+#endif
+}
+
+/*!
+ * Filters the level @a width by @a height texels that @a rows gives a row at a time down to the
+ * next level
+ */
+template<typename Rows>
+FloatImage downsample(uint32_t width, uint32_t height, Rows &rows, MipFilter filter, bool simd) {
+    FloatImage level;
+    level.width = std::max<uint32_t>(width / 2, 1);
+    level.height = std::max<uint32_t>(height / 2, 1);
+    const Taps horizontal = makeTaps(width, level.width, filter);
+    const Taps vertical = makeTaps(height, level.height, filter);
+
+    // A row at a time: down into one row of the source width, then across into the new level.
+    // The row stays in cache, where filtering across first would go through a buffer as tall as
+    // the source
+    const size_t sourceRowFloats = size_t(width) * kChannels;
+    const size_t rowFloats = size_t(level.width) * kChannels;
+    std::vector<float> row(sourceRowFloats);
+    std::vector<const float *> tapRows(vertical.count);
+    std::vector<float> tapWeights(vertical.count);
+    level.texels.resize(rowFloats * level.height);
+    for (uint32_t y = 0; y < level.height; y++) {
+        // the padding taps add nothing
+        size_t taps = 0;
+        for (size_t k = 0; k < vertical.count; k++) {
+            const float weight = vertical.weights[y * vertical.count + k];
+            if (weight != 0.0f) {
+                tapRows[taps] = rows(vertical.indices[y * vertical.count + k]);
+                tapWeights[taps++] = weight;
+            }
+        }
+        accumulate(row.data(), tapRows.data(), tapWeights.data(), taps, sourceRowFloats, simd);
+        float *out = &level.texels[y * rowFloats];
+        for (uint32_t x = 0; x < level.width; x++) {
+            gather(row.data(), &horizontal.indices[x * horizontal.count], &horizontal.weights[x * horizontal.count],
+                   horizontal.count, out + x * kChannels, simd);
+        }
+    }
+    return level;
+}
+
+const std::array<float, 256> &decodeTable() {
+    static const auto table = []() {
+        std::array<float, 256> values{};
+        for (size_t i = 0; i < values.size(); i++) {
+            values[i] = glm::convertSRGBToLinear(glm::vec3(i / 255.0f)).x;
+        }
+        return values;
+    }();
+    return table;
+}
+
+const std::array<uint8_t, kEncodeTableSize> &encodeTable() {
+    static const auto table = []() {
+        std::array<uint8_t, kEncodeTableSize> values{};
+        for (size_t i = 0; i < values.size(); i++) {
+            const float encoded = glm::convertLinearToSRGB(glm::vec3(i / float(kEncodeTableSize - 1))).x;
+            values[i] = static_cast<uint8_t>(std::lround(encoded * 255.0f));
+        }
+        return values;
+    }();
+    return table;
+}
+
+const std::array<float, 256> &unitTable() {
+    static const auto table = []() {
+        std::array<float, 256> values{};
+        for (size_t i = 0; i < values.size(); i++) {
+            values[i] = i / 255.0f;
+        }
+        return values;
+    }();
+    return table;
+}
+
+void toFloatScalar(const uint8_t *in, size_t texels, bool srgb, float *out) {
+    const auto &decode = decodeTable();
+    for (size_t i = 0; i < texels * kChannels; i += kChannels) {
+        const float alpha = in[i + 3] / 255.0f;
+        if (srgb) {
+            for (size_t c = 0; c < 3; c++) {
+                out[i + c] = decode[in[i + c]] * alpha;
+            }
+        } else {
+            for (size_t c = 0; c < 3; c++) {
+                out[i + c] = in[i + c] / 255.0f;
+            }
+        }
+        out[i + 3] = alpha;
+    }
+}
+
+/*!
+ * A row of 8 bit texels to floats, linear and premultiplied for sRGB. The SIMD version looks
+ * every channel up in a table instead of dividing, and premultiplies a texel with one multiply.
+ */
+inline void toFloat(const uint8_t *in, size_t texels, bool srgb, float *out, bool simd) {
+    if (!simd) {
+        toFloatScalar(in, texels, srgb, out);
+        return;
+    }
+    const auto &color = srgb ? decodeTable() : unitTable();
+    const auto &unit = unitTable();
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+    for (size_t i = 0; i < texels * kChannels; i += kChannels) {
+        const float alpha = unit[in[i + 3]];
+        glm_vec4 texel = _mm_set_ps(srgb ? 1.0f : alpha, color[in[i + 2]], color[in[i + 1]], color[in[i]]);
+        if (srgb) {
+            // alpha times one is alpha
+            texel = _mm_mul_ps(texel, _mm_set1_ps(alpha));
+        }
+        _mm_storeu_ps(out + i, texel);
+    }
+#elif GLM_ARCH & GLM_ARCH_NEON_BIT
+    for (size_t i = 0; i < texels * kChannels; i += kChannels) {
+        const float alpha = unit[in[i + 3]];
+        const float lanes[kChannels] = {color[in[i]], color[in[i + 1]], color[in[i + 2]], srgb ? 1.0f : alpha};
+        float32x4_t texel = vld1q_f32(lanes);
+        if (srgb) {
+            // alpha times one is alpha
+            texel = vmulq_n_f32(texel, alpha);
+        }
+        vst1q_f32(out + i, texel);
+    }
+#else
+    toFloatScalar(in, texels, srgb, out);
+#endif
+}
+
+/*!
+ * The rows of a level already in floats
+ */
+struct FloatRows {
+    const FloatImage &level;
+
+    const float *operator()(uint32_t y) const {
+        return &level.texels[size_t(y) * level.width * kChannels];
+    }
+};
+
+/*!
+ * The rows of the image itself, converted to floats as the filter asks for them. The vertical
+ * taps of consecutive new rows slide down the image, so a ring as long as the taps converts each
+ * row once without a float copy of the whole image, four times its size.
+ */
+class ImageRows {
+public:
+    ImageRows(const DecodedImage &image, bool srgb, MipFilter filter, bool simd)
+            : image_(image), srgb_(srgb), simd_(simd), tags_(ringRows(filter), UINT32_MAX) {
+        ring_.resize(size_t(image.width) * kChannels * tags_.size());
+    }
+
+    const float *operator()(uint32_t y) {
+        const size_t slot = y % tags_.size();
+        float *row = &ring_[slot * image_.width * kChannels];
+        if (tags_[slot] != y) {
+            toFloat(&image_.pixels[size_t(y) * image_.width * kChannels], image_.width, srgb_, row, simd_);
+            tags_[slot] = y;
+        }
+        return row;
+    }
+
+private:
+    /*!
+     * @return how many rows of the image the vertical taps of one new row can span. Halving, the
+     * filter reaches twice its support either side, plus a row for rounding at each end
+     */
+    static size_t ringRows(MipFilter filter) {
+        return 2 * static_cast<size_t>(std::ceil(2.0f * filterSupport(filter))) + 2;
+    }
+
+    const DecodedImage &image_;
+    bool srgb_;
+    bool simd_;
+    std::vector<float> ring_;
+    std::vector<uint32_t> tags_;
+};
+
+uint8_t toByte(float value) {
+    return static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+void toBytesScalar(const float *texels, size_t count, bool srgb, float alphaScale, uint8_t *out) {
+    const auto &encode = encodeTable();
+    for (size_t i = 0; i < count * kChannels; i += kChannels) {
+        // the sinc filters overshoot around edges, so everything is clamped
+        const float alpha = std::clamp(texels[i + 3], 0.0f, 1.0f);
+        for (size_t c = 0; c < 3; c++) {
+            if (srgb) {
+                const float linear = alpha > 0.0f ? std::clamp(texels[i + c] / alpha, 0.0f, 1.0f) : 0.0f;
+                out[i + c] = encode[static_cast<size_t>(linear * (kEncodeTableSize - 1) + 0.5f)];
+            } else {
+                out[i + c] = toByte(texels[i + c]);
+            }
+        }
+        out[i + 3] = toByte(alpha * alphaScale);
+    }
+}
+
+/*!
+ * @a count texels back to 8 bits, @a alphaScale applied to alpha. The SIMD version clamps,
+ * unpremultiplies and rounds a whole texel at once, with one divide where the scalar one has three,
+ * and only the sRGB table lookups are done a channel at a time.
+ */
+inline void toBytes(const float *texels, size_t count, bool srgb, float alphaScale, uint8_t *out, bool simd) {
+    if (!simd) {
+        toBytesScalar(texels, count, srgb, alphaScale, out);
+        return;
+    }
+    const auto &encode = encodeTable();
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+    const glm_vec4 zero = _mm_setzero_ps();
+    const glm_vec4 one = _mm_set1_ps(1.0f);
+    const glm_vec4 half = _mm_set1_ps(0.5f);
+    const glm_vec4 byteScale = _mm_set1_ps(255.0f);
+    const glm_vec4 tableScale = _mm_set1_ps(float(kEncodeTableSize - 1));
+    // clamped before and after scaling, like toByte(alpha * alphaScale), the color lanes times one
+    const glm_vec4 channelScale = _mm_set_ps(alphaScale, 1.0f, 1.0f, 1.0f);
+    for (size_t i = 0; i < count * kChannels; i += kChannels) {
+        const glm_vec4 texel = _mm_loadu_ps(texels + i);
+        const glm_vec4 clamped = _mm_min_ps(_mm_max_ps(texel, zero), one);
+        const glm_vec4 scaled = _mm_min_ps(_mm_max_ps(_mm_mul_ps(clamped, channelScale), zero), one);
+        __m128i bytes = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(scaled, byteScale), half));
+        bytes = _mm_packus_epi16(_mm_packs_epi32(bytes, bytes), bytes);
+        const int packed = _mm_cvtsi128_si32(bytes);
+        memcpy(out + i, &packed, kChannels);
+        if (srgb) {
+            const glm_vec4 alpha = _mm_shuffle_ps(clamped, clamped, _MM_SHUFFLE(3, 3, 3, 3));
+            // the max takes its second operand for the NaN of a clear texel, which the mask clears anyway
+            glm_vec4 linear = _mm_min_ps(_mm_max_ps(_mm_div_ps(texel, alpha), zero), one);
+            linear = _mm_and_ps(linear, _mm_cmpgt_ps(alpha, zero));
+            alignas(16) int32_t index[kChannels];
+            _mm_store_si128(reinterpret_cast<__m128i *>(index),
+                            _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(linear, tableScale), half)));
+            out[i] = encode[index[0]];
+            out[i + 1] = encode[index[1]];
+            out[i + 2] = encode[index[2]];
+        }
+    }
+#elif (GLM_ARCH & GLM_ARCH_NEON_BIT) && defined(__aarch64__)
+    // 32 bit NEON has no divide and takes the scalar version below
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t half = vdupq_n_f32(0.5f);
+    const float channelScales[kChannels] = {1.0f, 1.0f, 1.0f, alphaScale};
+    const float32x4_t channelScale = vld1q_f32(channelScales);
+    for (size_t i = 0; i < count * kChannels; i += kChannels) {
+        const float32x4_t texel = vld1q_f32(texels + i);
+        const float32x4_t clamped = vminq_f32(vmaxq_f32(texel, zero), one);
+        const float32x4_t scaled = vminq_f32(vmaxq_f32(vmulq_f32(clamped, channelScale), zero), one);
+        const uint32x4_t bytes = vcvtq_u32_f32(vaddq_f32(vmulq_n_f32(scaled, 255.0f), half));
+        const uint16x4_t shorts = vmovn_u32(bytes);
+        const uint32_t packed = vget_lane_u32(vreinterpret_u32_u8(vmovn_u16(vcombine_u16(shorts, shorts))), 0);
+        memcpy(out + i, &packed, kChannels);
+        if (srgb) {
+            const float32x4_t alpha = vdupq_laneq_f32(clamped, 3);
+            // NEON's max passes a clear texel's NaN through, the mask clears it
+            float32x4_t linear = vminq_f32(vmaxq_f32(vdivq_f32(texel, alpha), zero), one);
+            linear = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(linear), vcgtq_f32(alpha, zero)));
+            const uint32x4_t index = vcvtq_u32_f32(vaddq_f32(vmulq_n_f32(linear, float(kEncodeTableSize - 1)), half));
+            out[i] = encode[vgetq_lane_u32(index, 0)];
+            out[i + 1] = encode[vgetq_lane_u32(index, 1)];
+            out[i + 2] = encode[vgetq_lane_u32(index, 2)];
+        }
+    }
+#else
+    (void) encode;
+    toBytesScalar(texels, count, srgb, alphaScale, out);
+#endif
+}
+
+DecodedImage toBytes(const FloatImage &level, bool srgb, float alphaScale, bool simd) {
+    DecodedImage image;
+    image.width = level.width;
+    image.height = level.height;
+    image.pixels.resize(level.texels.size());
+    toBytes(level.texels.data(), level.texels.size() / kChannels, srgb, alphaScale, image.pixels.data(), simd);
+    return image;
+}
+
+float coverage(const FloatImage &level, float cutoff, float alphaScale) {
+    size_t covered = 0;
+    for (size_t i = 3; i < level.texels.size(); i += kChannels) {
+        covered += level.texels[i] * alphaScale > cutoff ? 1 : 0;
+    }
+    return float(covered) / float(level.texels.size() / kChannels);
+}
+
+float coverage(const DecodedImage &image, float cutoff) {
+    size_t covered = 0;
+    for (size_t i = 3; i < image.pixels.size(); i += kChannels) {
+        covered += image.pixels[i] / 255.0f > cutoff ? 1 : 0;
+    }
+    return float(covered) / float(image.pixels.size() / kChannels);
+}
+
+/*!
+ * @return the scale for @a level's alpha nearest to 1 that brings its coverage to @a target
+ */
+float coverageScale(const FloatImage &level, float cutoff, float target) {
+    const float current = coverage(level, cutoff, 1.0f);
+    if (current == target) {
+        return 1.0f;
+    }
+    if (current < target) {
+        // the smallest scale above 1 that covers enough
+        float low = 1.0f;
+        float high = 2.0f;
+        while (coverage(level, cutoff, high) < target && high < 256.0f) {
+            low = high;
+            high *= 2.0f;
+        }
+        for (int step = 0; step < 16; step++) {
+            const float middle = 0.5f * (low + high);
+            (coverage(level, cutoff, middle) < target ? low : high) = middle;
+        }
+        return high;
+    }
+    // the largest scale below 1 that doesn't cover too much
+    float low = 0.0f;
+    float high = 1.0f;
+    for (int step = 0; step < 16; step++) {
+        const float middle = 0.5f * (low + high);
+        (coverage(level, cutoff, middle) > target ? high : low) = middle;
+    }
+    return low;
+}
+
+} // namespace
+
+MipGenerator::MipGenerator(const Options &options) : options_(options) {}
+
+std::vector<DecodedImage> MipGenerator::generate(const DecodedImage &image) const {
+    return generate(image, true);
+}
+
+std::vector<DecodedImage> MipGenerator::generateScalar(const DecodedImage &image) const {
+    return generate(image, false);
+}
+
+uint32_t MipGenerator::levelCount(uint32_t width, uint32_t height) {
+    uint32_t levels = 1;
+    for (uint32_t size = std::max(width, height); size > 1; size >>= 1) {
+        levels++;
+    }
+    return levels;
+}
+
+std::vector<DecodedImage> MipGenerator::generate(const DecodedImage &image, bool simd) const {
+    std::vector<DecodedImage> levels;
+    if (image.width == 0 || image.height == 0) {
+        return levels;
+    }
+    levels.reserve(levelCount(image.width, image.height) - 1);
+
+    const float cutoff = options_.alphaCutoff;
+    const float targetCoverage = cutoff > 0.0f ? coverage(image, cutoff) : 0.0f;
+    const auto addLevel = [&](const FloatImage &level) {
+        // each level comes from the unscaled one above, so the coverage fix doesn't compound
+        const float alphaScale = cutoff > 0.0f ? coverageScale(level, cutoff, targetCoverage) : 1.0f;
+        levels.push_back(toBytes(level, options_.srgb, alphaScale, simd));
+    };
+    if (image.width == 1 && image.height == 1) {
+        return levels;
+    }
+    ImageRows imageRows(image, options_.srgb, options_.filter, simd);
+    FloatImage level = downsample(image.width, image.height, imageRows, options_.filter, simd);
+    addLevel(level);
+    while (level.width > 1 || level.height > 1) {
+        FloatRows rows{level};
+        level = downsample(level.width, level.height, rows, options_.filter, simd);
+        addLevel(level);
+    }
+    return levels;
+}
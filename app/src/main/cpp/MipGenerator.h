@@ -0,0 +1,70 @@
+#ifndef ANDROIDGLINVESTIGATIONS_MIPGENERATOR_H
+#define ANDROIDGLINVESTIGATIONS_MIPGENERATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ImageDecoder.h"
+
+enum class MipFilter {
+    // the average of the texels under each new texel, cheapest and softest
+    Box,
+    // windowed sinc, Kaiser window, 3 texels of the new level either side
+    Kaiser,
+    // windowed sinc, Lanczos window, 3 texels of the new level either side. The sharpest, and
+    // rings a little around hard edges
+    Lanczos,
+};
+
+/*!
+ * Builds mip chains on the CPU, so textures can go up with every level instead of waiting on
+ * glGenerateMipmap, which filters the encoded values and on some drivers stalls the render thread.
+ * Runs on the streaming workers or offline in texture_encoder.
+ *
+ * Each level is filtered from the one above it, separably, in floats. With SSE2 or NEON, where glm
+ * found them, the filter and the conversions to and from 8 bits work on a whole RGBA texel at a
+ * time, and the vertical pass sums every tap of a texel in registers before storing it.
+ */
+class MipGenerator {
+public:
+    struct Options {
+        MipFilter filter = MipFilter::Kaiser;
+        // The texels are sRGB encoded colors with straight alpha, the usual for images: they're
+        // filtered linear and premultiplied, so neither gamma nor transparent texels darken the
+        // mips. Off for data such as normal maps, each channel is then filtered as it is.
+        bool srgb = true;
+        // Scales each level's alpha so the same fraction of texels is above this as in the full
+        // size image, which keeps alpha tested cutouts from thinning out into nothing in the
+        // distance. 0 leaves alpha as filtered.
+        float alphaCutoff = 0.0f;
+    };
+
+    MipGenerator() : MipGenerator(Options()) {}
+
+    explicit MipGenerator(const Options &options);
+
+    /*!
+     * @return levels 1 and down of @a image, each half the size of the last, down to 1x1
+     */
+    std::vector<DecodedImage> generate(const DecodedImage &image) const;
+
+    /*!
+     * Scalar reference version of @a generate, gives the same levels
+     */
+    std::vector<DecodedImage> generateScalar(const DecodedImage &image) const;
+
+    /*!
+     * @return the number of levels in a full chain for @a width by @a height, the image included
+     */
+    static uint32_t levelCount(uint32_t width, uint32_t height);
+
+    inline const Options &getOptions() const { return options_; }
+
+private:
+    std::vector<DecodedImage> generate(const DecodedImage &image, bool simd) const;
+
+    Options options_;
+};
+
+#endif //ANDROIDGLINVESTIGATIONS_MIPGENERATOR_H
@@ -1,40 +1,167 @@
 #ifndef ANDROIDGLINVESTIGATIONS_MODEL_H
 #define ANDROIDGLINVESTIGATIONS_MODEL_H
 
+#include <array>
+#include <cassert>
 #include <vector>
 #include "TextureAsset.h"
+#include "VertexLayout.h"
 #include <glm/glm.hpp>
 
+/*!
+ * What a draw needs from a mesh. Each pass gets its own VAO so it only fetches the streams it reads.
+ */
+enum class VertexPass {
+    // every attribute, for shading
+    Shaded,
+    // positions only, for the lamp and depth style passes
+    PositionOnly,
+};
+
+constexpr int kVertexPassCount = 2;
+
+/*!
+ * A mesh's vertex arrays and buffers, deleted with it. Move only, usually kept in a
+ * ResourceRegistry and passed around as a MeshHandle.
+ */
 class Model {
 public:
+    /*!
+     * @param vertexArrays one VAO per VertexPass
+     * @param vertexBuffers one vertex buffer per stream of @a vertexLayout, 0 for unused streams
+     * @param indexType GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, the size of what's in @a indexBuffer
+     */
     inline Model(
-            GLuint vertexArray,
-            GLuint vertexBuffers
+            const std::array<GLuint, kVertexPassCount> &vertexArrays,
+            const std::array<GLuint, kMaxVertexStreams> &vertexBuffers,
+            GLuint indexBuffer,
+            GLsizei indexCount,
+            GLenum indexType,
+            const VertexLayout &vertexLayout
             )
-            : vertexArray_(std::move(vertexArray)),
-              vertexBuffers_(std::move(vertexBuffers)) {}
+            : vertexArrays_(vertexArrays),
+              vertexBuffers_(vertexBuffers),
+              indexBuffer_(indexBuffer),
+              indexCount_(indexCount),
+              indexType_(indexType),
+              vertexLayout_(vertexLayout) {
+        assert(indexType == GL_UNSIGNED_SHORT || indexType == GL_UNSIGNED_INT);
+    }
+
+    inline Model(Model &&other) noexcept
+            : texture_(other.texture_),
+              vertexArrays_(other.vertexArrays_),
+              vertexBuffers_(other.vertexBuffers_),
+              indexBuffer_(other.indexBuffer_),
+              indexCount_(other.indexCount_),
+              indexType_(other.indexType_),
+              vertexLayout_(other.vertexLayout_) {
+        other.forget();
+    }
+
+    inline Model &operator=(Model &&other) noexcept {
+        if (this != &other) {
+            release();
+            texture_ = other.texture_;
+            vertexArrays_ = other.vertexArrays_;
+            vertexBuffers_ = other.vertexBuffers_;
+            indexBuffer_ = other.indexBuffer_;
+            indexCount_ = other.indexCount_;
+            indexType_ = other.indexType_;
+            vertexLayout_ = other.vertexLayout_;
+            other.forget();
+        }
+        return *this;
+    }
+
+    Model(const Model &) = delete;
+
+    Model &operator=(const Model &) = delete;
+
+    inline ~Model() {
+        release();
+    }
 
-    inline const TextureAsset &getTexture() const {
-        return *spTexture_;
+    /*!
+     * @return the texture drawn on the mesh, looked up in the ResourceRegistry it came from. Null if
+     * there's none.
+     */
+    inline TextureHandle getTexture() const {
+        return texture_;
     }
 
-    inline const TextureAsset setTexture(TextureAsset *spTexture) {
-        spTexture_ = std::shared_ptr<TextureAsset>(spTexture);
+    inline void setTexture(TextureHandle texture) {
+        texture_ = texture;
     }
 
-    inline const GLuint getVAO() const {
-        return vertexArray_;
+    /*!
+     * @return the VAO set up for @a pass, binding only the streams that pass reads
+     */
+    inline const GLuint getVAO(VertexPass pass = VertexPass::Shaded) const {
+        return vertexArrays_[static_cast<int>(pass)];
     }
 
-    inline const GLuint getVBOs() const {
+    inline const std::array<GLuint, kMaxVertexStreams> &getVBOs() const {
         return vertexBuffers_;
     }
 
+    inline const GLuint getIBO() const {
+        return indexBuffer_;
+    }
+
+    /*!
+     * @return the number of indices to pass to glDrawElements
+     */
+    inline const GLsizei getIndexCount() const {
+        return indexCount_;
+    }
+
+    /*!
+     * @return GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+     */
+    inline const GLenum getIndexType() const {
+        return indexType_;
+    }
+
+    /*!
+     * @return how the vertex buffer is laid out, including the scale and bias needed to expand
+     * quantized positions
+     */
+    inline const VertexLayout &getVertexLayout() const {
+        return vertexLayout_;
+    }
 
 private:
-    std::shared_ptr<TextureAsset> spTexture_;
-    GLuint vertexArray_;
-    GLuint vertexBuffers_;
+    /*!
+     * Deletes the GL objects, 0s are skipped by GL
+     */
+    inline void release() {
+        if (indexBuffer_) {
+            glDeleteVertexArrays(kVertexPassCount, vertexArrays_.data());
+            glDeleteBuffers(kMaxVertexStreams, vertexBuffers_.data());
+            glDeleteBuffers(1, &indexBuffer_);
+        }
+        forget();
+    }
+
+    /*!
+     * Lets go of the GL objects without deleting them, after they've been moved elsewhere
+     */
+    inline void forget() {
+        texture_ = TextureHandle();
+        vertexArrays_.fill(0);
+        vertexBuffers_.fill(0);
+        indexBuffer_ = 0;
+        indexCount_ = 0;
+    }
+
+    TextureHandle texture_;
+    std::array<GLuint, kVertexPassCount> vertexArrays_;
+    std::array<GLuint, kMaxVertexStreams> vertexBuffers_;
+    GLuint indexBuffer_;
+    GLsizei indexCount_;
+    GLenum indexType_;
+    VertexLayout vertexLayout_;
 };
 
 #endif //ANDROIDGLINVESTIGATIONS_MODEL_H
\ No newline at end of file
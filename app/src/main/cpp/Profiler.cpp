@@ -0,0 +1,223 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifdef __ANDROID__
+#include <android/trace.h>
+#endif
+
+namespace {
+
+// events kept per track, a few seconds of markers at 60 fps
+constexpr size_t kTrackCapacity = 1 << 14;
+
+// threads and named tracks together, threads that exit hand theirs back
+constexpr size_t kMaxTracks = 64;
+
+/*!
+ * A ring of events written by one thread and read by whoever dumps the trace. Slots are relaxed
+ * atomics so a dump racing a write is well defined, @a written tells the reader which slots it can
+ * trust.
+ */
+struct Track {
+    struct Slot {
+        std::atomic<const char *> name;
+        std::atomic<uint64_t> begin;
+        std::atomic<uint64_t> end;
+    };
+
+    std::string name;
+    int id = 0;
+    bool inUse = false;
+    std::atomic<uint64_t> written{0};
+    Slot slots[kTrackCapacity];
+
+    void push(const char *eventName, uint64_t begin, uint64_t end) {
+        const uint64_t index = written.load(std::memory_order_relaxed);
+        Slot &slot = slots[index & (kTrackCapacity - 1)];
+        slot.name.store(eventName, std::memory_order_relaxed);
+        slot.begin.store(begin, std::memory_order_relaxed);
+        slot.end.store(end, std::memory_order_relaxed);
+        written.store(index + 1, std::memory_order_release);
+    }
+};
+
+struct Registry {
+    std::mutex mutex;
+    // filled in order and never freed, so a track can be found by id without the lock
+    std::unique_ptr<Track> tracks[kMaxTracks];
+    size_t count = 0;
+
+    /*!
+     * Hands out a track, reusing one left behind by a thread that exited. Caller holds the mutex.
+     * @return nullptr once every track is taken
+     */
+    Track *acquire(const std::string &name) {
+        for (size_t i = 0; i < count; i++) {
+            if (!tracks[i]->inUse && tracks[i]->name == name) {
+                tracks[i]->inUse = true;
+                return tracks[i].get();
+            }
+        }
+        if (count == kMaxTracks) {
+            return nullptr;
+        }
+        tracks[count] = std::make_unique<Track>();
+        Track *track = tracks[count++].get();
+        track->name = name;
+        track->id = static_cast<int>(count);
+        track->inUse = true;
+        return track;
+    }
+};
+
+Registry &registry() {
+    static Registry instance;
+    return instance;
+}
+
+/*!
+ * The calling thread's track, created on first use and handed back when the thread exits
+ */
+struct ThreadTrack {
+    Track *track = nullptr;
+    // set once the registry ran out, so the lock isn't taken for every marker after that
+    bool exhausted = false;
+
+    Track *get() {
+        if (!track && !exhausted) {
+            std::lock_guard<std::mutex> lock(registry().mutex);
+            track = registry().acquire("thread");
+            exhausted = track == nullptr;
+        }
+        return track;
+    }
+
+    ~ThreadTrack() {
+        if (track) {
+            std::lock_guard<std::mutex> lock(registry().mutex);
+            track->inUse = false;
+        }
+    }
+};
+
+thread_local ThreadTrack threadTrack;
+
+void writeJsonString(std::ostream &out, const char *text) {
+    out << '"';
+    for (const char *c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            out << '\\';
+        }
+        out << *c;
+    }
+    out << '"';
+}
+
+} // namespace
+
+uint64_t Profiler::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::setThreadName(const char *name) {
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    if (threadTrack.track) {
+        threadTrack.track->name = name;
+    } else {
+        threadTrack.track = registry().acquire(name);
+        threadTrack.exhausted = threadTrack.track == nullptr;
+    }
+}
+
+void Profiler::record(const char *name, uint64_t begin, uint64_t end) {
+    if (Track *track = threadTrack.get()) {
+        track->push(name, begin, end);
+    }
+}
+
+int Profiler::track(const char *name) {
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    for (size_t i = 0; i < registry().count; i++) {
+        if (registry().tracks[i]->name == name) {
+            return registry().tracks[i]->id;
+        }
+    }
+    // never released, so no thread can pick it up
+    Track *track = registry().acquire(name);
+    return track ? track->id : 0;
+}
+
+void Profiler::recordOnTrack(int track, const char *name, uint64_t begin, uint64_t end) {
+    if (track > 0) {
+        registry().tracks[track - 1]->push(name, begin, end);
+    }
+}
+
+void Profiler::writeChromeTrace(std::ostream &out) {
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    std::vector<Event> events;
+    bool first = true;
+    // microseconds with the nanoseconds after the point
+    auto precision = out.precision(15);
+    out << "{\"traceEvents\":[\n";
+    for (size_t t = 0; t < registry().count; t++) {
+        Track *track = registry().tracks[t].get();
+        out << (first ? "" : ",\n") << R"({"ph":"M","pid":1,"tid":)" << track->id
+            << R"(,"name":"thread_name","args":{"name":)";
+        writeJsonString(out, track->name.c_str());
+        out << "}}";
+        first = false;
+
+        // copy what's there, then drop whatever the writer lapped while we were copying
+        const uint64_t end = track->written.load(std::memory_order_acquire);
+        const uint64_t begin = end > kTrackCapacity ? end - kTrackCapacity : 0;
+        events.clear();
+        for (uint64_t i = begin; i < end; i++) {
+            const auto &slot = track->slots[i & (kTrackCapacity - 1)];
+            events.push_back({slot.name.load(std::memory_order_relaxed),
+                              slot.begin.load(std::memory_order_relaxed),
+                              slot.end.load(std::memory_order_relaxed)});
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t after = track->written.load(std::memory_order_relaxed);
+        const uint64_t firstValid = after > kTrackCapacity ? after - kTrackCapacity : 0;
+        for (uint64_t i = std::max(begin, firstValid); i < end; i++) {
+            const Event &event = events[i - begin];
+            out << ",\n" << R"({"ph":"X","pid":1,"tid":)" << track->id << R"(,"name":)";
+            writeJsonString(out, event.name);
+            out << R"(,"ts":)" << event.begin / 1000.0 << R"(,"dur":)"
+                << (event.end - event.begin) / 1000.0 << "}";
+        }
+    }
+    out << "\n]}\n";
+    out.precision(precision);
+}
+
+bool Profiler::writeChromeTrace(const std::string &path) {
+    std::ofstream file(path);
+    if (!file) {
+        return false;
+    }
+    writeChromeTrace(file);
+    return static_cast<bool>(file);
+}
+
+ProfileScope::ProfileScope(const char *name) : name_(name), begin_(Profiler::now()) {
+#ifdef __ANDROID__
+    ATrace_beginSection(name);
+#endif
+}
+
+ProfileScope::~ProfileScope() {
+#ifdef __ANDROID__
+    ATrace_endSection();
+#endif
+    Profiler::record(name_, begin_, Profiler::now());
+}
@@ -0,0 +1,105 @@
+#ifndef ANDROIDGLINVESTIGATIONS_PROFILER_H
+#define ANDROIDGLINVESTIGATIONS_PROFILER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/*!
+ * Scoped CPU markers, recorded per thread and dumped as Chrome trace JSON (chrome://tracing or
+ * ui.perfetto.dev). On Android every marker is also an ATrace section, so it shows up in systrace.
+ *
+ * Everything goes through the macros below, which expand to nothing unless PROFILER_ENABLED is
+ * defined (the ENABLE_PROFILER CMake option):
+ *
+ *  PROFILE_THREAD("render");            // once per thread, names its track
+ *  PROFILE_SCOPE("cull");               // times the enclosing scope
+ *  PROFILE_WRITE_TRACE("trace.json");   // dumps what's been recorded so far
+ *
+ * Names must be string literals or otherwise outlive the profiler, only the pointer is stored.
+ */
+class Profiler {
+public:
+    /*!
+     * One finished marker
+     */
+    struct Event {
+        const char *name;
+        // nanoseconds on the steady clock
+        uint64_t begin;
+        uint64_t end;
+    };
+
+    /*!
+     * @return the steady clock in nanoseconds
+     */
+    static uint64_t now();
+
+    /*!
+     * Names the calling thread's track in the trace
+     */
+    static void setThreadName(const char *name);
+
+    /*!
+     * Records a finished marker on the calling thread. Lock-free: each thread writes its own ring,
+     * the oldest events are overwritten once it's full.
+     */
+    static void record(const char *name, uint64_t begin, uint64_t end);
+
+    /*!
+     * Finds or creates a named track that isn't a CPU thread, for timings such as GPU queries.
+     * Takes a lock, look tracks up once and keep the id.
+     */
+    static int track(const char *name);
+
+    /*!
+     * Records a finished marker on @a track. Lock-free, but only one thread may record on a track.
+     */
+    static void recordOnTrack(int track, const char *name, uint64_t begin, uint64_t end);
+
+    /*!
+     * Writes every event still in the rings as Chrome trace JSON. Safe to call while other threads
+     * are recording, events overwritten during the copy are left out.
+     */
+    static void writeChromeTrace(std::ostream &out);
+
+    /*!
+     * @return false if @a path couldn't be written
+     */
+    static bool writeChromeTrace(const std::string &path);
+};
+
+/*!
+ * Records the lifetime of a scope, use PROFILE_SCOPE rather than this directly
+ */
+class ProfileScope {
+public:
+    explicit ProfileScope(const char *name);
+
+    ~ProfileScope();
+
+    ProfileScope(const ProfileScope &) = delete;
+
+    ProfileScope &operator=(const ProfileScope &) = delete;
+
+private:
+    const char *name_;
+    uint64_t begin_;
+};
+
+#define PROFILER_CONCAT_INNER(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_INNER(a, b)
+
+#ifdef PROFILER_ENABLED
+#define PROFILE_SCOPE(name) ProfileScope PROFILER_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_THREAD(name) Profiler::setThreadName(name)
+#define PROFILE_WRITE_TRACE(path) Profiler::writeChromeTrace(path)
+#else
+#define PROFILE_SCOPE(name) do {} while (0)
+#define PROFILE_THREAD(name) do {} while (0)
+#define PROFILE_WRITE_TRACE(path) do {} while (0)
+#endif
+
+#endif //ANDROIDGLINVESTIGATIONS_PROFILER_H
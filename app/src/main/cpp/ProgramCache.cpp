@@ -0,0 +1,169 @@
+#include "ProgramCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sys/stat.h>
+#include <utility>
+#include <vector>
+
+#include "AndroidOut.h"
+#include "Hash.h"
+
+namespace {
+
+// bump when the file layout changes, old files then just miss
+constexpr uint32_t kFileVersion = 1;
+constexpr uint32_t kMagic = 0x42475250; // "PRGB"
+
+/*!
+ * Starts every cache file, the driver's binary follows
+ */
+struct FileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t format;
+    uint32_t length;
+};
+
+/*!
+ * Chains @a string and a terminator, so "ab" + "c" and "a" + "bc" hash differently
+ */
+uint64_t hashString(const std::string &string, uint64_t hash) {
+    hash = hashBytes(string.data(), string.size(), hash);
+    const char terminator = '\0';
+    return hashBytes(&terminator, 1, hash);
+}
+
+std::string glString(GLenum name) {
+    auto *value = reinterpret_cast<const char *>(glGetString(name));
+    return value ? value : "";
+}
+
+} // namespace
+
+ProgramCache::ProgramCache(std::string directory)
+        : directory_(std::move(directory)),
+          enabled_(false),
+          driverHash_(0) {
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (directory_.empty() || formats == 0) {
+        if (formats == 0) {
+            aout << "No program binary formats, program cache off" << std::endl;
+        }
+        return;
+    }
+    // fails harmlessly when it already exists, a missing directory shows up as failed writes
+    mkdir(directory_.c_str(), 0700);
+    enabled_ = true;
+
+    uint64_t hash = hashBytes(&kFileVersion, sizeof(kFileVersion));
+    hash = hashString(glString(GL_VENDOR), hash);
+    hash = hashString(glString(GL_RENDERER), hash);
+    driverHash_ = hashString(glString(GL_VERSION), hash);
+}
+
+uint64_t ProgramCache::key(const std::string &vertexSource, const std::string &fragmentSource,
+                           const std::string &defines) const {
+    uint64_t hash = hashString(vertexSource, driverHash_);
+    hash = hashString(fragmentSource, hash);
+    return hashString(defines, hash);
+}
+
+std::string ProgramCache::pathOf(uint64_t key) const {
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx.bin", static_cast<unsigned long long>(key));
+    return directory_ + name;
+}
+
+GLuint ProgramCache::load(uint64_t key) {
+    if (!enabled_) {
+        return 0;
+    }
+    const std::string path = pathOf(key);
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        stats_.misses++;
+        return 0;
+    }
+    std::vector<char> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+
+    // a torn write or a file from another build is just a miss
+    FileHeader header{};
+    if (contents.size() < sizeof(header)) {
+        stats_.misses++;
+        remove(path.c_str());
+        return 0;
+    }
+    std::copy(contents.begin(), contents.begin() + sizeof(header), reinterpret_cast<char *>(&header));
+    if (header.magic != kMagic || header.version != kFileVersion || header.key != key
+        || header.length != contents.size() - sizeof(header)) {
+        stats_.misses++;
+        remove(path.c_str());
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.format, contents.data() + sizeof(header), header.length);
+    GLint linkStatus = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+    if (linkStatus != GL_TRUE) {
+        aout << "Driver rejected cached program " << path << ", rebuilding it" << std::endl;
+        glDeleteProgram(program);
+        remove(path.c_str());
+        stats_.misses++;
+        stats_.rejected++;
+        return 0;
+    }
+    stats_.hits++;
+    return program;
+}
+
+void ProgramCache::prepare(GLuint program) const {
+    if (enabled_) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+}
+
+void ProgramCache::store(uint64_t key, GLuint program) {
+    if (!enabled_) {
+        return;
+    }
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+    std::vector<char> binary(length);
+    FileHeader header{kMagic, kFileVersion, key, 0, 0};
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &header.format, binary.data());
+    if (written <= 0) {
+        return;
+    }
+    header.length = static_cast<uint32_t>(written);
+
+    // write next to it and move into place, a reader never sees half a file
+    const std::string path = pathOf(key);
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(binary.data(), written);
+        if (!file) {
+            aout << "Couldn't write " << temporary << std::endl;
+            file.close();
+            remove(temporary.c_str());
+            return;
+        }
+    }
+    if (rename(temporary.c_str(), path.c_str()) != 0) {
+        remove(temporary.c_str());
+        return;
+    }
+    stats_.stores++;
+}
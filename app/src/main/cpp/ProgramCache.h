@@ -0,0 +1,77 @@
+#ifndef ANDROIDGLINVESTIGATIONS_PROGRAMCACHE_H
+#define ANDROIDGLINVESTIGATIONS_PROGRAMCACHE_H
+
+#include <cstdint>
+#include <string>
+#include <GLES3/gl3.h>
+
+/*!
+ * Linked programs saved to disk with glGetProgramBinary, so later launches skip compiling and
+ * linking. A binary is only valid for the driver that made it, so the key covers the sources, the
+ * defines and the GL vendor, renderer and version strings: a driver update simply misses.
+ *
+ * Drivers may still refuse a binary, e.g. after an update that kept the version string. Such
+ * binaries are deleted and the caller builds from source as if there had been no entry.
+ *
+ * One file per program in the given directory, named after the key.
+ */
+class ProgramCache {
+public:
+    struct Stats {
+        // programs created from a cached binary
+        uint64_t hits = 0;
+        // lookups with no usable file
+        uint64_t misses = 0;
+        // binaries the driver refused, a subset of misses
+        uint64_t rejected = 0;
+        // binaries written
+        uint64_t stores = 0;
+    };
+
+    /*!
+     * Needs a current context to read the driver strings
+     * @param directory where the binaries go, created if missing. Empty turns the cache off.
+     */
+    explicit ProgramCache(std::string directory);
+
+    /*!
+     * @return false if there's no directory or the driver has no binary formats
+     */
+    inline bool isEnabled() const { return enabled_; }
+
+    /*!
+     * @return the key of the program built from these sources with these defines on this driver
+     */
+    uint64_t key(const std::string &vertexSource, const std::string &fragmentSource,
+                 const std::string &defines) const;
+
+    /*!
+     * Creates a program from the binary stored under @a key
+     * @return the linked program, or 0 if there is none or the driver refused it
+     */
+    GLuint load(uint64_t key);
+
+    /*!
+     * Call before linking a program that'll be stored, some drivers only keep the binary when
+     * asked to up front
+     */
+    void prepare(GLuint program) const;
+
+    /*!
+     * Saves the binary of the linked @a program under @a key
+     */
+    void store(uint64_t key, GLuint program);
+
+    inline const Stats &getStats() const { return stats_; }
+
+private:
+    std::string pathOf(uint64_t key) const;
+
+    std::string directory_;
+    bool enabled_;
+    // hash of the driver strings, the start of every key
+    uint64_t driverHash_;
+    Stats stats_;
+};
+
+#endif //ANDROIDGLINVESTIGATIONS_PROGRAMCACHE_H
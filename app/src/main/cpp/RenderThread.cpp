@@ -0,0 +1,92 @@
+#include "RenderThread.h"
+
+#include <cassert>
+#include <chrono>
+
+#include "Profiler.h"
+
+namespace {
+
+// how long the render thread naps when there's nothing new to draw
+constexpr auto kIdleWait = std::chrono::microseconds(500);
+
+} // namespace
+
+RenderThread::RenderThread(BackendFactory factory)
+        : factory_(std::move(factory)),
+          running_(true),
+          publishedCount_(0),
+          rendered_(0),
+          skipped_(0) {
+    for (int slot = 0; slot < kSlotCount; slot++) {
+        free_.push(slot);
+    }
+    thread_ = std::thread(&RenderThread::run, this);
+}
+
+RenderThread::~RenderThread() {
+    running_.store(false, std::memory_order_relaxed);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+FrameSnapshot *RenderThread::beginFrame() {
+    if (writing_ < 0 && !free_.pop(writing_)) {
+        writing_ = -1;
+        return nullptr;
+    }
+    return &slots_[writing_];
+}
+
+void RenderThread::publishFrame() {
+    assert(writing_ >= 0);
+    slots_[writing_].frame = nextFrame_++;
+    // there are only kSlotCount indices in flight, this can't overflow
+    bool pushed = published_.push(writing_);
+    assert(pushed);
+    (void) pushed;
+    writing_ = -1;
+    publishedCount_.fetch_add(1, std::memory_order_relaxed);
+}
+
+RenderThread::Stats RenderThread::getStats() const {
+    Stats stats;
+    stats.published = publishedCount_.load(std::memory_order_relaxed);
+    stats.rendered = rendered_.load(std::memory_order_relaxed);
+    stats.skipped = skipped_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void RenderThread::run() {
+    PROFILE_THREAD("render");
+    std::unique_ptr<RenderBackend> backend = factory_();
+
+    // the slot drawn last, held until a newer one arrives
+    int current = -1;
+    while (running_.load(std::memory_order_relaxed)) {
+        // jump to the newest snapshot, older ones go straight back to the game thread
+        int latest = -1;
+        int slot;
+        while (published_.pop(slot)) {
+            if (latest >= 0) {
+                free_.push(latest);
+                skipped_.fetch_add(1, std::memory_order_relaxed);
+            }
+            latest = slot;
+        }
+        if (latest < 0) {
+            std::this_thread::sleep_for(kIdleWait);
+            continue;
+        }
+        if (current >= 0) {
+            free_.push(current);
+        }
+        current = latest;
+
+        backend->render(slots_[current]);
+        rendered_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    backend.reset();
+}
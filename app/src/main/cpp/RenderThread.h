@@ -0,0 +1,105 @@
+#ifndef ANDROIDGLINVESTIGATIONS_RENDERTHREAD_H
+#define ANDROIDGLINVESTIGATIONS_RENDERTHREAD_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "SpscQueue.h"
+
+/*!
+ * Everything the render thread needs from the simulation to draw one frame. Written by the game
+ * thread, then read-only once published.
+ */
+struct FrameSnapshot {
+    // increases by one for every published frame
+    uint64_t frame = 0;
+    // orientation of the cube the user spins
+    glm::quat cubeRotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+};
+
+/*!
+ * Draws snapshots. Created, used and destroyed on the render thread, so a GL backend can own its
+ * context for its whole lifetime.
+ */
+class RenderBackend {
+public:
+    virtual ~RenderBackend() = default;
+
+    virtual void render(const FrameSnapshot &snapshot) = 0;
+};
+
+/*!
+ * Runs a RenderBackend on its own thread, fed with triple buffered FrameSnapshots.
+ *
+ * The game thread takes a free snapshot with @a beginFrame, fills it and hands it over with
+ * @a publishFrame; the render thread always draws the newest published snapshot and gives the
+ * others back. Both directions go through lock-free SPSC queues of slot indices, so neither thread
+ * ever waits on a lock: input and simulation for the next frame overlap with submitting this one.
+ */
+class RenderThread {
+public:
+    using BackendFactory = std::function<std::unique_ptr<RenderBackend>()>;
+
+    struct Stats {
+        uint64_t published = 0;
+        uint64_t rendered = 0;
+        // published snapshots replaced by a newer one before the render thread got to them
+        uint64_t skipped = 0;
+    };
+
+    /*!
+     * Starts the render thread
+     * @param factory called on the render thread to create the backend
+     */
+    explicit RenderThread(BackendFactory factory);
+
+    /*!
+     * Stops the render thread and destroys the backend on it
+     */
+    ~RenderThread();
+
+    RenderThread(const RenderThread &) = delete;
+
+    RenderThread &operator=(const RenderThread &) = delete;
+
+    /*!
+     * Game thread only
+     * @return a snapshot to fill for the next frame, or nullptr if the render thread still holds
+     * every slot, in which case try again later
+     */
+    FrameSnapshot *beginFrame();
+
+    /*!
+     * Game thread only. Hands the snapshot from @a beginFrame to the render thread.
+     */
+    void publishFrame();
+
+    Stats getStats() const;
+
+private:
+    static constexpr int kSlotCount = 3;
+
+    void run();
+
+    BackendFactory factory_;
+    FrameSnapshot slots_[kSlotCount];
+    // slot indices, game thread to render thread and back
+    SpscQueue<int, 4> published_;
+    SpscQueue<int, 4> free_;
+    // the slot the game thread is filling, game thread only
+    int writing_ = -1;
+    uint64_t nextFrame_ = 0;
+
+    std::atomic<bool> running_;
+    std::atomic<uint64_t> publishedCount_;
+    std::atomic<uint64_t> rendered_;
+    std::atomic<uint64_t> skipped_;
+    std::thread thread_;
+};
+
+#endif //ANDROIDGLINVESTIGATIONS_RENDERTHREAD_H
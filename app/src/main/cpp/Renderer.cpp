@@ -1,16 +1,84 @@
 #include "Renderer.h"
 
-#include <game-activity/native_app_glue/android_native_app_glue.h>
+#include <EGL/eglext.h>
 #include <glm/glm.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <vector>
-#include <android/imagedecoder.h>
 
 #include "AndroidOut.h"
+#include "MeshBuilder.h"
 #include "Shader.h"
 #include "TextureAsset.h"
 
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+namespace {
+
+/*!
+ * @return true if the space separated @a extensions list contains @a name
+ */
+bool hasExtension(const char *extensions, const char *name) {
+    if (!extensions) {
+        return false;
+    }
+    const size_t length = strlen(name);
+    for (const char *found = strstr(extensions, name); found; found = strstr(found + length, name)) {
+        bool starts = found == extensions || found[-1] == ' ';
+        bool ends = found[length] == ' ' || found[length] == '\0';
+        if (starts && ends) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// attribute locations, fixed by the layout qualifiers in cube_shader.vs and lamp_shader.vs
+constexpr GLint kPositionLocation = 0;
+constexpr GLint kNormalLocation = 1;
+constexpr GLint kInstanceModelLocation = 2;
+constexpr GLint kInstanceColorLocation = 6;
+
+/*!
+ * @return where @a position lands in [0, 1] depth, 0 at the near plane
+ */
+float depthOf(const glm::mat4 &viewProjection, const glm::vec4 &position) {
+    glm::vec4 clip = viewProjection * position;
+    return clip.w > 0.0f ? clip.z / clip.w * 0.5f + 0.5f : 0.0f;
+}
+
+/*!
+ * An indexed draw of the whole of @a model
+ */
+DrawCommand drawCommand(GLuint program, GLuint vertexArray, const Model &model, GLsizei instanceCount) {
+    DrawCommand command{};
+    command.program = program;
+    command.vertexArray = vertexArray;
+    command.mode = GL_TRIANGLES;
+    command.indexType = model.getIndexType();
+    command.indexCount = model.getIndexCount();
+    command.instanceCount = instanceCount;
+    return command;
+}
+
+} // namespace
+
 Renderer::~Renderer() {
+    // joins the decode threads, and deletes its GL objects while the context is still there
+    textures_.reset();
+    resources_.clear();
+    deleteSceneFramebuffer();
+    if (offscreenFramebuffer_) {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &offscreenFramebuffer_);
+        glDeleteRenderbuffers(1, &offscreenColor_);
+        glDeleteRenderbuffers(1, &offscreenDepth_);
+        offscreenFramebuffer_ = offscreenColor_ = offscreenDepth_ = 0;
+    }
     if (display_ != EGL_NO_DISPLAY) {
         eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
         if (context_ != EGL_NO_CONTEXT) {
@@ -26,80 +94,294 @@ Renderer::~Renderer() {
     }
 }
 
-void Renderer::render() {
+void Renderer::render(const FrameSnapshot &snapshot) {
+    PROFILE_SCOPE("render");
+    const uint64_t frameBegin = Profiler::now();
+    gpuProfiler_->beginFrame();
     updateRenderArea();
+    if (textures_) {
+        textures_->update();
+    }
+    // the last frame's commands have run, what was destroyed since can go
+    resources_.collect();
+
+    // Below full scale the scene goes into the corner of the scene framebuffer and is stretched
+    // over the output at the end. The aspect ratio stays, so the camera doesn't notice
+    const EGLint sceneWidth = std::max(1, static_cast<EGLint>(std::lround(width_ * resolutionScale_)));
+    const EGLint sceneHeight = std::max(1, static_cast<EGLint>(std::lround(height_ * resolutionScale_)));
+    const bool upscale = sceneWidth != width_ || sceneHeight != height_;
+    if (upscale && (sceneFramebufferWidth_ != width_ || sceneFramebufferHeight_ != height_)) {
+        createSceneFramebuffer();
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, upscale ? sceneFramebuffer_ : getOutputFramebuffer());
+    glViewport(0, 0, sceneWidth, sceneHeight);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    glm::mat4 view;
-    view = glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f),
-                       glm::vec3(0.0f, 0.0f, 0.0f),
-                       glm::vec3(0.0f, 1.0f, 0.0f));
-    glm::mat4 projection = glm::perspective(glm::radians(60.0f),(GLfloat)width_ / (GLfloat)height_, 0.1f, 100.0f);
-
-    if (cube_ != nullptr) {
-        cubeShader_->activate();
-        GLint objectColorLoc = glGetUniformLocation(cubeShader_->getProgram(), "objectColor");
-        GLint lightColorLoc  = glGetUniformLocation(cubeShader_->getProgram(), "lightColor");
-        GLint lightPosLoc    = glGetUniformLocation(cubeShader_->getProgram(), "lightPos");
-        GLint viewPosLoc     = glGetUniformLocation(cubeShader_->getProgram(), "viewPos");
-        glUniform3f(objectColorLoc, 1.0f, 0.5f, 0.31f);
-        glUniform3f(lightColorLoc,  1.0f, 1.0f, 1.0f);
-        glUniform3f(lightPosLoc,    lightPos.x, lightPos.y, lightPos.z);
-        glUniform3f(viewPosLoc,     cameraPos.x, cameraPos.y, cameraPos.z);
-
-        // Create camera transformations
-
-        // Get the uniform locations
-        GLint modelLoc = glGetUniformLocation(cubeShader_->getProgram(), "model");
-        GLint viewLoc  = glGetUniformLocation(cubeShader_->getProgram(),  "view");
-        GLint projLoc  = glGetUniformLocation(cubeShader_->getProgram(),  "projection");
-        // Pass the matrices to the shader
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
-
-        // Draw the container (using container's vertex attributes)
-        glBindVertexArray(cube_->getVAO());
-        glm::mat4 model;
-        model = glm::rotate(model, movementSpeed_ * 10.0f, glm::vec3(0.0f, 10.0f, 0.0f));
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
-    }
-
-    if(lamp_ != nullptr) {
-        lightShader_->activate();
-        // Get location objects for the matrices on the lamp shader (these could be different on a different shader)
-        GLint modelLoc = glGetUniformLocation(lightShader_->getProgram(), "model");
-        GLint viewLoc  = glGetUniformLocation(lightShader_->getProgram(), "view");
-        GLint projLoc  = glGetUniformLocation(lightShader_->getProgram(), "projection");
-        // Set matrices
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
-        glm::mat4 model = glm::mat4();
-        model = glm::translate(model, lightPos);
-        model = glm::scale(model, glm::vec3(0.2f)); // Make it a smaller cube
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-        // Draw the light object (using light's vertex attributes)
-        glBindVertexArray(lamp_->getVAO());
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
-    }
-    changeSpeed();
+    // the camera only rebuilds and re-uploads its matrices when it or the viewport changed
+    if (shaderNeedsNewProjectionMatrix_) {
+        camera_.setViewport(width_, height_);
+        shaderNeedsNewProjectionMatrix_ = false;
+    }
+    if (camera_.update()) {
+        CameraBlock camera;
+        camera.view = camera_.getView();
+        camera.projection = camera_.getProjection();
+        camera.viewPos = glm::vec4(camera_.getPosition(), 1.0f);
+        cameraRing_->write(kCameraBinding, camera);
+        lightsDirty_ = true;
+    }
+    if (lightsDirty_) {
+        PROFILE_SCOPE("lights");
+        lighting_->update(camera_, lights_);
+        lightsDirty_ = false;
+    }
+
+    // the spinning cube is the only thing that moves, the lamp's world matrix stays cached
+    transforms_.setRotation(cubeNode_, snapshot.cubeRotation);
+    {
+        PROFILE_SCOPE("transforms");
+        transforms_.update();
+    }
+
+    // While the first programs are still linking, frames are just the clear color. Keeps the
+    // window responsive instead of stalling the first frame on the compiler
+    selectVariants(false);
+    const Model *cube = resources_.getMeshes().get(cube_);
+    if (cube != nullptr && !isLoading()) {
+        // the first cube is the one the user spins
+        if (!cubeInstances_.empty()) {
+            setCubeTransform(0, transforms_.getWorld(cubeNode_));
+        }
+
+        // drop the cubes outside the view. While all of them are visible the instance buffer mirrors
+        // cubeInstances_ and only the dirty range is uploaded, otherwise the survivors are gathered
+        // and uploaded whole
+        cubeVisible_.resize(cubeBounds_.size());
+        size_t visibleCount;
+        {
+            PROFILE_SCOPE("cull");
+            visibleCount = FrustumCuller::cull(Frustum::fromMatrix(camera_.getViewProjection()),
+                                               cubeBounds_, cubeVisible_.data());
+        }
+        if (visibleCount == cubeInstances_.size()) {
+            PROFILE_SCOPE("upload");
+            if (cubeBufferCulled_) {
+                markCubesDirty(0, cubeInstances_.size());
+                cubeBufferCulled_ = false;
+            }
+            if (cubeDirtyBegin_ < cubeDirtyEnd_ || cubeInstanceBuffer_->getCount() != (GLsizei) cubeInstances_.size()) {
+                cubeInstanceBuffer_->upload(cubeInstances_, cubeDirtyBegin_, cubeDirtyEnd_);
+                cubeDirtyBegin_ = cubeDirtyEnd_ = 0;
+            }
+        } else {
+            PROFILE_SCOPE("upload");
+            cubeVisibleInstances_.clear();
+            for (size_t i = 0; i < visibleCount; i++) {
+                cubeVisibleInstances_.push_back(cubeInstances_[cubeVisible_[i]]);
+            }
+            cubeInstanceBuffer_->upload(cubeVisibleInstances_, 0, cubeVisibleInstances_.size());
+            cubeBufferCulled_ = true;
+            cubeDirtyBegin_ = cubeDirtyEnd_ = 0;
+        }
+
+        // Every cube at once, the model matrix and color come from the instance buffer. The batch
+        // has no single depth, it sorts by state only
+        commands_.uniform(cubeUniforms_.positionScale.getLocation(), cube->getVertexLayout().getPositionScale());
+        commands_.uniform(cubeUniforms_.positionBias.getLocation(), cube->getVertexLayout().getPositionBias());
+        commands_.uniform(cubeUniforms_.lightColor.getLocation(), glm::vec3(1.0f, 1.0f, 1.0f));
+        commands_.uniform(cubeUniforms_.lightPos.getLocation(), lightPos);
+        if (cubeUniforms_.clusterScale.isValid()) {
+            commands_.uniform(cubeUniforms_.clusterScale.getLocation(),
+                              lighting_->getClusterScale(sceneWidth, sceneHeight));
+        }
+        if (cubeUniforms_.fogDensity.isValid()) {
+            commands_.uniform(cubeUniforms_.fogColor.getLocation(), fogColor_);
+            commands_.uniform(cubeUniforms_.fogDensity.getLocation(), fogDensity_);
+        }
+        commands_.draw(RenderPass::Opaque, 0.0f,
+                       drawCommand(cubeVariant_->getProgram(), cube->getVAO(), *cube,
+                                   cubeInstanceBuffer_->getCount()));
+
+        // The light object, it only needs the position stream
+        const glm::mat4 &lampModel = transforms_.getWorld(lampNode_);
+        commands_.uniform(lampUniforms_.positionScale.getLocation(), cube->getVertexLayout().getPositionScale());
+        commands_.uniform(lampUniforms_.positionBias.getLocation(), cube->getVertexLayout().getPositionBias());
+        commands_.uniform(lampUniforms_.model.getLocation(), lampModel);
+        if (lampUniforms_.fogDensity.isValid()) {
+            commands_.uniform(lampUniforms_.fogColor.getLocation(), fogColor_);
+            commands_.uniform(lampUniforms_.fogDensity.getLocation(), fogDensity_);
+        }
+        commands_.draw(RenderPass::Emissive, depthOf(camera_.getViewProjection(), lampModel[3]),
+                       drawCommand(lampVariant_->getProgram(), cube->getVAO(VertexPass::PositionOnly),
+                                   *cube, 1));
+    }
+
+    {
+        PROFILE_SCOPE("submit");
+        GpuProfileScope gpuScope(*gpuProfiler_, "scene");
+        commands_.submit(glBackend_);
+    }
+    glBindVertexArray(0);
+    cameraRing_->endFrame();
+    lighting_->endFrame();
+
+    if (upscale) {
+        PROFILE_SCOPE("upscale");
+        GpuProfileScope gpuScope(*gpuProfiler_, "upscale");
+        // depth is done with, on a tiler this saves writing it back to memory
+        constexpr GLenum depth = GL_DEPTH_ATTACHMENT;
+        glInvalidateFramebuffer(GL_FRAMEBUFFER, 1, &depth);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, sceneFramebuffer_);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, getOutputFramebuffer());
+        glBlitFramebuffer(0, 0, sceneWidth, sceneHeight, 0, 0, width_, height_,
+                          GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        glBindFramebuffer(GL_FRAMEBUFFER, getOutputFramebuffer());
+    }
+
+    // The GPU time is a few frames old, the CPU time is this frame's up to the present. Either one
+    // being over budget means frames are late
+    if (dynamicResolution_) {
+        gpuProfiler_->takeFrameTime(gpuFrameMs_);
+        const float cpuMs = static_cast<float>(Profiler::now() - frameBegin) * 1e-6f;
+        const float scale = governor_.update(cpuMs, gpuFrameMs_);
+        if (scale != resolutionScale_) {
+            // don't feed it the old resolution's timing again
+            gpuFrameMs_ = 0.0f;
+            resolutionScale_ = scale;
+        }
+    }
+
+    if (isOffscreen()) {
+        // nothing to present, just get the frame going
+        glFlush();
+        return;
+    }
     // Present the rendered image. This is an implicit glFlush.
+    PROFILE_SCOPE("eglSwapBuffers");
     auto swapResult = eglSwapBuffers(display_, surface_);
     assert(swapResult == EGL_TRUE);
 }
 
-void Renderer::changeSpeed() {
-    if(movementSpeed_ > 0) {
-        movementSpeed_ = movementSpeed_ - 0.1 > 0 ? movementSpeed_ - 0.1 : 0;
+size_t Renderer::addCube(const glm::mat4 &model, const glm::vec3 &color) {
+    cubeInstances_.push_back({model, glm::vec4(color, 1.0f)});
+    glm::vec3 center, extents;
+    BoundingBoxes::transform(model, cubeCenter_, cubeExtents_, center, extents);
+    cubeBounds_.add(center, extents);
+    markCubesDirty(cubeInstances_.size() - 1, cubeInstances_.size());
+    return cubeInstances_.size() - 1;
+}
+
+void Renderer::setCubeTransform(size_t index, const glm::mat4 &model) {
+    assert(index < cubeInstances_.size());
+    cubeInstances_[index].model = model;
+    glm::vec3 center, extents;
+    BoundingBoxes::transform(model, cubeCenter_, cubeExtents_, center, extents);
+    cubeBounds_.set(static_cast<uint32_t>(index), center, extents);
+    markCubesDirty(index, index + 1);
+}
+
+void Renderer::setCubeColor(size_t index, const glm::vec3 &color) {
+    assert(index < cubeInstances_.size());
+    cubeInstances_[index].color = glm::vec4(color, 1.0f);
+    markCubesDirty(index, index + 1);
+}
+
+void Renderer::clearCubes() {
+    cubeInstances_.clear();
+    cubeBounds_.clear();
+    cubeDirtyBegin_ = cubeDirtyEnd_ = 0;
+}
+
+size_t Renderer::addLight(const PointLight &light) {
+    lights_.push_back(light);
+    lightsDirty_ = true;
+    return lights_.size() - 1;
+}
+
+void Renderer::setLight(size_t index, const PointLight &light) {
+    assert(index < lights_.size());
+    lights_[index] = light;
+    lightsDirty_ = true;
+}
+
+void Renderer::clearLights() {
+    lights_.clear();
+    lightsDirty_ = true;
+}
+
+void Renderer::setTextureSource(const AssetLoader &assets, std::unique_ptr<ImageDecoder> decoder,
+                                const TextureStreamer::Config &config) {
+    textures_ = std::make_unique<TextureStreamer>(assets, std::move(decoder), config);
+}
+
+void Renderer::setFog(const glm::vec3 &color, float density) {
+    fogColor_ = color;
+    fogDensity_ = std::max(0.0f, density);
+}
+
+void Renderer::finishLoading() {
+    selectVariants(true);
+}
+
+void Renderer::selectVariants(bool wait) {
+    // the base variants skip the cluster loop and the fog math altogether
+    ShaderVariants::Mask cubeMask = 0;
+    ShaderVariants::Mask lampMask = 0;
+    ShaderVariants &cubeShader = *resources_.getPrograms().get(cubeShader_);
+    ShaderVariants &lightShader = *resources_.getPrograms().get(lightShader_);
+    if (!lights_.empty()) {
+        cubeMask |= cubeShader.feature("CLUSTERED_LIGHTS");
+    }
+    if (fogDensity_ > 0.0f) {
+        cubeMask |= cubeShader.feature("FOG");
+        lampMask |= lightShader.feature("FOG");
+    }
+
+    // Without waiting, a variant that isn't ready is asked for and the one in use stays until it
+    // is, e.g. the cubes go without point lights for a frame or two
+    if (wait) {
+        cubeShader.get(cubeMask);
+        lightShader.get(lampMask);
+    } else {
+        cubeShader.request(cubeMask);
+        lightShader.request(lampMask);
+        cubeShader.poll();
+        lightShader.poll();
+    }
+
+    if (cubeMask != cubeMask_ && cubeShader.isReady(cubeMask)) {
+        cubeMask_ = cubeMask;
+        cubeVariant_ = &cubeShader.get(cubeMask);
+        cubeUniforms_.positionScale = cubeVariant_->uniform<glm::vec3>("positionScale");
+        cubeUniforms_.positionBias = cubeVariant_->uniform<glm::vec3>("positionBias");
+        cubeUniforms_.lightColor = cubeVariant_->uniform<glm::vec3>("lightColor");
+        cubeUniforms_.lightPos = cubeVariant_->uniform<glm::vec3>("lightPos");
+        cubeUniforms_.clusterScale = cubeVariant_->uniform<glm::vec4>("clusterScale");
+        cubeUniforms_.fogColor = cubeVariant_->uniform<glm::vec3>("fogColor");
+        cubeUniforms_.fogDensity = cubeVariant_->uniform<GLfloat>("fogDensity");
+    }
+    if (lampMask != lampMask_ && lightShader.isReady(lampMask)) {
+        lampMask_ = lampMask;
+        lampVariant_ = &lightShader.get(lampMask);
+        lampUniforms_.positionScale = lampVariant_->uniform<glm::vec3>("positionScale");
+        lampUniforms_.positionBias = lampVariant_->uniform<glm::vec3>("positionBias");
+        lampUniforms_.model = lampVariant_->uniform<glm::mat4>("model");
+        lampUniforms_.fogColor = lampVariant_->uniform<glm::vec3>("fogColor");
+        lampUniforms_.fogDensity = lampVariant_->uniform<GLfloat>("fogDensity");
     }
-    if(movementSpeed_ < 0) {
-        movementSpeed_ = movementSpeed_ + 0.1 < 0 ? movementSpeed_ + 0.1 : 0;
+}
+
+void Renderer::markCubesDirty(size_t first, size_t last) {
+    if (cubeDirtyBegin_ == cubeDirtyEnd_) {
+        cubeDirtyBegin_ = first;
+        cubeDirtyEnd_ = last;
+    } else {
+        cubeDirtyBegin_ = std::min(cubeDirtyBegin_, first);
+        cubeDirtyEnd_ = std::max(cubeDirtyEnd_, last);
     }
 }
 
-void Renderer::initRenderer() {
+void Renderer::initWindowContext(EGLNativeWindowType window) {
     // Choose your render attributes
     constexpr EGLint attribs[] = {
             EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT,
@@ -144,7 +426,7 @@ void Renderer::initRenderer() {
     // create the proper window surface
     EGLint format;
     eglGetConfigAttrib(display, config, EGL_NATIVE_VISUAL_ID, &format);
-    EGLSurface surface = eglCreateWindowSurface(display, config, app_->window, nullptr);
+    EGLSurface surface = eglCreateWindowSurface(display, config, window, nullptr);
 
     EGLint contextAttribs[] = {EGL_CONTEXT_CLIENT_VERSION, 3, EGL_NONE};
     EGLContext context = eglCreateContext(display, config, nullptr, contextAttribs);
@@ -156,16 +438,197 @@ void Renderer::initRenderer() {
     display_ = display;
     surface_ = surface;
     context_ = context;
+}
+
+void Renderer::initOffscreenContext() {
+    // Mesa can run without any window system, ask for that explicitly where it's offered
+    EGLDisplay display = EGL_NO_DISPLAY;
+    if (hasExtension(eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS), "EGL_MESA_platform_surfaceless")) {
+        auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+                eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (getPlatformDisplay) {
+            display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        }
+    }
+    if (display == EGL_NO_DISPLAY) {
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    eglInitialize(display, nullptr, nullptr);
+
+    // color and depth live in the framebuffer object, the config only has to give us a context
+    constexpr EGLint attribs[] = {
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT,
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_NONE
+    };
+    EGLConfig config = nullptr;
+    EGLint numConfigs = 0;
+    eglChooseConfig(display, attribs, &config, 1, &numConfigs);
+    assert(numConfigs > 0);
+
+    EGLint contextAttribs[] = {EGL_CONTEXT_CLIENT_VERSION, 3, EGL_NONE};
+    EGLContext context = eglCreateContext(display, config, nullptr, contextAttribs);
+
+    // without surfaceless contexts there has to be some surface to make current, keep it tiny
+    EGLSurface surface = EGL_NO_SURFACE;
+    if (!hasExtension(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context")) {
+        constexpr EGLint pbufferAttribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+        surface = eglCreatePbufferSurface(display, config, pbufferAttribs);
+    }
+
+    auto madeCurrent = eglMakeCurrent(display, surface, surface, context);
+    assert(madeCurrent);
+
+    display_ = display;
+    surface_ = surface;
+    context_ = context;
+}
+
+void Renderer::createOffscreenFramebuffer() {
+    glGenRenderbuffers(1, &offscreenColor_);
+    glBindRenderbuffer(GL_RENDERBUFFER, offscreenColor_);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, offscreenWidth_, offscreenHeight_);
+
+    glGenRenderbuffers(1, &offscreenDepth_);
+    glBindRenderbuffer(GL_RENDERBUFFER, offscreenDepth_);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, offscreenWidth_, offscreenHeight_);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    // stays bound for good, every frame draws into it
+    glGenFramebuffers(1, &offscreenFramebuffer_);
+    glBindFramebuffer(GL_FRAMEBUFFER, offscreenFramebuffer_);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, offscreenColor_);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, offscreenDepth_);
+    auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    assert(status == GL_FRAMEBUFFER_COMPLETE);
+    (void) status;
+}
+
+void Renderer::setDynamicResolution(float targetFps) {
+    dynamicResolution_ = targetFps > 0.0f;
+    gpuFrameMs_ = 0.0f;
+    if (!dynamicResolution_) {
+        resolutionScale_ = 1.0f;
+        return;
+    }
+    ResolutionGovernor::Config config;
+    config.targetMs = 1000.0f / targetFps;
+    governor_ = ResolutionGovernor(config);
+    resolutionScale_ = governor_.getScale();
+}
+
+void Renderer::setResolutionScale(float scale) {
+    dynamicResolution_ = false;
+    resolutionScale_ = std::clamp(scale, 0.1f, 1.0f);
+}
+
+void Renderer::createSceneFramebuffer() {
+    deleteSceneFramebuffer();
+    sceneFramebufferWidth_ = width_;
+    sceneFramebufferHeight_ = height_;
+
+    glGenRenderbuffers(1, &sceneColor_);
+    glBindRenderbuffer(GL_RENDERBUFFER, sceneColor_);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width_, height_);
+
+    glGenRenderbuffers(1, &sceneDepth_);
+    glBindRenderbuffer(GL_RENDERBUFFER, sceneDepth_);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width_, height_);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &sceneFramebuffer_);
+    glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer_);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, sceneColor_);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, sceneDepth_);
+    auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    assert(status == GL_FRAMEBUFFER_COMPLETE);
+    (void) status;
+    aout << "Scene framebuffer " << width_ << "x" << height_ << std::endl;
+}
+
+void Renderer::deleteSceneFramebuffer() {
+    if (!sceneFramebuffer_) {
+        return;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, getOutputFramebuffer());
+    glDeleteFramebuffers(1, &sceneFramebuffer_);
+    glDeleteRenderbuffers(1, &sceneColor_);
+    glDeleteRenderbuffers(1, &sceneDepth_);
+    sceneFramebuffer_ = sceneColor_ = sceneDepth_ = 0;
+    sceneFramebufferWidth_ = sceneFramebufferHeight_ = 0;
+}
+
+void Renderer::readPixels(std::vector<uint8_t> &rgba) const {
+    const size_t rowSize = size_t(width_) * 4;
+    rgba.resize(rowSize * height_);
+    glReadPixels(0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+
+    // GL's first row is the bottom one
+    std::vector<uint8_t> row(rowSize);
+    for (EGLint y = 0; y < height_ / 2; y++) {
+        uint8_t *top = rgba.data() + y * rowSize;
+        uint8_t *bottom = rgba.data() + (height_ - 1 - y) * rowSize;
+        std::copy(top, top + rowSize, row.data());
+        std::copy(bottom, bottom + rowSize, top);
+        std::copy(row.begin(), row.end(), bottom);
+    }
+}
+
+void Renderer::initRenderer(const AssetLoader &assets, EGLNativeWindowType window,
+                            const std::string &programCacheDirectory) {
+    if (isOffscreen()) {
+        initOffscreenContext();
+    } else {
+        initWindowContext(window);
+    }
 
     // make width and height invalid so it gets updated the first frame in @a updateRenderArea()
     width_ = -1;
     height_ = -1;
 
-    cubeShader_ = std::unique_ptr<Shader>(new Shader(app_->activity->assetManager,"cube_shader.vs", "cube_shader.frag"));
-    assert(cubeShader_);
+    if (isOffscreen()) {
+        createOffscreenFramebuffer();
+    }
+
+    const uint64_t shadersBegin = Profiler::now();
+    Shader::enableParallelCompile();
+    programCache_ = std::make_unique<ProgramCache>(programCacheDirectory);
+    cubeShader_ = resources_.getPrograms().create(ShaderVariants(assets, "cube_shader", programCache_.get()));
+    lightShader_ = resources_.getPrograms().create(ShaderVariants(assets, "lamp_shader", programCache_.get()));
+    ShaderVariants &cubeShader = *resources_.getPrograms().get(cubeShader_);
+    ShaderVariants &lightShader = *resources_.getPrograms().get(lightShader_);
+
+    // Every program reads the camera from the same binding point. The point lights' buffer and
+    // textures never move either, so each variant is hooked up to them once when it's built
+    cubeShader.setOnBuild([](const Shader &shader) {
+        shader.bindUniformBlock("Camera", kCameraBinding);
+        shader.bindUniformBlock("Lights", kLightsBinding);
+        shader.bindSampler("clusterGrid", kClusterGridUnit);
+        shader.bindSampler("clusterLights", kClusterLightsUnit);
+    });
+    lightShader.setOnBuild([](const Shader &shader) {
+        shader.bindUniformBlock("Camera", kCameraBinding);
+    });
+
+    // The variants the app is known to need, the rest are built when first drawn with. Only
+    // submitted here, render() shows a loading state until they are done
+    std::string manifest;
+    size_t submitted = 0;
+    if (assets.read("shader_variants.txt", manifest)) {
+        submitted += cubeShader.warmUp(manifest, ShaderBuild::Async);
+        submitted += lightShader.warmUp(manifest, ShaderBuild::Async);
+    }
+    aout << submitted << " shader variants submitted in " << (Profiler::now() - shadersBegin) / 1000
+         << " us, " << programCache_->getStats().hits << " from the program cache" << std::endl;
+
+    cameraRing_ = std::make_unique<UniformRing>(sizeof(CameraBlock));
+    lighting_ = std::make_unique<ClusteredLighting>();
+    gpuProfiler_ = std::make_unique<GpuProfiler>();
 
-    lightShader_ = std::unique_ptr<Shader>(new Shader(app_->activity->assetManager, "lamp_shader.vs", "lamp_shader.frag"));
-    assert(lightShader_);
+    camera_.lookAt(glm::vec3(0.0f, 0.0f, 3.0f),
+                   glm::vec3(0.0f, 0.0f, 0.0f),
+                   glm::vec3(0.0f, 1.0f, 0.0f));
+    camera_.setPerspective(glm::radians(60.0f), 0.1f, 100.0f);
 
     // setup any other gl related global states
     glClearColor(.2f,.2f,.2f,1.0f);
@@ -179,16 +642,16 @@ void Renderer::initRenderer() {
 }
 
 void Renderer::updateRenderArea() {
-    EGLint width;
-    eglQuerySurface(display_, surface_, EGL_WIDTH, &width);
-
-    EGLint height;
-    eglQuerySurface(display_, surface_, EGL_HEIGHT, &height);
+    EGLint width = offscreenWidth_;
+    EGLint height = offscreenHeight_;
+    if (!isOffscreen()) {
+        eglQuerySurface(display_, surface_, EGL_WIDTH, &width);
+        eglQuerySurface(display_, surface_, EGL_HEIGHT, &height);
+    }
 
     if (width != width_ || height != height_) {
         width_ = width;
         height_ = height;
-        glViewport(0, 0, width, height);
 
         // make sure that we lazily recreate the projection matrix before we render
         shaderNeedsNewProjectionMatrix_ = true;
@@ -240,95 +703,72 @@ void Renderer::createModels() {
             -0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
             -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f
     };
-    // First, set the container's VAO (and VBO)
-    GLuint VBO, containerVAO;
-    glGenVertexArrays(1, &containerVAO);
-    glGenBuffers(1, &VBO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    glBindVertexArray(containerVAO);
-    GLint attribLocation = glGetAttribLocation(cubeShader_->getProgram(),"position");
-    // Position attribute
-    glVertexAttribPointer(attribLocation, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (GLvoid*)0);
-    glEnableVertexAttribArray(0);
-    // Normal attribute
-    attribLocation = glGetAttribLocation(cubeShader_->getProgram(),"normal");
-    glVertexAttribPointer(attribLocation, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(1);
-    cube_ = std::unique_ptr<Model>(new Model(containerVAO, VBO));
+    // Weld the duplicated corners into an indexed mesh, ordered for the post-transform cache
+    static_assert(sizeof(vertices) % (6 * sizeof(GLfloat)) == 0, "position + normal per vertex");
+    std::vector<MeshVertex> soup;
+    for (size_t i = 0; i < sizeof(vertices) / sizeof(GLfloat); i += 6) {
+        soup.push_back({glm::vec3(vertices[i], vertices[i + 1], vertices[i + 2]),
+                        glm::vec3(vertices[i + 3], vertices[i + 4], vertices[i + 5]),
+                        glm::vec2(0.0f)});
+    }
+    MeshData mesh = MeshBuilder::build(soup.data(), soup.size());
+    glm::vec3 lower = mesh.vertices.front().position;
+    glm::vec3 upper = lower;
+    for (const auto &vertex: mesh.vertices) {
+        lower = glm::min(lower, vertex.position);
+        upper = glm::max(upper, vertex.position);
+    }
+    cubeCenter_ = (lower + upper) * 0.5f;
+    cubeExtents_ = (upper - lower) * 0.5f;
+    // 16 bit indices unless the mesh has too many vertices for them
+    std::vector<uint8_t> indices;
+    const GLenum indexType = MeshBuilder::packIndices(mesh, indices) == sizeof(GLushort) ? GL_UNSIGNED_SHORT
+                                                                                         : GL_UNSIGNED_INT;
+    VertexLayout layout = VertexLayout::choose(mesh, vertexCompression_, vertexStreams_);
+
+    // One vertex buffer per stream, and the index buffer
+    std::array<GLuint, kMaxVertexStreams> vertexBuffers{};
+    glGenBuffers(layout.getStreamCount(), vertexBuffers.data());
+    for (int stream = 0; stream < layout.getStreamCount(); stream++) {
+        std::vector<uint8_t> vertexData = layout.pack(mesh, stream);
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffers[stream]);
+        glBufferData(GL_ARRAY_BUFFER, vertexData.size(), vertexData.data(), GL_STATIC_DRAW);
+    }
+    GLuint IBO;
+    glGenBuffers(1, &IBO);
+
+    std::array<GLuint, kVertexPassCount> vertexArrays{};
+    glGenVertexArrays(kVertexPassCount, vertexArrays.data());
+
+    // First, set the container's VAO
+    glBindVertexArray(vertexArrays[static_cast<int>(VertexPass::Shaded)]);
+    // The element buffer binding is part of the VAO state
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size(), indices.data(), GL_STATIC_DRAW);
+    // Position and normal attributes, in whatever format and stream the layout picked. The
+    // locations are fixed in the shaders, so this needn't wait for any program to link and serves
+    // every variant
+    layout.bindAttribute(VertexAttribute::Position, kPositionLocation, vertexBuffers.data());
+    layout.bindAttribute(VertexAttribute::Normal, kNormalLocation, vertexBuffers.data());
+    // Per instance model matrix and color
+    cubeInstanceBuffer_ = std::make_unique<InstanceBuffer>();
+    cubeInstanceBuffer_->bindAttributes(kInstanceModelLocation, kInstanceColorLocation);
+
+    // Then, we set the light's VAO. Same mesh, but it only reads positions so with split streams
+    // it never touches the normals
+    glBindVertexArray(vertexArrays[static_cast<int>(VertexPass::PositionOnly)]);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+    layout.bindAttribute(VertexAttribute::Position, kPositionLocation, vertexBuffers.data());
     glBindVertexArray(0);
 
-    // Then, we set the light's VAO (VBO stays the same. After all, the vertices are the same for the light object (also a 3D cube))
-    GLuint lightVAO;
-    glGenVertexArrays(1, &lightVAO);
-    glBindVertexArray(lightVAO);
-    // We only need to bind to the VBO (to link it with glVertexAttribPointer), no need to fill it; the VBO's data already contains all we need.
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    attribLocation = glGetAttribLocation(lightShader_->getProgram(),"position");
-    // Set the vertex attributes (only position data for the lamp))
-    glVertexAttribPointer(attribLocation, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (GLvoid*)0); // Note that we skip over the normal vectors
-    glEnableVertexAttribArray(0);
-    lamp_ = std::unique_ptr<Model>(new Model(containerVAO, VBO));
-    glBindVertexArray(0);
-}
+    cube_ = resources_.getMeshes().create(Model(vertexArrays, vertexBuffers, IBO, mesh.indices.size(), indexType, layout));
 
-void Renderer::handleInput() {
-    // handle all queued inputs
-    auto *inputBuffer = android_app_swap_input_buffers(app_);
-    if (!inputBuffer) {
-        // no inputs yet.
-        return;
-    }
+    // the cube the user spins, more can be added with addCube()
+    cubeNode_ = transforms_.create();
+    addCube(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.31f));
 
-    // handle motion events (motionEventsCounts can be 0).
-    for (auto i = 0; i < inputBuffer->motionEventsCount; i++) {
-        auto &motionEvent = inputBuffer->motionEvents[i];
-        auto action = motionEvent.action;
-
-        // Find the pointer index, mask and bitshift to turn it into a readable value.
-        auto pointerIndex = (action & AMOTION_EVENT_ACTION_POINTER_INDEX_MASK)
-                >> AMOTION_EVENT_ACTION_POINTER_INDEX_SHIFT;
-        aout << "Pointer(s): ";
-
-        // get the x and y position of this event if it is not ACTION_MOVE.
-        auto &pointer = motionEvent.pointers[pointerIndex];
-        auto x = GameActivityPointerAxes_getX(&pointer);
-        auto y = GameActivityPointerAxes_getY(&pointer);
-
-        long startTime;
-        // determine the action type and process the event accordingly.
-        switch (action & AMOTION_EVENT_ACTION_MASK) {
-            case AMOTION_EVENT_ACTION_DOWN:
-            case AMOTION_EVENT_ACTION_POINTER_DOWN:
-                movementSpeed_ = 0;
-                startTime = std::time(nullptr);
-                break;
-            case AMOTION_EVENT_ACTION_UP:
-            case AMOTION_EVENT_ACTION_POINTER_UP:
-                aout << "(" << pointer.id << ", " << x << ", " << y << ") "
-                     << "Pointer Down";
-                break;
-
-            case AMOTION_EVENT_ACTION_MOVE:
-                // There is no pointer index for ACTION_MOVE, only a snapshot of
-                // all active pointers; app needs to cache previous active pointers
-                // to figure out which ones are actually moved.
-                for (auto index = 0; index < motionEvent.pointerCount; index++) {
-                    pointer = motionEvent.pointers[index];
-                    movementSpeed_ = (pointer.rawY - y) / (std::time(nullptr) - startTime);
-                    if (index != (motionEvent.pointerCount - 1)) aout << ",";
-                    aout << " ";
-                }
-                aout << "Pointer Move";
-                break;
-            default:
-                aout << "Unknown MotionEvent Action: " << action;
-        }
-        aout << std::endl;
-    }
-    // clear the motion input count in this buffer for main thread to re-use.
-    android_app_clear_motion_events(inputBuffer);
+    lampNode_ = transforms_.create();
+    transforms_.setTranslation(lampNode_, lightPos);
+    transforms_.setScale(lampNode_, glm::vec3(0.2f)); // Make it a smaller cube
+}
 
-}
\ No newline at end of file
@@ -3,56 +3,241 @@
 
 #include <EGL/egl.h>
 #include <memory>
+#include <vector>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "AssetLoader.h"
+#include "Camera.h"
+#include "ClusteredLighting.h"
+#include "CommandBuffer.h"
+#include "FrustumCuller.h"
+#include "GlCommandBackend.h"
+#include "GpuProfiler.h"
+#include "InstanceBuffer.h"
 #include "Model.h"
+#include "RenderThread.h"
+#include "ResourceRegistry.h"
+#include "ResolutionGovernor.h"
 #include "Shader.h"
+#include "ShaderVariants.h"
+#include "TextureStreamer.h"
+#include "TransformHierarchy.h"
+#include "UniformRing.h"
 
-struct android_app;
-
-class Renderer {
+/*!
+ * The GL backend. Lives on the render thread: it creates its EGL context there and everything
+ * below must only be called from that thread.
+ */
+class Renderer : public RenderBackend {
 public:
     /*!
-     * @param pApp the android_app this Renderer belongs to, needed to configure GL
+     * Renders to a window
+     * @param assets where to load shaders from, only used while constructing
+     * @param window the native window to create the EGL surface for
+     * @param programCacheDirectory where linked programs are kept between runs, empty for none
      */
-    inline Renderer(android_app *pApp) :
-            app_(pApp),
+    inline Renderer(const AssetLoader &assets, EGLNativeWindowType window,
+                    const std::string &programCacheDirectory = {}) :
             display_(EGL_NO_DISPLAY),
             surface_(EGL_NO_SURFACE),
             context_(EGL_NO_CONTEXT),
             width_(0),
             height_(0),
-            movementSpeed_(0),
             shaderNeedsNewProjectionMatrix_(true) {
-        initRenderer();
+        initRenderer(assets, window, programCacheDirectory);
     }
 
-    virtual ~Renderer();
+    /*!
+     * Renders offscreen into a framebuffer object, for benchmarks and image comparisons where there
+     * is no window, e.g. on a host with Mesa. Uses a surfaceless context where EGL supports one and
+     * a 1x1 pbuffer otherwise. Nothing is presented, read results back with @a readPixels.
+     */
+    inline Renderer(const AssetLoader &assets, int width, int height,
+                    const std::string &programCacheDirectory = {}) :
+            display_(EGL_NO_DISPLAY),
+            surface_(EGL_NO_SURFACE),
+            context_(EGL_NO_CONTEXT),
+            width_(0),
+            height_(0),
+            offscreenWidth_(width),
+            offscreenHeight_(height),
+            shaderNeedsNewProjectionMatrix_(true) {
+        initRenderer(assets, {}, programCacheDirectory);
+    }
+
+    ~Renderer() override;
+
+    inline bool isOffscreen() const { return offscreenWidth_ > 0; }
+
+    /*!
+     * Reads back the last rendered frame, blocking until the GPU is done with it
+     * @param rgba receives width * height RGBA8 pixels, top row first
+     */
+    void readPixels(std::vector<uint8_t> &rgba) const;
+
+    inline EGLint getWidth() const { return width_; }
+
+    inline EGLint getHeight() const { return height_; }
+
+    /*!
+     * Lets a ResolutionGovernor pick the scene's resolution every frame, between half and full
+     * size, to hold @a targetFps. The scene is then drawn into a smaller framebuffer and stretched
+     * over the output.
+     * @param targetFps the frame rate to hold, 0 turns it off and goes back to full resolution
+     */
+    void setDynamicResolution(float targetFps);
+
+    /*!
+     * Draws the scene at a fixed fraction of the output size from now on, and turns dynamic
+     * resolution off
+     */
+    void setResolutionScale(float scale);
+
+    /*!
+     * @return the fraction of the output size the next frame is drawn at
+     */
+    inline float getResolutionScale() const { return resolutionScale_; }
+
+    inline const ResolutionGovernor &getResolutionGovernor() const { return governor_; }
+
+    /*!
+     * @return true until the shader programs the scene needs have linked. Frames rendered until
+     * then show only the clear color.
+     */
+    inline bool isLoading() const { return cubeVariant_ == nullptr || lampVariant_ == nullptr; }
+
+    /*!
+     * Waits for the programs the scene needs as of now, for when a stall beats a loading frame,
+     * e.g. before timing or comparing frames
+     */
+    void finishLoading();
+
+    /*!
+     * Renders all the models in the renderer, as of @a snapshot
+     */
+    void render(const FrameSnapshot &snapshot) override;
+
+    /*!
+     * Adds a cube to the instanced cube pass. All cubes are drawn with a single draw call no
+     * matter how many there are.
+     * @param model the cube's model matrix, rotation and uniform scale only
+     * @param color the cube's surface color
+     * @return the index of the new cube, stable until @a clearCubes
+     */
+    size_t addCube(const glm::mat4 &model, const glm::vec3 &color);
+
+    void setCubeTransform(size_t index, const glm::mat4 &model);
+
+    void setCubeColor(size_t index, const glm::vec3 &color);
+
+    /*!
+     * Removes every cube from the instanced cube pass
+     */
+    void clearCubes();
+
+    inline size_t getCubeCount() const { return cubeInstances_.size(); }
+
+    /*!
+     * Adds a point light to the clustered lights on the cubes, on top of the lamp. At most
+     * LightClusters::kMaxLights are used.
+     * @return the index of the new light, stable until @a clearLights
+     */
+    size_t addLight(const PointLight &light);
+
+    void setLight(size_t index, const PointLight &light);
+
+    void clearLights();
+
+    inline size_t getLightCount() const { return lights_.size(); }
 
     /*!
-     * Handles input from the android_app.
-     *
-     * Note: this will clear the input queue
+     * @return the light lists as of the last frame, for statistics
      */
-    void handleInput();
+    inline const LightClusters &getLightClusters() const { return lighting_->getClusters(); }
 
     /*!
-     * Renders all the models in the renderer
+     * Fades everything towards @a color with distance from the camera
+     * @param density per unit of view depth, 0 turns fog off
      */
-    void render();
+    void setFog(const glm::vec3 &color, float density);
+
+    /*!
+     * Turns on texture streaming, see TextureStreamer
+     * @param assets where textures are read from, on worker threads. Must outlive the Renderer.
+     * @param decoder decodes them, AndroidImageDecoder on a device
+     */
+    void setTextureSource(const AssetLoader &assets, std::unique_ptr<ImageDecoder> decoder,
+                          const TextureStreamer::Config &config = TextureStreamer::Config());
+
+    /*!
+     * @return the streamer textures are requested from, null until @a setTextureSource
+     */
+    inline TextureStreamer *getTextures() { return textures_.get(); }
+
+    inline Camera &getCamera() { return camera_; }
+
+    inline const Camera &getCamera() const { return camera_; }
+
+    /*!
+     * @return the ring the camera block is written to, its write count is how often the camera
+     * was uploaded
+     */
+    inline const UniformRing &getCameraRing() const { return *cameraRing_; }
+
+    inline const ProgramCache &getProgramCache() const { return *programCache_; }
+
+    inline const ShaderVariants &getCubeShader() const { return *resources_.getPrograms().get(cubeShader_); }
+
+    inline const ShaderVariants &getLampShader() const { return *resources_.getPrograms().get(lightShader_); }
+
+    /*!
+     * @return the meshes, textures and programs drawn with. Resources destroyed in it are freed at
+     * the start of the next render().
+     */
+    inline ResourceRegistry &getResources() { return resources_; }
 
 private:
     /*!
      * Performs necessary OpenGL initialization. Customize this if you want to change your EGL
      * context or application-wide settings.
+     * @param window the window to render to, ignored when offscreen
+     */
+    void initRenderer(const AssetLoader &assets, EGLNativeWindowType window,
+                      const std::string &programCacheDirectory);
+
+    /*!
+     * Creates the display, context and window surface for on-screen rendering
+     */
+    void initWindowContext(EGLNativeWindowType window);
+
+    /*!
+     * Creates the display, context and, unless surfaceless, a pbuffer for offscreen rendering
+     */
+    void initOffscreenContext();
+
+    /*!
+     * Creates the framebuffer object offscreen frames are drawn into
      */
-    void initRenderer();
+    void createOffscreenFramebuffer();
+
+    /*!
+     * (Re)creates the framebuffer scaled scenes are drawn into, at the full output size so scale
+     * changes only move the viewport
+     */
+    void createSceneFramebuffer();
+
+    void deleteSceneFramebuffer();
+
+    /*!
+     * @return the framebuffer that ends up on screen, or in @a readPixels offscreen
+     */
+    inline GLuint getOutputFramebuffer() const { return offscreenFramebuffer_; }
 
     /*!
      * @brief we have to check every frame to see if the framebuffer has changed in size. If it has,
-     * update the viewport accordingly
+     * update the projection accordingly
      */
     void updateRenderArea();
 
@@ -62,25 +247,127 @@ private:
      */
     void createModels();
 
-    void changeSpeed();
+    /*!
+     * Picks the shader variants the current lights and fog need, and re-resolves the uniform
+     * handles when they change
+     * @param wait build or finish the variants now, otherwise they are built in the background
+     * and the ones in use stay until they are ready
+     */
+    void selectVariants(bool wait);
 
-    android_app *app_;
     EGLDisplay display_;
     EGLSurface surface_;
     EGLContext context_;
     EGLint width_;
     EGLint height_;
-    float movementSpeed_;
+
+    // offscreen target, sizes are 0 when rendering to a window
+    EGLint offscreenWidth_ = 0;
+    EGLint offscreenHeight_ = 0;
+    GLuint offscreenFramebuffer_ = 0;
+    GLuint offscreenColor_ = 0;
+    GLuint offscreenDepth_ = 0;
+
+    // dynamic resolution: below full scale the scene is drawn into the corner of sceneFramebuffer_
+    // and blitted up to the output. Created on first use, the full size never needs it
+    float resolutionScale_ = 1.0f;
+    bool dynamicResolution_ = false;
+    ResolutionGovernor governor_;
+    // the last GPU frame time we got, results trickle in a few frames late and not every frame
+    float gpuFrameMs_ = 0.0f;
+    GLuint sceneFramebuffer_ = 0;
+    GLuint sceneColor_ = 0;
+    GLuint sceneDepth_ = 0;
+    EGLint sceneFramebufferWidth_ = 0;
+    EGLint sceneFramebufferHeight_ = 0;
+
+    // vertex format for the meshes built in createModels()
+    VertexCompression vertexCompression_ = VertexCompression::Compact;
+    VertexStreams vertexStreams_ = VertexStreams::SplitPosition;
 
     bool shaderNeedsNewProjectionMatrix_;
 
-    std::unique_ptr<Shader> cubeShader_;
-    std::unique_ptr<Shader> lightShader_;
-    std::unique_ptr<Model> cube_;
-    std::unique_ptr<Model> lamp_;
+    // every mesh, texture and program, freed before the context goes
+    ResourceRegistry resources_;
+
+    // linked programs from earlier runs
+    std::unique_ptr<ProgramCache> programCache_;
+    ProgramHandle cubeShader_;
+    ProgramHandle lightShader_;
+    // the variants in use and their masks, see selectVariants()
+    const Shader *cubeVariant_ = nullptr;
+    const Shader *lampVariant_ = nullptr;
+    ShaderVariants::Mask cubeMask_ = ~ShaderVariants::Mask(0);
+    ShaderVariants::Mask lampMask_ = ~ShaderVariants::Mask(0);
+
+    // uniform handles, resolved again only when selectVariants() switches programs
+    struct CubeUniforms {
+        Uniform<glm::vec3> positionScale;
+        Uniform<glm::vec3> positionBias;
+        Uniform<glm::vec3> lightColor;
+        Uniform<glm::vec3> lightPos;
+        Uniform<glm::vec4> clusterScale;
+        Uniform<glm::vec3> fogColor;
+        Uniform<GLfloat> fogDensity;
+    } cubeUniforms_;
+
+    struct LampUniforms {
+        Uniform<glm::vec3> positionScale;
+        Uniform<glm::vec3> positionBias;
+        Uniform<glm::mat4> model;
+        Uniform<glm::vec3> fogColor;
+        Uniform<GLfloat> fogDensity;
+    } lampUniforms_;
+
+    glm::vec3 fogColor_ = glm::vec3(0.2f);
+    float fogDensity_ = 0.0f;
+
+    // view and projection for every program, only re-written when the camera changes
+    Camera camera_;
+    std::unique_ptr<UniformRing> cameraRing_;
+    // draws are recorded here each frame, then sorted by state and executed in one go
+    CommandBuffer commands_;
+    GlCommandBackend glBackend_;
+    // GPU timings for the resolution governor, and for the profiler when it's compiled in
+    std::unique_ptr<GpuProfiler> gpuProfiler_;
+    // the cube mesh, drawn shaded for the cubes and position only for the lamp
+    MeshHandle cube_;
+
+    /*!
+     * Widens the range of cube instances that need to be uploaded before the next draw
+     */
+    void markCubesDirty(size_t first, size_t last);
+
+    // every object's transform, world matrices are computed once per frame in update()
+    TransformHierarchy transforms_;
+    TransformHierarchy::Handle cubeNode_ = TransformHierarchy::kNoParent;
+    TransformHierarchy::Handle lampNode_ = TransformHierarchy::kNoParent;
+
+    // CPU side instance list for the cube pass, only the changed range [begin, end) is uploaded
+    std::vector<CubeInstance> cubeInstances_;
+    size_t cubeDirtyBegin_ = 0;
+    size_t cubeDirtyEnd_ = 0;
+    std::unique_ptr<InstanceBuffer> cubeInstanceBuffer_;
+
+    // model space bounds of the cube mesh, and each cube's world space bounds for culling
+    glm::vec3 cubeCenter_ = glm::vec3(0.0f);
+    glm::vec3 cubeExtents_ = glm::vec3(0.0f);
+    BoundingBoxes cubeBounds_;
+    // indices and instances of the cubes that survived culling this frame
+    std::vector<uint32_t> cubeVisible_;
+    std::vector<CubeInstance> cubeVisibleInstances_;
+    // true while the instance buffer holds a culled subset instead of cubeInstances_
+    bool cubeBufferCulled_ = false;
 
     glm::vec3 lightPos = glm::vec3(1.2f, 1.0f, 2.0f);
-    glm::vec3 cameraPos = glm::vec3(0.0f, 0.0f, 3.0f);
+
+    // point lights, re-clustered when they or the camera change
+    std::vector<PointLight> lights_;
+    bool lightsDirty_ = true;
+    std::unique_ptr<ClusteredLighting> lighting_;
+
+    // textures decoded in the background and streamed up a few rows per frame
+    std::unique_ptr<TextureStreamer> textures_;
 };
 
 #endif //ANDROIDGLINVESTIGATIONS_RENDERER_H
\ No newline at end of file
@@ -0,0 +1,79 @@
+#include "ResolutionGovernor.h"
+
+#include <algorithm>
+#include <cmath>
+
+ResolutionGovernor::ResolutionGovernor() : ResolutionGovernor(Config()) {}
+
+ResolutionGovernor::ResolutionGovernor(const Config &config)
+        : config_(config),
+          scale_(config.maxScale),
+          // the first frames pay for shader compiles and uploads, don't judge by them
+          cooldown_(config.cooldownFrames) {}
+
+void ResolutionGovernor::reset(float scale) {
+    scale_ = quantize(scale);
+    cpuMs_ = 0.0f;
+    gpuMs_ = 0.0f;
+    overBudget_ = 0;
+    underBudget_ = 0;
+    cooldown_ = config_.cooldownFrames;
+}
+
+float ResolutionGovernor::quantize(float scale) const {
+    scale = std::round(scale / config_.scaleStep) * config_.scaleStep;
+    return std::clamp(scale, config_.minScale, config_.maxScale);
+}
+
+float ResolutionGovernor::smooth(float average, float sample, float weight) {
+    return average == 0.0f ? sample : average + (sample - average) * weight;
+}
+
+float ResolutionGovernor::update(float cpuMs, float gpuMs) {
+    stats_.frames++;
+    cpuMs_ = smooth(cpuMs_, cpuMs, config_.smoothing);
+    if (gpuMs > 0.0f) {
+        gpuMs_ = smooth(gpuMs_, gpuMs, config_.smoothing);
+    }
+    // A late frame with an idle GPU is the CPU's fault, rendering fewer pixels wouldn't help it
+    const float frameMs = gpuMs_ > 0.0f ? gpuMs_ : cpuMs_;
+
+    if (cooldown_ > 0) {
+        cooldown_--;
+        return scale_;
+    }
+
+    const float budget = config_.targetMs;
+    // the runs stop counting once long enough, at a scale limit they'd go on forever
+    overBudget_ = frameMs > budget * config_.downThreshold ? std::min(overBudget_ + 1, config_.downFrames) : 0;
+    underBudget_ = frameMs < budget * config_.upThreshold ? std::min(underBudget_ + 1, config_.upFrames) : 0;
+
+    float next = scale_;
+    if (overBudget_ >= config_.downFrames) {
+        // GPU cost goes with the pixel count, the square of the scale. Aim a little under the
+        // threshold so the next frame isn't straight back over it
+        float ratio = budget * config_.downThreshold * 0.9f / frameMs;
+        next = quantize(scale_ * std::sqrt(ratio));
+        if (next >= scale_) {
+            next = quantize(scale_ - config_.scaleStep);
+        }
+    } else if (underBudget_ >= config_.upFrames) {
+        next = quantize(scale_ + config_.scaleStep);
+    }
+
+    if (next != scale_) {
+        if (next < scale_) {
+            stats_.scaleDowns++;
+        } else {
+            stats_.scaleUps++;
+        }
+        scale_ = next;
+        overBudget_ = 0;
+        underBudget_ = 0;
+        cooldown_ = config_.cooldownFrames;
+        // the old averages describe the old resolution
+        cpuMs_ = 0.0f;
+        gpuMs_ = 0.0f;
+    }
+    return scale_;
+}
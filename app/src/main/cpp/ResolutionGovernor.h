@@ -0,0 +1,90 @@
+#ifndef ANDROIDGLINVESTIGATIONS_RESOLUTIONGOVERNOR_H
+#define ANDROIDGLINVESTIGATIONS_RESOLUTIONGOVERNOR_H
+
+#include <cstdint>
+
+/*!
+ * Picks the render scale for dynamic resolution from measured frame times. Fed one CPU and one
+ * GPU time per frame, it smooths both and, going by the GPU's where it has one since that's the
+ * part the resolution moves,
+ *  - drops the scale quickly, sized by how far over budget the frame is, once a few frames in a row
+ *    are over the budget
+ *  - raises it a small step at a time only after a long run of frames with clear headroom
+ *  - waits a while after any change before changing again
+ * The gap between the two thresholds and the uneven frame counts are the hysteresis that keeps it
+ * from flip-flopping around the target.
+ *
+ * Plain arithmetic on the numbers it's given, so it can be driven with synthetic traces.
+ */
+class ResolutionGovernor {
+public:
+    struct Config {
+        // frame budget, 60 fps by default
+        float targetMs = 1000.0f / 60.0f;
+        float minScale = 0.5f;
+        float maxScale = 1.0f;
+        // scales are multiples of this, so small wobbles don't resize anything
+        float scaleStep = 0.05f;
+        // over budget when the smoothed time is above targetMs * downThreshold
+        float downThreshold = 0.95f;
+        // room to grow when it's below targetMs * upThreshold
+        float upThreshold = 0.75f;
+        // frames in a row needed before acting
+        int downFrames = 3;
+        int upFrames = 60;
+        // frames to ignore after a change while the new resolution settles, GPU times lag a few
+        int cooldownFrames = 10;
+        // weight of the newest frame in the moving average
+        float smoothing = 0.2f;
+    };
+
+    struct Stats {
+        uint64_t frames = 0;
+        uint64_t scaleDowns = 0;
+        uint64_t scaleUps = 0;
+    };
+
+    ResolutionGovernor();
+
+    explicit ResolutionGovernor(const Config &config);
+
+    /*!
+     * Feeds one frame's timings
+     * @param cpuMs the CPU time spent producing the frame
+     * @param gpuMs the GPU time, or 0 if it isn't known. Then the CPU time decides, a CPU bound
+     * frame at least also shows up there
+     * @return the scale to render the next frame at
+     */
+    float update(float cpuMs, float gpuMs);
+
+    /*!
+     * Resets to @a scale and forgets the history
+     */
+    void reset(float scale);
+
+    inline float getScale() const { return scale_; }
+
+    inline float getSmoothedCpuMs() const { return cpuMs_; }
+
+    inline float getSmoothedGpuMs() const { return gpuMs_; }
+
+    inline const Config &getConfig() const { return config_; }
+
+    inline const Stats &getStats() const { return stats_; }
+
+private:
+    float quantize(float scale) const;
+
+    Config config_;
+    Stats stats_;
+    float scale_;
+    static float smooth(float average, float sample, float weight);
+
+    float cpuMs_ = 0.0f;
+    float gpuMs_ = 0.0f;
+    int overBudget_ = 0;
+    int underBudget_ = 0;
+    int cooldown_ = 0;
+};
+
+#endif //ANDROIDGLINVESTIGATIONS_RESOLUTIONGOVERNOR_H
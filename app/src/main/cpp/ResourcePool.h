@@ -0,0 +1,192 @@
+#ifndef ANDROIDGLINVESTIGATIONS_RESOURCEPOOL_H
+#define ANDROIDGLINVESTIGATIONS_RESOURCEPOOL_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+template<typename T>
+class ResourcePool;
+
+/*!
+ * Names a resource in a ResourcePool<T>: the slot it lives in, in the low 20 bits, and which use of
+ * that slot it is, in the high 12. Once the resource is destroyed the slot's generation moves on and
+ * the handle no longer finds anything, even after the slot is reused. A default handle is null.
+ */
+template<typename T>
+class ResourceHandle {
+public:
+    constexpr ResourceHandle() = default;
+
+    constexpr bool isNull() const { return value_ == 0; }
+
+    /*!
+     * @return the handle as a number, e.g. for a hash map key. 0 for a null handle.
+     */
+    constexpr uint32_t getValue() const { return value_; }
+
+    constexpr bool operator==(const ResourceHandle &other) const { return value_ == other.value_; }
+
+    constexpr bool operator!=(const ResourceHandle &other) const { return value_ != other.value_; }
+
+private:
+    friend class ResourcePool<T>;
+
+    constexpr explicit ResourceHandle(uint32_t value) : value_(value) {}
+
+    uint32_t value_ = 0;
+};
+
+/*!
+ * Owns resources of one type, packed together in a vector with no holes, and hands out handles to
+ * them instead of pointers. A lookup is two array reads, and a handle whose resource is gone finds
+ * null rather than freed memory. Destroying swaps the last resource into the hole, so pointers
+ * from get() only last until the next create() or destroy().
+ *
+ * Destroyed resources aren't freed right away: the commands recorded this frame may still name
+ * them. They wait until collect(), called once those commands have run. T must be movable, and a
+ * moved-from T must be safe to destroy.
+ *
+ * A slot's generation wraps after 4095 reuses, a handle kept that long could find the slot's
+ * newest resource.
+ */
+template<typename T>
+class ResourcePool {
+public:
+    using Handle = ResourceHandle<T>;
+
+    static constexpr uint32_t kIndexBits = 20;
+    static constexpr uint32_t kMaxResources = 1u << kIndexBits;
+
+    ResourcePool() = default;
+
+    ResourcePool(const ResourcePool &) = delete;
+
+    ResourcePool &operator=(const ResourcePool &) = delete;
+
+    /*!
+     * Takes @a resource over
+     * @return its handle, never null
+     */
+    Handle create(T &&resource) {
+        uint32_t slot;
+        if (!freeSlots_.empty()) {
+            slot = freeSlots_.back();
+            freeSlots_.pop_back();
+        } else {
+            assert(slots_.size() < kMaxResources);
+            slot = static_cast<uint32_t>(slots_.size());
+            slots_.push_back({0, 1});
+        }
+        slots_[slot].dense = static_cast<uint32_t>(resources_.size());
+        resources_.push_back(std::move(resource));
+        owners_.push_back(slot);
+        return Handle(slots_[slot].generation << kIndexBits | slot);
+    }
+
+    /*!
+     * @return the resource of @a handle, or null if it's been destroyed or is null
+     */
+    T *get(Handle handle) {
+        const Slot *slot = find(handle);
+        return slot ? &resources_[slot->dense] : nullptr;
+    }
+
+    const T *get(Handle handle) const {
+        const Slot *slot = find(handle);
+        return slot ? &resources_[slot->dense] : nullptr;
+    }
+
+    inline bool contains(Handle handle) const { return find(handle) != nullptr; }
+
+    /*!
+     * Retires the resource of @a handle, it's freed by the next collect(). Its handle, and every
+     * copy of it, stops finding it right away.
+     * @return false if there was nothing to destroy
+     */
+    bool destroy(Handle handle) {
+        if (!find(handle)) {
+            return false;
+        }
+        const uint32_t index = handle.value_ & kIndexMask;
+        Slot &slot = slots_[index];
+        nextGeneration(slot);
+        retired_.push_back(std::move(resources_[slot.dense]));
+        if (slot.dense + 1 != resources_.size()) {
+            resources_[slot.dense] = std::move(resources_.back());
+            owners_[slot.dense] = owners_.back();
+            slots_[owners_[slot.dense]].dense = slot.dense;
+        }
+        resources_.pop_back();
+        owners_.pop_back();
+        freeSlots_.push_back(index);
+        return true;
+    }
+
+    /*!
+     * Frees the resources destroyed since the last call
+     * @return how many were freed
+     */
+    size_t collect() {
+        const size_t count = retired_.size();
+        retired_.clear();
+        return count;
+    }
+
+    /*!
+     * Frees every resource now, retired or not, and invalidates every handle
+     */
+    void clear() {
+        for (uint32_t index: owners_) {
+            nextGeneration(slots_[index]);
+            freeSlots_.push_back(index);
+        }
+        resources_.clear();
+        owners_.clear();
+        retired_.clear();
+    }
+
+    inline size_t size() const { return resources_.size(); }
+
+    inline size_t getRetiredCount() const { return retired_.size(); }
+
+    /*!
+     * @return the live resources, in no particular order
+     */
+    inline const std::vector<T> &getResources() const { return resources_; }
+
+private:
+    static constexpr uint32_t kIndexMask = kMaxResources - 1;
+    static constexpr uint32_t kMaxGeneration = (1u << (32 - kIndexBits)) - 1;
+
+    struct Slot {
+        // where the slot's resource sits in resources_
+        uint32_t dense;
+        // 1 to kMaxGeneration, so no handle is ever 0
+        uint32_t generation;
+    };
+
+    const Slot *find(Handle handle) const {
+        const uint32_t index = handle.value_ & kIndexMask;
+        if (index >= slots_.size() || slots_[index].generation != handle.value_ >> kIndexBits) {
+            return nullptr;
+        }
+        return &slots_[index];
+    }
+
+    static void nextGeneration(Slot &slot) {
+        slot.generation = slot.generation == kMaxGeneration ? 1 : slot.generation + 1;
+    }
+
+    std::vector<T> resources_;
+    // the slot of each resource, parallel to resources_
+    std::vector<uint32_t> owners_;
+    std::vector<Slot> slots_;
+    std::vector<uint32_t> freeSlots_;
+    // destroyed, waiting for collect()
+    std::vector<T> retired_;
+};
+
+#endif //ANDROIDGLINVESTIGATIONS_RESOURCEPOOL_H
@@ -0,0 +1,50 @@
+#ifndef ANDROIDGLINVESTIGATIONS_RESOURCEREGISTRY_H
+#define ANDROIDGLINVESTIGATIONS_RESOURCEREGISTRY_H
+
+#include "Model.h"
+#include "ResourcePool.h"
+#include "ShaderVariants.h"
+#include "TextureAsset.h"
+
+using MeshHandle = ResourceHandle<Model>;
+using ProgramHandle = ResourceHandle<ShaderVariants>;
+
+/*!
+ * Every GPU resource the renderer draws with, one pool per kind, see ResourcePool. Render thread
+ * only, and everything in it is freed by clear() while the context is still current.
+ */
+class ResourceRegistry {
+public:
+    inline ResourcePool<Model> &getMeshes() { return meshes_; }
+
+    inline const ResourcePool<Model> &getMeshes() const { return meshes_; }
+
+    inline ResourcePool<TextureAsset> &getTextures() { return textures_; }
+
+    inline const ResourcePool<TextureAsset> &getTextures() const { return textures_; }
+
+    inline ResourcePool<ShaderVariants> &getPrograms() { return programs_; }
+
+    inline const ResourcePool<ShaderVariants> &getPrograms() const { return programs_; }
+
+    /*!
+     * Frees whatever was destroyed before the last frame was submitted
+     * @return how many resources were freed
+     */
+    inline size_t collect() {
+        return meshes_.collect() + textures_.collect() + programs_.collect();
+    }
+
+    inline void clear() {
+        meshes_.clear();
+        textures_.clear();
+        programs_.clear();
+    }
+
+private:
+    ResourcePool<Model> meshes_;
+    ResourcePool<TextureAsset> textures_;
+    ResourcePool<ShaderVariants> programs_;
+};
+
+#endif //ANDROIDGLINVESTIGATIONS_RESOURCEREGISTRY_H
@@ -1,36 +1,131 @@
 #include "Shader.h"
 
+#include <algorithm>
+#include <cstring>
+#include <EGL/egl.h>
+
 #include "AndroidOut.h"
+#include "Hash.h"
 
-Shader::Shader(AAssetManager *assetManager, const std::string &vertexPath,const std::string &fragmentPath) {
-    GLuint vertexShader = loadShader(GL_VERTEX_SHADER, loadFile(assetManager,vertexPath));
-    if (!vertexShader) {
-        return;
+bool Shader::parallelCompile_ = false;
+
+Shader::Shader(const AssetLoader &assets, const std::string &vertexPath,const std::string &fragmentPath,
+               ProgramCache *cache)
+        : Shader(loadSource(assets, vertexPath, fragmentPath), {}, cache) {}
+
+Shader::Shader(const ShaderSource &source, const std::string &defines, ProgramCache *cache,
+               ShaderBuild build)
+        : cache_(cache) {
+    const std::string vertexSource = addDefines(source.vertex, defines);
+    const std::string fragmentSource = addDefines(source.fragment, defines);
+
+    // a binary from an earlier run skips compiling and linking altogether
+    if (cache_ && cache_->isEnabled()) {
+        cacheKey_ = cache_->key(source.vertex, source.fragment, defines);
+        program_ = cache_->load(cacheKey_);
+        if (program_) {
+            reflect();
+            return;
+        }
     }
 
-    GLuint fragmentShader = loadShader(GL_FRAGMENT_SHADER, loadFile(assetManager,fragmentPath));
-    if (!fragmentShader) {
-        glDeleteShader(vertexShader);
+    // Hand everything to the driver without asking how it went: any status query waits for the
+    // work to finish, which is what poll() avoids
+    vertexShader_ = loadShader(GL_VERTEX_SHADER, vertexSource);
+    fragmentShader_ = loadShader(GL_FRAGMENT_SHADER, fragmentSource);
+    pendingProgram_ = glCreateProgram();
+    if (!vertexShader_ || !fragmentShader_ || !pendingProgram_) {
+        release();
         return;
     }
+    glAttachShader(pendingProgram_, vertexShader_);
+    glAttachShader(pendingProgram_, fragmentShader_);
+    if (cache_) {
+        cache_->prepare(pendingProgram_);
+    }
+    glLinkProgram(pendingProgram_);
 
-    GLuint program = glCreateProgram();
-    if (program) {
-        glAttachShader(program, vertexShader);
-        glAttachShader(program, fragmentShader);
+    if (build == ShaderBuild::Blocking) {
+        finish();
+    }
+}
+
+bool Shader::enableParallelCompile() {
+    GLint extensionCount = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+    parallelCompile_ = false;
+    for (GLint i = 0; i < extensionCount && !parallelCompile_; i++) {
+        auto *name = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+        parallelCompile_ = name && strcmp(name, "GL_KHR_parallel_shader_compile") == 0;
+    }
+    if (!parallelCompile_) {
+        aout << "GL_KHR_parallel_shader_compile not supported, program status is checked a frame later"
+             << std::endl;
+        return false;
+    }
+    // let the driver use as many threads as it likes, some default to none
+    auto maxShaderCompilerThreads = reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC>(
+            eglGetProcAddress("glMaxShaderCompilerThreadsKHR"));
+    if (maxShaderCompilerThreads) {
+        maxShaderCompilerThreads(0xFFFFFFFFu);
+    }
+    return true;
+}
+
+bool Shader::poll() {
+    if (!pendingProgram_) {
+        return true;
+    }
+    if (parallelCompile_) {
+        GLint completed = GL_FALSE;
+        glGetProgramiv(pendingProgram_, GL_COMPLETION_STATUS_KHR, &completed);
+        if (completed != GL_TRUE) {
+            return false;
+        }
+    } else if (polls_++ == 0) {
+        // no way to ask without waiting, so give the driver until the next poll, a frame later
+        return false;
+    }
+    finish();
+    return true;
+}
 
-        glLinkProgram(program);
-        GLint linkStatus = GL_FALSE;
-        glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
-        if (linkStatus != GL_TRUE) {
-            glDeleteProgram(program);
-        } else {
-            program_ = program;
+void Shader::finish() {
+    if (!pendingProgram_) {
+        return;
+    }
+    GLint linkStatus = GL_FALSE;
+    glGetProgramiv(pendingProgram_, GL_LINK_STATUS, &linkStatus);
+    if (linkStatus != GL_TRUE) {
+        // a stage that didn't compile explains the failed link better than the link log
+        if (logCompileErrors(vertexShader_) && logCompileErrors(fragmentShader_)) {
+            GLint infoLength = 0;
+            glGetProgramiv(pendingProgram_, GL_INFO_LOG_LENGTH, &infoLength);
+            if (infoLength) {
+                std::vector<GLchar> infoLog(infoLength);
+                glGetProgramInfoLog(pendingProgram_, infoLength, nullptr, infoLog.data());
+                aout << "Failed to link with:\n" << infoLog.data() << std::endl;
+            }
         }
+        release();
+        return;
+    }
+    program_ = pendingProgram_;
+    pendingProgram_ = 0;
+    reflect();
+    if (cache_) {
+        cache_->store(cacheKey_, program_);
     }
+    release();
+}
 
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+void Shader::release() {
+    glDeleteShader(vertexShader_);
+    glDeleteShader(fragmentShader_);
+    glDeleteProgram(pendingProgram_);
+    vertexShader_ = 0;
+    fragmentShader_ = 0;
+    pendingProgram_ = 0;
 }
 
 GLuint Shader::loadShader(GLenum shaderType, const std::string &shaderSource) {
@@ -40,40 +135,151 @@ GLuint Shader::loadShader(GLenum shaderType, const std::string &shaderSource) {
         GLint shaderLength = shaderSource.length();
         glShaderSource(shader, 1, &shaderRawString, &shaderLength);
         glCompileShader(shader);
+    }
+    return shader;
+}
 
-        GLint shaderCompiled = 0;
-        glGetShaderiv(shader, GL_COMPILE_STATUS, &shaderCompiled);
+bool Shader::logCompileErrors(GLuint shader) {
+    GLint shaderCompiled = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &shaderCompiled);
+    if (shaderCompiled) {
+        return true;
+    }
 
-        // If the shader doesn't compile, log the result to the terminal for debugging
-        if (!shaderCompiled) {
-            GLint infoLength = 0;
-            glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLength);
+    // If the shader doesn't compile, log the result to the terminal for debugging
+    GLint infoLength = 0;
+    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLength);
+    if (infoLength) {
+        auto *infoLog = new GLchar[infoLength];
+        glGetShaderInfoLog(shader, infoLength, nullptr, infoLog);
+        aout << "Failed to compile with:\n" << infoLog << std::endl;
+        delete[] infoLog;
+    }
+    return false;
+}
 
-            if (infoLength) {
-                auto *infoLog = new GLchar[infoLength];
-                glGetShaderInfoLog(shader, infoLength, nullptr, infoLog);
-                aout << "Failed to compile with:\n" << infoLog << std::endl;
-                delete[] infoLog;
-            }
+void Shader::reflect() {
+    GLint maxLength = 0;
+    glGetProgramiv(program_, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    GLint maxAttributeLength = 0;
+    glGetProgramiv(program_, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxAttributeLength);
+    std::vector<GLchar> nameBuffer(std::max(std::max(maxLength, maxAttributeLength), 1));
 
-            glDeleteShader(shader);
-            shader = 0;
+    // Array uniforms are reported as "name[0]", strip that so lookups use the plain name
+    auto addVariable = [&nameBuffer](std::vector<Variable> &table, GLsizei length, GLint location,
+                                     GLenum type, GLint size) {
+        std::string name(nameBuffer.data(), length);
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+            name.resize(name.size() - 3);
         }
+        table.push_back({hashName(name.data(), name.size()), location, type, size, name});
+    };
+
+    GLint uniformCount = 0;
+    glGetProgramiv(program_, GL_ACTIVE_UNIFORMS, &uniformCount);
+    uniforms_.clear();
+    uniforms_.reserve(uniformCount);
+    for (GLint i = 0; i < uniformCount; i++) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(program_, i, nameBuffer.size(), &length, &size, &type, nameBuffer.data());
+        // uniforms inside a block have no location, they are reached through their buffer
+        GLint location = glGetUniformLocation(program_, nameBuffer.data());
+        if (location < 0) {
+            continue;
+        }
+        addVariable(uniforms_, length, location, type, size);
     }
-    return shader;
+
+    GLint attributeCount = 0;
+    glGetProgramiv(program_, GL_ACTIVE_ATTRIBUTES, &attributeCount);
+    attributes_.clear();
+    attributes_.reserve(attributeCount);
+    for (GLint i = 0; i < attributeCount; i++) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveAttrib(program_, i, nameBuffer.size(), &length, &size, &type, nameBuffer.data());
+        addVariable(attributes_, length, glGetAttribLocation(program_, nameBuffer.data()), type, size);
+    }
+
+    auto byHash = [](const Variable &a, const Variable &b) { return a.hash < b.hash; };
+    std::sort(uniforms_.begin(), uniforms_.end(), byHash);
+    std::sort(attributes_.begin(), attributes_.end(), byHash);
 }
 
-std::string Shader::loadFile(AAssetManager *assetManager, const std::string fileName) {
-    auto shaderAsset = AAssetManager_open(
-            assetManager,
-            fileName.c_str(),
-            AASSET_MODE_BUFFER);
-    off_t file_size = AAsset_getLength(shaderAsset);
-    std::string file_buffer;
-    file_buffer.resize(file_size);
-    AAsset_read(shaderAsset, &file_buffer.front(), file_size);
-    AAsset_close(shaderAsset);
+uint32_t Shader::hashName(const char *name, size_t length) {
+    // the low half is plenty for a handful of identifiers, and keeps the tables small
+    return static_cast<uint32_t>(hashBytes(name, length));
+}
+
+const Shader::Variable *Shader::find(const std::vector<Variable> &table, const std::string &name) {
+    uint32_t hash = hashName(name.data(), name.size());
+    auto it = std::lower_bound(table.begin(), table.end(), hash,
+                               [](const Variable &variable, uint32_t value) {
+                                   return variable.hash < value;
+                               });
+    for (; it != table.end() && it->hash == hash; ++it) {
+        if (it->name == name) {
+            return &*it;
+        }
+    }
+    return nullptr;
+}
+
+GLint Shader::attribute(const std::string &name) const {
+    auto *variable = find(attributes_, name);
+    return variable ? variable->location : -1;
+}
 
+bool Shader::bindUniformBlock(const std::string &name, GLuint binding) const {
+    GLuint index = glGetUniformBlockIndex(program_, name.c_str());
+    if (index == GL_INVALID_INDEX) {
+        return false;
+    }
+    glUniformBlockBinding(program_, index, binding);
+    return true;
+}
+
+bool Shader::bindSampler(const std::string &name, GLint unit) const {
+    auto *variable = find(uniforms_, name);
+    if (!variable) {
+        return false;
+    }
+    glUseProgram(program_);
+    glUniform1i(variable->location, unit);
+    glUseProgram(0);
+    return true;
+}
+
+ShaderSource Shader::loadSource(const AssetLoader &assets, const std::string &vertexPath,
+                                const std::string &fragmentPath) {
+    return {loadFile(assets, vertexPath), loadFile(assets, fragmentPath)};
+}
+
+std::string Shader::addDefines(const std::string &source, const std::string &defines) {
+    if (defines.empty()) {
+        return source;
+    }
+    // #version has to stay the very first line
+    size_t lineEnd = source.compare(0, 8, "#version") == 0 ? source.find('\n') : std::string::npos;
+    if (lineEnd == std::string::npos) {
+        return defines + "#line 1\n" + source;
+    }
+    return source.substr(0, lineEnd + 1) + defines + "#line 2\n" + source.substr(lineEnd + 1);
+}
+
+std::string Shader::loadFile(const AssetLoader &assets, const std::string &fileName) {
+    // from a pack this is the only copy, straight out of the mapping
+    std::string_view view;
+    if (assets.view(fileName, view)) {
+        return std::string(view);
+    }
+    std::string file_buffer;
+    if (!assets.read(fileName, file_buffer)) {
+        aout << "Missing shader " << fileName << std::endl;
+    }
     return file_buffer;
 }
 
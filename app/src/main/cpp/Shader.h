@@ -1,41 +1,291 @@
 #ifndef ANDROIDGLINVESTIGATIONS_SHADER_H
 #define ANDROIDGLINVESTIGATIONS_SHADER_H
 
+#include <cassert>
+#include <cstdint>
 #include <string>
+#include <vector>
 #include <GLES3/gl3.h>
-#include <android/asset_manager.h>
+#include <GLES2/gl2ext.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "AssetLoader.h"
+#include "ProgramCache.h"
 
 class Model;
 
+#ifndef GL_KHR_parallel_shader_compile
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+typedef void (GL_APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+#endif
+
+/*!
+ * Maps a C++ type to the GL type reported by glGetActiveUniform, so a handle can be checked
+ * against what the program actually declares.
+ */
+template<typename T>
+struct UniformType;
+
+template<> struct UniformType<GLfloat> { static constexpr GLenum value = GL_FLOAT; };
+template<> struct UniformType<GLint> { static constexpr GLenum value = GL_INT; };
+template<> struct UniformType<glm::vec2> { static constexpr GLenum value = GL_FLOAT_VEC2; };
+template<> struct UniformType<glm::vec3> { static constexpr GLenum value = GL_FLOAT_VEC3; };
+template<> struct UniformType<glm::vec4> { static constexpr GLenum value = GL_FLOAT_VEC4; };
+template<> struct UniformType<glm::mat3> { static constexpr GLenum value = GL_FLOAT_MAT3; };
+template<> struct UniformType<glm::mat4> { static constexpr GLenum value = GL_FLOAT_MAT4; };
+
 /*!
- * A class representing a simple shader program. It consists of vertex and fragment components. The
- * input attributes are a position (as a Vector3) and a uv (as a Vector2). It also takes a uniform
- * to be used as the entire model/view/projection matrix. The shader expects a single texture for
- * fragment shading, and does no other lighting calculations (thus no uniforms for lights or normal
- * attributes).
+ * A typed, pre-resolved uniform location. Get one from Shader::uniform once after the program is
+ * linked and keep it around; setting a value never goes back to the driver for the name.
+ *
+ * A handle to a uniform the program doesn't have (or that the compiler optimized away) is valid to
+ * use, setting it is a no-op just like glUniform* with location -1.
+ */
+template<typename T>
+class Uniform {
+public:
+    inline Uniform() : location_(-1) {}
+
+    inline explicit Uniform(GLint location) : location_(location) {}
+
+    inline bool isValid() const { return location_ >= 0; }
+
+    inline GLint getLocation() const { return location_; }
+
+    /*!
+     * Uploads @a value to the currently bound program. The program this handle was resolved from
+     * must be active.
+     */
+    void set(const T &value) const;
+
+private:
+    GLint location_;
+};
+
+template<> inline void Uniform<GLfloat>::set(const GLfloat &value) const {
+    glUniform1f(location_, value);
+}
+
+template<> inline void Uniform<GLint>::set(const GLint &value) const {
+    glUniform1i(location_, value);
+}
+
+template<> inline void Uniform<glm::vec2>::set(const glm::vec2 &value) const {
+    glUniform2fv(location_, 1, glm::value_ptr(value));
+}
+
+template<> inline void Uniform<glm::vec3>::set(const glm::vec3 &value) const {
+    glUniform3fv(location_, 1, glm::value_ptr(value));
+}
+
+template<> inline void Uniform<glm::vec4>::set(const glm::vec4 &value) const {
+    glUniform4fv(location_, 1, glm::value_ptr(value));
+}
+
+template<> inline void Uniform<glm::mat3>::set(const glm::mat3 &value) const {
+    glUniformMatrix3fv(location_, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+template<> inline void Uniform<glm::mat4>::set(const glm::mat4 &value) const {
+    glUniformMatrix4fv(location_, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+/*!
+ * The vertex and fragment source of one program
+ */
+struct ShaderSource {
+    std::string vertex;
+    std::string fragment;
+};
+
+/*!
+ * Whether a Shader constructor waits for the program to link
+ */
+enum class ShaderBuild {
+    Blocking,
+    // the constructor only submits the work, see Shader::poll
+    Async,
+};
+
+/*!
+ * A class representing a simple shader program. It consists of vertex and fragment components.
+ *
+ * When the program links, every active uniform and attribute is reflected once into a small table
+ * sorted by name hash. Use @a uniform and @a attribute to resolve locations at setup time, never
+ * from the render loop.
+ *
+ * Built with ShaderBuild::Async, the constructor only submits the compiles and the link. Asking
+ * for any status would wait for the driver, so nothing is asked until @a poll says it won't block
+ * (with GL_KHR_parallel_shader_compile) or a poll a frame later (without). Until then the program
+ * is 0 and there is nothing to reflect.
  */
 class Shader {
 public:
-    Shader(AAssetManager *assetManager, const std::string &vertexPath,const std::string &fragmentPath);
+    /*!
+     * One reflected uniform or attribute. Array names are stored without their "[0]" suffix.
+     */
+    struct Variable {
+        uint32_t hash;
+        GLint location;
+        GLenum type;
+        GLint size;
+        std::string name;
+    };
+
+    /*!
+     * Builds the program from the two source files
+     * @param cache if given, the program comes from there when it has a binary for these sources
+     * and is stored there otherwise
+     */
+    Shader(const AssetLoader &assets, const std::string &vertexPath,const std::string &fragmentPath,
+           ProgramCache *cache = nullptr);
+
+    /*!
+     * Builds the program from source
+     * @param defines inserted into both stages right after the #version line, e.g. "#define FOG 1\n"
+     * @param cache as above, the defines are part of the key
+     */
+    Shader(const ShaderSource &source, const std::string &defines, ProgramCache *cache = nullptr,
+           ShaderBuild build = ShaderBuild::Blocking);
+
+    /*!
+     * Reads the two source files, logging any that are missing
+     */
+    static ShaderSource loadSource(const AssetLoader &assets, const std::string &vertexPath,
+                                   const std::string &fragmentPath);
 
     ~Shader() {
+        release();
         if (program_) {
             glDeleteProgram(program_);
             program_ = 0;
         }
     }
 
+    Shader(const Shader &) = delete;
+
+    Shader &operator=(const Shader &) = delete;
+
+    /*!
+     * Turns on GL_KHR_parallel_shader_compile for the current context, if the driver has it, so
+     * async builds can be polled without waiting. Call once after creating the context.
+     * @return false if the driver doesn't have it, async builds then check their status one poll
+     * after being submitted
+     */
+    static bool enableParallelCompile();
+
+    /*!
+     * Finishes an async build if that won't wait on the driver. Never blocks, so it's fine to call
+     * every frame.
+     * @return true once the build is done, linked or failed
+     */
+    bool poll();
+
+    /*!
+     * Finishes an async build, waiting for the driver if it isn't done yet
+     */
+    void finish();
+
+    /*!
+     * @return true while an async build hasn't been finished by @a poll or @a finish
+     */
+    inline bool isPending() const { return pendingProgram_ != 0; }
+
     void activate() const;
 
     void deactivate() const;
 
     GLuint getProgram() const;
 
+    /*!
+     * Resolves a typed uniform handle. In debug builds this asserts that the declared GLSL type
+     * matches @a T.
+     * @param name the uniform name as written in the shader
+     * @return a handle, invalid if the program has no active uniform with that name
+     */
+    template<typename T>
+    Uniform<T> uniform(const std::string &name) const {
+        auto *variable = find(uniforms_, name);
+        if (!variable) {
+            return Uniform<T>();
+        }
+        assert(variable->type == UniformType<T>::value);
+        return Uniform<T>(variable->location);
+    }
+
+    /*!
+     * @param name the attribute name as written in the vertex shader
+     * @return the attribute location, or -1 if the program has no active attribute with that name
+     */
+    GLint attribute(const std::string &name) const;
+
+    /*!
+     * Hooks the named uniform block up to a shared binding point. Only needs to happen once per
+     * program, after that whatever buffer range is bound to @a binding feeds the block.
+     * @return false if the program has no active block with that name
+     */
+    bool bindUniformBlock(const std::string &name, GLuint binding) const;
+
+    /*!
+     * Points the named sampler at a texture unit. Like @a bindUniformBlock only needed once, for
+     * textures that stay bound to their unit.
+     * @return false if the program has no active sampler with that name
+     */
+    bool bindSampler(const std::string &name, GLint unit) const;
+
+    inline const std::vector<Variable> &getUniforms() const { return uniforms_; }
+
+    inline const std::vector<Variable> &getAttributes() const { return attributes_; }
+
 private:
+    /*!
+     * Creates the shader and submits the compile, without waiting for it
+     */
     static GLuint loadShader(GLenum shaderType, const std::string &shaderSource);
 
-    std::string loadFile(AAssetManager *assetManager, const std::string fileName);
-    GLuint program_;
+    /*!
+     * Logs why @a shader didn't compile. Waits for the compile.
+     * @return true if it did compile
+     */
+    static bool logCompileErrors(GLuint shader);
+
+    /*!
+     * Deletes the objects of an unfinished or failed build
+     */
+    void release();
+
+    static uint32_t hashName(const char *name, size_t length);
+
+    static const Variable *find(const std::vector<Variable> &table, const std::string &name);
+
+    /*!
+     * Fills the uniform and attribute tables from the linked program
+     */
+    void reflect();
+
+    /*!
+     * @return @a source with @a defines after its #version line, and a #line so compile errors
+     * still point at the right line of the file
+     */
+    static std::string addDefines(const std::string &source, const std::string &defines);
+
+    static std::string loadFile(const AssetLoader &assets, const std::string &fileName);
+
+    GLuint program_ = 0;
+    // an async build in flight, program_ stays 0 until it's finished
+    GLuint vertexShader_ = 0;
+    GLuint fragmentShader_ = 0;
+    GLuint pendingProgram_ = 0;
+    // polls so far, without the extension the first one never finishes
+    int polls_ = 0;
+    ProgramCache *cache_ = nullptr;
+    uint64_t cacheKey_ = 0;
+    std::vector<Variable> uniforms_;
+    std::vector<Variable> attributes_;
+
+    // GL_KHR_parallel_shader_compile is on, see enableParallelCompile()
+    static bool parallelCompile_;
 };
 
-#endif //ANDROIDGLINVESTIGATIONS_SHADER_H
\ No newline at end of file
+#endif //ANDROIDGLINVESTIGATIONS_SHADER_H
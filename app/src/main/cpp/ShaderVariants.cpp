@@ -0,0 +1,162 @@
+#include "ShaderVariants.h"
+
+#include <algorithm>
+#include <cassert>
+#include <sstream>
+#include <utility>
+
+#include "AndroidOut.h"
+
+namespace {
+
+constexpr char kFeaturesPragma[] = "#pragma features";
+
+} // namespace
+
+ShaderVariants::ShaderVariants(const AssetLoader &assets, std::string name, ProgramCache *cache)
+        : name_(std::move(name)),
+          source_(Shader::loadSource(assets, name_ + ".vs", name_ + ".frag")),
+          cache_(cache) {
+    parseFeatures(source_.vertex, features_);
+    parseFeatures(source_.fragment, features_);
+    if (features_.size() > kMaxFeatures) {
+        aout << name_ << " declares " << features_.size() << " features, only the first "
+             << kMaxFeatures << " are used" << std::endl;
+        features_.resize(kMaxFeatures);
+    }
+    variants_.resize(size_t(1) << features_.size());
+    ready_.resize(variants_.size(), false);
+}
+
+ShaderVariants::Mask ShaderVariants::feature(const std::string &keyword) const {
+    auto it = std::find(features_.begin(), features_.end(), keyword);
+    return it == features_.end() ? 0 : Mask(1) << (it - features_.begin());
+}
+
+void ShaderVariants::setOnBuild(std::function<void(const Shader &)> onBuild) {
+    onBuild_ = std::move(onBuild);
+}
+
+const Shader &ShaderVariants::get(Mask mask) {
+    assert(mask < variants_.size());
+    if (!variants_[mask]) {
+        logFirstUse(mask);
+        build(mask, ShaderBuild::Blocking);
+    } else if (!ready_[mask]) {
+        variants_[mask]->finish();
+        pending_.erase(std::find(pending_.begin(), pending_.end(), mask));
+        finished(mask);
+    }
+    return *variants_[mask];
+}
+
+void ShaderVariants::request(Mask mask) {
+    assert(mask < variants_.size());
+    if (!variants_[mask]) {
+        logFirstUse(mask);
+        build(mask, ShaderBuild::Async);
+    }
+}
+
+size_t ShaderVariants::poll() {
+    for (auto it = pending_.begin(); it != pending_.end();) {
+        if (variants_[*it]->poll()) {
+            finished(*it);
+            it = pending_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return pending_.size();
+}
+
+size_t ShaderVariants::getBuiltCount() const {
+    return std::count(ready_.begin(), ready_.end(), true);
+}
+
+size_t ShaderVariants::warmUp(const std::string &manifest, ShaderBuild build) {
+    size_t built = 0;
+    std::istringstream lines(manifest);
+    std::string line;
+    while (std::getline(lines, line)) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream words(line);
+        std::string word;
+        if (!(words >> word) || word != name_) {
+            continue;
+        }
+        Mask mask = 0;
+        bool valid = true;
+        while (words >> word) {
+            Mask bit = feature(word);
+            if (!bit) {
+                aout << "Warm-up manifest: " << name_ << " has no feature " << word << std::endl;
+                valid = false;
+            }
+            mask |= bit;
+        }
+        if (valid && !variants_[mask]) {
+            this->build(mask, build);
+            stats_.warmedUp++;
+            built++;
+        }
+    }
+    return built;
+}
+
+std::string ShaderVariants::defines(Mask mask) const {
+    std::string defines;
+    for (size_t bit = 0; bit < features_.size(); bit++) {
+        if (mask & (Mask(1) << bit)) {
+            defines += "#define " + features_[bit] + " 1\n";
+        }
+    }
+    return defines;
+}
+
+void ShaderVariants::build(Mask mask, ShaderBuild build) {
+    variants_[mask] = std::make_unique<Shader>(source_, defines(mask), cache_, build);
+    if (variants_[mask]->isPending()) {
+        pending_.push_back(mask);
+    } else {
+        finished(mask);
+    }
+}
+
+void ShaderVariants::logFirstUse(Mask mask) {
+    // worth listing in the manifest, this was a hitch on the frame that asked
+    aout << "Building " << name_ << " variant " << mask << " on first use:"
+         << (mask ? "" : " (no features)");
+    for (size_t bit = 0; bit < features_.size(); bit++) {
+        if (mask & (Mask(1) << bit)) {
+            aout << " " << features_[bit];
+        }
+    }
+    aout << std::endl;
+    stats_.builtOnUse++;
+}
+
+void ShaderVariants::finished(Mask mask) {
+    ready_[mask] = true;
+    if (onBuild_ && variants_[mask]->getProgram()) {
+        onBuild_(*variants_[mask]);
+    }
+}
+
+void ShaderVariants::parseFeatures(const std::string &source, std::vector<std::string> &features) {
+    std::istringstream lines(source);
+    std::string line;
+    while (std::getline(lines, line)) {
+        const size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos || line.compare(start, sizeof(kFeaturesPragma) - 1, kFeaturesPragma) != 0) {
+            continue;
+        }
+        std::istringstream words(line.substr(start + sizeof(kFeaturesPragma) - 1));
+        std::string keyword;
+        while (words >> keyword) {
+            if (std::find(features.begin(), features.end(), keyword) == features.end()) {
+                features.push_back(keyword);
+            }
+        }
+    }
+}
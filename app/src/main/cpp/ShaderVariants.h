@@ -0,0 +1,145 @@
+#ifndef ANDROIDGLINVESTIGATIONS_SHADERVARIANTS_H
+#define ANDROIDGLINVESTIGATIONS_SHADERVARIANTS_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "AssetLoader.h"
+#include "ProgramCache.h"
+#include "Shader.h"
+
+/*!
+ * Every permutation of one shader. The source declares its optional features with a pragma in
+ * either stage, e.g.
+ *
+ *  #pragma features CLUSTERED_LIGHTS FOG
+ *
+ * Each keyword gets a bit in declaration order, and a variant is the program compiled with
+ * "#define KEYWORD 1" for every bit set in its mask. Variants are built the first time they are
+ * asked for, or up front from a warm-up manifest so the first frame that needs one doesn't stall
+ * on the compiler. Both can be async: @a request and an async @a warmUp only submit the work, and
+ * @a poll finishes whatever the driver is done with.
+ *
+ * The shaders give their attributes explicit locations, so a vertex array set up for one variant
+ * works with all of them.
+ */
+class ShaderVariants {
+public:
+    using Mask = uint32_t;
+
+    static constexpr size_t kMaxFeatures = 8;
+
+    struct Stats {
+        // variants built from the manifest
+        size_t warmedUp = 0;
+        // variants built the first time they were drawn with
+        size_t builtOnUse = 0;
+    };
+
+    /*!
+     * Reads @a name.vs and @a name.frag and their feature list, nothing is compiled yet
+     * @param cache where the variants' binaries go, may be null
+     */
+    ShaderVariants(const AssetLoader &assets, std::string name, ProgramCache *cache = nullptr);
+
+    /*!
+     * @return the bit of @a keyword, 0 if the shader doesn't declare it
+     */
+    Mask feature(const std::string &keyword) const;
+
+    inline const std::vector<std::string> &getFeatures() const { return features_; }
+
+    inline const std::string &getName() const { return name_; }
+
+    /*!
+     * Called with every variant once it has linked, for state that lives in the program such as
+     * uniform block bindings and sampler units
+     */
+    void setOnBuild(std::function<void(const Shader &)> onBuild);
+
+    /*!
+     * @return the variant for @a mask, built now if it wasn't yet and waiting for it if it's
+     * still building
+     */
+    const Shader &get(Mask mask);
+
+    /*!
+     * Starts an async build of the variant for @a mask unless it exists or is on its way. Follow
+     * up with @a poll until @a isReady.
+     */
+    void request(Mask mask);
+
+    /*!
+     * @return true if the variant for @a mask is built and finished, @a get won't wait
+     */
+    inline bool isReady(Mask mask) const { return mask < ready_.size() && ready_[mask]; }
+
+    /*!
+     * Finishes the async builds the driver is done with, never waits
+     * @return how many are still building
+     */
+    size_t poll();
+
+    /*!
+     * @return how many variants are built and finished so far
+     */
+    size_t getBuiltCount() const;
+
+    /*!
+     * Builds the variants a manifest lists for this shader. One variant per line, the shader name
+     * followed by its keywords:
+     *
+     *  # comment
+     *  cube_shader
+     *  cube_shader CLUSTERED_LIGHTS FOG
+     *
+     * Lines for other shaders are skipped, so all shaders can share one manifest.
+     * @param build ShaderBuild::Async only submits them, see @a poll
+     * @return how many variants were built or submitted
+     */
+    size_t warmUp(const std::string &manifest, ShaderBuild build = ShaderBuild::Blocking);
+
+    /*!
+     * @return the define preamble for @a mask
+     */
+    std::string defines(Mask mask) const;
+
+    inline const Stats &getStats() const { return stats_; }
+
+private:
+    void build(Mask mask, ShaderBuild build);
+
+    /*!
+     * Logs that @a mask is being built because something asked for it, not the manifest
+     */
+    void logFirstUse(Mask mask);
+
+    /*!
+     * Marks a finished variant ready and hands it to the build callback
+     */
+    void finished(Mask mask);
+
+    /*!
+     * Collects the keywords of every "#pragma features" line in @a source into @a features,
+     * skipping ones already there
+     */
+    static void parseFeatures(const std::string &source, std::vector<std::string> &features);
+
+    std::string name_;
+    ShaderSource source_;
+    ProgramCache *cache_;
+    std::vector<std::string> features_;
+    std::function<void(const Shader &)> onBuild_;
+    // indexed by mask, null until built
+    std::vector<std::unique_ptr<Shader>> variants_;
+    // indexed by mask, true once the variant is finished and has been through onBuild_
+    std::vector<bool> ready_;
+    // masks of the async builds in flight
+    std::vector<Mask> pending_;
+    Stats stats_;
+};
+
+#endif //ANDROIDGLINVESTIGATIONS_SHADERVARIANTS_H
@@ -0,0 +1,18 @@
+#include "Simulation.h"
+
+#include <algorithm>
+
+void Simulation::step(FrameSnapshot &snapshot, float seconds) {
+    accumulated_ += std::min(seconds, kMaxElapsed);
+    for (; accumulated_ >= kTimeStep; accumulated_ -= kTimeStep) {
+        // friction, the spin winds down a little every tick
+        if(movementSpeed_ > 0) {
+            movementSpeed_ = movementSpeed_ - 0.1 > 0 ? movementSpeed_ - 0.1 : 0;
+        }
+        if(movementSpeed_ < 0) {
+            movementSpeed_ = movementSpeed_ + 0.1 < 0 ? movementSpeed_ + 0.1 : 0;
+        }
+    }
+
+    snapshot.cubeRotation = glm::angleAxis(movementSpeed_ * 10.0f, glm::vec3(0.0f, 1.0f, 0.0f));
+}
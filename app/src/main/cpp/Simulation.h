@@ -0,0 +1,39 @@
+#ifndef ANDROIDGLINVESTIGATIONS_SIMULATION_H
+#define ANDROIDGLINVESTIGATIONS_SIMULATION_H
+
+#include "RenderThread.h"
+
+/*!
+ * The game state, advanced in fixed ticks of wall time on the game thread, however often frames are
+ * published. Knows nothing about GL or Android input, the game thread feeds it and it writes
+ * FrameSnapshots.
+ */
+class Simulation {
+public:
+    // one tick of the simulation, in seconds
+    static constexpr float kTimeStep = 1.0f / 60.0f;
+
+    /*!
+     * Sets how fast the cube spins, it slows back down to rest on its own
+     */
+    inline void setSpeed(float speed) { movementSpeed_ = speed; }
+
+    inline float getSpeed() const { return movementSpeed_; }
+
+    /*!
+     * Runs the ticks that fit in @a seconds plus what was left over from the last call, then
+     * writes the current state into @a snapshot
+     * @param seconds wall time since the last step
+     */
+    void step(FrameSnapshot &snapshot, float seconds);
+
+private:
+    // ticks are dropped past this, so a stall doesn't have to be caught up with in one go
+    static constexpr float kMaxElapsed = 0.25f;
+
+    float movementSpeed_ = 0.0f;
+    // wall time not yet simulated, less than a tick
+    float accumulated_ = 0.0f;
+};
+
+#endif //ANDROIDGLINVESTIGATIONS_SIMULATION_H
@@ -0,0 +1,68 @@
+#ifndef ANDROIDGLINVESTIGATIONS_SPSCQUEUE_H
+#define ANDROIDGLINVESTIGATIONS_SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+/*!
+ * A bounded lock-free queue for exactly one producer thread and one consumer thread. Each side only
+ * writes its own index, and caches the other side's so the shared cache line is only read when the
+ * queue looks full or empty. A push happens-before the pop that returns it.
+ *
+ * @tparam T a trivially copyable value, typically an index into storage owned elsewhere
+ * @tparam Capacity the most values in flight, a power of two
+ */
+template<typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    /*!
+     * Producer side only
+     * @return false if the queue is full
+     */
+    bool push(const T &value) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - headCache_ == Capacity) {
+            headCache_ = head_.load(std::memory_order_acquire);
+            if (tail - headCache_ == Capacity) {
+                return false;
+            }
+        }
+        items_[tail & (Capacity - 1)] = value;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /*!
+     * Consumer side only
+     * @return false if the queue is empty
+     */
+    bool pop(T &value) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tailCache_) {
+            tailCache_ = tail_.load(std::memory_order_acquire);
+            if (head == tailCache_) {
+                return false;
+            }
+        }
+        value = items_[head & (Capacity - 1)];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    static constexpr size_t kCacheLine = 64;
+
+    // consumer owned
+    alignas(kCacheLine) std::atomic<size_t> head_{0};
+    size_t tailCache_ = 0;
+
+    // producer owned
+    alignas(kCacheLine) std::atomic<size_t> tail_{0};
+    size_t headCache_ = 0;
+
+    alignas(kCacheLine) T items_[Capacity];
+};
+
+#endif //ANDROIDGLINVESTIGATIONS_SPSCQUEUE_H
@@ -1,80 +1,147 @@
-#include <android/imagedecoder.h>
 #include "TextureAsset.h"
+#ifdef __ANDROID__
+#include "AndroidImageDecoder.h"
+#endif
 #include "AndroidOut.h"
-#include <cassert>
+#include "CompressedTexture.h"
+#include "MipGenerator.h"
+#include "TextureFormatSelector.h"
 
-std::shared_ptr<TextureAsset>
-TextureAsset::loadAsset(AAssetManager *assetManager, const std::string &assetPath) {
-    // Get the image from asset manager
-    auto pAndroidRobotPng = AAssetManager_open(
-            assetManager,
-            assetPath.c_str(),
-            AASSET_MODE_BUFFER);
+namespace {
 
-    // Make a decoder to turn it into a texture
-    AImageDecoder *pAndroidDecoder = nullptr;
-    auto result = AImageDecoder_createFromAAsset(pAndroidRobotPng, &pAndroidDecoder);
-    assert(result == ANDROID_IMAGE_DECODER_SUCCESS);
+/*!
+ * Sets @a sampler on the bound texture. Without mips, a mipmapped filter would leave the texture
+ * incomplete, it becomes the same filter on level 0.
+ */
+void applySampler(const TextureSampler &sampler, bool mipmapped) {
+    GLint minFilter = sampler.minFilter;
+    if (!mipmapped && (minFilter == GL_NEAREST_MIPMAP_NEAREST || minFilter == GL_NEAREST_MIPMAP_LINEAR)) {
+        minFilter = GL_NEAREST;
+    } else if (!mipmapped && (minFilter == GL_LINEAR_MIPMAP_NEAREST || minFilter == GL_LINEAR_MIPMAP_LINEAR)) {
+        minFilter = GL_LINEAR;
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, sampler.wrapS);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, sampler.wrapT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, sampler.magFilter);
+}
+
+} // namespace
+
+#ifdef __ANDROID__
+TextureAsset
+TextureAsset::loadAsset(const AssetLoader &assets, const std::string &assetPath) {
+    return loadAsset(assets, assetPath, AndroidImageDecoder());
+}
+#endif
 
-    // make sure we get 8 bits per channel out. RGBA order.
-    AImageDecoder_setAndroidBitmapFormat(pAndroidDecoder, ANDROID_BITMAP_FORMAT_RGBA_8888);
+TextureAsset
+TextureAsset::loadAsset(const AssetLoader &assets, const std::string &assetPath, const ImageDecoder &decoder,
+                        const TextureSampler &sampler) {
+    // Get the encoded image, decoded in place when the loader has it mapped
+    std::string_view encoded;
+    std::string buffer;
+    if (!assets.view(assetPath, encoded)) {
+        if (!assets.read(assetPath, buffer)) {
+            aout << "Missing texture " << assetPath << std::endl;
+            return TextureAsset();
+        }
+        encoded = buffer;
+    }
 
-    // Get the image header, to help set everything up
-    const AImageDecoderHeaderInfo *pAndroidHeader = nullptr;
-    pAndroidHeader = AImageDecoder_getHeaderInfo(pAndroidDecoder);
+    // KTX2 files are already in a GPU format, their blocks go up untouched
+    if (CompressedTexture::isCompressedPath(assetPath)) {
+        CompressedTexture compressed(encoded);
+        if (!compressed.isValid()) {
+            aout << "Couldn't read " << assetPath << std::endl;
+            return TextureAsset();
+        }
+        GLuint textureId = compressed.upload();
+        if (!textureId) {
+            aout << "This GPU can't sample the format of " << assetPath << std::endl;
+            return TextureAsset();
+        }
+        size_t bytes = 0;
+        for (uint32_t level = 0; level < compressed.getLevelCount(); level++) {
+            bytes += compressed.getLevel(level).size();
+        }
+        glBindTexture(GL_TEXTURE_2D, textureId);
+        applySampler(sampler, compressed.getLevelCount() > 1);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return TextureAsset(textureId, bytes);
+    }
 
-    // important metrics for sending to GL
-    auto width = AImageDecoderHeaderInfo_getWidth(pAndroidHeader);
-    auto height = AImageDecoderHeaderInfo_getHeight(pAndroidHeader);
-    auto stride = AImageDecoder_getMinimumStride(pAndroidDecoder);
+    // Decode it to RGBA, 8 bits per channel
+    DecodedImage image;
+    if (!decoder.decode(encoded, image) || image.width == 0 || image.height == 0) {
+        aout << "Couldn't decode " << assetPath << std::endl;
+        return TextureAsset();
+    }
 
-    // Get the bitmap data of the image
-    auto upAndroidImageData = std::make_unique<std::vector<uint8_t>>(height * stride);
-    auto decodeResult = AImageDecoder_decodeImage(
-            pAndroidDecoder,
-            upAndroidImageData->data(),
-            stride,
-            upAndroidImageData->size());
-    assert(decodeResult == ANDROID_IMAGE_DECODER_SUCCESS);
+    // The mips come from the CPU rather than glGenerateMipmap, filtered in linear space
+    std::vector<DecodedImage> mips = MipGenerator().generate(image);
+
+    // Then everything goes into the smallest format that keeps the texels of every level
+    const TextureFormatSelector::Format &format = *TextureFormatSelector().choose(image, mips).format;
+    TextureFormatSelector::convert(image, format);
+    for (auto &mip: mips) {
+        TextureFormatSelector::convert(mip, format);
+    }
+    const auto levels = static_cast<uint32_t>(mips.size() + 1);
+    const size_t rgba8Bytes = TextureFormatSelector::chainBytes(TextureFormatSelector::rgba8(), image.width,
+                                                                image.height, levels);
+    const size_t bytes = TextureFormatSelector::chainBytes(format, image.width, image.height, levels);
+    aout << assetPath << ": " << format.name << ", " << (rgba8Bytes - bytes) / 1024 << " KiB of VRAM saved over RGBA8"
+         << std::endl;
 
     // Get an opengl texture
     GLuint textureId;
     glGenTextures(1, &textureId);
     glBindTexture(GL_TEXTURE_2D, textureId);
 
-    // Clamp to the edge, you'll get odd results alpha blending if you don't
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // Clamp to the edge by default, you'll get odd results alpha blending if you don't
+    applySampler(sampler, levels > 1);
 
-    // Load the texture into VRAM
-    glTexImage2D(
-            GL_TEXTURE_2D, // target
-            0, // mip level
-            GL_RGBA, // internal format, often advisable to use BGR
-            width, // width of the texture
-            height, // height of the texture
-            0, // border (always 0)
-            GL_RGBA, // format
-            GL_UNSIGNED_BYTE, // type
-            upAndroidImageData->data() // Data to upload
-    );
+    // Load every level into VRAM. Rows of the narrow formats needn't be 4 byte aligned
+    glTexStorage2D(GL_TEXTURE_2D, static_cast<GLsizei>(levels), format.internalFormat, image.width, image.height);
+    TextureFormatSelector::applySwizzle(format);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (size_t level = 0; level <= mips.size(); level++) {
+        const DecodedImage &pixels = level == 0 ? image : mips[level - 1];
+        glTexSubImage2D(
+                GL_TEXTURE_2D, // target
+                static_cast<GLint>(level), // mip level
+                0, 0, // offset
+                pixels.width, // width of the level
+                pixels.height, // height of the level
+                format.format, // format
+                format.type, // type
+                pixels.pixels.data() // Data to upload
+        );
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
-    // generate mip levels. Not really needed for 2D, but good to do
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    // cleanup helpers
-    AImageDecoder_delete(pAndroidDecoder);
-    AAsset_close(pAndroidRobotPng);
+    // The texture is deleted with the TextureAsset
+    return TextureAsset(textureId, bytes);
+}
 
-    // Create a shared pointer so it can be cleaned up easily/automatically
-    return std::shared_ptr<TextureAsset>(new TextureAsset(textureId));
+TextureAsset &TextureAsset::operator=(TextureAsset &&other) noexcept {
+    if (this != &other) {
+        if (textureID_) {
+            glDeleteTextures(1, &textureID_);
+        }
+        textureID_ = other.textureID_;
+        vramBytes_ = other.vramBytes_;
+        other.textureID_ = 0;
+        other.vramBytes_ = 0;
+    }
+    return *this;
 }
 
 TextureAsset::~TextureAsset() {
-    // return texture resources
-    glDeleteTextures(1, &textureID_);
-    textureID_ = 0;
+    // return texture resources, moved from ones have none
+    if (textureID_) {
+        glDeleteTextures(1, &textureID_);
+        textureID_ = 0;
+    }
 }
\ No newline at end of file
@@ -1,33 +1,97 @@
 #ifndef ANDROIDGLINVESTIGATIONS_TEXTUREASSET_H
 #define ANDROIDGLINVESTIGATIONS_TEXTUREASSET_H
 
-#include <memory>
-#include <android/asset_manager.h>
 #include <GLES3/gl3.h>
 #include <string>
 
+#include "AssetLoader.h"
+#include "ImageDecoder.h"
+#include "ResourcePool.h"
+
+/*!
+ * How a texture is sampled. GLES 3 keeps this in the texture itself, so the same image sampled two
+ * ways is two textures.
+ */
+struct TextureSampler {
+    GLint wrapS = GL_CLAMP_TO_EDGE;
+    GLint wrapT = GL_CLAMP_TO_EDGE;
+    // mipmapped filters fall back to their level 0 version for KTX2 files without mips
+    GLint minFilter = GL_LINEAR_MIPMAP_LINEAR;
+    GLint magFilter = GL_LINEAR;
+
+    inline bool operator==(const TextureSampler &other) const {
+        return wrapS == other.wrapS && wrapT == other.wrapT && minFilter == other.minFilter
+               && magFilter == other.magFilter;
+    }
+};
+
+/*!
+ * Owns a GL texture, deleted with it. Move only, usually kept in a ResourceRegistry and passed
+ * around as a TextureHandle.
+ */
 class TextureAsset {
 public:
+#ifdef __ANDROID__
+    /*!
+     * Loads a texture asset from the assets/ directory, decoded with AImageDecoder
+     */
+    static TextureAsset
+    loadAsset(const AssetLoader &assets, const std::string &assetPath);
+#endif
+
     /*!
-     * Loads a texture asset from the assets/ directory
-     * @param assetManager Asset manager to use
+     * Loads a texture asset from the assets/ directory. Decodes and uploads right here on the
+     * calling thread, see TextureStreamer for loading without the stall. KTX2 files, see
+     * CompressedTexture, skip the decode and keep their compressed format and mip chain. Each load
+     * is a texture of its own, see TextureCache for sharing them.
+     * @param assets where to read the asset from
      * @param assetPath The path to the asset
-     * @return a shared pointer to a texture asset, resources will be reclaimed when it's cleaned up
+     * @param decoder turns the file into pixels
+     * @param sampler how the texture is sampled
+     * @return the texture, or an invalid one if the asset is missing or can't be read
+     */
+    static TextureAsset
+    loadAsset(const AssetLoader &assets, const std::string &assetPath, const ImageDecoder &decoder,
+              const TextureSampler &sampler = TextureSampler());
+
+    /*!
+     * An invalid texture, with nothing to delete
      */
-    static std::shared_ptr<TextureAsset>
-    loadAsset(AAssetManager *assetManager, const std::string &assetPath);
+    TextureAsset() = default;
+
+    inline TextureAsset(TextureAsset &&other) noexcept
+            : textureID_(other.textureID_), vramBytes_(other.vramBytes_) {
+        other.textureID_ = 0;
+        other.vramBytes_ = 0;
+    }
+
+    TextureAsset &operator=(TextureAsset &&other) noexcept;
+
+    TextureAsset(const TextureAsset &) = delete;
+
+    TextureAsset &operator=(const TextureAsset &) = delete;
 
     ~TextureAsset();
 
+    constexpr bool isValid() const { return textureID_ != 0; }
+
     /*!
      * @return the texture id for use with OpenGL
      */
     constexpr GLuint getTextureID() const { return textureID_; }
 
+    /*!
+     * @return the bytes of VRAM the texture's levels take, as allocated by glTexStorage2D
+     */
+    constexpr size_t getVramBytes() const { return vramBytes_; }
+
 private:
-    inline TextureAsset(GLuint textureId) : textureID_(textureId) {}
+    inline TextureAsset(GLuint textureId, size_t vramBytes) : textureID_(textureId), vramBytes_(vramBytes) {}
 
-    GLuint textureID_;
+    GLuint textureID_ = 0;
+    size_t vramBytes_ = 0;
 };
 
+using TextureHandle = ResourceHandle<TextureAsset>;
+
 #endif //ANDROIDGLINVESTIGATIONS_TEXTUREASSET_H
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "TextureCache.h"
+
+#include <cassert>
+#include <utility>
+
+#include "Hash.h"
+
+size_t TextureCache::KeyHash::operator()(const Key &key) const {
+    const GLint sampler[] = {key.sampler.wrapS, key.sampler.wrapT, key.sampler.minFilter, key.sampler.magFilter};
+    return static_cast<size_t>(hashBytes(sampler, sizeof(sampler), hashBytes(key.path.data(), key.path.size())));
+}
+
+TextureCache::TextureCache(const AssetLoader &assets, ResourceRegistry &resources,
+                           std::unique_ptr<ImageDecoder> decoder, Config config)
+        : assets_(assets), resources_(resources), decoder_(std::move(decoder)), config_(config) {
+    assert(decoder_);
+}
+
+TextureCache::~TextureCache() {
+    for (const auto &entry: entries_) {
+        resources_.getTextures().destroy(entry.second.texture);
+    }
+}
+
+TextureHandle TextureCache::get(const std::string &path, const TextureSampler &sampler) {
+    Key key{path, sampler};
+    auto found = entries_.find(key);
+    if (found != entries_.end()) {
+        stats_.hits++;
+        found->second.users++;
+        recent_.splice(recent_.begin(), recent_, found->second.use);
+        return found->second.texture;
+    }
+
+    stats_.misses++;
+    TextureAsset loaded = TextureAsset::loadAsset(assets_, path, *decoder_, sampler);
+    if (!loaded.isValid()) {
+        return TextureHandle();
+    }
+    // room for the new one first, it isn't in the cache yet so it can't go itself
+    const size_t vramBytes = loaded.getVramBytes();
+    evictDownTo(config_.budgetBytes > vramBytes ? config_.budgetBytes - vramBytes : 0);
+    const TextureHandle texture = resources_.getTextures().create(std::move(loaded));
+    recent_.push_front(key);
+    entries_.emplace(std::move(key), Entry{texture, vramBytes, 1, recent_.begin()});
+    keys_.emplace(texture.getValue(), recent_.begin());
+    stats_.bytesResident += vramBytes;
+    stats_.textures = entries_.size();
+    return texture;
+}
+
+void TextureCache::release(TextureHandle texture) {
+    auto key = keys_.find(texture.getValue());
+    if (key == keys_.end()) {
+        return;
+    }
+    auto entry = entries_.find(*key->second);
+    assert(entry != entries_.end() && entry->second.users > 0);
+    entry->second.users--;
+}
+
+void TextureCache::trim() {
+    evictDownTo(config_.budgetBytes);
+}
+
+void TextureCache::purge() {
+    evictDownTo(0);
+}
+
+void TextureCache::setBudget(size_t budgetBytes) {
+    config_.budgetBytes = budgetBytes;
+    trim();
+}
+
+void TextureCache::evictDownTo(size_t bytes) {
+    for (auto use = recent_.end(); use != recent_.begin() && stats_.bytesResident > bytes;) {
+        --use;
+        auto entry = entries_.find(*use);
+        assert(entry != entries_.end());
+        if (entry->second.users > 0) {
+            continue;
+        }
+        // freed by the registry once the frames drawing with it are done
+        resources_.getTextures().destroy(entry->second.texture);
+        keys_.erase(entry->second.texture.getValue());
+        stats_.bytesResident -= entry->second.vramBytes;
+        stats_.evictions++;
+        entries_.erase(entry);
+        use = recent_.erase(use);
+    }
+    stats_.textures = entries_.size();
+}
@@ -0,0 +1,133 @@
+#ifndef ANDROIDGLINVESTIGATIONS_TEXTURECACHE_H
+#define ANDROIDGLINVESTIGATIONS_TEXTURECACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "AssetLoader.h"
+#include "ImageDecoder.h"
+#include "ResourceRegistry.h"
+#include "TextureAsset.h"
+
+/*!
+ * Shares textures between everything that loads the same file with the same sampler state,
+ * instead of every load making a texture of its own. The textures live in a ResourceRegistry and
+ * each get() counts as a use until its release(). Textures nobody uses any more stay cached for
+ * the next load, until the textures in the cache take more VRAM than the budget: then the least
+ * recently used of them are destroyed first. Textures in use are never evicted, so the cache can
+ * sit over its budget while they are.
+ *
+ * Loads decode and upload on the calling thread, see TextureAsset::loadAsset. Render thread only.
+ */
+class TextureCache {
+public:
+    struct Config {
+        // bytes of VRAM the cached textures may take before unused ones are evicted
+        size_t budgetBytes = 64 * 1024 * 1024;
+    };
+
+    struct Stats {
+        // loads served from the cache
+        uint64_t hits = 0;
+        // loads that had to read the file, including the ones that failed
+        uint64_t misses = 0;
+        // textures dropped to get back under the budget
+        uint64_t evictions = 0;
+        // VRAM of every texture in the cache, in use or not
+        size_t bytesResident = 0;
+        size_t textures = 0;
+    };
+
+    /*!
+     * @param assets where the textures are read from, must outlive this
+     * @param resources where the textures are kept, must outlive this
+     */
+    TextureCache(const AssetLoader &assets, ResourceRegistry &resources, std::unique_ptr<ImageDecoder> decoder,
+                 Config config);
+
+    TextureCache(const AssetLoader &assets, ResourceRegistry &resources, std::unique_ptr<ImageDecoder> decoder)
+            : TextureCache(assets, resources, std::move(decoder), Config()) {}
+
+    /*!
+     * Destroys every texture in the cache, in use or not
+     */
+    ~TextureCache();
+
+    TextureCache(const TextureCache &) = delete;
+
+    TextureCache &operator=(const TextureCache &) = delete;
+
+    /*!
+     * @return the texture of @a path sampled with @a sampler, loaded if it isn't cached, or null if
+     * it couldn't be loaded. Pass it to release() when done with it.
+     */
+    TextureHandle get(const std::string &path, const TextureSampler &sampler = TextureSampler());
+
+    /*!
+     * Ends a use of @a texture, from get(). Once nothing uses it, it can be evicted.
+     */
+    void release(TextureHandle texture);
+
+    /*!
+     * Evicts textures nothing uses, least recently used first, until the cache is within its
+     * budget. Loads do this already, call it after releasing textures to free them sooner.
+     */
+    void trim();
+
+    /*!
+     * Evicts every texture nothing uses
+     */
+    void purge();
+
+    void setBudget(size_t budgetBytes);
+
+    inline const Config &getConfig() const { return config_; }
+
+    inline const Stats &getStats() const { return stats_; }
+
+private:
+    struct Key {
+        std::string path;
+        TextureSampler sampler;
+
+        inline bool operator==(const Key &other) const {
+            return path == other.path && sampler == other.sampler;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key &key) const;
+    };
+
+    struct Entry {
+        TextureHandle texture;
+        size_t vramBytes;
+        // get()s not released yet
+        uint32_t users;
+        // where the key sits in recent_
+        std::list<Key>::iterator use;
+    };
+
+    /*!
+     * Evicts unused textures, least recently used first, while the cache holds more than @a bytes
+     */
+    void evictDownTo(size_t bytes);
+
+    const AssetLoader &assets_;
+    ResourceRegistry &resources_;
+    std::unique_ptr<ImageDecoder> decoder_;
+    Config config_;
+    Stats stats_;
+
+    std::unordered_map<Key, Entry, KeyHash> entries_;
+    // most recently used first
+    std::list<Key> recent_;
+    // the key of each texture, by handle value, for release()
+    std::unordered_map<uint32_t, std::list<Key>::iterator> keys_;
+};
+
+#endif //ANDROIDGLINVESTIGATIONS_TEXTURECACHE_H
@@ -0,0 +1,188 @@
+#include "TextureFormatSelector.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+namespace {
+
+constexpr size_t kBytesPerPixel = 4;
+
+enum FormatIndex {
+    kR8,
+    kRg8,
+    kRgb565,
+    kRgba4444,
+    kRgb8,
+    kRgba8,
+    kFormatCount,
+};
+
+// smallest first
+const TextureFormatSelector::Format kFormats[kFormatCount] = {
+        {"R8", GL_R8, GL_RED, GL_UNSIGNED_BYTE, 1, {GL_RED, GL_RED, GL_RED, GL_ONE}},
+        {"RG8", GL_RG8, GL_RG, GL_UNSIGNED_BYTE, 2, {GL_RED, GL_RED, GL_RED, GL_GREEN}},
+        {"RGB565", GL_RGB565, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, 2, {GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA}},
+        {"RGBA4444", GL_RGBA4, GL_RGBA, GL_UNSIGNED_SHORT_4_4_4_4, 2, {GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA}},
+        {"RGB8", GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE, 3, {GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA}},
+        {"RGBA8", GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, 4, {GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA}},
+};
+
+/*!
+ * How far each 8 bit value moves going through 4, 5 and 6 bits the way glm packs them and the
+ * GPU expands them again
+ */
+struct QuantizationErrors {
+    uint8_t bits4[256];
+    uint8_t bits5[256];
+    uint8_t bits6[256];
+};
+
+const QuantizationErrors &quantizationErrors() {
+    static const auto errors = []() {
+        QuantizationErrors table{};
+        for (int value = 0; value < 256; value++) {
+            const float unorm = value / 255.0f;
+            const glm::vec4 four = glm::unpackUnorm4x4(glm::packUnorm4x4(glm::vec4(unorm)));
+            const glm::vec3 fiveSix = glm::unpackUnorm1x5_1x6_1x5(glm::packUnorm1x5_1x6_1x5(glm::vec3(unorm)));
+            table.bits4[value] = static_cast<uint8_t>(std::abs(static_cast<int>(std::lround(four.x * 255.0f)) - value));
+            table.bits5[value] = static_cast<uint8_t>(std::abs(static_cast<int>(std::lround(fiveSix.x * 255.0f)) - value));
+            table.bits6[value] = static_cast<uint8_t>(std::abs(static_cast<int>(std::lround(fiveSix.y * 255.0f)) - value));
+        }
+        return table;
+    }();
+    return errors;
+}
+
+/*!
+ * The grey a texel's color becomes in the grey formats
+ */
+inline uint8_t luminance(const uint8_t *texel) {
+    return static_cast<uint8_t>((texel[0] + texel[1] + texel[2] + 1) / 3);
+}
+
+inline glm::vec4 toUnorm(const uint8_t *texel) {
+    return glm::vec4(texel[0], texel[1], texel[2], texel[3]) / 255.0f;
+}
+
+/*!
+ * Raises each of @a errors to the largest difference its format makes to a texel of @a image
+ * @return true once every format but RGBA8 is over @a maxError, nothing else needs looking at
+ */
+bool addErrors(const DecodedImage &image, uint32_t maxError, uint32_t errors[kFormatCount]) {
+    const QuantizationErrors &quantization = quantizationErrors();
+    const size_t rowBytes = size_t(image.width) * kBytesPerPixel;
+    for (uint32_t y = 0; y < image.height; y++) {
+        const uint8_t *row = &image.pixels[y * rowBytes];
+        for (size_t i = 0; i < rowBytes; i += kBytesPerPixel) {
+            const uint8_t *texel = row + i;
+            const int grey = luminance(texel);
+            const uint32_t colorToGrey = std::max({std::abs(texel[0] - grey), std::abs(texel[1] - grey),
+                                                   std::abs(texel[2] - grey)});
+            const uint32_t alphaToOpaque = 255u - texel[3];
+            const uint32_t to565 = std::max({quantization.bits5[texel[0]], quantization.bits6[texel[1]],
+                                             quantization.bits5[texel[2]]});
+            const uint32_t to4444 = std::max({quantization.bits4[texel[0]], quantization.bits4[texel[1]],
+                                              quantization.bits4[texel[2]], quantization.bits4[texel[3]]});
+            errors[kR8] = std::max({errors[kR8], colorToGrey, alphaToOpaque});
+            errors[kRg8] = std::max(errors[kRg8], colorToGrey);
+            errors[kRgb565] = std::max({errors[kRgb565], to565, alphaToOpaque});
+            errors[kRgba4444] = std::max(errors[kRgba4444], to4444);
+            errors[kRgb8] = std::max(errors[kRgb8], alphaToOpaque);
+        }
+        // most images rule everything out in the first rows, no need to look at the rest
+        if (std::all_of(errors, errors + kRgba8, [maxError](uint32_t error) { return error > maxError; })) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+TextureFormatSelector::TextureFormatSelector(const Options &options) : options_(options) {}
+
+TextureFormatSelector::Choice TextureFormatSelector::choose(const DecodedImage &image,
+                                                            const std::vector<DecodedImage> &mips) const {
+    // the mips are filtered, and the alpha cutoff rescales them, so they can need more than the
+    // image: every level has to fit
+    uint32_t errors[kFormatCount] = {};
+    bool ruledOut = addErrors(image, options_.maxError, errors);
+    for (size_t level = 0; level < mips.size() && !ruledOut; level++) {
+        ruledOut = addErrors(mips[level], options_.maxError, errors);
+    }
+
+    Choice choice{&kFormats[kRgba8], 0};
+    for (int format = 0; format < kRgba8; format++) {
+        if (errors[format] > options_.maxError) {
+            continue;
+        }
+        if (kFormats[format].bytesPerTexel < choice.format->bytesPerTexel
+            || (kFormats[format].bytesPerTexel == choice.format->bytesPerTexel && errors[format] < choice.error)) {
+            choice = {&kFormats[format], errors[format]};
+        }
+    }
+    return choice;
+}
+
+void TextureFormatSelector::convert(DecodedImage &image, const Format &format) {
+    if (&format == &kFormats[kRgba8]) {
+        return;
+    }
+    const size_t texels = size_t(image.width) * image.height;
+    std::vector<uint8_t> packed(texels * format.bytesPerTexel);
+    const uint8_t *in = image.pixels.data();
+    uint8_t *out = packed.data();
+    for (size_t i = 0; i < texels; i++, in += kBytesPerPixel, out += format.bytesPerTexel) {
+        switch (format.internalFormat) {
+            case GL_R8:
+                out[0] = luminance(in);
+                break;
+            case GL_RG8:
+                out[0] = luminance(in);
+                out[1] = in[3];
+                break;
+            case GL_RGB8:
+                memcpy(out, in, 3);
+                break;
+            case GL_RGB565: {
+                // glm fills the low bits first, GL wants red in the high ones
+                const glm::vec4 unorm = toUnorm(in);
+                const uint16_t texel = glm::packUnorm1x5_1x6_1x5(glm::vec3(unorm.b, unorm.g, unorm.r));
+                memcpy(out, &texel, sizeof(texel));
+                break;
+            }
+            case GL_RGBA4: {
+                const glm::vec4 unorm = toUnorm(in);
+                const uint16_t texel = glm::packUnorm4x4(glm::vec4(unorm.a, unorm.b, unorm.g, unorm.r));
+                memcpy(out, &texel, sizeof(texel));
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    image.pixels = std::move(packed);
+}
+
+void TextureFormatSelector::applySwizzle(const Format &format) {
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, format.swizzle[0]);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, format.swizzle[1]);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, format.swizzle[2]);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_A, format.swizzle[3]);
+}
+
+size_t TextureFormatSelector::chainBytes(const Format &format, uint32_t width, uint32_t height, uint32_t levels) {
+    size_t texels = 0;
+    for (uint32_t level = 0; level < levels; level++) {
+        texels += size_t(std::max(width >> level, 1u)) * std::max(height >> level, 1u);
+    }
+    return texels * format.bytesPerTexel;
+}
+
+const TextureFormatSelector::Format &TextureFormatSelector::rgba8() {
+    return kFormats[kRgba8];
+}
@@ -0,0 +1,83 @@
+#ifndef ANDROIDGLINVESTIGATIONS_TEXTUREFORMATSELECTOR_H
+#define ANDROIDGLINVESTIGATIONS_TEXTUREFORMATSELECTOR_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <GLES3/gl3.h>
+
+#include "ImageDecoder.h"
+
+/*!
+ * Picks the GL format a decoded image goes up in from what's in its texels, so that not every
+ * texture costs 4 bytes a texel: opaque images drop their alpha, grey ones their other colors, and
+ * with an error bound RGB565 and RGBA4444 take the images that survive 16 bits a texel. Images are
+ * decoded as RGBA8 and repacked here, the mips alongside in the same format.
+ */
+class TextureFormatSelector {
+public:
+    /*!
+     * An uncompressed format, and how glTexSubImage2D takes its texels
+     */
+    struct Format {
+        const char *name;
+        GLenum internalFormat;
+        GLenum format;
+        GLenum type;
+        uint32_t bytesPerTexel;
+        // where the shader's r, g, b and a come from, so the grey formats still sample as RGBA
+        std::array<GLint, 4> swizzle;
+    };
+
+    struct Options {
+        // The largest difference allowed in any channel of any texel, in 8 bit steps. 0 only takes
+        // formats that keep every texel as it is; from 4 every opaque image fits RGB565, from 8
+        // every image fits RGBA4444.
+        uint32_t maxError = 0;
+    };
+
+    struct Choice {
+        const Format *format;
+        // the largest difference the format makes in any channel, in 8 bit steps
+        uint32_t error;
+    };
+
+    TextureFormatSelector() : TextureFormatSelector(Options()) {}
+
+    explicit TextureFormatSelector(const Options &options);
+
+    /*!
+     * @return the smallest format that holds @a image and every level of @a mips, RGBA8 texels,
+     * within the error bound, so RGBA8 if any one level fits nothing smaller. Of formats the same
+     * size, the one with the least error.
+     */
+    Choice choose(const DecodedImage &image, const std::vector<DecodedImage> &mips) const;
+
+    /*!
+     * Repacks @a image's RGBA8 texels into @a format, rows tightly packed
+     */
+    static void convert(DecodedImage &image, const Format &format);
+
+    /*!
+     * Sets the swizzle of @a format on the texture bound to GL_TEXTURE_2D
+     */
+    static void applySwizzle(const Format &format);
+
+    /*!
+     * @return the bytes of the first @a levels of a @a width by @a height mip chain in @a format
+     */
+    static size_t chainBytes(const Format &format, uint32_t width, uint32_t height, uint32_t levels);
+
+    /*!
+     * @return the format every image is decoded in
+     */
+    static const Format &rgba8();
+
+    inline const Options &getOptions() const { return options_; }
+
+private:
+    Options options_;
+};
+
+#endif //ANDROIDGLINVESTIGATIONS_TEXTUREFORMATSELECTOR_H
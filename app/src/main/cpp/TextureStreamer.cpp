@@ -0,0 +1,346 @@
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <utility>
+
+#include "AndroidOut.h"
+#include "Profiler.h"
+
+namespace {
+
+constexpr size_t kBytesPerPixel = 4;
+
+} // namespace
+
+TextureStreamer::TextureStreamer(const AssetLoader &assets, std::unique_ptr<ImageDecoder> decoder,
+                                 Config config)
+        : assets_(assets),
+          decoder_(std::move(decoder)),
+          config_(config),
+          staging_{},
+          stagingIndex_(0),
+          placeholder_(0),
+          stopping_(false) {
+    assert(decoder_);
+    // at least one row of anything sensible, so every upload makes progress
+    config_.uploadBudget = std::max<size_t>(config_.uploadBudget, 16 * 1024);
+    config_.workerThreads = std::max<size_t>(config_.workerThreads, 1);
+
+    const uint8_t grey[kBytesPerPixel] = {128, 128, 128, 255};
+    glGenTextures(1, &placeholder_);
+    glBindTexture(GL_TEXTURE_2D, placeholder_);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, 1, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    for (auto &staging: staging_) {
+        glGenBuffers(1, &staging.buffer);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.buffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, config_.uploadBudget, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    for (size_t i = 0; i < config_.workerThreads; i++) {
+        workers_.emplace_back(&TextureStreamer::work, this);
+    }
+}
+
+TextureStreamer::~TextureStreamer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        jobs_.clear();
+    }
+    wake_.notify_all();
+    for (auto &worker: workers_) {
+        worker.join();
+    }
+
+    for (auto &staging: staging_) {
+        if (staging.fence) {
+            glDeleteSync(staging.fence);
+        }
+        glDeleteBuffers(1, &staging.buffer);
+    }
+    for (auto &entry: entries_) {
+        if (entry.texture) {
+            glDeleteTextures(1, &entry.texture);
+        }
+    }
+    glDeleteTextures(1, &placeholder_);
+}
+
+TextureStreamer::Handle TextureStreamer::request(const std::string &path) {
+    const auto handle = static_cast<Handle>(entries_.size());
+    entries_.push_back({path, State::Decoding, 0, {}, {}, nullptr, {}, nullptr, 0, 0});
+    stats_.requested++;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.emplace_back(handle, path);
+    }
+    wake_.notify_one();
+    return handle;
+}
+
+GLuint TextureStreamer::getTexture(Handle handle) const {
+    assert(handle < entries_.size());
+    return entries_[handle].state == State::Resident ? entries_[handle].texture : placeholder_;
+}
+
+bool TextureStreamer::isResident(Handle handle) const {
+    assert(handle < entries_.size());
+    return entries_[handle].state == State::Resident;
+}
+
+bool TextureStreamer::isFailed(Handle handle) const {
+    assert(handle < entries_.size());
+    return entries_[handle].state == State::Failed;
+}
+
+size_t TextureStreamer::getPendingCount() const {
+    return stats_.requested - stats_.resident - stats_.failed;
+}
+
+void TextureStreamer::update() {
+    if (getPendingCount() == 0) {
+        return;
+    }
+    PROFILE_SCOPE("textures");
+    collect();
+    upload();
+}
+
+void TextureStreamer::work() {
+    for (;;) {
+        std::pair<Handle, std::string> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+            if (stopping_) {
+                return;
+            }
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+
+        // straight from the mapping when the assets come from a pack
+        Decoded decoded{job.first, false, {}, {}, nullptr, {}, nullptr};
+        std::string_view encoded;
+        auto buffer = std::make_unique<std::string>();
+        bool found = assets_.view(job.second, encoded);
+        if (!found && assets_.read(job.second, *buffer)) {
+            encoded = *buffer;
+            found = true;
+        }
+        if (found && CompressedTexture::isCompressedPath(job.second)) {
+            // nothing to decode, the blocks go up as they are. A read file is kept for that
+            decoded.compressed = CompressedTexture(encoded);
+            decoded.succeeded = decoded.compressed.isValid();
+            if (encoded.data() == buffer->data()) {
+                decoded.fileBuffer = std::move(buffer);
+            }
+        } else if (found) {
+            decoded.succeeded = decoder_->decode(encoded, decoded.image)
+                                && decoded.image.width > 0 && decoded.image.height > 0;
+            if (decoded.succeeded) {
+                decoded.mips = MipGenerator(config_.mips).generate(decoded.image);
+                decoded.format = TextureFormatSelector(config_.formats).choose(decoded.image, decoded.mips).format;
+                TextureFormatSelector::convert(decoded.image, *decoded.format);
+                for (auto &mip: decoded.mips) {
+                    TextureFormatSelector::convert(mip, *decoded.format);
+                }
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        decoded_.push_back(std::move(decoded));
+    }
+}
+
+void TextureStreamer::collect() {
+    std::vector<Decoded> decoded;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        decoded.swap(decoded_);
+    }
+    for (auto &result: decoded) {
+        Entry &entry = entries_[result.handle];
+        const CompressedTexture &compressed = result.compressed;
+        // a failed decode has no format, so the row size is only looked at once the rest passed
+        bool usable = result.succeeded && (!compressed.isValid() || compressed.isSupported());
+        if (usable) {
+            const size_t rowSize = compressed.isValid() ? compressed.getBlockRowSize(0)
+                                                        : size_t(result.image.width) * result.format->bytesPerTexel;
+            usable = rowSize <= config_.uploadBudget;
+        }
+        if (!usable) {
+            aout << "Couldn't load texture " << entry.path << std::endl;
+            entry.state = State::Failed;
+            stats_.failed++;
+            continue;
+        }
+        entry.image = std::move(result.image);
+        entry.mips = std::move(result.mips);
+        entry.format = result.format;
+        entry.compressed = result.compressed;
+        entry.fileBuffer = std::move(result.fileBuffer);
+        entry.state = State::Uploading;
+
+        // immutable storage for the whole chain now, the rows follow over the next frames
+        glGenTextures(1, &entry.texture);
+        glBindTexture(GL_TEXTURE_2D, entry.texture);
+        if (compressed.isValid()) {
+            glTexStorage2D(GL_TEXTURE_2D, compressed.getLevelCount(), compressed.getFormat().glFormat,
+                           compressed.getWidth(), compressed.getHeight());
+        } else {
+            glTexStorage2D(GL_TEXTURE_2D, uploadLevelCount(entry), entry.format->internalFormat, entry.image.width,
+                           entry.image.height);
+            TextureFormatSelector::applySwizzle(*entry.format);
+            const size_t rgba8Bytes = TextureFormatSelector::chainBytes(
+                    TextureFormatSelector::rgba8(), entry.image.width, entry.image.height, uploadLevelCount(entry));
+            const size_t bytes = TextureFormatSelector::chainBytes(
+                    *entry.format, entry.image.width, entry.image.height, uploadLevelCount(entry));
+            aout << entry.path << ": " << entry.format->name << ", " << (rgba8Bytes - bytes) / 1024
+                 << " KiB of VRAM saved over RGBA8" << std::endl;
+            stats_.bytesSaved += rgba8Bytes - bytes;
+        }
+        const bool mipmapped = uploadLevelCount(entry) > 1;
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        uploads_.push_back(result.handle);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void TextureStreamer::upload() {
+    if (uploads_.empty()) {
+        return;
+    }
+    // never wait on the GPU, the rows just go up a frame later
+    StagingBuffer &staging = staging_[stagingIndex_];
+    if (staging.fence) {
+        if (glClientWaitSync(staging.fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+            stats_.stalledFrames++;
+            return;
+        }
+        glDeleteSync(staging.fence);
+        staging.fence = nullptr;
+    }
+
+    // Fill the buffer with as many rows as fit, front of the queue first. The GPU is done with
+    // it, so it's mapped unsynchronized
+    struct Band {
+        Handle handle;
+        GLint level;
+        uint32_t y;
+        uint32_t width;
+        uint32_t height;
+        size_t size;
+        size_t offset;
+        // the entry's last rows
+        bool completes;
+    };
+    std::vector<Band> bands;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.buffer);
+    auto *mapped = static_cast<uint8_t *>(glMapBufferRange(
+            GL_PIXEL_UNPACK_BUFFER, 0, config_.uploadBudget,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+    if (!mapped) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return;
+    }
+    size_t used = 0;
+    bool full = false;
+    for (auto handle = uploads_.begin(); handle != uploads_.end() && !full; ++handle) {
+        Entry &entry = entries_[*handle];
+        // the small levels of a compressed chain take little room, several can go up at once
+        for (;;) {
+            // GL wants the offsets of 16 bit texels aligned to them
+            used = std::min((used + 3) & ~size_t(3), config_.uploadBudget);
+            const Level level = nextLevel(entry);
+            const auto rows = static_cast<uint32_t>(std::min<size_t>(level.rows - entry.rowsUploaded,
+                                                                     (config_.uploadBudget - used) / level.rowSize));
+            if (rows == 0) {
+                full = true;
+                break;
+            }
+            memcpy(mapped + used, level.data + entry.rowsUploaded * level.rowSize, rows * level.rowSize);
+            // a band of blocks may hang over the bottom of the level, GL wants the size clipped
+            const uint32_t y = entry.rowsUploaded * level.rowHeight;
+            bands.push_back({*handle, level.level, y, level.width,
+                             std::min(rows * level.rowHeight, level.height - y), rows * level.rowSize, used, false});
+            used += rows * level.rowSize;
+
+            entry.rowsUploaded += rows;
+            if (entry.rowsUploaded < level.rows) {
+                continue;
+            }
+            entry.rowsUploaded = 0;
+            entry.levelsUploaded++;
+            if (entry.levelsUploaded == uploadLevelCount(entry)) {
+                bands.back().completes = true;
+                break;
+            }
+        }
+    }
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    // With a buffer bound, the pointer is an offset into it and the copy runs on the GPU's time.
+    // Rows are tightly packed, which for the narrow formats leaves them unaligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (const Band &band: bands) {
+        Entry &entry = entries_[band.handle];
+        const auto *offset = reinterpret_cast<const void *>(band.offset);
+        glBindTexture(GL_TEXTURE_2D, entry.texture);
+        if (entry.compressed.isValid()) {
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, band.level, 0, static_cast<GLint>(band.y), band.width,
+                                      band.height, entry.compressed.getFormat().glFormat,
+                                      static_cast<GLsizei>(band.size), offset);
+        } else {
+            glTexSubImage2D(GL_TEXTURE_2D, band.level, 0, static_cast<GLint>(band.y), band.width, band.height,
+                            entry.format->format, entry.format->type, offset);
+        }
+        if (band.completes) {
+            // GL orders draws after the uploads, the texture is good to draw with from here on
+            entry.state = State::Resident;
+            entry.image = DecodedImage();
+            entry.mips.clear();
+            entry.format = nullptr;
+            entry.compressed = CompressedTexture();
+            entry.fileBuffer.reset();
+            stats_.resident++;
+            uploads_.pop_front();
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    staging.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    stagingIndex_ = (stagingIndex_ + 1) % kStagingBuffers;
+
+    stats_.bytesUploaded += used;
+    stats_.peakFrameBytes = std::max(stats_.peakFrameBytes, used);
+}
+
+TextureStreamer::Level TextureStreamer::nextLevel(const Entry &entry) {
+    // smallest first
+    const uint32_t level = uploadLevelCount(entry) - 1 - entry.levelsUploaded;
+    const CompressedTexture &compressed = entry.compressed;
+    if (!compressed.isValid()) {
+        const DecodedImage &image = level == 0 ? entry.image : entry.mips[level - 1];
+        return {static_cast<GLint>(level), image.width, image.height, 1, image.height,
+                size_t(image.width) * entry.format->bytesPerTexel, image.pixels.data()};
+    }
+    return {static_cast<GLint>(level), compressed.getLevelWidth(level), compressed.getLevelHeight(level),
+            compressed.getFormat().blockHeight, compressed.getBlockRows(level), compressed.getBlockRowSize(level),
+            reinterpret_cast<const uint8_t *>(compressed.getLevel(level).data())};
+}
+
+uint32_t TextureStreamer::uploadLevelCount(const Entry &entry) {
+    return entry.compressed.isValid() ? entry.compressed.getLevelCount()
+                                      : static_cast<uint32_t>(entry.mips.size() + 1);
+}
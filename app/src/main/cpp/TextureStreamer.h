@@ -0,0 +1,224 @@
+#ifndef ANDROIDGLINVESTIGATIONS_TEXTURESTREAMER_H
+#define ANDROIDGLINVESTIGATIONS_TEXTURESTREAMER_H
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <GLES3/gl3.h>
+
+#include "AssetLoader.h"
+#include "CompressedTexture.h"
+#include "ImageDecoder.h"
+#include "MipGenerator.h"
+#include "TextureFormatSelector.h"
+
+/*!
+ * Loads textures without stalling the render thread. Worker threads read and decode the files and
+ * build the mip chains, the render thread then streams every level to the GPU through pixel unpack
+ * buffers, a few rows at a time so no frame uploads more than its budget. Until a texture is
+ * complete, its handle gives a 1x1 grey placeholder, so it can be bound from the first frame on.
+ * The workers also repack each image into the smallest format that holds it, see
+ * TextureFormatSelector.
+ *
+ * KTX2 files (see CompressedTexture) aren't decoded, the workers only check them. Their levels are
+ * streamed as they are, smallest first, in rows of blocks.
+ *
+ * The staging buffers are a ring of kStagingBuffers, each fenced after the frame that filled it.
+ * A frame whose next buffer the GPU is still reading from skips its upload instead of waiting.
+ *
+ * Everything but the workers runs on the render thread, with the context current.
+ */
+class TextureStreamer {
+public:
+    using Handle = uint32_t;
+
+    static constexpr size_t kStagingBuffers = 3;
+
+    struct Config {
+        // decode threads
+        size_t workerThreads = 2;
+        // bytes of pixels or blocks uploaded per frame at most, rounded up to whole rows of one
+        // texture
+        size_t uploadBudget = 2 * 1024 * 1024;
+        // how the workers filter the mips of decoded images
+        MipGenerator::Options mips;
+        // how far the workers may change texels to fit decoded images in smaller formats
+        TextureFormatSelector::Options formats;
+    };
+
+    struct Stats {
+        size_t requested = 0;
+        size_t resident = 0;
+        size_t failed = 0;
+        uint64_t bytesUploaded = 0;
+        // the most any frame uploaded
+        size_t peakFrameBytes = 0;
+        // frames that skipped their upload because the GPU still had the staging buffer
+        uint64_t stalledFrames = 0;
+        // VRAM the decoded images' formats save over RGBA8, mips included
+        uint64_t bytesSaved = 0;
+    };
+
+    /*!
+     * Starts the workers. Needs a current context for the placeholder and the staging buffers.
+     * @param assets read from the workers, must outlive this
+     */
+    TextureStreamer(const AssetLoader &assets, std::unique_ptr<ImageDecoder> decoder, Config config);
+
+    TextureStreamer(const AssetLoader &assets, std::unique_ptr<ImageDecoder> decoder)
+            : TextureStreamer(assets, std::move(decoder), Config()) {}
+
+    /*!
+     * Stops the workers, dropping whatever they haven't decoded yet, and deletes every texture
+     */
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer &) = delete;
+
+    TextureStreamer &operator=(const TextureStreamer &) = delete;
+
+    /*!
+     * Queues @a path for decoding
+     * @return the handle of the texture, usable right away
+     */
+    Handle request(const std::string &path);
+
+    /*!
+     * @return the texture for @a handle, the placeholder until it's resident
+     */
+    GLuint getTexture(Handle handle) const;
+
+    /*!
+     * @return true once every level of the texture has been uploaded
+     */
+    bool isResident(Handle handle) const;
+
+    /*!
+     * @return true if the texture couldn't be read or decoded, it keeps the placeholder
+     */
+    bool isFailed(Handle handle) const;
+
+    /*!
+     * Takes in what the workers decoded and uploads up to the budget. Call once per frame, before
+     * the draws that use the textures.
+     */
+    void update();
+
+    /*!
+     * @return how many textures are still being decoded or uploaded
+     */
+    size_t getPendingCount() const;
+
+    inline GLuint getPlaceholder() const { return placeholder_; }
+
+    inline const Stats &getStats() const { return stats_; }
+
+    /*!
+     * @return the config in use, with the upload budget raised to its minimum if it was lower
+     */
+    inline const Config &getConfig() const { return config_; }
+
+private:
+    enum class State {
+        Decoding,
+        Uploading,
+        Resident,
+        Failed,
+    };
+
+    struct Entry {
+        std::string path;
+        State state;
+        GLuint texture;
+        DecodedImage image;
+        // levels 1 and down of the image
+        std::vector<DecodedImage> mips;
+        // what the image and mips have been repacked into
+        const TextureFormatSelector::Format *format;
+        // for KTX2 files instead of the image, views the pack mapping or fileBuffer
+        CompressedTexture compressed;
+        std::unique_ptr<std::string> fileBuffer;
+        // levels already handed to GL
+        uint32_t levelsUploaded;
+        // rows of the current level already handed to GL, rows of blocks if it's compressed
+        uint32_t rowsUploaded;
+    };
+
+    struct Decoded {
+        Handle handle;
+        bool succeeded;
+        DecodedImage image;
+        std::vector<DecodedImage> mips;
+        const TextureFormatSelector::Format *format;
+        CompressedTexture compressed;
+        std::unique_ptr<std::string> fileBuffer;
+    };
+
+    /*!
+     * Where the rows of the next level of an entry come from
+     */
+    struct Level {
+        GLint level;
+        uint32_t width;
+        uint32_t height;
+        // texels per row, the block height for compressed levels
+        uint32_t rowHeight;
+        uint32_t rows;
+        size_t rowSize;
+        const uint8_t *data;
+    };
+
+    struct StagingBuffer {
+        GLuint buffer;
+        // set once a frame's uploads read from it, the buffer is free again when it signals
+        GLsync fence;
+    };
+
+    void work();
+
+    /*!
+     * @return the level of @a entry that goes up next, smallest first
+     */
+    static Level nextLevel(const Entry &entry);
+
+    static uint32_t uploadLevelCount(const Entry &entry);
+
+    /*!
+     * Moves the workers' results over and allocates storage for each new texture
+     */
+    void collect();
+
+    /*!
+     * Copies rows of the queued textures into the next staging buffer and uploads them from there
+     */
+    void upload();
+
+    const AssetLoader &assets_;
+    std::unique_ptr<ImageDecoder> decoder_;
+    Config config_;
+    Stats stats_;
+
+    // render thread only
+    std::vector<Entry> entries_;
+    // textures waiting for their pixels to go up, in the order they were decoded
+    std::deque<Handle> uploads_;
+    std::array<StagingBuffer, kStagingBuffers> staging_;
+    size_t stagingIndex_;
+    GLuint placeholder_;
+
+    // shared with the workers
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<std::pair<Handle, std::string>> jobs_;
+    std::vector<Decoded> decoded_;
+    bool stopping_;
+    std::vector<std::thread> workers_;
+};
+
+#endif //ANDROIDGLINVESTIGATIONS_TEXTURESTREAMER_H
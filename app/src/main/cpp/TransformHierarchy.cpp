@@ -0,0 +1,245 @@
+#include "TransformHierarchy.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <glm/simd/platform.h>
+
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+#include <glm/simd/matrix.h>
+#elif GLM_ARCH & GLM_ARCH_NEON_BIT
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+/*!
+ * The first three columns of T * R * S, R * S without going through full matrix products
+ */
+inline void rotationScale(const glm::quat &q, const glm::vec3 &s, glm::vec3 columns[3]) {
+    float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+    float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+    columns[0] = glm::vec3(1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy)) * s.x;
+    columns[1] = glm::vec3(2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx)) * s.y;
+    columns[2] = glm::vec3(2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy)) * s.z;
+}
+
+/*!
+ * out = T * R * S, for roots
+ */
+inline void compose(const glm::vec3 &t, const glm::quat &q, const glm::vec3 &s, glm::mat4 &out) {
+    glm::vec3 columns[3];
+    rotationScale(q, s, columns);
+    out[0] = glm::vec4(columns[0], 0.0f);
+    out[1] = glm::vec4(columns[1], 0.0f);
+    out[2] = glm::vec4(columns[2], 0.0f);
+    out[3] = glm::vec4(t, 1.0f);
+}
+
+/*!
+ * out = parent * T * R * S, column major. The local matrix never goes through memory, and as its
+ * last row is 0 0 0 1 each world column is only three multiply-adds of the parent's columns, plus
+ * the parent's translation for the last one.
+ */
+inline void composeUnder(const glm::mat4 &parent, const glm::vec3 &t, const glm::quat &q, const glm::vec3 &s,
+                         glm::mat4 &out) {
+    glm::vec3 columns[3];
+    rotationScale(q, s, columns);
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+    const glm_vec4 p0 = _mm_loadu_ps(&parent[0][0]);
+    const glm_vec4 p1 = _mm_loadu_ps(&parent[1][0]);
+    const glm_vec4 p2 = _mm_loadu_ps(&parent[2][0]);
+    const glm_vec4 p3 = _mm_loadu_ps(&parent[3][0]);
+    auto transform = [&](const glm::vec3 &c) {
+        return _mm_add_ps(_mm_add_ps(_mm_mul_ps(p0, _mm_set1_ps(c.x)), _mm_mul_ps(p1, _mm_set1_ps(c.y))),
+                          _mm_mul_ps(p2, _mm_set1_ps(c.z)));
+    };
+    _mm_storeu_ps(&out[0][0], transform(columns[0]));
+    _mm_storeu_ps(&out[1][0], transform(columns[1]));
+    _mm_storeu_ps(&out[2][0], transform(columns[2]));
+    _mm_storeu_ps(&out[3][0], _mm_add_ps(transform(t), p3));
+#elif GLM_ARCH & GLM_ARCH_NEON_BIT
+    const float32x4_t p0 = vld1q_f32(&parent[0][0]);
+    const float32x4_t p1 = vld1q_f32(&parent[1][0]);
+    const float32x4_t p2 = vld1q_f32(&parent[2][0]);
+    const float32x4_t p3 = vld1q_f32(&parent[3][0]);
+    auto transform = [&](const glm::vec3 &c, float32x4_t r) {
+        r = vmlaq_n_f32(r, p0, c.x);
+        r = vmlaq_n_f32(r, p1, c.y);
+        return vmlaq_n_f32(r, p2, c.z);
+    };
+    vst1q_f32(&out[0][0], transform(columns[0], vdupq_n_f32(0.0f)));
+    vst1q_f32(&out[1][0], transform(columns[1], vdupq_n_f32(0.0f)));
+    vst1q_f32(&out[2][0], transform(columns[2], vdupq_n_f32(0.0f)));
+    vst1q_f32(&out[3][0], transform(t, p3));
+#else
+    out[0] = parent * glm::vec4(columns[0], 0.0f);
+    out[1] = parent * glm::vec4(columns[1], 0.0f);
+    out[2] = parent * glm::vec4(columns[2], 0.0f);
+    out[3] = parent * glm::vec4(t, 1.0f);
+#endif
+}
+
+} // namespace
+
+TransformHierarchy::Handle TransformHierarchy::create(Handle parent) {
+    auto handle = static_cast<Handle>(indexOf_.size());
+    auto index = static_cast<uint32_t>(parents_.size());
+    indexOf_.push_back(index);
+    handles_.push_back(handle);
+
+    // appending keeps the order valid, the parent already exists so it has a smaller index
+    translations_.emplace_back(0.0f);
+    rotations_.emplace_back(1.0f, 0.0f, 0.0f, 0.0f);
+    scales_.emplace_back(1.0f);
+    parents_.push_back(parent == kNoParent ? kNoParent : indexOf_[parent]);
+    dirty_.push_back(0);
+    world_.emplace_back(1.0f);
+
+    markDirty(index);
+    return handle;
+}
+
+void TransformHierarchy::setParent(Handle node, Handle parent) {
+    uint32_t index = indexOf_[node];
+    uint32_t parentIndex = parent == kNoParent ? kNoParent : indexOf_[parent];
+#ifndef NDEBUG
+    for (uint32_t ancestor = parentIndex; ancestor != kNoParent; ancestor = parents_[ancestor]) {
+        assert(ancestor != index && "setParent would create a cycle");
+    }
+#endif
+    parents_[index] = parentIndex;
+    if (parentIndex != kNoParent && parentIndex > index) {
+        needsSort_ = true;
+    }
+    markDirty(index);
+}
+
+void TransformHierarchy::setTranslation(Handle node, const glm::vec3 &translation) {
+    uint32_t index = indexOf_[node];
+    translations_[index] = translation;
+    markDirty(index);
+}
+
+void TransformHierarchy::setRotation(Handle node, const glm::quat &rotation) {
+    uint32_t index = indexOf_[node];
+    rotations_[index] = rotation;
+    markDirty(index);
+}
+
+void TransformHierarchy::setScale(Handle node, const glm::vec3 &scale) {
+    uint32_t index = indexOf_[node];
+    scales_[index] = scale;
+    markDirty(index);
+}
+
+void TransformHierarchy::setLocal(Handle node, const glm::vec3 &translation,
+                                  const glm::quat &rotation, const glm::vec3 &scale) {
+    uint32_t index = indexOf_[node];
+    translations_[index] = translation;
+    rotations_[index] = rotation;
+    scales_[index] = scale;
+    markDirty(index);
+}
+
+void TransformHierarchy::markDirty(uint32_t index) {
+    dirty_[index] = 1;
+    firstDirty_ = std::min(firstDirty_, index);
+}
+
+void TransformHierarchy::update() {
+    if (needsSort_) {
+        sortTopologically();
+    }
+
+    stats_.nodesUpdated = 0;
+    const auto count = static_cast<uint32_t>(parents_.size());
+    if (firstDirty_ >= count) {
+        return;
+    }
+
+    // parents come first, so by the time a node is reached its parent's flag says whether the
+    // parent's world matrix changed this pass
+    for (uint32_t i = firstDirty_; i < count; i++) {
+        uint32_t parent = parents_[i];
+        bool parentDirty = parent != kNoParent && dirty_[parent];
+        if (!dirty_[i] && !parentDirty) {
+            continue;
+        }
+        dirty_[i] = 1;
+
+        if (parent == kNoParent) {
+            compose(translations_[i], rotations_[i], scales_[i], world_[i]);
+        } else {
+            composeUnder(world_[parent], translations_[i], rotations_[i], scales_[i], world_[i]);
+        }
+        stats_.nodesUpdated++;
+    }
+
+    memset(dirty_.data() + firstDirty_, 0, count - firstDirty_);
+    firstDirty_ = count;
+}
+
+void TransformHierarchy::sortTopologically() {
+    const auto count = static_cast<uint32_t>(parents_.size());
+
+    // depth of every node, walking up until a node with a known depth
+    std::vector<uint32_t> depth(count, kNoParent);
+    std::vector<uint32_t> chain;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t node = i;
+        while (depth[node] == kNoParent && parents_[node] != kNoParent) {
+            chain.push_back(node);
+            node = parents_[node];
+        }
+        uint32_t d = depth[node] == kNoParent ? 0 : depth[node];
+        depth[node] = d;
+        while (!chain.empty()) {
+            depth[chain.back()] = ++d;
+            chain.pop_back();
+        }
+    }
+
+    // sorting by depth puts every parent before its children and keeps siblings in order
+    std::vector<uint32_t> order(count);
+    for (uint32_t i = 0; i < count; i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&depth](uint32_t a, uint32_t b) {
+        return depth[a] < depth[b];
+    });
+    std::vector<uint32_t> newIndex(count);
+    for (uint32_t i = 0; i < count; i++) {
+        newIndex[order[i]] = i;
+    }
+
+    auto permute = [&order](auto &values) {
+        auto sorted = values;
+        for (size_t i = 0; i < order.size(); i++) {
+            sorted[i] = values[order[i]];
+        }
+        values.swap(sorted);
+    };
+    permute(translations_);
+    permute(rotations_);
+    permute(scales_);
+    permute(parents_);
+    permute(dirty_);
+    permute(world_);
+    permute(handles_);
+
+    // the dirty bookkeeping was in old indices
+    firstDirty_ = count;
+    for (uint32_t i = 0; i < count; i++) {
+        if (parents_[i] != kNoParent) {
+            parents_[i] = newIndex[parents_[i]];
+        }
+        indexOf_[handles_[i]] = i;
+        if (dirty_[i]) {
+            firstDirty_ = std::min(firstDirty_, i);
+        }
+    }
+    needsSort_ = false;
+}
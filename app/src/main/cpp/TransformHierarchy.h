@@ -0,0 +1,91 @@
+#ifndef ANDROIDGLINVESTIGATIONS_TRANSFORMHIERARCHY_H
+#define ANDROIDGLINVESTIGATIONS_TRANSFORMHIERARCHY_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+/*!
+ * A transform hierarchy stored as structure of arrays. Nodes are kept sorted so that every parent
+ * comes before its children, which lets @a update compute every world matrix in one linear pass
+ * with the SIMD matrix kernels, touching only nodes under something that changed.
+ */
+class TransformHierarchy {
+public:
+    /*!
+     * Identifies a node. Handles stay valid when nodes are reordered.
+     */
+    using Handle = uint32_t;
+
+    static constexpr Handle kNoParent = ~0u;
+
+    struct Stats {
+        // world matrices recomputed by the last update()
+        size_t nodesUpdated = 0;
+    };
+
+    /*!
+     * Adds a node with an identity local transform
+     * @param parent the parent node, or kNoParent for a root
+     */
+    Handle create(Handle parent = kNoParent);
+
+    /*!
+     * Moves @a node, and everything under it, below @a parent
+     */
+    void setParent(Handle node, Handle parent);
+
+    void setTranslation(Handle node, const glm::vec3 &translation);
+
+    void setRotation(Handle node, const glm::quat &rotation);
+
+    void setScale(Handle node, const glm::vec3 &scale);
+
+    void setLocal(Handle node, const glm::vec3 &translation, const glm::quat &rotation,
+                  const glm::vec3 &scale);
+
+    /*!
+     * Recomputes the world matrices of every node that changed and of everything below them
+     */
+    void update();
+
+    /*!
+     * @return the world matrix as of the last @a update
+     */
+    inline const glm::mat4 &getWorld(Handle node) const {
+        return world_[indexOf_[node]];
+    }
+
+    inline size_t size() const { return parents_.size(); }
+
+    inline const Stats &getStats() const { return stats_; }
+
+private:
+    void markDirty(uint32_t index);
+
+    /*!
+     * Restores the parents-before-children order after setParent broke it
+     */
+    void sortTopologically();
+
+    // per node, in topological order
+    std::vector<glm::vec3> translations_;
+    std::vector<glm::quat> rotations_;
+    std::vector<glm::vec3> scales_;
+    // index of the parent, always smaller than the node's own index once sorted
+    std::vector<uint32_t> parents_;
+    std::vector<uint8_t> dirty_;
+    std::vector<glm::mat4> world_;
+    std::vector<Handle> handles_;
+
+    // per handle
+    std::vector<uint32_t> indexOf_;
+
+    // no node before this one is dirty
+    uint32_t firstDirty_ = 0;
+    bool needsSort_ = false;
+    Stats stats_;
+};
+
+#endif //ANDROIDGLINVESTIGATIONS_TRANSFORMHIERARCHY_H
@@ -0,0 +1,82 @@
+#include "UniformRing.h"
+
+#include <cassert>
+#include <cstring>
+
+UniformRing::UniformRing(GLsizeiptr blockSize, int slotCount)
+        : buffer_(0),
+          blockSize_(blockSize),
+          slotStride_(0),
+          slotCount_(slotCount),
+          current_(-1),
+          fences_{},
+          writeCount_(0) {
+    assert(slotCount_ > 0 && slotCount_ <= 4);
+
+    // every slot has to start on the offset alignment for glBindBufferRange
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    if (alignment <= 0) {
+        alignment = 256;
+    }
+    slotStride_ = (blockSize_ + alignment - 1) / alignment * alignment;
+
+    glGenBuffers(1, &buffer_);
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer_);
+    glBufferData(GL_UNIFORM_BUFFER, slotStride_ * slotCount_, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+UniformRing::~UniformRing() {
+    for (auto &fence : fences_) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    if (buffer_) {
+        glDeleteBuffers(1, &buffer_);
+        buffer_ = 0;
+    }
+}
+
+void UniformRing::write(GLuint binding, const void *data) {
+    current_ = (current_ + 1) % slotCount_;
+    writeCount_++;
+
+    // wait for the GPU to finish with whatever frame last used this slot
+    GLsync &fence = fences_[current_];
+    if (fence) {
+        GLenum result;
+        do {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        } while (result == GL_TIMEOUT_EXPIRED);
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    GLintptr offset = slotStride_ * current_;
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer_);
+    void *mapped = glMapBufferRange(
+            GL_UNIFORM_BUFFER,
+            offset,
+            blockSize_,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    assert(mapped);
+    if (mapped) {
+        memcpy(mapped, data, blockSize_);
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+    }
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer_, offset, blockSize_);
+}
+
+void UniformRing::endFrame() {
+    if (current_ < 0) {
+        return;
+    }
+    GLsync &fence = fences_[current_];
+    if (fence) {
+        glDeleteSync(fence);
+    }
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
@@ -0,0 +1,85 @@
+#ifndef ANDROIDGLINVESTIGATIONS_UNIFORMRING_H
+#define ANDROIDGLINVESTIGATIONS_UNIFORMRING_H
+
+#include <cstdint>
+#include <GLES3/gl3.h>
+#include <glm/glm.hpp>
+
+/*!
+ * Uniform buffer binding points shared by every program. Shader::bindUniformBlock hooks a named
+ * block up to one of these once at load time.
+ */
+enum UniformBinding : GLuint {
+    kCameraBinding = 0,
+    kLightsBinding = 1,
+};
+
+/*!
+ * Per-frame, per-view data. The layout follows std140 and must match the Camera block declared in
+ * the shaders:
+ *
+ *  layout(std140) uniform Camera {
+ *      mat4 view;
+ *      mat4 projection;
+ *      vec4 viewPos;
+ *  };
+ */
+struct CameraBlock {
+    glm::mat4 view;
+    glm::mat4 projection;
+    // xyz is the camera position in world space, w is unused
+    glm::vec4 viewPos;
+};
+
+/*!
+ * A GL_UNIFORM_BUFFER split into a few slots that are written round robin, one per frame. Writes
+ * map the next slot unsynchronized, so the driver never has to stall or shadow the buffer, and a
+ * fence per slot makes sure the GPU is done reading it before it is overwritten.
+ */
+class UniformRing {
+public:
+    /*!
+     * @param blockSize the size in bytes of the data written each frame
+     * @param slotCount how many frames can be in flight before a write has to wait
+     */
+    UniformRing(GLsizeiptr blockSize, int slotCount = 3);
+
+    ~UniformRing();
+
+    UniformRing(const UniformRing &) = delete;
+
+    UniformRing &operator=(const UniformRing &) = delete;
+
+    /*!
+     * Copies @a data into the next slot and binds that slot to @a binding. Any program with a
+     * block hooked up to @a binding sees the new data from here on.
+     */
+    void write(GLuint binding, const void *data);
+
+    template<typename T>
+    inline void write(GLuint binding, const T &block) {
+        write(binding, static_cast<const void *>(&block));
+    }
+
+    /*!
+     * Fences the slot last written. Call once per frame after all draws reading it have been
+     * submitted, also on frames that didn't write: the slot stays bound and is read again.
+     */
+    void endFrame();
+
+    /*!
+     * @return how many times @a write was called, to check that unchanged data isn't re-uploaded
+     */
+    inline uint64_t getWriteCount() const { return writeCount_; }
+
+private:
+    GLuint buffer_;
+    GLsizeiptr blockSize_;
+    GLsizeiptr slotStride_;
+    int slotCount_;
+    int current_;
+    GLsync fences_[4];
+    uint64_t writeCount_;
+};
+
+#endif //ANDROIDGLINVESTIGATIONS_UNIFORMRING_H
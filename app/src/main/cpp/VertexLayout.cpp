@@ -0,0 +1,148 @@
+#include "VertexLayout.h"
+
+#include <cmath>
+#include <cstring>
+#include <glm/gtc/packing.hpp>
+
+namespace {
+
+// normals further than this from unit length are stored as floats, 10 bits can't represent them
+constexpr float kUnitLengthTolerance = 1e-3f;
+
+// half floats have 11 bits of mantissa, past this texel addresses on a 2048 texture get fuzzy
+constexpr float kMaxHalfUv = 2048.0f;
+
+void append(VertexAttributeFormat &format, GLsizei *strides, int stream, GLint components,
+            GLenum type, GLboolean normalized, GLsizei size) {
+    format = {components, type, normalized, static_cast<GLuint>(stream),
+              static_cast<GLuint>(strides[stream])};
+    strides[stream] += size;
+}
+
+} // namespace
+
+VertexLayout::VertexLayout()
+        : formats_{},
+          strides_{},
+          streamCount_(1),
+          positionScale_(1.0f),
+          positionBias_(0.0f) {}
+
+VertexLayout VertexLayout::choose(const MeshData &mesh, VertexCompression compression,
+                                  VertexStreams streams) {
+    bool hasUvs = false;
+    bool unitNormals = true;
+    bool smallUvs = true;
+    glm::vec3 lower(0.0f);
+    glm::vec3 upper(0.0f);
+    if (!mesh.vertices.empty()) {
+        lower = upper = mesh.vertices.front().position;
+    }
+    for (const auto &vertex: mesh.vertices) {
+        lower = glm::min(lower, vertex.position);
+        upper = glm::max(upper, vertex.position);
+        unitNormals = unitNormals && std::abs(glm::length(vertex.normal) - 1.0f) < kUnitLengthTolerance;
+        hasUvs = hasUvs || vertex.uv != glm::vec2(0.0f);
+        smallUvs = smallUvs && std::abs(vertex.uv.x) <= kMaxHalfUv && std::abs(vertex.uv.y) <= kMaxHalfUv;
+    }
+
+    VertexLayout layout;
+    auto &position = layout.formats_[static_cast<int>(VertexAttribute::Position)];
+    auto &normal = layout.formats_[static_cast<int>(VertexAttribute::Normal)];
+    auto &uv = layout.formats_[static_cast<int>(VertexAttribute::Uv)];
+    bool compact = compression == VertexCompression::Compact;
+    // positions always go first, the other attributes follow them or get their own stream
+    int attributeStream = 0;
+    if (streams == VertexStreams::SplitPosition) {
+        attributeStream = 1;
+        layout.streamCount_ = 2;
+    }
+
+    if (compact) {
+        // three shorts padded to eight bytes to keep the next attribute 4 byte aligned
+        append(position, layout.strides_, 0, 3, GL_SHORT, GL_TRUE, 4 * sizeof(int16_t));
+        layout.positionBias_ = (lower + upper) * 0.5f;
+        layout.positionScale_ = (upper - lower) * 0.5f;
+        for (int axis = 0; axis < 3; axis++) {
+            if (layout.positionScale_[axis] <= 0.0f) {
+                layout.positionScale_[axis] = 1.0f;
+            }
+        }
+    } else {
+        append(position, layout.strides_, 0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float));
+    }
+
+    if (compact && unitNormals) {
+        append(normal, layout.strides_, attributeStream, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(uint32_t));
+    } else {
+        append(normal, layout.strides_, attributeStream, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float));
+    }
+
+    if (hasUvs) {
+        if (compact && smallUvs) {
+            append(uv, layout.strides_, attributeStream, 2, GL_HALF_FLOAT, GL_FALSE, 2 * sizeof(uint16_t));
+        } else {
+            append(uv, layout.strides_, attributeStream, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float));
+        }
+    }
+    return layout;
+}
+
+std::vector<uint8_t> VertexLayout::pack(const MeshData &mesh, int stream) const {
+    const GLsizei stride = strides_[stream];
+    std::vector<uint8_t> data(mesh.vertices.size() * stride, 0);
+    const auto &position = getFormat(VertexAttribute::Position);
+    const auto &normal = getFormat(VertexAttribute::Normal);
+    const auto &uv = getFormat(VertexAttribute::Uv);
+    const glm::vec3 inverseScale = 1.0f / positionScale_;
+
+    for (size_t i = 0; i < mesh.vertices.size(); i++) {
+        const MeshVertex &vertex = mesh.vertices[i];
+        uint8_t *out = data.data() + i * stride;
+
+        if (position.stream != (GLuint) stream) {
+            // not in this stream
+        } else if (position.type == GL_SHORT) {
+            glm::vec3 quantized = (vertex.position - positionBias_) * inverseScale;
+            uint16_t packed[3] = {
+                    glm::packSnorm1x16(quantized.x),
+                    glm::packSnorm1x16(quantized.y),
+                    glm::packSnorm1x16(quantized.z)};
+            memcpy(out + position.offset, packed, sizeof(packed));
+        } else {
+            memcpy(out + position.offset, &vertex.position, sizeof(glm::vec3));
+        }
+
+        if (normal.stream != (GLuint) stream) {
+            // not in this stream
+        } else if (normal.type == GL_INT_2_10_10_10_REV) {
+            uint32_t packed = glm::packSnorm3x10_1x2(glm::vec4(vertex.normal, 0.0f));
+            memcpy(out + normal.offset, &packed, sizeof(packed));
+        } else {
+            memcpy(out + normal.offset, &vertex.normal, sizeof(glm::vec3));
+        }
+
+        if (uv.components == 0 || uv.stream != (GLuint) stream) {
+            // not stored, or not in this stream
+        } else if (uv.type == GL_HALF_FLOAT) {
+            uint16_t packed[2] = {glm::packHalf1x16(vertex.uv.x), glm::packHalf1x16(vertex.uv.y)};
+            memcpy(out + uv.offset, packed, sizeof(packed));
+        } else {
+            memcpy(out + uv.offset, &vertex.uv, sizeof(glm::vec2));
+        }
+    }
+    return data;
+}
+
+void VertexLayout::bindAttribute(VertexAttribute attribute, GLint location,
+                                 const GLuint *streamBuffers) const {
+    const auto &format = getFormat(attribute);
+    if (location < 0 || format.components == 0) {
+        return;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, streamBuffers[format.stream]);
+    glVertexAttribPointer(location, format.components, format.type, format.normalized,
+                          strides_[format.stream],
+                          (GLvoid *) (uintptr_t) format.offset);
+    glEnableVertexAttribArray(location);
+}
@@ -0,0 +1,113 @@
+#ifndef ANDROIDGLINVESTIGATIONS_VERTEXLAYOUT_H
+#define ANDROIDGLINVESTIGATIONS_VERTEXLAYOUT_H
+
+#include <cstdint>
+#include <vector>
+#include <GLES3/gl3.h>
+#include <glm/glm.hpp>
+
+#include "MeshBuilder.h"
+
+/*!
+ * The vertex attributes a mesh can carry
+ */
+enum class VertexAttribute {
+    Position,
+    Normal,
+    Uv,
+};
+
+/*!
+ * How hard to squeeze vertices. Compact trades a little precision for roughly half the bandwidth:
+ * snorm16 positions against the mesh bounds, 10:10:10:2 normals and half float UVs.
+ */
+enum class VertexCompression {
+    None,
+    Compact,
+};
+
+/*!
+ * How attributes are spread over vertex buffers. SplitPosition keeps positions alone in stream 0
+ * and everything else interleaved in stream 1, so passes that only need positions (depth, shadows,
+ * the lamp) fetch just the bytes they use.
+ */
+enum class VertexStreams {
+    Interleaved,
+    SplitPosition,
+};
+
+/*!
+ * The most vertex buffers a layout uses
+ */
+constexpr int kMaxVertexStreams = 2;
+
+/*!
+ * Where and how one attribute is stored
+ */
+struct VertexAttributeFormat {
+    // 0 if the layout doesn't store this attribute
+    GLint components;
+    GLenum type;
+    GLboolean normalized;
+    // which vertex buffer the attribute lives in, and where in that buffer's vertex
+    GLuint stream;
+    GLuint offset;
+};
+
+/*!
+ * Describes how a mesh is laid out in its vertex buffers and does the packing. Meshes pick their
+ * layout with @a choose, which decides per attribute whether the compact format can represent the
+ * data, so callers never hard-code strides or offsets.
+ *
+ * Quantized positions have to be expanded in the vertex shader with
+ *  position * positionScale + positionBias
+ * both of which are (1, 1, 1) and (0, 0, 0) for uncompressed layouts.
+ */
+class VertexLayout {
+public:
+    /*!
+     * Picks the attribute formats for @a mesh. UVs are only stored if any vertex has a non-zero
+     * UV, normals only fall back to floats if they aren't unit length.
+     */
+    static VertexLayout choose(const MeshData &mesh, VertexCompression compression,
+                               VertexStreams streams = VertexStreams::Interleaved);
+
+    /*!
+     * @return the vertex data of @a stream for @a mesh in this layout
+     */
+    std::vector<uint8_t> pack(const MeshData &mesh, int stream = 0) const;
+
+    /*!
+     * Points @a location at this attribute and enables it on the currently bound VAO. Does nothing
+     * if the layout doesn't store the attribute or @a location is -1.
+     * @param streamBuffers one vertex buffer per stream, as filled from @a pack
+     */
+    void bindAttribute(VertexAttribute attribute, GLint location, const GLuint *streamBuffers) const;
+
+    inline const VertexAttributeFormat &getFormat(VertexAttribute attribute) const {
+        return formats_[static_cast<int>(attribute)];
+    }
+
+    inline bool has(VertexAttribute attribute) const {
+        return getFormat(attribute).components > 0;
+    }
+
+    inline int getStreamCount() const { return streamCount_; }
+
+    inline GLsizei getStride(int stream = 0) const { return strides_[stream]; }
+
+    inline const glm::vec3 &getPositionScale() const { return positionScale_; }
+
+    inline const glm::vec3 &getPositionBias() const { return positionBias_; }
+
+private:
+    VertexLayout();
+
+    VertexAttributeFormat formats_[3];
+    GLsizei strides_[kMaxVertexStreams];
+    int streamCount_;
+    glm::vec3 positionScale_;
+    glm::vec3 positionBias_;
+};
+
+#endif //ANDROIDGLINVESTIGATIONS_VERTEXLAYOUT_H
@@ -1,7 +1,8 @@
 #include <jni.h>
 
 #include "AndroidOut.h"
-#include "Renderer.h"
+#include "Game.h"
+#include "Profiler.h"
 
 #include <game-activity/GameActivity.cpp>
 #include <game-text-input/gametextinput.cpp>
@@ -18,11 +19,11 @@ extern "C" {
 void handle_cmd(android_app *pApp, int32_t cmd) {
     switch (cmd) {
         case APP_CMD_INIT_WINDOW:
-            // A new window is created, associate a renderer with it. You may replace this with a
-            // "game" class if that suits your needs. Remember to change all instances of userData
-            // if you change the class here as a reinterpret_cast is dangerous this in the
-            // android_main function and the APP_CMD_TERM_WINDOW handler case.
-            pApp->userData = new Renderer(pApp);
+            // A new window is created, associate a game with it. The game starts a render thread
+            // that draws into the window. Remember to change all instances of userData if you
+            // change the class here as a reinterpret_cast is dangerous this in the android_main
+            // function and the APP_CMD_TERM_WINDOW handler case.
+            pApp->userData = new Game(pApp);
             break;
         case APP_CMD_TERM_WINDOW:
             // The window is being destroyed. Use this to clean up your userData to avoid leaking
@@ -30,10 +31,14 @@ void handle_cmd(android_app *pApp, int32_t cmd) {
             //
             // We have to check if userData is assigned just in case this comes in really quickly
             if (pApp->userData) {
-                //
-                auto *pRenderer = reinterpret_cast<Renderer *>(pApp->userData);
+                // this joins the render thread, which releases the window before we return
+                auto *pGame = reinterpret_cast<Game *>(pApp->userData);
                 pApp->userData = nullptr;
-                delete pRenderer;
+                delete pGame;
+
+                // everything recorded while the window was up, pull it with
+                //  adb exec-out run-as <package> cat files/frame_trace.json
+                PROFILE_WRITE_TRACE(std::string(pApp->activity->internalDataPath) + "/frame_trace.json");
             }
             break;
         default:
@@ -62,6 +67,7 @@ bool motion_event_filter_func(const GameActivityMotionEvent *motionEvent) {
 void android_main(struct android_app *pApp) {
     // Can be removed, useful to ensure your code is running
     aout << "Welcome to android_main" << std::endl;
+    PROFILE_THREAD("game");
 
     // Register an event handler for Android events
     pApp->onAppCmd = handle_cmd;
@@ -72,28 +78,37 @@ void android_main(struct android_app *pApp) {
     android_app_set_motion_event_filter(pApp, motion_event_filter_func);
 
     // This sets up a typical game/event loop. It will run until the app is destroyed.
+    // Rendering happens on the render thread, this one only handles events, input and simulation.
     int events;
     android_poll_source *pSource;
+    int timeoutMillis = 0;
     do {
-        // Process all pending events before running game logic.
-        if (ALooper_pollAll(0, nullptr, &events, (void **) &pSource) >= 0) {
-            if (pSource) {
-                pSource->process(pApp, pSource);
+        // Process all pending events before running game logic. While the render thread is behind
+        // there's no snapshot to fill, so wait for events a little instead of spinning.
+        {
+            PROFILE_SCOPE("events");
+            if (ALooper_pollAll(timeoutMillis, nullptr, &events, (void **) &pSource) >= 0) {
+                if (pSource) {
+                    pSource->process(pApp, pSource);
+                }
             }
         }
+        timeoutMillis = 0;
 
         // Check if any user data is associated. This is assigned in handle_cmd
         if (pApp->userData) {
 
-            // We know that our user data is a Renderer, so reinterpret cast it. If you change your
+            // We know that our user data is a Game, so reinterpret cast it. If you change your
             // user data remember to change it here
-            auto *pRenderer = reinterpret_cast<Renderer *>(pApp->userData);
+            auto *pGame = reinterpret_cast<Game *>(pApp->userData);
 
             // Process game input
-            pRenderer->handleInput();
+            pGame->handleInput();
 
-            // Render a frame
-            pRenderer->render();
+            // Simulate and hand the frame to the render thread
+            if (!pGame->update()) {
+                timeoutMillis = 1;
+            }
         }
     } while (!pApp->destroyRequested);
 }
@@ -0,0 +1,193 @@
+/*!
+ * Packs a directory into one asset pack, see AssetPack.h for the layout.
+ *
+ *  asset_packer <assets directory>... <out.pack> [--align 16]
+ *
+ * Every file below the directories goes in under its path relative to its directory, except other
+ * packs, so generated assets such as compressed textures can come from a build directory. Entries are
+ * aligned to --align bytes from the start of the pack. In memory that only holds as far as the pack
+ * itself is aligned, 4 bytes for a file stored in an APK. The pack is read back and compared with
+ * the files before the tool exits.
+ */
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "AssetPack.h"
+
+namespace {
+
+namespace fs = std::filesystem;
+
+constexpr uint32_t kMaxAlignment = 4096;
+
+struct File {
+    std::string name;
+    std::string contents;
+    uint32_t alignment;
+};
+
+uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+bool readFile(const fs::path &path, std::string &contents) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    std::ostringstream buffer;
+    buffer << file.rdbuf();
+    contents = buffer.str();
+    return true;
+}
+
+/*!
+ * @return whether @a pack holds exactly @a files
+ * @param aligned also check each file's address is a multiple of its alignment
+ */
+bool readsBack(const AssetPack *pack, const std::vector<File> &files, bool aligned) {
+    if (!pack || !pack->isValid() || pack->getEntryCount() != files.size()) {
+        return false;
+    }
+    for (const auto &file: files) {
+        std::string_view contents;
+        if (!pack->view(file.name, contents) || contents != file.contents
+            || (aligned && reinterpret_cast<uintptr_t>(contents.data()) % file.alignment != 0)) {
+            fprintf(stderr, "%s doesn't read back\n", file.name.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+/*!
+ * Lays the files out and writes the pack
+ */
+bool writePack(const std::string &path, const std::vector<File> &files) {
+    AssetPackHeader header{AssetPack::kMagic, AssetPack::kVersion, static_cast<uint32_t>(files.size()), 0, 0, 0};
+    header.tocOffset = alignUp(sizeof(header), AssetPack::kTocAlignment);
+    header.namesOffset = header.tocOffset + files.size() * sizeof(AssetPackEntry);
+
+    std::string names;
+    std::vector<AssetPackEntry> entries(files.size());
+    for (size_t i = 0; i < files.size(); i++) {
+        entries[i].nameOffset = static_cast<uint32_t>(names.size());
+        entries[i].nameLength = static_cast<uint32_t>(files[i].name.size());
+        entries[i].alignment = files[i].alignment;
+        entries[i].size = files[i].contents.size();
+        names += files[i].name;
+    }
+    uint64_t offset = header.namesOffset + names.size();
+    for (auto &entry: entries) {
+        entry.offset = alignUp(offset, entry.alignment);
+        offset = entry.offset + entry.size;
+    }
+
+    std::string pack(offset, '\0');
+    memcpy(&pack[0], &header, sizeof(header));
+    memcpy(&pack[header.tocOffset], entries.data(), entries.size() * sizeof(AssetPackEntry));
+    memcpy(&pack[header.namesOffset], names.data(), names.size());
+    for (size_t i = 0; i < files.size(); i++) {
+        memcpy(&pack[entries[i].offset], files[i].contents.data(), files[i].contents.size());
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(pack.data(), pack.size());
+    return static_cast<bool>(file);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    // the directories, then the pack, then the options
+    int options = 1;
+    while (options < argc && strncmp(argv[options], "--", 2) != 0) {
+        options++;
+    }
+    if (options < 3) {
+        fprintf(stderr, "usage: see the top of AssetPacker.cpp\n");
+        return 2;
+    }
+    const std::vector<fs::path> directories(argv + 1, argv + options - 1);
+    const std::string output = argv[options - 1];
+    uint32_t alignment = 16;
+    for (int i = options; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--align") == 0) {
+            alignment = static_cast<uint32_t>(atoi(argv[i + 1]));
+        } else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0 || alignment > kMaxAlignment) {
+        fprintf(stderr, "--align must be a power of two up to %u\n", kMaxAlignment);
+        return 2;
+    }
+
+    std::vector<File> files;
+    for (const auto &directory: directories) {
+        std::error_code error;
+        for (const auto &item: fs::recursive_directory_iterator(directory, error)) {
+            if (!item.is_regular_file() || item.path().extension() == ".pack") {
+                continue;
+            }
+            File file;
+            file.name = item.path().lexically_relative(directory).generic_string();
+            if (!readFile(item.path(), file.contents)) {
+                fprintf(stderr, "couldn't read %s\n", item.path().c_str());
+                return 1;
+            }
+            file.alignment = alignment;
+            files.push_back(std::move(file));
+        }
+        if (error) {
+            fprintf(stderr, "couldn't list %s: %s\n", directory.c_str(), error.message().c_str());
+            return 1;
+        }
+    }
+    // the reader binary searches by path
+    std::sort(files.begin(), files.end(), [](const File &a, const File &b) { return a.name < b.name; });
+    const auto duplicate = std::adjacent_find(files.begin(), files.end(),
+                                              [](const File &a, const File &b) { return a.name == b.name; });
+    if (duplicate != files.end()) {
+        fprintf(stderr, "%s is in more than one directory\n", duplicate->name.c_str());
+        return 1;
+    }
+
+    if (!writePack(output, files)) {
+        fprintf(stderr, "couldn't write %s\n", output.c_str());
+        return 1;
+    }
+
+    // read it back the way the app does. The mapping starts on a page, so the data's addresses are
+    // as aligned as its offsets
+    auto pack = AssetPack::openFile(output);
+    if (!readsBack(pack.get(), files, true)) {
+        fprintf(stderr, "%s doesn't read back\n", output.c_str());
+        return 1;
+    }
+    // and from 4 bytes past an 8 byte boundary, as an APK may place it
+    std::string packed;
+    readFile(output, packed);
+    std::vector<uint64_t> storage(packed.size() / sizeof(uint64_t) + 2);
+    char *shifted = reinterpret_cast<char *>(storage.data()) + 4;
+    memcpy(shifted, packed.data(), packed.size());
+    AssetPack shiftedPack(shifted, packed.size());
+    if (!readsBack(&shiftedPack, files, false)) {
+        fprintf(stderr, "%s doesn't read back from a 4 byte aligned address\n", output.c_str());
+        return 1;
+    }
+    size_t bytes = 0;
+    for (const auto &file: files) {
+        bytes += file.contents.size();
+    }
+    printf("packed %zu files, %zu bytes, into %s\n", files.size(), bytes, output.c_str());
+    return 0;
+}
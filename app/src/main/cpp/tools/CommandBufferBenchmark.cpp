@@ -0,0 +1,131 @@
+/*!
+ * Host benchmark for CommandBuffer. Records a random scene into the recording backend, checks the
+ * executed order follows the sort keys, and prints sort time against std::sort and how many state
+ * changes sorting saved over submission order.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "CommandBuffer.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t kDrawCount = 100000;
+constexpr int kRepeats = 20;
+constexpr uint32_t kPrograms = 8;
+constexpr uint32_t kVertexArrays = 32;
+constexpr uint32_t kTextures = 64;
+
+struct Draw {
+    RenderPass pass;
+    float depth;
+    DrawCommand command;
+};
+
+double nanosecondsPerDraw(Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / kDrawCount;
+}
+
+/*!
+ * State changes if the draws were executed in the order they were made
+ */
+size_t unsortedBinds(const std::vector<Draw> &draws) {
+    size_t binds = 0;
+    uint32_t program = ~0u, vertexArray = ~0u, texture = ~0u;
+    for (const auto &draw: draws) {
+        binds += draw.command.program != program;
+        binds += draw.command.vertexArray != vertexArray;
+        binds += draw.command.texture != texture;
+        program = draw.command.program;
+        vertexArray = draw.command.vertexArray;
+        texture = draw.command.texture;
+    }
+    return binds;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> depth(0.0f, 1.0f);
+    std::vector<Draw> draws(kDrawCount);
+    for (auto &draw: draws) {
+        draw.pass = random() % 4 == 0 ? RenderPass::Transparent : RenderPass::Opaque;
+        draw.depth = depth(random);
+        draw.command = DrawCommand{};
+        draw.command.program = 1 + random() % kPrograms;
+        draw.command.vertexArray = 1 + random() % kVertexArrays;
+        draw.command.texture = 1 + random() % kTextures;
+        draw.command.indexCount = 36;
+        draw.command.instanceCount = 1;
+    }
+
+    CommandBuffer commands;
+    RecordingCommandBackend backend;
+    double bestSubmit = 1e9;
+    for (int repeat = 0; repeat < kRepeats; repeat++) {
+        backend.clear();
+        for (const auto &draw: draws) {
+            commands.uniform(0, draw.depth);
+            commands.draw(draw.pass, draw.depth, draw.command);
+        }
+        auto start = Clock::now();
+        commands.submit(backend);
+        bestSubmit = std::min(bestSubmit, nanosecondsPerDraw(start));
+    }
+
+    // the same keys through the radix sort alone and through std::sort
+    std::vector<uint64_t> keys(kDrawCount);
+    for (size_t i = 0; i < kDrawCount; i++) {
+        const auto &command = draws[i].command;
+        keys[i] = CommandBuffer::makeKey(draws[i].pass, command.program, command.vertexArray,
+                                         command.texture, draws[i].depth);
+    }
+    double bestRadix = 1e9;
+    double bestStd = 1e9;
+    std::vector<uint64_t> sortedKeys, keyScratch;
+    std::vector<uint32_t> indices, indexScratch;
+    for (int repeat = 0; repeat < kRepeats; repeat++) {
+        sortedKeys = keys;
+        indices.resize(kDrawCount);
+        std::iota(indices.begin(), indices.end(), 0u);
+        auto start = Clock::now();
+        CommandBuffer::radixSort(sortedKeys, indices, keyScratch, indexScratch);
+        bestRadix = std::min(bestRadix, nanosecondsPerDraw(start));
+
+        std::vector<std::pair<uint64_t, uint32_t>> pairs(kDrawCount);
+        for (size_t i = 0; i < kDrawCount; i++) {
+            pairs[i] = {keys[i], static_cast<uint32_t>(i)};
+        }
+        start = Clock::now();
+        std::stable_sort(pairs.begin(), pairs.end(),
+                         [](const auto &a, const auto &b) { return a.first < b.first; });
+        bestStd = std::min(bestStd, nanosecondsPerDraw(start));
+    }
+
+    // every executed draw must come in key order
+    bool ordered = backend.getDraws().size() == kDrawCount
+                   && std::is_sorted(sortedKeys.begin(), sortedKeys.end());
+    for (size_t i = 0; i < kDrawCount && ordered; i++) {
+        const auto &command = backend.getDraws()[i];
+        ordered = command.program == draws[indices[i]].command.program
+                  && command.vertexArray == draws[indices[i]].command.vertexArray
+                  && command.texture == draws[indices[i]].command.texture;
+    }
+
+    const auto &stats = commands.getStats();
+    size_t sortedBinds = stats.programBinds + stats.vertexArrayBinds + stats.textureBinds;
+    printf("%zu draws: submit %.2f ns/draw  radix sort %.2f ns/draw  std::stable_sort %.2f ns/draw\n",
+           kDrawCount, bestSubmit, bestRadix, bestStd);
+    printf("state changes: %zu unsorted, %zu sorted (%zu program, %zu vao, %zu texture)\n",
+           unsortedBinds(draws), sortedBinds, stats.programBinds, stats.vertexArrayBinds,
+           stats.textureBinds);
+    printf("execution order %s\n", ordered ? "follows the keys" : "WRONG");
+    return ordered ? 0 : 1;
+}
@@ -0,0 +1,106 @@
+/*!
+ * Host benchmark for FrustumCuller. Scatters 1M random boxes around a camera, checks the SIMD path
+ * agrees with the scalar one and prints ns per object for both. Also checks that the padding after
+ * box counts that don't fill a SIMD block never comes back as visible.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "FrustumCuller.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t kBoxCount = 1000000;
+constexpr int kRepeats = 20;
+
+/*!
+ * Runs @a cull kRepeats times and prints the best and mean time per box
+ */
+template<typename Cull>
+size_t measure(const char *name, Cull cull) {
+    double best = 1e9;
+    double total = 0.0;
+    size_t visible = 0;
+    for (int repeat = 0; repeat < kRepeats; repeat++) {
+        auto start = Clock::now();
+        visible = cull();
+        double elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count()
+                         / kBoxCount;
+        best = std::min(best, elapsed);
+        total += elapsed;
+    }
+    printf("%-8s %7zu / %zu visible  best %.3f ns/object  mean %.3f ns/object\n",
+           name, visible, kBoxCount, best, total / kRepeats);
+    return visible;
+}
+
+/*!
+ * Culls @a count boxes against a frustum everything is inside of, padding included unless it's
+ * masked off
+ * @return true if exactly the real boxes came back
+ */
+bool checkPadding(size_t count) {
+    BoundingBoxes boxes;
+    for (size_t i = 0; i < count; i++) {
+        boxes.add(glm::vec3(static_cast<float>(i)), glm::vec3(0.5f));
+    }
+    Frustum everything;
+    for (auto &plane: everything.planes) {
+        plane = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+    // room for the padding too, so a wrong mask shows up as a count rather than an overflow
+    std::vector<uint32_t> visible(count + 16);
+    size_t written = FrustumCuller::cull(everything, boxes, visible.data());
+    for (size_t i = 0; i < written; i++) {
+        if (visible[i] != i) {
+            return false;
+        }
+    }
+    return written == count;
+}
+
+} // namespace
+
+int main() {
+    bool paddingMasked = true;
+    for (size_t count = 0; count <= 19; count++) {
+        paddingMasked &= checkPadding(count);
+    }
+    printf("padding lanes %s\n", paddingMasked ? "masked" : "LEAKED");
+
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> size(0.1f, 2.0f);
+
+    BoundingBoxes boxes;
+    for (size_t i = 0; i < kBoxCount; i++) {
+        boxes.add(glm::vec3(position(random), position(random), position(random)),
+                  glm::vec3(size(random), size(random), size(random)));
+    }
+
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.2f, -1.0f),
+                                 glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum = Frustum::fromMatrix(projection * view);
+
+    std::vector<uint32_t> scalarVisible(kBoxCount);
+    std::vector<uint32_t> simdVisible(kBoxCount);
+    size_t scalarCount = measure("scalar", [&] {
+        return FrustumCuller::cullScalar(frustum, boxes, scalarVisible.data());
+    });
+    size_t simdCount = measure("simd", [&] {
+        return FrustumCuller::cull(frustum, boxes, simdVisible.data());
+    });
+
+    bool match = scalarCount == simdCount
+                 && std::equal(scalarVisible.begin(), scalarVisible.begin() + scalarCount,
+                               simdVisible.begin());
+    printf("simd and scalar results %s\n", match ? "match" : "DIFFER");
+    return match && paddingMasked ? 0 : 1;
+}
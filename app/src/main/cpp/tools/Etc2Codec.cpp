@@ -0,0 +1,619 @@
+#include "Etc2Codec.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <climits>
+#include <cmath>
+
+namespace {
+
+using Color = std::array<int, 3>;
+
+/*!
+ * The 16 texels of a block in the order the index bits use, down each column: texel i is at
+ * x = i / 4, y = i % 4
+ */
+using Block = std::array<Color, Etc2Codec::kBlockTexels>;
+
+enum class Mode {
+    Individual,
+    Differential,
+    T,
+    H,
+    Planar,
+};
+
+struct Candidate {
+    uint64_t bits;
+    uint32_t error;
+};
+
+// individual and differential modes, index values 0 to 3 are +small, +large, -small, -large
+constexpr int kModifiers[8][2] = {{2, 8}, {5, 17}, {9, 29}, {13, 42}, {18, 60}, {24, 80}, {33, 106}, {47, 183}};
+
+// T and H modes
+constexpr int kDistances[8] = {3, 6, 11, 16, 23, 32, 41, 64};
+
+// EAC, by index value
+constexpr int kAlphaModifiers[16][8] = {
+        {-3, -6, -9,  -15, 2, 5, 8, 14},
+        {-3, -7, -10, -13, 2, 6, 9, 12},
+        {-2, -5, -8,  -13, 1, 4, 7, 12},
+        {-2, -4, -6,  -13, 1, 3, 5, 12},
+        {-3, -6, -8,  -12, 2, 5, 7, 11},
+        {-3, -7, -9,  -11, 2, 6, 8, 10},
+        {-4, -7, -8,  -11, 3, 6, 7, 10},
+        {-3, -5, -8,  -11, 2, 4, 7, 10},
+        {-2, -6, -8,  -10, 1, 5, 7, 9},
+        {-2, -5, -8,  -10, 1, 4, 7, 9},
+        {-2, -4, -8,  -10, 1, 3, 7, 9},
+        {-2, -5, -7,  -10, 1, 4, 6, 9},
+        {-3, -4, -7,  -10, 2, 3, 6, 9},
+        {-1, -2, -3,  -10, 0, 1, 2, 9},
+        {-4, -6, -8,  -9,  3, 5, 7, 8},
+        {-3, -5, -7,  -9,  2, 4, 6, 8},
+};
+// an alpha table and index that add nothing, for blocks of one alpha
+constexpr int kFlatAlphaTable = 13;
+constexpr int kFlatAlphaIndex = 4;
+
+// the halves of the block, left and right without the flip bit, top and bottom with it
+constexpr uint16_t kSubblockMasks[2][2] = {{0x00ff, 0xff00}, {0x3333, 0xcccc}};
+
+int clamp255(int value) {
+    return std::clamp(value, 0, 255);
+}
+
+int expand4(int value) {
+    return value * 17;
+}
+
+int expand5(int value) {
+    return (value << 3) | (value >> 2);
+}
+
+int expand6(int value) {
+    return (value << 2) | (value >> 4);
+}
+
+int expand7(int value) {
+    return (value << 1) | (value >> 6);
+}
+
+int signed3(uint64_t value) {
+    return static_cast<int>(value & 7) - (value & 4 ? 8 : 0);
+}
+
+uint32_t squaredError(const Color &a, const Color &b) {
+    uint32_t error = 0;
+    for (int c = 0; c < 3; c++) {
+        error += (a[c] - b[c]) * (a[c] - b[c]);
+    }
+    return error;
+}
+
+Color offset(const Color &color, int amount) {
+    return {clamp255(color[0] + amount), clamp255(color[1] + amount), clamp255(color[2] + amount)};
+}
+
+Block load(const uint8_t *texels) {
+    Block block;
+    for (size_t i = 0; i < block.size(); i++) {
+        const uint8_t *texel = texels + ((i % 4) * 4 + i / 4) * 4;
+        block[i] = {texel[0], texel[1], texel[2]};
+    }
+    return block;
+}
+
+void store(uint64_t bits, uint8_t *block) {
+    for (size_t i = 0; i < Etc2Codec::kBlockBytes; i++) {
+        block[i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+    }
+}
+
+uint64_t fetch(const uint8_t *block) {
+    uint64_t bits = 0;
+    for (size_t i = 0; i < Etc2Codec::kBlockBytes; i++) {
+        bits = (bits << 8) | block[i];
+    }
+    return bits;
+}
+
+/*!
+ * Differential, T, H and planar all set the diff bit and are told apart by which base color, if
+ * any, would overflow as a differential block
+ */
+Mode modeOf(uint64_t bits) {
+    if (!((bits >> 33) & 1)) {
+        return Mode::Individual;
+    }
+    const int red = static_cast<int>((bits >> 59) & 31) + signed3(bits >> 56);
+    const int green = static_cast<int>((bits >> 51) & 31) + signed3(bits >> 48);
+    const int blue = static_cast<int>((bits >> 43) & 31) + signed3(bits >> 40);
+    if (red < 0 || red > 31) {
+        return Mode::T;
+    }
+    if (green < 0 || green > 31) {
+        return Mode::H;
+    }
+    if (blue < 0 || blue > 31) {
+        return Mode::Planar;
+    }
+    return Mode::Differential;
+}
+
+/*!
+ * T, H and planar blocks have bits nothing reads, set them so the block decodes as @a mode
+ */
+uint64_t forceMode(uint64_t bits, uint64_t unused, Mode mode) {
+    for (uint64_t set = unused;; set = (set - 1) & unused) {
+        if (modeOf(bits | set) == mode) {
+            return bits | set;
+        }
+        if (set == 0) {
+            break;
+        }
+    }
+    assert(false && "every mode can be signalled");
+    return bits;
+}
+
+uint32_t indexValue(uint64_t bits, size_t texel) {
+    return static_cast<uint32_t>(((bits >> (16 + texel)) & 1) << 1 | ((bits >> texel) & 1));
+}
+
+/*!
+ * Picks the closest of @a paint for each texel in @a mask
+ * @param indices gets the index bits of those texels
+ * @return the squared error
+ */
+uint32_t fit(const Block &block, uint16_t mask, const Color (&paint)[4], uint32_t &indices) {
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < block.size(); i++) {
+        if (!(mask & (1u << i))) {
+            continue;
+        }
+        uint32_t best = 0;
+        uint32_t bestError = UINT_MAX;
+        for (uint32_t value = 0; value < 4; value++) {
+            const uint32_t error = squaredError(block[i], paint[value]);
+            if (error < bestError) {
+                best = value;
+                bestError = error;
+            }
+        }
+        indices |= (best & 1) << i | (best >> 1) << (16 + i);
+        total += bestError;
+    }
+    return total;
+}
+
+void baseTablePaint(const Color &base, int table, Color (&paint)[4]) {
+    paint[0] = offset(base, kModifiers[table][0]);
+    paint[1] = offset(base, kModifiers[table][1]);
+    paint[2] = offset(base, -kModifiers[table][0]);
+    paint[3] = offset(base, -kModifiers[table][1]);
+}
+
+void tPaint(const Color &first, const Color &second, int distance, Color (&paint)[4]) {
+    paint[0] = first;
+    paint[1] = offset(second, kDistances[distance]);
+    paint[2] = second;
+    paint[3] = offset(second, -kDistances[distance]);
+}
+
+void hPaint(const Color &first, const Color &second, int distance, Color (&paint)[4]) {
+    paint[0] = offset(first, kDistances[distance]);
+    paint[1] = offset(first, -kDistances[distance]);
+    paint[2] = offset(second, kDistances[distance]);
+    paint[3] = offset(second, -kDistances[distance]);
+}
+
+void decodeBlock(uint64_t bits, Block &block) {
+    const Mode mode = modeOf(bits);
+    if (mode == Mode::Planar) {
+        const Color origin = {expand6((bits >> 57) & 63),
+                              expand7(((bits >> 56) & 1) << 6 | ((bits >> 49) & 63)),
+                              expand6(((bits >> 48) & 1) << 5 | ((bits >> 43) & 3) << 3 | ((bits >> 39) & 7))};
+        const Color horizontal = {expand6(((bits >> 34) & 31) << 1 | ((bits >> 32) & 1)),
+                                  expand7((bits >> 25) & 127),
+                                  expand6((bits >> 19) & 63)};
+        const Color vertical = {expand6((bits >> 13) & 63), expand7((bits >> 6) & 127), expand6(bits & 63)};
+        for (int i = 0; i < 16; i++) {
+            const int x = i / 4;
+            const int y = i % 4;
+            for (int c = 0; c < 3; c++) {
+                block[i][c] = clamp255((x * (horizontal[c] - origin[c]) + y * (vertical[c] - origin[c])
+                                        + 4 * origin[c] + 2) >> 2);
+            }
+        }
+        return;
+    }
+
+    Color paint[2][4];
+    bool subblocks = false;
+    if (mode == Mode::T || mode == Mode::H) {
+        Color first, second;
+        int distance;
+        if (mode == Mode::T) {
+            first = {expand4(((bits >> 59) & 3) << 2 | ((bits >> 56) & 3)), expand4((bits >> 52) & 15),
+                     expand4((bits >> 48) & 15)};
+            second = {expand4((bits >> 44) & 15), expand4((bits >> 40) & 15), expand4((bits >> 36) & 15)};
+            distance = static_cast<int>(((bits >> 34) & 3) << 1 | ((bits >> 32) & 1));
+            tPaint(first, second, distance, paint[0]);
+        } else {
+            const int r1 = (bits >> 59) & 15;
+            const int g1 = ((bits >> 56) & 7) << 1 | ((bits >> 52) & 1);
+            const int b1 = ((bits >> 51) & 1) << 3 | ((bits >> 47) & 7);
+            const int r2 = (bits >> 43) & 15;
+            const int g2 = (bits >> 39) & 15;
+            const int b2 = (bits >> 35) & 15;
+            // the lowest bit of the distance is in the order of the colors
+            distance = static_cast<int>(((bits >> 34) & 1) << 2 | ((bits >> 32) & 1) << 1)
+                       | ((r1 << 8 | g1 << 4 | b1) >= (r2 << 8 | g2 << 4 | b2) ? 1 : 0);
+            first = {expand4(r1), expand4(g1), expand4(b1)};
+            second = {expand4(r2), expand4(g2), expand4(b2)};
+            hPaint(first, second, distance, paint[0]);
+        }
+    } else {
+        Color first, second;
+        if (mode == Mode::Individual) {
+            first = {expand4((bits >> 60) & 15), expand4((bits >> 52) & 15), expand4((bits >> 44) & 15)};
+            second = {expand4((bits >> 56) & 15), expand4((bits >> 48) & 15), expand4((bits >> 40) & 15)};
+        } else {
+            const int r = (bits >> 59) & 31;
+            const int g = (bits >> 51) & 31;
+            const int b = (bits >> 43) & 31;
+            first = {expand5(r), expand5(g), expand5(b)};
+            second = {expand5(r + signed3(bits >> 56)), expand5(g + signed3(bits >> 48)),
+                      expand5(b + signed3(bits >> 40))};
+        }
+        baseTablePaint(first, (bits >> 37) & 7, paint[0]);
+        baseTablePaint(second, (bits >> 34) & 7, paint[1]);
+        subblocks = true;
+    }
+
+    const uint16_t secondMask = kSubblockMasks[(bits >> 32) & 1][1];
+    for (uint32_t i = 0; i < 16; i++) {
+        const bool second = subblocks && (secondMask & (1u << i));
+        block[i] = paint[second ? 1 : 0][indexValue(bits, i)];
+    }
+}
+
+struct SubblockFit {
+    Color base;
+    int table;
+    uint32_t indices;
+    uint32_t error;
+};
+
+/*!
+ * Finds a base color with @a levels steps per channel and a table for the texels in @a mask.
+ * Tries the quantized average and a step either side of it, each channel within @a low to @a high.
+ */
+SubblockFit fitSubblock(const Block &block, uint16_t mask, int levels, const Color &low, const Color &high) {
+    double average[3] = {};
+    for (uint32_t i = 0; i < 16; i++) {
+        if (mask & (1u << i)) {
+            for (int c = 0; c < 3; c++) {
+                average[c] += block[i][c] / 8.0;
+            }
+        }
+    }
+    SubblockFit best{{}, 0, 0, UINT_MAX};
+    for (int step = -1; step <= 1; step++) {
+        Color base;
+        for (int c = 0; c < 3; c++) {
+            base[c] = std::clamp(static_cast<int>(std::lround(average[c] * (levels - 1) / 255.0)) + step,
+                                 low[c], high[c]);
+        }
+        const Color expanded = levels == 16 ? Color{expand4(base[0]), expand4(base[1]), expand4(base[2])}
+                                            : Color{expand5(base[0]), expand5(base[1]), expand5(base[2])};
+        for (int table = 0; table < 8; table++) {
+            Color paint[4];
+            baseTablePaint(expanded, table, paint);
+            uint32_t indices = 0;
+            const uint32_t error = fit(block, mask, paint, indices);
+            if (error < best.error) {
+                best = {base, table, indices, error};
+            }
+        }
+    }
+    return best;
+}
+
+bool deltasFit(const Color &first, const Color &second) {
+    for (int c = 0; c < 3; c++) {
+        if (second[c] - first[c] < -4 || second[c] - first[c] > 3) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void keep(Candidate &best, uint64_t bits, uint32_t error) {
+    if (error < best.error) {
+        best = {bits, error};
+    }
+}
+
+void encodeIndividualDifferential(const Block &block, Candidate &best) {
+    const Color zero = {0, 0, 0};
+    for (uint64_t flip = 0; flip < 2; flip++) {
+        const uint16_t *masks = kSubblockMasks[flip];
+
+        // two 4 bit colors
+        const Color max4 = {15, 15, 15};
+        SubblockFit first = fitSubblock(block, masks[0], 16, zero, max4);
+        SubblockFit second = fitSubblock(block, masks[1], 16, zero, max4);
+        keep(best, uint64_t(first.base[0]) << 60 | uint64_t(second.base[0]) << 56
+                   | uint64_t(first.base[1]) << 52 | uint64_t(second.base[1]) << 48
+                   | uint64_t(first.base[2]) << 44 | uint64_t(second.base[2]) << 40
+                   | uint64_t(first.table) << 37 | uint64_t(second.table) << 34 | flip << 32
+                   | first.indices | second.indices,
+             first.error + second.error);
+
+        // a 5 bit color and a 3 bit signed delta. If the best two are too far apart, one is kept
+        // and the other searched again within reach of it
+        const Color max5 = {31, 31, 31};
+        first = fitSubblock(block, masks[0], 32, zero, max5);
+        second = fitSubblock(block, masks[1], 32, zero, max5);
+        if (!deltasFit(first.base, second.base)) {
+            Color low, high;
+            for (int c = 0; c < 3; c++) {
+                low[c] = std::max(first.base[c] - 4, 0);
+                high[c] = std::min(first.base[c] + 3, 31);
+            }
+            const SubblockFit nearFirst = fitSubblock(block, masks[1], 32, low, high);
+            for (int c = 0; c < 3; c++) {
+                low[c] = std::max(second.base[c] - 3, 0);
+                high[c] = std::min(second.base[c] + 4, 31);
+            }
+            const SubblockFit nearSecond = fitSubblock(block, masks[0], 32, low, high);
+            if (first.error + nearFirst.error <= nearSecond.error + second.error) {
+                second = nearFirst;
+            } else {
+                first = nearSecond;
+            }
+        }
+        assert(deltasFit(first.base, second.base));
+        uint64_t bits = uint64_t(1) << 33 | flip << 32 | uint64_t(first.table) << 37 | uint64_t(second.table) << 34
+                        | first.indices | second.indices;
+        for (int c = 0; c < 3; c++) {
+            bits |= uint64_t(first.base[c]) << (59 - 8 * c) | uint64_t((second.base[c] - first.base[c]) & 7) << (56 - 8 * c);
+        }
+        keep(best, bits, first.error + second.error);
+    }
+}
+
+/*!
+ * Splits the block into two groups of colors with a few rounds of k-means
+ */
+void twoColors(const Block &block, Color &first, Color &second) {
+    // seeded with the two texels furthest apart
+    uint32_t widest = 0;
+    first = second = block[0];
+    for (size_t i = 0; i < block.size(); i++) {
+        for (size_t j = i + 1; j < block.size(); j++) {
+            if (squaredError(block[i], block[j]) > widest) {
+                widest = squaredError(block[i], block[j]);
+                first = block[i];
+                second = block[j];
+            }
+        }
+    }
+    for (int round = 0; round < 4; round++) {
+        int sums[2][3] = {};
+        int counts[2] = {};
+        for (const Color &texel: block) {
+            const int group = squaredError(texel, first) <= squaredError(texel, second) ? 0 : 1;
+            counts[group]++;
+            for (int c = 0; c < 3; c++) {
+                sums[group][c] += texel[c];
+            }
+        }
+        for (int c = 0; c < 3; c++) {
+            if (counts[0]) {
+                first[c] = (sums[0][c] + counts[0] / 2) / counts[0];
+            }
+            if (counts[1]) {
+                second[c] = (sums[1][c] + counts[1] / 2) / counts[1];
+            }
+        }
+    }
+}
+
+Color quantize4(const Color &color) {
+    return {(color[0] * 15 + 127) / 255, (color[1] * 15 + 127) / 255, (color[2] * 15 + 127) / 255};
+}
+
+Color expand4(const Color &color) {
+    return {expand4(color[0]), expand4(color[1]), expand4(color[2])};
+}
+
+/*!
+ * T and H modes, for blocks of two colors that don't line up with the halves
+ */
+void encodeTH(const Block &block, Candidate &best) {
+    Color first, second;
+    twoColors(block, first, second);
+    const Color quantized[2] = {quantize4(first), quantize4(second)};
+
+    // T: one group is a single color, the other gets its color and two more at a distance
+    for (int single = 0; single < 2; single++) {
+        const Color &a = quantized[single];
+        const Color &b = quantized[1 - single];
+        for (int distance = 0; distance < 8; distance++) {
+            Color paint[4];
+            tPaint(expand4(a), expand4(b), distance, paint);
+            uint32_t indices = 0;
+            const uint32_t error = fit(block, 0xffff, paint, indices);
+            if (error >= best.error) {
+                continue;
+            }
+            const uint64_t bits = uint64_t(a[0] >> 2) << 59 | uint64_t(a[0] & 3) << 56 | uint64_t(a[1]) << 52
+                                  | uint64_t(a[2]) << 48 | uint64_t(b[0]) << 44 | uint64_t(b[1]) << 40
+                                  | uint64_t(b[2]) << 36 | uint64_t(distance >> 1) << 34 | uint64_t(1) << 33
+                                  | uint64_t(distance & 1) << 32 | indices;
+            keep(best, forceMode(bits, 0xe400000000000000ull, Mode::T), error);
+        }
+    }
+
+    // H: both groups get two colors at a distance. The order of the colors holds the lowest bit of
+    // the distance, so they're swapped to suit it
+    const auto value = [](const Color &color) { return color[0] << 8 | color[1] << 4 | color[2]; };
+    for (int distance = 0; distance < 8; distance++) {
+        const int order = distance & 1;
+        const bool swap = (value(quantized[0]) >= value(quantized[1]) ? 1 : 0) != order;
+        const Color &a = quantized[swap ? 1 : 0];
+        const Color &b = quantized[swap ? 0 : 1];
+        if ((value(a) >= value(b) ? 1 : 0) != order) {
+            // equal colors always read as order 1
+            continue;
+        }
+        Color paint[4];
+        hPaint(expand4(a), expand4(b), distance, paint);
+        uint32_t indices = 0;
+        const uint32_t error = fit(block, 0xffff, paint, indices);
+        if (error >= best.error) {
+            continue;
+        }
+        const uint64_t bits = uint64_t(a[0]) << 59 | uint64_t(a[1] >> 1) << 56 | uint64_t(a[1] & 1) << 52
+                              | uint64_t(a[2] >> 3) << 51 | uint64_t(a[2] & 7) << 47 | uint64_t(b[0]) << 43
+                              | uint64_t(b[1]) << 39 | uint64_t(b[2]) << 35 | uint64_t(distance >> 2) << 34
+                              | uint64_t(1) << 33 | uint64_t((distance >> 1) & 1) << 32 | indices;
+        keep(best, forceMode(bits, 0x80e4000000000000ull, Mode::H), error);
+    }
+}
+
+/*!
+ * Planar mode, a least squares fit of a gradient over the block
+ */
+void encodePlanar(const Block &block, Candidate &best) {
+    int origin[3], horizontal[3], vertical[3];
+    for (int c = 0; c < 3; c++) {
+        // with x and y centred on the block, the slopes and the mean are independent
+        double mean = 0.0, slopeX = 0.0, slopeY = 0.0;
+        for (int i = 0; i < 16; i++) {
+            mean += block[i][c] / 16.0;
+            slopeX += (i / 4 - 1.5) * block[i][c] / 20.0;
+            slopeY += (i % 4 - 1.5) * block[i][c] / 20.0;
+        }
+        const double o = mean - 1.5 * slopeX - 1.5 * slopeY;
+        const int levels = c == 1 ? 127 : 63;
+        const auto quantize = [levels](double value) {
+            return std::clamp(static_cast<int>(std::lround(value * levels / 255.0)), 0, levels);
+        };
+        origin[c] = quantize(o);
+        horizontal[c] = quantize(o + 4.0 * slopeX);
+        vertical[c] = quantize(o + 4.0 * slopeY);
+    }
+    uint64_t bits = uint64_t(origin[0]) << 57 | uint64_t(origin[1] >> 6) << 56 | uint64_t(origin[1] & 63) << 49
+                    | uint64_t(origin[2] >> 5) << 48 | uint64_t((origin[2] >> 3) & 3) << 43
+                    | uint64_t(origin[2] & 7) << 39 | uint64_t(horizontal[0] >> 1) << 34 | uint64_t(1) << 33
+                    | uint64_t(horizontal[0] & 1) << 32 | uint64_t(horizontal[1]) << 25
+                    | uint64_t(horizontal[2]) << 19 | uint64_t(vertical[0]) << 13 | uint64_t(vertical[1]) << 6
+                    | uint64_t(vertical[2]);
+    bits = forceMode(bits, 0x8080e40000000000ull, Mode::Planar);
+
+    Block decoded;
+    decodeBlock(bits, decoded);
+    uint32_t error = 0;
+    for (int i = 0; i < 16; i++) {
+        error += squaredError(block[i], decoded[i]);
+    }
+    keep(best, bits, error);
+}
+
+} // namespace
+
+void Etc2Codec::encodeColor(const uint8_t *texels, uint8_t *block) {
+    const Block source = load(texels);
+    Candidate best{0, UINT_MAX};
+    encodeIndividualDifferential(source, best);
+    if (best.error > 0) {
+        encodeTH(source, best);
+    }
+    if (best.error > 0) {
+        encodePlanar(source, best);
+    }
+    store(best.bits, block);
+
+#ifndef NDEBUG
+    Block decoded;
+    decodeBlock(best.bits, decoded);
+    uint32_t error = 0;
+    for (size_t i = 0; i < decoded.size(); i++) {
+        error += squaredError(source[i], decoded[i]);
+    }
+    assert(error == best.error);
+#endif
+}
+
+void Etc2Codec::decodeColor(const uint8_t *block, uint8_t *texels) {
+    Block decoded;
+    decodeBlock(fetch(block), decoded);
+    for (size_t i = 0; i < decoded.size(); i++) {
+        uint8_t *texel = texels + ((i % 4) * 4 + i / 4) * 4;
+        for (int c = 0; c < 3; c++) {
+            texel[c] = static_cast<uint8_t>(decoded[i][c]);
+        }
+    }
+}
+
+void Etc2Codec::encodeAlpha(const uint8_t *texels, uint8_t *block) {
+    int alpha[16];
+    for (int i = 0; i < 16; i++) {
+        alpha[i] = texels[((i % 4) * 4 + i / 4) * 4 + 3];
+    }
+    const auto [low, high] = std::minmax_element(alpha, alpha + 16);
+
+    // the multiplier is kept above 0, which some decoders treat specially
+    uint64_t bits = uint64_t(*low) << 56 | uint64_t(1) << 52 | uint64_t(kFlatAlphaTable) << 48;
+    for (int i = 0; i < 16; i++) {
+        bits |= uint64_t(kFlatAlphaIndex) << (45 - 3 * i);
+    }
+    uint32_t bestError = *low == *high ? 0 : UINT_MAX;
+
+    // otherwise every table and multiplier, the base centring the table's range on the block's
+    for (int table = 0; table < 16 && bestError > 0; table++) {
+        const int *modifiers = kAlphaModifiers[table];
+        for (int multiplier = 1; multiplier < 16; multiplier++) {
+            const int centre = (*low + *high - (modifiers[3] + modifiers[7]) * multiplier) / 2;
+            for (int base = std::max(centre - 1, 0); base <= std::min(centre + 1, 255); base++) {
+                uint64_t indices = 0;
+                uint32_t error = 0;
+                for (int i = 0; i < 16 && error < bestError; i++) {
+                    int bestIndex = 0;
+                    int bestDifference = INT_MAX;
+                    for (int index = 0; index < 8; index++) {
+                        const int difference = std::abs(clamp255(base + modifiers[index] * multiplier) - alpha[i]);
+                        if (difference < bestDifference) {
+                            bestIndex = index;
+                            bestDifference = difference;
+                        }
+                    }
+                    indices |= uint64_t(bestIndex) << (45 - 3 * i);
+                    error += bestDifference * bestDifference;
+                }
+                if (error < bestError) {
+                    bestError = error;
+                    bits = uint64_t(base) << 56 | uint64_t(multiplier) << 52 | uint64_t(table) << 48 | indices;
+                }
+            }
+        }
+    }
+    store(bits, block);
+}
+
+void Etc2Codec::decodeAlpha(const uint8_t *block, uint8_t *texels) {
+    const uint64_t bits = fetch(block);
+    const int base = static_cast<int>(bits >> 56);
+    const int multiplier = static_cast<int>((bits >> 52) & 15);
+    const int *modifiers = kAlphaModifiers[(bits >> 48) & 15];
+    for (int i = 0; i < 16; i++) {
+        const int index = static_cast<int>((bits >> (45 - 3 * i)) & 7);
+        texels[((i % 4) * 4 + i / 4) * 4 + 3] = static_cast<uint8_t>(clamp255(base + modifiers[index] * multiplier));
+    }
+}
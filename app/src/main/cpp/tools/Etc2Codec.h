@@ -0,0 +1,43 @@
+#ifndef ANDROIDGLINVESTIGATIONS_ETC2CODEC_H
+#define ANDROIDGLINVESTIGATIONS_ETC2CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*!
+ * ETC2 block compression, see appendix C of the GLES 3.0 specification. A block is 4x4 texels,
+ * passed as 16 RGBA8 texels in rows, top row first. Color blocks are the 8 bytes of
+ * GL_COMPRESSED_RGB8_ETC2, alpha blocks the 8 bytes of EAC that precede the color block in
+ * GL_COMPRESSED_RGBA8_ETC2_EAC.
+ *
+ * The encoder tries every ETC2 mode (individual, differential, T, H and planar) with a small
+ * search in each and keeps the one with the least squared error. The decoders exist to measure
+ * that error, the app never decodes.
+ */
+class Etc2Codec {
+public:
+    static constexpr size_t kBlockTexels = 16;
+    static constexpr size_t kBlockBytes = 8;
+
+    /*!
+     * Encodes the RGB of @a texels, alpha is ignored
+     */
+    static void encodeColor(const uint8_t *texels, uint8_t *block);
+
+    /*!
+     * Encodes the alpha of @a texels
+     */
+    static void encodeAlpha(const uint8_t *texels, uint8_t *block);
+
+    /*!
+     * Writes the RGB of @a texels, leaves alpha alone
+     */
+    static void decodeColor(const uint8_t *block, uint8_t *texels);
+
+    /*!
+     * Writes the alpha of @a texels, leaves RGB alone
+     */
+    static void decodeAlpha(const uint8_t *block, uint8_t *texels);
+};
+
+#endif //ANDROIDGLINVESTIGATIONS_ETC2CODEC_H
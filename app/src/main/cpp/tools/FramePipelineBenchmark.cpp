@@ -0,0 +1,126 @@
+/*!
+ * Host benchmark for RenderThread. Runs the real Simulation on this thread against a mock backend
+ * on the render thread, each with a fake workload, and checks every rendered snapshot is whole and
+ * newer than the last. Prints the frame rate against what running both serially would give. Also
+ * checks that the simulation moves at the same pace however often frames are published.
+ */
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "RenderThread.h"
+#include "Simulation.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint64_t kFrameCount = 500;
+// fake per-frame costs. Simulation burns CPU, rendering mostly blocks in the driver and on swap so
+// it sleeps, which also lets the overlap show on a single core
+constexpr auto kSimulateCost = std::chrono::microseconds(1500);
+constexpr auto kRenderCost = std::chrono::microseconds(2000);
+
+void busyWait(std::chrono::microseconds duration) {
+    auto end = Clock::now() + duration;
+    while (Clock::now() < end) {}
+}
+
+/*!
+ * Checks each snapshot against the rotation the game thread recorded for its frame
+ */
+class MockBackend : public RenderBackend {
+public:
+    MockBackend(const std::vector<glm::quat> &expected, uint64_t &lastFrame, uint64_t &errors)
+            : expected_(expected), lastFrame_(lastFrame), errors_(errors) {}
+
+    void render(const FrameSnapshot &snapshot) override {
+        bool ordered = lastFrame_ == ~0ull || snapshot.frame > lastFrame_;
+        bool whole = snapshot.frame < expected_.size() && snapshot.cubeRotation == expected_[snapshot.frame];
+        errors_ += !ordered || !whole;
+        lastFrame_ = snapshot.frame;
+        std::this_thread::sleep_for(kRenderCost);
+    }
+
+private:
+    const std::vector<glm::quat> &expected_;
+    uint64_t &lastFrame_;
+    uint64_t &errors_;
+};
+
+/*!
+ * @return the spin speed after a swipe and @a seconds of wall time, published @a rate times a second
+ */
+float speedAfter(float seconds, float rate) {
+    Simulation simulation;
+    simulation.setSpeed(5.0f);
+    FrameSnapshot snapshot;
+    for (float elapsed = 0.0f; elapsed < seconds; elapsed += 1.0f / rate) {
+        simulation.step(snapshot, 1.0f / rate);
+    }
+    return simulation.getSpeed();
+}
+
+} // namespace
+
+int main() {
+    // the spin has to wind down alike at 30, 60 and 144 frames a second
+    const float speed30 = speedAfter(0.5f, 30.0f);
+    const float speed60 = speedAfter(0.5f, 60.0f);
+    const float speed144 = speedAfter(0.5f, 144.0f);
+    const bool paced = std::abs(speed30 - speed60) < 0.15f && std::abs(speed144 - speed60) < 0.15f;
+    printf("speed after 0.5 s: %.2f at 30 fps, %.2f at 60 fps, %.2f at 144 fps%s\n", speed30, speed60, speed144,
+           paced ? "" : "  FRAME RATE DEPENDENT");
+
+    // written by this thread before each publish, read by the render thread after it
+    std::vector<glm::quat> expected(kFrameCount);
+    uint64_t lastFrame = ~0ull;
+    uint64_t errors = 0;
+    RenderThread::Stats stats;
+
+    auto start = Clock::now();
+    {
+        RenderThread renderThread([&]() {
+            return std::unique_ptr<RenderBackend>(new MockBackend(expected, lastFrame, errors));
+        });
+        Simulation simulation;
+        uint64_t frame = 0;
+        while (frame < kFrameCount) {
+            // a swipe every hundred frames so the rotation keeps changing
+            if (frame % 100 == 0) {
+                simulation.setSpeed(5.0f);
+            }
+            FrameSnapshot *snapshot = renderThread.beginFrame();
+            if (!snapshot) {
+                std::this_thread::yield();
+                continue;
+            }
+            busyWait(kSimulateCost);
+            simulation.step(*snapshot, Simulation::kTimeStep);
+            // make every frame distinct, so a torn or stale read can't match by accident
+            snapshot->cubeRotation.w += static_cast<float>(frame) * 1e-3f;
+            expected[frame] = snapshot->cubeRotation;
+            renderThread.publishFrame();
+            frame++;
+        }
+        // let the render thread catch up with the last frame, every frame is rendered or skipped
+        do {
+            std::this_thread::yield();
+            stats = renderThread.getStats();
+        } while (stats.rendered + stats.skipped < kFrameCount);
+    }
+    // the render thread has been joined, its results are safe to read
+    errors += lastFrame != kFrameCount - 1;
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    double serialSeconds = kFrameCount * std::chrono::duration<double>(kSimulateCost + kRenderCost).count();
+
+    printf("published %llu  rendered %llu  skipped %llu\n",
+           (unsigned long long) stats.published, (unsigned long long) stats.rendered,
+           (unsigned long long) stats.skipped);
+    printf("pipelined %.1f frames/s simulated, %.1f frames/s rendered, serial would be %.1f\n",
+           kFrameCount / seconds, stats.rendered / seconds, kFrameCount / serialSeconds);
+    printf("%llu bad snapshots\n", (unsigned long long) errors);
+    return errors == 0 && paced ? 0 : 1;
+}
@@ -0,0 +1,615 @@
+/*!
+ * Renders the cube scene offscreen, without a device or a window, on whatever GLES driver EGL
+ * finds (Mesa's llvmpipe on a build machine). Prints frame time statistics and can write the last
+ * frame out or compare it against a golden image, for the performance regression pipeline.
+ *
+ *  cube_headless [--size 1280x720] [--frames 300] [--warmup 10] [--cubes 1] [--assets DIR|FILE.pack]
+ *                [--write-image out.ppm] [--golden golden.ppm] [--tolerance 2]
+ *                [--scale 1.0 | --target-fps 60] [--lights 0] [--fog 0] [--program-cache DIR]
+ *                [--texture PATH]... [--texture-budget 2048] [--texture-error 0] [--texture-failures 0]
+ *                [--cached-texture PATH]... [--texture-cache 65536] [--check-etc2 FILE.ktx2]... [--help]
+ *
+ * Frames are deterministic: frame n shows the cube turned by n * 0.02 radians. Each frame is
+ * timed from render() to the end of a glFinish(). Shaders build in the background, the run waits
+ * for them before the first frame and reports how long that took on top of the startup.
+ *
+ *  --size              framebuffer size
+ *  --frames            frames timed
+ *  --warmup            frames drawn untimed before them
+ *  --cubes             cubes in the scene
+ *  --assets            a directory or an asset pack, e.g. the assets.pack the host build makes
+ *  --write-image       writes the last frame out
+ *  --golden            compares the last frame with a reference, tools/golden holds them
+ *  --tolerance         how far a channel may differ from the golden or the ETC2 decode
+ *  --scale             draws at a fixed fraction of the size and upscales
+ *  --target-fps        lets the resolution governor pick the scale, reports how it moved
+ *  --lights            colored point lights around the cubes, for the clustered lighting
+ *  --fog               fog density; --lights and --fog switch to the shader variants with them
+ *  --program-cache     keeps linked programs in DIR, run twice to see a warm cache's startup
+ *  --texture           streamed in with TextureStreamer during the frames, may be repeated
+ *  --texture-budget    KiB uploaded per frame at most
+ *  --texture-error     8 bit steps a texel may change by to fit a smaller format
+ *  --texture-failures  how many --texture loads are expected to fail
+ *  --cached-texture    loaded up front through a TextureCache, a repeated path is a hit
+ *  --texture-cache     the cache's budget in KiB, checked once the textures are let go
+ *  --check-etc2        uploads a KTX2 from texture_encoder, reads it back, compares with Etc2Codec
+ *  --help              prints the usage
+ *
+ * Textures still streaming after the last frame are waited for. Exits non-zero if:
+ *  - the golden comparison fails
+ *  - the camera, which never moves, is rebuilt or uploaded after the first frame
+ *  - other than --texture-failures textures fail, any is left streaming, or a frame exceeds the budget
+ *  - a cached texture fails, hits and misses aren't the repeated and distinct paths, the cache stays
+ *    over budget, or the most recently used texture was evicted although it fits
+ *  - an ETC2 level read back differs from the decode; sRGB files may be off by a rounding step
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "AssetLoader.h"
+#include "AssetPack.h"
+#include "CompressedTexture.h"
+#include "Etc2Codec.h"
+#include "PngImageDecoder.h"
+#include "Renderer.h"
+#include "TextureCache.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// a golden comparison fails when more than this fraction of pixels is off by more than the tolerance
+constexpr double kMaxMismatchFraction = 0.001;
+// how long textures still streaming after the timed frames are waited for
+constexpr auto kStreamTimeout = std::chrono::seconds(60);
+
+struct Options {
+    int width = 1280;
+    int height = 720;
+    int frames = 300;
+    int warmup = 10;
+    int cubes = 1;
+    std::string assets = DEFAULT_ASSET_DIR;
+    std::string writeImage;
+    std::string golden;
+    int tolerance = 2;
+    float scale = 1.0f;
+    float targetFps = 0.0f;
+    int lights = 0;
+    float fog = 0.0f;
+    std::string programCache;
+    std::vector<std::string> textures;
+    size_t textureBudgetKib = 2048;
+    uint32_t textureError = 0;
+    int textureFailures = 0;
+    std::vector<std::string> cachedTextures;
+    size_t textureCacheKib = 65536;
+    std::vector<std::string> etc2Checks;
+    bool help = false;
+};
+
+const char *const kUsage =
+        "usage: cube_headless [--size 1280x720] [--frames 300] [--warmup 10] [--cubes 1] [--assets DIR|FILE.pack]\n"
+        "                     [--write-image out.ppm] [--golden golden.ppm] [--tolerance 2]\n"
+        "                     [--scale 1.0 | --target-fps 60] [--lights 0] [--fog 0] [--program-cache DIR]\n"
+        "                     [--texture PATH]... [--texture-budget 2048] [--texture-error 0] [--texture-failures 0]\n"
+        "                     [--cached-texture PATH]... [--texture-cache 65536] [--check-etc2 FILE.ktx2]...\n"
+        "                     [--help]\n"
+        "see the top of HeadlessRenderer.cpp for what they do\n";
+
+bool parse(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            options.help = true;
+            return true;
+        }
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            fprintf(stderr, "%s needs a value\n", arg.c_str());
+            return false;
+        }
+        i++;
+        if (arg == "--size") {
+            if (sscanf(value, "%dx%d", &options.width, &options.height) != 2) {
+                return false;
+            }
+        } else if (arg == "--frames") {
+            options.frames = atoi(value);
+        } else if (arg == "--warmup") {
+            options.warmup = atoi(value);
+        } else if (arg == "--cubes") {
+            options.cubes = std::max(1, atoi(value));
+        } else if (arg == "--assets") {
+            options.assets = value;
+        } else if (arg == "--write-image") {
+            options.writeImage = value;
+        } else if (arg == "--golden") {
+            options.golden = value;
+        } else if (arg == "--tolerance") {
+            options.tolerance = atoi(value);
+        } else if (arg == "--scale") {
+            options.scale = static_cast<float>(atof(value));
+        } else if (arg == "--program-cache") {
+            options.programCache = value;
+        } else if (arg == "--lights") {
+            options.lights = std::max(0, atoi(value));
+        } else if (arg == "--texture") {
+            options.textures.emplace_back(value);
+        } else if (arg == "--texture-budget") {
+            options.textureBudgetKib = std::max(1, atoi(value));
+        } else if (arg == "--texture-failures") {
+            options.textureFailures = std::max(0, atoi(value));
+        } else if (arg == "--texture-error") {
+            options.textureError = static_cast<uint32_t>(std::max(0, atoi(value)));
+        } else if (arg == "--cached-texture") {
+            options.cachedTextures.emplace_back(value);
+        } else if (arg == "--texture-cache") {
+            options.textureCacheKib = std::max(0, atoi(value));
+        } else if (arg == "--check-etc2") {
+            options.etc2Checks.emplace_back(value);
+        } else if (arg == "--fog") {
+            options.fog = std::max(0.0f, static_cast<float>(atof(value)));
+        } else if (arg == "--target-fps") {
+            options.targetFps = static_cast<float>(atof(value));
+        } else {
+            fprintf(stderr, "unknown option %s\n", arg.c_str());
+            return false;
+        }
+    }
+    return options.width > 0 && options.height > 0 && options.frames > 0;
+}
+
+/*!
+ * Binary PPM, RGB only: alpha is always opaque for this scene
+ */
+bool writePpm(const std::string &path, int width, int height, const std::vector<uint8_t> &rgba) {
+    std::ofstream file(path, std::ios::binary);
+    file << "P6\n" << width << " " << height << "\n255\n";
+    for (size_t i = 0; i < rgba.size(); i += 4) {
+        file.write(reinterpret_cast<const char *>(&rgba[i]), 3);
+    }
+    return static_cast<bool>(file);
+}
+
+bool readPpm(const std::string &path, int &width, int &height, std::vector<uint8_t> &rgb) {
+    std::ifstream file(path, std::ios::binary);
+    std::string magic;
+    int maxValue = 0;
+    file >> magic >> width >> height >> maxValue;
+    file.get();
+    if (!file || magic != "P6" || maxValue != 255) {
+        return false;
+    }
+    rgb.resize(size_t(width) * height * 3);
+    file.read(reinterpret_cast<char *>(rgb.data()), rgb.size());
+    return static_cast<bool>(file);
+}
+
+/*!
+ * Spreads extra cubes over a grid behind the first one so the scene can be made heavier
+ */
+void addCubes(Renderer &renderer, int count) {
+    int side = static_cast<int>(std::ceil(std::cbrt(count - 1)));
+    for (int i = 1; i < count; i++) {
+        int x = (i - 1) % side;
+        int y = (i - 1) / side % side;
+        int z = (i - 1) / (side * side);
+        glm::vec3 position(x - side * 0.5f, y - side * 0.5f, -2.0f - z);
+        glm::mat4 model = glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(0.4f));
+        renderer.addCube(model, glm::vec3(0.3f + 0.7f * x / side, 0.5f, 0.3f + 0.7f * y / side));
+    }
+}
+
+/*!
+ * Scatters small colored lights through the volume the cubes from @a addCubes fill
+ */
+void addLights(Renderer &renderer, int count, int cubes) {
+    const float side = std::max(1.0f, std::ceil(std::cbrt(float(cubes - 1))));
+    for (int i = 0; i < count; i++) {
+        // a fixed, well spread sequence so frames stay deterministic
+        float u = std::fmod(i * 0.618034f, 1.0f);
+        float v = std::fmod(i * 0.754878f, 1.0f);
+        float w = std::fmod(i * 0.569840f, 1.0f);
+        PointLight light;
+        light.position = glm::vec3((u - 0.5f) * (side + 2.0f), (v - 0.5f) * (side + 2.0f), 1.0f - w * (side + 2.0f));
+        light.radius = 1.5f;
+        light.color = glm::vec3(0.5f + 0.5f * std::sin(i * 2.1f), 0.5f + 0.5f * std::sin(i * 2.1f + 2.1f),
+                                0.5f + 0.5f * std::sin(i * 2.1f + 4.2f));
+        light.intensity = 2.0f;
+        renderer.addLight(light);
+    }
+}
+
+GLuint compileShader(GLenum type, const char *source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+    return shader;
+}
+
+/*!
+ * Uploads the ETC2 KTX2 file at @a path and compares what texelFetch returns for every level with
+ * Etc2Codec's decode of the same blocks. Leaves GL state changed, run it after the frames.
+ * @return false if the file can't be read or any texel differs by more than @a tolerance
+ */
+bool checkEtc2(const std::string &path, int tolerance) {
+    std::ifstream file(path, std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    CompressedTexture texture(contents);
+    if (!file || !texture.isValid() || texture.getFormat().astc) {
+        fprintf(stderr, "%s isn't an ETC2 KTX2 file\n", path.c_str());
+        return false;
+    }
+    const CompressedTexture::Format &format = texture.getFormat();
+    const bool alpha = format.blockBytes == 2 * Etc2Codec::kBlockBytes;
+
+    // a full screen triangle strip, each fragment fetches its own texel
+    const char *vertexSource = "#version 300 es\n"
+                               "void main() {\n"
+                               "    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n"
+                               "    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);\n"
+                               "}\n";
+    const char *fragmentSource = "#version 300 es\n"
+                                 "precision highp float;\n"
+                                 "uniform highp sampler2D uTexture;\n"
+                                 "uniform int uLevel;\n"
+                                 "out vec4 outColor;\n"
+                                 "void main() {\n"
+                                 "    outColor = texelFetch(uTexture, ivec2(gl_FragCoord.xy), uLevel);\n"
+                                 "}\n";
+    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource);
+    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glLinkProgram(program);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    GLuint vertexArray;
+    glGenVertexArrays(1, &vertexArray);
+    GLuint framebuffer;
+    glGenFramebuffers(1, &framebuffer);
+
+    GLuint compressed = texture.upload();
+    glUseProgram(program);
+    glBindVertexArray(vertexArray);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glUniform1i(glGetUniformLocation(program, "uTexture"), 0);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+    glDisable(GL_CULL_FACE);
+    glDisable(GL_SCISSOR_TEST);
+
+    size_t mismatched = 0;
+    int worst = 0;
+    std::vector<uint8_t> pixels;
+    for (uint32_t level = 0; level < texture.getLevelCount(); level++) {
+        const uint32_t width = texture.getLevelWidth(level);
+        const uint32_t height = texture.getLevelHeight(level);
+        // sRGB texels are decoded to linear by the fetch and encoded again on the way out
+        GLuint target;
+        glGenTextures(1, &target);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, target);
+        glTexStorage2D(GL_TEXTURE_2D, 1, format.srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8, width, height);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target, 0);
+        glBindTexture(GL_TEXTURE_2D, compressed);
+        glUniform1i(glGetUniformLocation(program, "uLevel"), static_cast<GLint>(level));
+        glViewport(0, 0, width, height);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        pixels.resize(size_t(width) * height * 4);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        glDeleteTextures(1, &target);
+
+        const auto *blocks = reinterpret_cast<const uint8_t *>(texture.getLevel(level).data());
+        const uint32_t blocksWide = (width + 3) / 4;
+        for (uint32_t blockY = 0; blockY < (height + 3) / 4; blockY++) {
+            for (uint32_t blockX = 0; blockX < blocksWide; blockX++) {
+                const uint8_t *block = blocks + (size_t(blockY) * blocksWide + blockX) * format.blockBytes;
+                uint8_t texels[Etc2Codec::kBlockTexels * 4];
+                if (alpha) {
+                    Etc2Codec::decodeAlpha(block, texels);
+                    Etc2Codec::decodeColor(block + Etc2Codec::kBlockBytes, texels);
+                } else {
+                    Etc2Codec::decodeColor(block, texels);
+                    for (size_t i = 0; i < Etc2Codec::kBlockTexels; i++) {
+                        texels[i * 4 + 3] = 255;
+                    }
+                }
+                // the fetch's rows start at the bottom of the framebuffer, which is row 0 of the
+                // level, so block rows and read back rows line up
+                for (uint32_t y = blockY * 4; y < std::min(height, blockY * 4 + 4); y++) {
+                    for (uint32_t x = blockX * 4; x < std::min(width, blockX * 4 + 4); x++) {
+                        const uint8_t *expected = &texels[((y % 4) * 4 + x % 4) * 4];
+                        const uint8_t *fetched = &pixels[(size_t(y) * width + x) * 4];
+                        int difference = 0;
+                        for (int channel = 0; channel < 4; channel++) {
+                            difference = std::max(difference, std::abs(fetched[channel] - expected[channel]));
+                        }
+                        worst = std::max(worst, difference);
+                        mismatched += difference > tolerance;
+                    }
+                }
+            }
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteVertexArrays(1, &vertexArray);
+    glDeleteProgram(program);
+    glDeleteTextures(1, &compressed);
+    const bool passed = mismatched == 0 && glGetError() == GL_NO_ERROR;
+    printf("%s: %u levels of %s%s, GPU decode %s Etc2Codec: %zu texels over tolerance %d, worst difference %d\n",
+           path.c_str(), texture.getLevelCount(), alpha ? "ETC2 RGBA" : "ETC2 RGB", format.srgb ? " sRGB" : "",
+           passed ? "matches" : "DIFFERS from", mismatched, tolerance, worst);
+    return passed;
+}
+
+double percentile(std::vector<double> sorted, double fraction) {
+    size_t index = std::min(sorted.size() - 1, static_cast<size_t>(fraction * sorted.size()));
+    return sorted[index];
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parse(argc, argv, options)) {
+        fprintf(stderr, "%s", kUsage);
+        return 2;
+    }
+    if (options.help) {
+        printf("%s", kUsage);
+        return 0;
+    }
+
+    // a .pack is mapped and read in place, anything else is a directory of loose files
+    std::unique_ptr<AssetLoader> assets;
+    if (options.assets.size() > 5 && options.assets.compare(options.assets.size() - 5, 5, ".pack") == 0) {
+        assets = AssetPack::openFile(options.assets);
+        if (!assets) {
+            fprintf(stderr, "couldn't open %s\n", options.assets.c_str());
+            return 1;
+        }
+    } else {
+        assets = std::make_unique<FileAssetLoader>(options.assets);
+    }
+    auto startupBegin = Clock::now();
+    Renderer renderer(*assets, options.width, options.height, options.programCache);
+    double startupMs = std::chrono::duration<double, std::milli>(Clock::now() - startupBegin).count();
+    printf("%s, %s\n", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+    const auto &programs = renderer.getProgramCache().getStats();
+    printf("renderer up in %.1f ms, program cache: %llu hits, %llu misses, %llu rejected\n", startupMs,
+           static_cast<unsigned long long>(programs.hits), static_cast<unsigned long long>(programs.misses),
+           static_cast<unsigned long long>(programs.rejected));
+    addCubes(renderer, options.cubes);
+    addLights(renderer, options.lights, options.cubes);
+    renderer.setFog(glm::vec3(0.2f), options.fog);
+    // frames are compared and timed with the final shaders, not the loading state
+    auto loadingBegin = Clock::now();
+    renderer.finishLoading();
+    printf("shaders finished %.1f ms later\n",
+           std::chrono::duration<double, std::milli>(Clock::now() - loadingBegin).count());
+    if (options.targetFps > 0.0f) {
+        renderer.setDynamicResolution(options.targetFps);
+    } else {
+        renderer.setResolutionScale(options.scale);
+    }
+
+    // requested now, resident some frames into the run
+    std::vector<TextureStreamer::Handle> textures;
+    int texturesResidentFrame = -1;
+    if (!options.textures.empty()) {
+        TextureStreamer::Config config;
+        config.uploadBudget = options.textureBudgetKib * 1024;
+        config.formats.maxError = options.textureError;
+        renderer.setTextureSource(*assets, std::make_unique<PngImageDecoder>(), config);
+        for (const auto &path: options.textures) {
+            textures.push_back(renderer.getTextures()->request(path));
+        }
+    }
+    if (!options.cachedTextures.empty()) {
+        TextureCache::Config config;
+        config.budgetBytes = options.textureCacheKib * 1024;
+        TextureCache cache(*assets, renderer.getResources(), std::make_unique<PngImageDecoder>(), config);
+        std::vector<TextureHandle> held;
+        auto loadBegin = Clock::now();
+        for (const auto &path: options.cachedTextures) {
+            held.push_back(cache.get(path));
+        }
+        const double loadMs = std::chrono::duration<double, std::milli>(Clock::now() - loadBegin).count();
+        const auto &stats = cache.getStats();
+        printf("texture cache: %zu loads in %.1f ms, %llu hits, %llu misses, %zu textures, %.1f KiB resident",
+               held.size(), loadMs, static_cast<unsigned long long>(stats.hits),
+               static_cast<unsigned long long>(stats.misses), stats.textures, stats.bytesResident / 1024.0);
+        const auto first = options.cachedTextures.begin();
+        size_t unique = 0;
+        for (auto path = first; path != options.cachedTextures.end(); ++path) {
+            unique += std::find(first, path, *path) == path;
+        }
+        // the last one loaded is the most recently used, so it's the last to be evicted
+        const TextureAsset *last = renderer.getResources().getTextures().get(held.back());
+        const size_t lastBytes = last ? last->getVramBytes() : 0;
+        for (TextureHandle texture: held) {
+            cache.release(texture);
+        }
+        cache.trim();
+        printf("; let go: %zu textures, %.1f KiB resident, %llu evicted\n", stats.textures,
+               stats.bytesResident / 1024.0, static_cast<unsigned long long>(stats.evictions));
+
+        if (std::find(held.begin(), held.end(), TextureHandle()) != held.end()) {
+            fprintf(stderr, "a cached texture failed to load\n");
+            return 1;
+        }
+        if (stats.misses != unique || stats.hits != held.size() - unique) {
+            fprintf(stderr, "%zu paths, %zu of them repeated, should be as many misses and hits\n", unique,
+                    held.size() - unique);
+            return 1;
+        }
+        if (stats.bytesResident > config.budgetBytes) {
+            fprintf(stderr, "texture cache over its budget with nothing in use\n");
+            return 1;
+        }
+        if (lastBytes <= config.budgetBytes) {
+            const uint64_t hits = stats.hits;
+            cache.release(cache.get(options.cachedTextures.back()));
+            if (stats.hits != hits + 1) {
+                fprintf(stderr, "%s was evicted before textures used less recently\n",
+                        options.cachedTextures.back().c_str());
+                return 1;
+            }
+        }
+    }
+
+    FrameSnapshot snapshot;
+    std::vector<double> times;
+    float lowestScale = renderer.getResolutionScale();
+    Camera::Stats firstFrameCamera;
+    uint64_t firstFrameCameraWrites = 0;
+    for (int frame = 0; frame < options.warmup + options.frames; frame++) {
+        snapshot.frame = frame;
+        snapshot.cubeRotation = glm::angleAxis(frame * 0.02f, glm::vec3(0.0f, 1.0f, 0.0f));
+        auto start = Clock::now();
+        renderer.render(snapshot);
+        glFinish();
+        if (frame == 0) {
+            firstFrameCamera = renderer.getCamera().getStats();
+            firstFrameCameraWrites = renderer.getCameraRing().getWriteCount();
+        }
+        if (texturesResidentFrame < 0 && renderer.getTextures() && renderer.getTextures()->getPendingCount() == 0) {
+            texturesResidentFrame = frame;
+        }
+        if (frame >= options.warmup) {
+            times.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+            lowestScale = std::min(lowestScale, renderer.getResolutionScale());
+        }
+    }
+
+    // textures still streaming are waited for, drawing the last frame again, so their counts are final
+    const auto streamDeadline = Clock::now() + kStreamTimeout;
+    for (int frame = options.warmup + options.frames;
+         renderer.getTextures() && renderer.getTextures()->getPendingCount() > 0 && Clock::now() < streamDeadline;
+         frame++) {
+        renderer.render(snapshot);
+        glFinish();
+        if (renderer.getTextures()->getPendingCount() == 0) {
+            texturesResidentFrame = frame;
+        }
+    }
+
+    std::sort(times.begin(), times.end());
+    double mean = 0.0;
+    for (double time: times) {
+        mean += time;
+    }
+    mean /= times.size();
+    // nothing moves the camera, every frame after the first should reuse its matrices and block
+    const Camera::Stats &camera = renderer.getCamera().getStats();
+    const uint64_t cameraRebuilds = camera.viewRebuilds + camera.projectionRebuilds + camera.viewProjectionRebuilds
+                                    - firstFrameCamera.viewRebuilds - firstFrameCamera.projectionRebuilds
+                                    - firstFrameCamera.viewProjectionRebuilds;
+    const uint64_t cameraWrites = renderer.getCameraRing().getWriteCount() - firstFrameCameraWrites;
+    printf("camera after the first frame: %llu updates, %llu matrix rebuilds, %llu uploads\n",
+           static_cast<unsigned long long>(camera.updates - firstFrameCamera.updates),
+           static_cast<unsigned long long>(cameraRebuilds), static_cast<unsigned long long>(cameraWrites));
+    if (cameraRebuilds != 0 || cameraWrites != 0) {
+        fprintf(stderr, "the camera didn't move but was rebuilt or uploaded again\n");
+        return 1;
+    }
+    printf("shader variants: cube_shader %zu built, %zu on first use; lamp_shader %zu built, %zu on first use\n",
+           renderer.getCubeShader().getBuiltCount(), renderer.getCubeShader().getStats().builtOnUse,
+           renderer.getLampShader().getBuiltCount(), renderer.getLampShader().getStats().builtOnUse);
+    if (!textures.empty()) {
+        const auto &stats = renderer.getTextures()->getStats();
+        printf("%zu textures: %zu resident, %zu failed, done after frame %d; %.1f KiB uploaded, at most %.1f KiB in a frame, %llu frames waited on a staging buffer, %.1f KiB of VRAM saved\n",
+               textures.size(), stats.resident, stats.failed, texturesResidentFrame, stats.bytesUploaded / 1024.0,
+               stats.peakFrameBytes / 1024.0, static_cast<unsigned long long>(stats.stalledFrames),
+               stats.bytesSaved / 1024.0);
+        if (stats.failed != size_t(options.textureFailures)) {
+            fprintf(stderr, "%zu textures failed to load, expected %d\n", stats.failed, options.textureFailures);
+            return 1;
+        }
+        if (stats.resident + stats.failed != textures.size()) {
+            fprintf(stderr, "%zu textures still streaming after %lld s\n", textures.size() - stats.resident - stats.failed,
+                    static_cast<long long>(kStreamTimeout.count()));
+            return 1;
+        }
+        const size_t budget = renderer.getTextures()->getConfig().uploadBudget;
+        if (stats.peakFrameBytes > budget) {
+            fprintf(stderr, "a frame uploaded %zu bytes, over the budget of %zu\n", stats.peakFrameBytes, budget);
+            return 1;
+        }
+    }
+    if (options.lights > 0) {
+        const auto &stats = renderer.getLightClusters().getStats();
+        printf("%d lights: %zu visible, %zu cluster entries, at most %zu in a cluster\n",
+               options.lights, stats.lights, stats.indices, stats.busiestCluster);
+    }
+    printf("%dx%d, %d cubes, %zu frames: mean %.3f ms  median %.3f ms  p95 %.3f ms  p99 %.3f ms  max %.3f ms  (%.1f fps)\n",
+           options.width, options.height, options.cubes, times.size(), mean, percentile(times, 0.5),
+           percentile(times, 0.95), percentile(times, 0.99), times.back(), 1000.0 / mean);
+    if (options.targetFps > 0.0f) {
+        const auto &stats = renderer.getResolutionGovernor().getStats();
+        printf("dynamic resolution for %.0f fps: scale %.2f at the end, lowest %.2f, %llu steps down, %llu up\n",
+               options.targetFps, renderer.getResolutionScale(), lowestScale,
+               static_cast<unsigned long long>(stats.scaleDowns), static_cast<unsigned long long>(stats.scaleUps));
+    } else if (options.scale != 1.0f) {
+        printf("scene drawn at %.2f scale and upscaled\n", renderer.getResolutionScale());
+    }
+
+    std::vector<uint8_t> pixels;
+    renderer.readPixels(pixels);
+    if (!options.writeImage.empty()) {
+        if (!writePpm(options.writeImage, options.width, options.height, pixels)) {
+            fprintf(stderr, "couldn't write %s\n", options.writeImage.c_str());
+            return 1;
+        }
+        printf("wrote %s\n", options.writeImage.c_str());
+    }
+
+    if (!options.golden.empty()) {
+        int width = 0, height = 0;
+        std::vector<uint8_t> golden;
+        if (!readPpm(options.golden, width, height, golden)) {
+            fprintf(stderr, "couldn't read %s\n", options.golden.c_str());
+            return 1;
+        }
+        if (width != options.width || height != options.height) {
+            fprintf(stderr, "golden is %dx%d, rendered %dx%d\n", width, height, options.width, options.height);
+            return 1;
+        }
+        size_t mismatched = 0;
+        int worst = 0;
+        for (size_t pixel = 0; pixel < size_t(width) * height; pixel++) {
+            int difference = 0;
+            for (int channel = 0; channel < 3; channel++) {
+                difference = std::max(difference, std::abs(pixels[pixel * 4 + channel] - golden[pixel * 3 + channel]));
+            }
+            worst = std::max(worst, difference);
+            mismatched += difference > options.tolerance;
+        }
+        double fraction = double(mismatched) / (size_t(width) * height);
+        bool passed = fraction <= kMaxMismatchFraction;
+        printf("golden %s: %zu pixels over tolerance %d (%.4f%%), worst difference %d\n",
+               passed ? "matches" : "DIFFERS", mismatched, options.tolerance, fraction * 100.0, worst);
+        if (!passed) {
+            return 1;
+        }
+    }
+
+    bool etc2Matches = true;
+    for (const auto &path: options.etc2Checks) {
+        etc2Matches = checkEtc2(path, options.tolerance) && etc2Matches;
+    }
+    return etc2Matches ? 0 : 1;
+}
@@ -0,0 +1,144 @@
+/*!
+ * Host benchmark for LightClusters. Scatters point lights in front of a camera, checks the SIMD
+ * assignment gives the same lists as the scalar one and that every light reaching a random point
+ * is in that point's cluster, then prints the time per assignment for both and how many lights a
+ * fragment would loop over against the total.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "LightClusters.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kRepeats = 200;
+constexpr int kSamplePoints = 100000;
+constexpr float kFovY = 1.0471976f;
+constexpr float kAspect = 16.0f / 9.0f;
+constexpr float kNear = 0.1f;
+constexpr float kFar = 100.0f;
+
+/*!
+ * Runs @a assign kRepeats times and prints the best and mean time
+ */
+template<typename Assign>
+void measure(const char *name, size_t lightCount, Assign assign) {
+    double best = 1e9;
+    double total = 0.0;
+    for (int repeat = 0; repeat < kRepeats; repeat++) {
+        auto start = Clock::now();
+        assign();
+        double elapsed = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+        best = std::min(best, elapsed);
+        total += elapsed;
+    }
+    printf("  %-8s best %8.2f us  mean %8.2f us  (%.1f ns/light)\n",
+           name, best, total / kRepeats, best * 1000.0 / lightCount);
+}
+
+/*!
+ * The cluster a view space point falls in, the way cube_shader.frag finds it
+ */
+int clusterOf(const LightClusters &clusters, const glm::mat4 &projection, const glm::vec3 &viewPoint) {
+    glm::vec4 clip = projection * glm::vec4(viewPoint, 1.0f);
+    glm::vec2 ndc = glm::vec2(clip) / clip.w;
+    int tileX = std::clamp(int((ndc.x * 0.5f + 0.5f) * LightClusters::kTilesX), 0, LightClusters::kTilesX - 1);
+    int tileY = std::clamp(int((ndc.y * 0.5f + 0.5f) * LightClusters::kTilesY), 0, LightClusters::kTilesY - 1);
+    int slice = int(std::floor(std::log(-viewPoint.z) * clusters.getSliceScale() + clusters.getSliceBias()));
+    slice = std::clamp(slice, 0, LightClusters::kSlices - 1);
+    return LightClusters::clusterIndex(tileX, tileY, slice);
+}
+
+bool run(size_t lightCount, std::mt19937 &random) {
+    std::uniform_real_distribution<float> across(-20.0f, 20.0f);
+    std::uniform_real_distribution<float> depth(-40.0f, 0.0f);
+    std::uniform_real_distribution<float> radius(0.5f, 4.0f);
+    std::vector<PointLight> lights(lightCount);
+    for (auto &light: lights) {
+        light.position = glm::vec3(across(random), across(random) * 0.5f, depth(random));
+        light.radius = radius(random);
+        light.color = glm::vec3(1.0f);
+        light.intensity = 1.0f;
+    }
+
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(kFovY, kAspect, kNear, kFar);
+    LightClusters simd, scalar;
+    simd.setProjection(kFovY, kAspect, kNear, kFar);
+    scalar.setProjection(kFovY, kAspect, kNear, kFar);
+    simd.assign(view, lights.data(), lights.size());
+    scalar.assignScalar(view, lights.data(), lights.size());
+
+    bool passed = simd.getLightIndices() == scalar.getLightIndices();
+    for (int i = 0; passed && i < LightClusters::kClusterCount; i++) {
+        passed = simd.getClusters()[i].offset == scalar.getClusters()[i].offset
+                 && simd.getClusters()[i].count == scalar.getClusters()[i].count;
+    }
+    if (!passed) {
+        printf("%zu lights: SIMD and scalar lists differ\n", lightCount);
+        return false;
+    }
+
+    // Any point a light reaches must find the light in its cluster. Points are picked close to
+    // lights so most of them are lit at all
+    std::uniform_int_distribution<size_t> pickLight(0, lightCount - 1);
+    std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+    size_t missing = 0, lit = 0, checked = 0;
+    const auto &clusters = simd.getClusters();
+    const auto &indices = simd.getLightIndices();
+    for (int sample = 0; sample < kSamplePoints; sample++) {
+        const PointLight &near = lights[pickLight(random)];
+        glm::vec3 world = near.position + glm::vec3(offset(random), offset(random), offset(random)) * near.radius;
+        glm::vec3 viewPoint = glm::vec3(view * glm::vec4(world, 1.0f));
+        glm::vec4 clip = projection * glm::vec4(viewPoint, 1.0f);
+        if (-viewPoint.z < kNear || -viewPoint.z > kFar
+            || std::abs(clip.x) > clip.w || std::abs(clip.y) > clip.w) {
+            continue;
+        }
+        checked++;
+        const auto &cluster = clusters[clusterOf(simd, projection, viewPoint)];
+        for (size_t light = 0; light < lightCount; light++) {
+            // a hair inside the radius, right at it the light contributes nothing anyway
+            if (glm::length(world - lights[light].position) >= lights[light].radius * 0.999f) {
+                continue;
+            }
+            lit++;
+            auto begin = indices.begin() + cluster.offset;
+            if (!std::binary_search(begin, begin + cluster.count, static_cast<uint8_t>(light))) {
+                missing++;
+            }
+        }
+    }
+
+    const auto &stats = simd.getStats();
+    size_t used = 0;
+    for (const auto &cluster: clusters) {
+        used += cluster.count > 0;
+    }
+    printf("%zu lights: %zu visible, %zu indices, %.2f lights per used cluster, busiest %zu, %zu dropped\n",
+           lightCount, stats.lights, stats.indices, used ? double(stats.indices) / used : 0.0,
+           stats.busiestCluster, stats.dropped);
+    printf("  %zu points checked, %zu light hits, %zu missing from their cluster\n", checked, lit, missing);
+
+    measure("scalar", lightCount, [&]() { scalar.assignScalar(view, lights.data(), lights.size()); });
+    measure("simd", lightCount, [&]() { simd.assign(view, lights.data(), lights.size()); });
+    return missing == 0;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 random(42);
+    bool passed = true;
+    for (size_t lightCount: {16, 64, 256}) {
+        passed &= run(lightCount, random);
+    }
+    return passed ? 0 : 1;
+}
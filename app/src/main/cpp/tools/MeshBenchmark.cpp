@@ -0,0 +1,130 @@
+/*!
+ * Host benchmark for MeshBuilder. Builds a few triangle soups, runs the optimizer over them and
+ * reports post-transform cache efficiency before and after, along with how long each step takes.
+ * Fails if the indices don't survive packing, the grid has too many vertices for 16 bits.
+ */
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <glm/gtc/constants.hpp>
+
+#include "MeshBuilder.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+/*!
+ * A width x height grid of quads, two triangles each, with the triangle order shuffled the way an
+ * exporter that doesn't care about ordering might leave it
+ */
+std::vector<MeshVertex> makeShuffledGrid(int width, int height) {
+    std::vector<MeshVertex> soup;
+    soup.reserve(width * height * 6);
+    auto vertex = [width, height](int x, int y) {
+        return MeshVertex{glm::vec3(float(x), 0.0f, float(y)),
+                          glm::vec3(0.0f, 1.0f, 0.0f),
+                          glm::vec2(float(x) / width, float(y) / height)};
+    };
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            MeshVertex quad[6] = {
+                    vertex(x, y), vertex(x, y + 1), vertex(x + 1, y),
+                    vertex(x + 1, y), vertex(x, y + 1), vertex(x + 1, y + 1)};
+            soup.insert(soup.end(), quad, quad + 6);
+        }
+    }
+
+    std::mt19937 random(1234);
+    size_t triangleCount = soup.size() / 3;
+    for (size_t t = triangleCount - 1; t > 0; t--) {
+        size_t other = std::uniform_int_distribution<size_t>(0, t)(random);
+        for (int corner = 0; corner < 3; corner++) {
+            std::swap(soup[t * 3 + corner], soup[other * 3 + corner]);
+        }
+    }
+    return soup;
+}
+
+/*!
+ * A UV sphere with smooth normals, triangles in the usual ring by ring order
+ */
+std::vector<MeshVertex> makeSphere(int rings, int segments) {
+    auto vertex = [rings, segments](int ring, int segment) {
+        float theta = glm::pi<float>() * float(ring) / float(rings);
+        float phi = 2.0f * glm::pi<float>() * float(segment % segments) / float(segments);
+        glm::vec3 normal(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+        return MeshVertex{normal, normal, glm::vec2(float(segment) / segments, float(ring) / rings)};
+    };
+    std::vector<MeshVertex> soup;
+    for (int ring = 0; ring < rings; ring++) {
+        for (int segment = 0; segment < segments; segment++) {
+            MeshVertex quad[6] = {
+                    vertex(ring, segment), vertex(ring + 1, segment), vertex(ring, segment + 1),
+                    vertex(ring, segment + 1), vertex(ring + 1, segment), vertex(ring + 1, segment + 1)};
+            soup.insert(soup.end(), quad, quad + 6);
+        }
+    }
+    return soup;
+}
+
+/*!
+ * @return false if the packed indices don't match
+ */
+bool report(const char *name, const std::vector<MeshVertex> &soup) {
+    auto start = Clock::now();
+    MeshData welded = MeshBuilder::weld(soup.data(), soup.size());
+    double weldTime = millisecondsSince(start);
+
+    MeshData optimized = welded;
+    start = Clock::now();
+    MeshBuilder::optimizeVertexCache(optimized.indices, optimized.vertices.size());
+    double cacheTime = millisecondsSince(start);
+    start = Clock::now();
+    MeshBuilder::optimizeOverdraw(optimized.indices, optimized.vertices);
+    double overdrawTime = millisecondsSince(start);
+    start = Clock::now();
+    MeshBuilder::optimizeVertexFetch(optimized);
+    double fetchTime = millisecondsSince(start);
+
+    printf("%s: %zu soup vertices -> %zu unique, %zu triangles\n",
+           name, soup.size(), welded.vertices.size(), welded.indices.size() / 3);
+    for (unsigned cacheSize: {16u, 32u}) {
+        VertexCacheStats before = MeshBuilder::analyzeVertexCache(
+                welded.indices, welded.vertices.size(), cacheSize);
+        VertexCacheStats after = MeshBuilder::analyzeVertexCache(
+                optimized.indices, optimized.vertices.size(), cacheSize);
+        printf("  fifo %2u  ACMR %.3f -> %.3f  ATVR %.3f -> %.3f\n",
+               cacheSize, before.acmr, after.acmr, before.atvr, after.atvr);
+    }
+    printf("  weld %.2f ms, vertex cache %.2f ms, overdraw %.2f ms, vertex fetch %.2f ms\n",
+           weldTime, cacheTime, overdrawTime, fetchTime);
+
+    // the packed indices must read back the same at whatever width was picked
+    std::vector<uint8_t> packed;
+    const size_t indexSize = MeshBuilder::packIndices(optimized, packed);
+    bool intact = indexSize == (optimized.vertices.size() < 0xffff ? 2 : 4);
+    for (size_t i = 0; intact && i < optimized.indices.size(); i++) {
+        uint32_t index = 0;
+        memcpy(&index, &packed[i * indexSize], indexSize);
+        intact = index == optimized.indices[i];
+    }
+    printf("  %zu bit indices%s\n\n", indexSize * 8, intact ? "" : "  MISMATCH");
+    return intact;
+}
+
+} // namespace
+
+int main() {
+    bool intact = report("shuffled grid 256x256", makeShuffledGrid(256, 256));
+    intact &= report("uv sphere 64x128", makeSphere(64, 128));
+    return intact ? 0 : 1;
+}
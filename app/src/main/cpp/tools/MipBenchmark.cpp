@@ -0,0 +1,181 @@
+/*!
+ * Host benchmark for MipGenerator. Builds the chain of a noisy image with cutout alpha under each
+ * filter, checks the SIMD levels match the scalar ones byte for byte, that a flat image stays
+ * flat all the way down and that an alpha cutoff keeps the coverage, then prints megapixels of
+ * source image a second for both. --quick runs the same checks on smaller images, timed once, for
+ * ctest.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "MipGenerator.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kRepeats = 5;
+// with --quick
+constexpr int kQuickRepeats = 1;
+constexpr float kCutoff = 0.5f;
+// how far a level's coverage may drift from the full size image's, as a fraction of texels
+constexpr double kCoverageTolerance = 0.02;
+
+const char *filterName(MipFilter filter) {
+    switch (filter) {
+        case MipFilter::Box:
+            return "box";
+        case MipFilter::Kaiser:
+            return "kaiser";
+        case MipFilter::Lanczos:
+            return "lanczos";
+    }
+    return "?";
+}
+
+/*!
+ * Smooth color gradients with noise on top, and alpha that is a field of opaque discs on clear,
+ * the shape of foliage cards that cutoff preservation is for
+ */
+DecodedImage makeImage(uint32_t width, uint32_t height, std::mt19937 &random) {
+    std::uniform_int_distribution<int> noise(-24, 24);
+    DecodedImage image;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(size_t(width) * height * 4);
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            uint8_t *texel = &image.pixels[(size_t(y) * width + x) * 4];
+            texel[0] = uint8_t(std::clamp(int(255 * x / width) + noise(random), 0, 255));
+            texel[1] = uint8_t(std::clamp(int(255 * y / height) + noise(random), 0, 255));
+            texel[2] = uint8_t(std::clamp(128 + noise(random) * 4, 0, 255));
+            const float u = std::fmod(x / 37.0f, 1.0f) - 0.5f;
+            const float v = std::fmod(y / 37.0f, 1.0f) - 0.5f;
+            texel[3] = u * u + v * v < 0.1f ? 255 : 0;
+        }
+    }
+    return image;
+}
+
+double coverage(const DecodedImage &image, float cutoff) {
+    size_t covered = 0;
+    const size_t texels = size_t(image.width) * image.height;
+    for (size_t i = 0; i < texels; i++) {
+        covered += image.pixels[i * 4 + 3] / 255.0f > cutoff;
+    }
+    return double(covered) / texels;
+}
+
+/*!
+ * Runs @a generate @a repeats times and prints the best time and the rate it makes of @a image
+ */
+template<typename Generate>
+void measure(const char *name, const DecodedImage &image, int repeats, Generate generate) {
+    double best = 1e9;
+    for (int repeat = 0; repeat < repeats; repeat++) {
+        auto start = Clock::now();
+        generate();
+        best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    }
+    const double megapixels = double(image.width) * image.height / 1e6;
+    printf("  %-8s best %8.2f ms  %8.1f MP/s\n", name, best, megapixels / (best / 1000.0));
+}
+
+bool run(const DecodedImage &image, MipGenerator::Options options, int repeats) {
+    MipGenerator generator(options);
+    printf("%ux%u %s%s%s\n", image.width, image.height, filterName(options.filter),
+           options.srgb ? " srgb" : " linear", options.alphaCutoff > 0.0f ? " cutoff" : "");
+
+    const auto simd = generator.generate(image);
+    const auto scalar = generator.generateScalar(image);
+    bool passed = simd.size() + 1 == MipGenerator::levelCount(image.width, image.height)
+                  && simd.size() == scalar.size();
+    for (size_t level = 0; passed && level < simd.size(); level++) {
+        passed = simd[level].width == scalar[level].width
+                 && simd[level].height == scalar[level].height
+                 && simd[level].pixels == scalar[level].pixels;
+    }
+    if (!passed) {
+        printf("  SIMD and scalar levels differ\n");
+        return false;
+    }
+
+    if (options.alphaCutoff > 0.0f) {
+        // the tiny levels can't hold the fraction to within a texel, only the ones above 16x16
+        // are held to it
+        const double target = coverage(image, options.alphaCutoff);
+        double worst = 0.0;
+        for (const auto &level: simd) {
+            if (level.width * level.height >= 256) {
+                worst = std::max(worst, std::abs(coverage(level, options.alphaCutoff) - target));
+            }
+        }
+        printf("  coverage %.3f, worst level off by %.3f\n", target, worst);
+        passed = worst <= kCoverageTolerance;
+    }
+
+    measure("scalar", image, repeats, [&]() { generator.generateScalar(image); });
+    measure("simd", image, repeats, [&]() { generator.generate(image); });
+    return passed;
+}
+
+/*!
+ * A flat image has to stay flat, whatever the filter's negative lobes and the linear round trip
+ */
+bool checkFlat(MipFilter filter) {
+    DecodedImage image;
+    image.width = 96;
+    image.height = 40;
+    image.pixels.resize(size_t(image.width) * image.height * 4);
+    for (size_t i = 0; i < image.pixels.size(); i += 4) {
+        image.pixels[i] = 200;
+        image.pixels[i + 1] = 90;
+        image.pixels[i + 2] = 17;
+        image.pixels[i + 3] = 160;
+    }
+    MipGenerator::Options options;
+    options.filter = filter;
+    for (const auto &level: MipGenerator(options).generate(image)) {
+        for (size_t i = 0; i < level.pixels.size(); i++) {
+            if (level.pixels[i] != image.pixels[i % 4]) {
+                printf("%s: flat image changed at %ux%u\n", filterName(filter), level.width, level.height);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const bool quick = argc > 1 && strcmp(argv[1], "--quick") == 0;
+    const int repeats = quick ? kQuickRepeats : kRepeats;
+    std::mt19937 random(42);
+    bool passed = true;
+    for (MipFilter filter: {MipFilter::Box, MipFilter::Kaiser, MipFilter::Lanczos}) {
+        passed &= checkFlat(filter);
+    }
+
+    // a power of two texture and an odd sized one, whose texels straddle the ones above
+    const DecodedImage square = quick ? makeImage(512, 512, random) : makeImage(2048, 2048, random);
+    const DecodedImage odd = quick ? makeImage(250, 151, random) : makeImage(1000, 601, random);
+    for (MipFilter filter: {MipFilter::Box, MipFilter::Kaiser, MipFilter::Lanczos}) {
+        MipGenerator::Options options;
+        options.filter = filter;
+        passed &= run(square, options, repeats);
+    }
+    MipGenerator::Options options;
+    options.srgb = false;
+    passed &= run(square, options, repeats);
+    options.srgb = true;
+    options.alphaCutoff = kCutoff;
+    passed &= run(square, options, repeats);
+    passed &= run(odd, options, repeats);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,21 @@
+#include "PngImageDecoder.h"
+
+#include <png.h>
+
+bool PngImageDecoder::decode(std::string_view encoded, DecodedImage &image) const {
+    // the simplified API keeps all its state in the png_image, so threads don't share anything
+    png_image png{};
+    png.version = PNG_IMAGE_VERSION;
+    if (!png_image_begin_read_from_memory(&png, encoded.data(), encoded.size())) {
+        return false;
+    }
+    png.format = PNG_FORMAT_RGBA;
+    image.width = png.width;
+    image.height = png.height;
+    image.pixels.resize(PNG_IMAGE_SIZE(png));
+    if (!png_image_finish_read(&png, nullptr, image.pixels.data(), 0, nullptr)) {
+        png_image_free(&png);
+        return false;
+    }
+    return true;
+}
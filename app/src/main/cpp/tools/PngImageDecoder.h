@@ -0,0 +1,14 @@
+#ifndef ANDROIDGLINVESTIGATIONS_PNGIMAGEDECODER_H
+#define ANDROIDGLINVESTIGATIONS_PNGIMAGEDECODER_H
+
+#include "ImageDecoder.h"
+
+/*!
+ * Decodes PNGs with libpng, the host's stand in for AndroidImageDecoder
+ */
+class PngImageDecoder : public ImageDecoder {
+public:
+    bool decode(std::string_view encoded, DecodedImage &image) const override;
+};
+
+#endif //ANDROIDGLINVESTIGATIONS_PNGIMAGEDECODER_H
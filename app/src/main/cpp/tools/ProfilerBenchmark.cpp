@@ -0,0 +1,100 @@
+/*!
+ * Host benchmark for Profiler. Records nested markers from a few threads at once while the trace is
+ * dumped, prints the cost of one PROFILE_SCOPE and writes the Chrome trace to the path given on the
+ * command line (profiler_trace.json by default) for loading into ui.perfetto.dev.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "Profiler.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kScopeCount = 1000000;
+constexpr int kThreadCount = 3;
+constexpr int kFramesPerThread = 2000;
+
+/*!
+ * A fake frame: a few nested phases with a little work in each
+ */
+void frame() {
+    PROFILE_SCOPE("frame");
+    volatile float sink = 0.0f;
+    {
+        PROFILE_SCOPE("update");
+        for (int i = 0; i < 200; i++) sink = sink + i;
+    }
+    {
+        PROFILE_SCOPE("render");
+        {
+            PROFILE_SCOPE("cull");
+            for (int i = 0; i < 100; i++) sink = sink + i;
+        }
+        PROFILE_SCOPE("submit");
+        for (int i = 0; i < 300; i++) sink = sink + i;
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : "profiler_trace.json";
+    PROFILE_THREAD("main");
+
+    // empty scopes back to back, the whole cost is the marker
+    double best = 1e9;
+    for (int repeat = 0; repeat < 5; repeat++) {
+        auto start = Clock::now();
+        for (int i = 0; i < kScopeCount; i++) {
+            PROFILE_SCOPE("empty");
+        }
+        best = std::min(best, std::chrono::duration<double, std::nano>(Clock::now() - start).count() / kScopeCount);
+    }
+    // two clock reads per scope are most of that, show how much
+    double clock = 1e9;
+    for (int repeat = 0; repeat < 5; repeat++) {
+        uint64_t sum = 0;
+        auto start = Clock::now();
+        for (int i = 0; i < kScopeCount; i++) {
+            sum += Profiler::now();
+        }
+        clock = std::min(clock, std::chrono::duration<double, std::nano>(Clock::now() - start).count() / kScopeCount);
+        if (sum == 0) printf(" ");
+    }
+    printf("PROFILE_SCOPE costs %.1f ns, of which 2 x %.1f ns reading the clock\n", best, clock);
+
+    // several threads recording while the trace is dumped under them
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreadCount; t++) {
+        threads.emplace_back([t]() {
+            static const char *names[] = {"worker 0", "worker 1", "worker 2"};
+            PROFILE_THREAD(names[t]);
+            for (int i = 0; i < kFramesPerThread; i++) {
+                frame();
+            }
+        });
+    }
+    size_t concurrentBytes = 0;
+    for (int i = 0; i < 5; i++) {
+        std::ostringstream trace;
+        Profiler::writeChromeTrace(trace);
+        concurrentBytes = std::max(concurrentBytes, trace.str().size());
+    }
+    for (auto &thread: threads) {
+        thread.join();
+    }
+    printf("dumped %zu bytes while recording\n", concurrentBytes);
+
+    if (!Profiler::writeChromeTrace(path)) {
+        printf("couldn't write %s\n", path);
+        return 1;
+    }
+    printf("wrote %s\n", path);
+    return 0;
+}
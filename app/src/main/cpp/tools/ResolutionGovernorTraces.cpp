@@ -0,0 +1,154 @@
+/*!
+ * Drives ResolutionGovernor with synthetic frame time traces and checks how it reacts: a light
+ * load it should leave alone, a thermal ramp it should scale down for and recover from, spikes it
+ * should ride out, a load hovering near the budget it mustn't oscillate on and a CPU bound load
+ * that resolution can't fix. The GPU time of a frame is modelled as a fixed part plus a part that
+ * goes with the pixel count, times a heat factor, with a little noise.
+ *
+ * Prints a line per trace and exits non-zero if any expectation fails.
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <random>
+
+#include "ResolutionGovernor.h"
+
+namespace {
+
+constexpr float kTargetMs = 1000.0f / 60.0f;
+constexpr int kFrames = 3000;
+
+struct Load {
+    // CPU time of a frame
+    float cpuMs = 4.0f;
+    // GPU time that doesn't depend on the resolution
+    float gpuFixedMs = 2.0f;
+    // GPU time at full resolution on top of that
+    float gpuPixelMs = 8.0f;
+    // slows the GPU down, 1 is a cool device
+    float heat = 1.0f;
+    // a one-off extra on this frame's GPU time
+    float spikeMs = 0.0f;
+};
+
+struct Expectation {
+    float minLowestScale = 0.0f;
+    float maxLowestScale = 1.0f;
+    float minFinalScale = 0.0f;
+    float maxFinalScale = 1.0f;
+    int maxChanges = kFrames;
+    // fraction of frames after the first second that may be over budget
+    float maxLateFraction = 1.0f;
+};
+
+bool run(const char *name, const std::function<Load(int frame)> &trace, const Expectation &expect) {
+    ResolutionGovernor::Config config;
+    config.targetMs = kTargetMs;
+    ResolutionGovernor governor(config);
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> noise(0.97f, 1.03f);
+
+    float scale = governor.getScale();
+    float lowest = scale;
+    int late = 0;
+    for (int frame = 0; frame < kFrames; frame++) {
+        Load load = trace(frame);
+        float gpuMs = (load.gpuFixedMs + load.gpuPixelMs * scale * scale) * load.heat * noise(random)
+                      + load.spikeMs;
+        float cpuMs = load.cpuMs * noise(random);
+        if (frame >= 60 && std::max(cpuMs, gpuMs) > kTargetMs) {
+            late++;
+        }
+        scale = governor.update(cpuMs, gpuMs);
+        lowest = std::min(lowest, scale);
+    }
+
+    const auto &stats = governor.getStats();
+    const int changes = static_cast<int>(stats.scaleDowns + stats.scaleUps);
+    const float lateFraction = float(late) / (kFrames - 60);
+    bool passed = lowest >= expect.minLowestScale - 1e-4f && lowest <= expect.maxLowestScale + 1e-4f
+                  && scale >= expect.minFinalScale - 1e-4f && scale <= expect.maxFinalScale + 1e-4f
+                  && changes <= expect.maxChanges
+                  && lateFraction <= expect.maxLateFraction;
+    printf("%-16s %s  lowest %.2f  final %.2f  %3llu down %3llu up  %5.1f%% frames late\n",
+           name, passed ? "ok  " : "FAIL", lowest, scale,
+           static_cast<unsigned long long>(stats.scaleDowns),
+           static_cast<unsigned long long>(stats.scaleUps), lateFraction * 100.0f);
+    return passed;
+}
+
+} // namespace
+
+int main() {
+    bool passed = true;
+
+    // 10 ms at full resolution, plenty of headroom
+    Expectation light;
+    light.minLowestScale = 1.0f;
+    light.maxChanges = 0;
+    light.maxLateFraction = 0.0f;
+    passed &= run("light", [](int) { return Load(); }, light);
+
+    // the GPU gets twice as slow over 10 s and stays there: 20 ms at full resolution, but it
+    // fits at 85%
+    Expectation thermal;
+    thermal.maxLowestScale = 0.9f;
+    thermal.minLowestScale = 0.7f;
+    thermal.maxFinalScale = 0.9f;
+    thermal.maxChanges = 20;
+    thermal.maxLateFraction = 0.05f;
+    passed &= run("thermal ramp", [](int frame) {
+        Load load;
+        load.heat = 1.0f + std::clamp((frame - 300) / 600.0f, 0.0f, 1.0f);
+        return load;
+    }, thermal);
+
+    // heats up like the above, then cools back down and should return to full resolution
+    Expectation recovery;
+    recovery.maxLowestScale = 0.9f;
+    recovery.minFinalScale = 1.0f;
+    recovery.maxChanges = 30;
+    recovery.maxLateFraction = 0.05f;
+    passed &= run("heat and cool", [](int frame) {
+        Load load;
+        float up = std::clamp((frame - 300) / 300.0f, 0.0f, 1.0f);
+        float down = std::clamp((frame - 1200) / 300.0f, 0.0f, 1.0f);
+        load.heat = 1.0f + up - down;
+        return load;
+    }, recovery);
+
+    // a 40 ms frame every couple of seconds, e.g. a texture upload, isn't worth a resolution change
+    Expectation spikes;
+    spikes.minLowestScale = 1.0f;
+    spikes.maxChanges = 0;
+    passed &= run("spikes", [](int frame) {
+        Load load;
+        load.spikeMs = frame % 97 == 0 ? 30.0f : 0.0f;
+        return load;
+    }, spikes);
+
+    // 16 ms at full resolution, in the band between the thresholds: it may step down but then
+    // mustn't flip-flop
+    Expectation hovering;
+    hovering.minLowestScale = 0.85f;
+    hovering.maxChanges = 4;
+    passed &= run("hovering", [](int) {
+        Load load;
+        load.gpuPixelMs = 14.0f;
+        return load;
+    }, hovering);
+
+    // the CPU takes 20 ms, fewer pixels won't make the frame any earlier
+    Expectation cpuBound;
+    cpuBound.minLowestScale = 1.0f;
+    cpuBound.maxChanges = 0;
+    passed &= run("cpu bound", [](int) {
+        Load load;
+        load.cpuMs = 20.0f;
+        return load;
+    }, cpuBound);
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,164 @@
+/*!
+ * Checks ResourcePool's handle rules: a destroyed handle finds nothing, even once its slot holds a
+ * new resource; destroying swaps the last resource into the hole without losing anyone else's;
+ * retired resources live until collect() and no longer; clear() invalidates everything; and a
+ * slot's generation wraps after 4095 reuses without ever making a null handle.
+ *
+ * Prints a line per check and exits non-zero if any fails.
+ */
+#include <cstdio>
+#include <vector>
+
+#include "ResourcePool.h"
+
+namespace {
+
+// A resource that counts how many times one of its kind was freed, moved-from ones don't count
+struct Tracked {
+    Tracked(int id, int &freed) : id(id), freed(&freed) {}
+
+    Tracked(Tracked &&other) noexcept : id(other.id), freed(other.freed) { other.freed = nullptr; }
+
+    Tracked &operator=(Tracked &&other) noexcept {
+        release();
+        id = other.id;
+        freed = other.freed;
+        other.freed = nullptr;
+        return *this;
+    }
+
+    Tracked(const Tracked &) = delete;
+
+    Tracked &operator=(const Tracked &) = delete;
+
+    ~Tracked() { release(); }
+
+    void release() {
+        if (freed) {
+            ++*freed;
+            freed = nullptr;
+        }
+    }
+
+    int id;
+    int *freed;
+};
+
+using Pool = ResourcePool<Tracked>;
+
+bool check(const char *name, bool passed) {
+    printf("%-48s %s\n", name, passed ? "ok" : "FAILED");
+    return passed;
+}
+
+bool finds(const Pool &pool, Pool::Handle handle, int id) {
+    const Tracked *resource = pool.get(handle);
+    return resource && resource->id == id;
+}
+
+bool staleHandles() {
+    int freed = 0;
+    Pool pool;
+    const Pool::Handle a = pool.create(Tracked(1, freed));
+    const Pool::Handle b = pool.create(Tracked(2, freed));
+    bool passed = check("null handle finds nothing", !pool.get(Pool::Handle()));
+    passed &= check("live handles find their resource", finds(pool, a, 1) && finds(pool, b, 2));
+
+    passed &= check("destroy succeeds once", pool.destroy(a) && !pool.destroy(a));
+    passed &= check("destroyed handle finds nothing", !pool.get(a) && !pool.contains(a));
+
+    // the free slot is reused by the next create
+    const Pool::Handle c = pool.create(Tracked(3, freed));
+    passed &= check("reused slot gets a new handle", c != a && !c.isNull());
+    passed &= check("destroyed handle misses the slot's new resource",
+                    !pool.get(a) && finds(pool, c, 3));
+    passed &= check("other handles unaffected by reuse", finds(pool, b, 2));
+    return passed;
+}
+
+bool swapWithLast() {
+    int freed = 0;
+    Pool pool;
+    std::vector<Pool::Handle> handles;
+    for (int id = 0; id < 8; ++id) {
+        handles.push_back(pool.create(Tracked(id, freed)));
+    }
+    // the first, one in the middle and the last, each moves a different resource into its place
+    pool.destroy(handles[0]);
+    pool.destroy(handles[4]);
+    pool.destroy(handles[7]);
+
+    bool passed = check("destroy leaves the rest packed", pool.size() == 5);
+    bool survivorsFound = true;
+    for (int id: {1, 2, 3, 5, 6}) {
+        survivorsFound &= finds(pool, handles[id], id);
+    }
+    passed &= check("swap with last keeps other handles right", survivorsFound);
+
+    bool packed = true;
+    for (const Tracked &resource: pool.getResources()) {
+        packed &= resource.id != 0 && resource.id != 4 && resource.id != 7;
+    }
+    passed &= check("getResources() holds only live resources", packed);
+    return passed;
+}
+
+bool retirement() {
+    int freed = 0;
+    Pool pool;
+    const Pool::Handle a = pool.create(Tracked(1, freed));
+    const Pool::Handle b = pool.create(Tracked(2, freed));
+    pool.create(Tracked(3, freed));
+    pool.destroy(a);
+    pool.destroy(b);
+
+    bool passed = check("destroyed resources wait for collect()",
+                        pool.getRetiredCount() == 2 && freed == 0);
+    passed &= check("collect() frees what was retired", pool.collect() == 2 && freed == 2);
+    passed &= check("retired count is 0 after collect()", pool.getRetiredCount() == 0);
+    passed &= check("second collect() frees nothing", pool.collect() == 0 && freed == 2);
+
+    const Pool::Handle d = pool.create(Tracked(4, freed));
+    pool.destroy(d);
+    pool.clear();
+    passed &= check("clear() frees live and retired resources",
+                    freed == 4 && pool.size() == 0 && pool.getRetiredCount() == 0);
+    passed &= check("clear() invalidates handles", !pool.get(d) && !pool.get(b));
+    return passed;
+}
+
+bool generationWrap() {
+    int freed = 0;
+    Pool pool;
+    const Pool::Handle first = pool.create(Tracked(0, freed));
+    Pool::Handle handle = first;
+    bool neverNull = true;
+    bool neverFirst = true;
+    // generations run 1 to 4095, so the 4095th reuse is back at the first
+    constexpr int kGenerations = (1 << (32 - Pool::kIndexBits)) - 1;
+    for (int reuse = 1; reuse < kGenerations; ++reuse) {
+        pool.destroy(handle);
+        pool.collect();
+        handle = pool.create(Tracked(reuse, freed));
+        neverNull &= !handle.isNull();
+        neverFirst &= handle != first;
+    }
+    bool passed = check("reuses before the wrap are distinct", neverNull && neverFirst);
+
+    pool.destroy(handle);
+    pool.collect();
+    handle = pool.create(Tracked(kGenerations, freed));
+    passed &= check("generation wraps to 1, not 0", !handle.isNull() && handle == first);
+    passed &= check("wrapped handle finds the newest resource", finds(pool, first, kGenerations));
+    return passed;
+}
+
+} // namespace
+
+int main() {
+    bool passed = staleHandles();
+    passed &= swapWithLast();
+    passed &= retirement();
+    passed &= generationWrap();
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,301 @@
+/*!
+ * Compresses a PNG to ETC2 with its full mip chain, in a KTX2 file the app uploads as it is, see
+ * CompressedTexture.h.
+ *
+ *  texture_encoder <in.png> <out.ktx2> [--format auto|etc2|etc2a] [--srgb] [--no-mips]
+ *                  [--filter box|kaiser|lanczos] [--linear] [--alpha-cutoff 0.5]
+ *
+ * etc2 is GL_COMPRESSED_RGB8_ETC2, 4 bits a texel, etc2a adds EAC alpha for 8 bits a texel. auto,
+ * the default, takes etc2 unless some texel isn't opaque. --srgb marks the texels as sRGB encoded
+ * so sampling linearizes them. The mips come from MipGenerator with --filter, Kaiser by default,
+ * in linear space unless --linear says the texels are data rather than colors. --alpha-cutoff
+ * keeps the coverage of alpha tested cutouts. Every level is decoded again to report its PSNR
+ * against what went in.
+ *
+ * ETC2 is the format every GLES 3 device samples. ASTC files load too, when the GPU has
+ * GL_KHR_texture_compression_astc_ldr, but this doesn't write them: make them with an ASTC encoder
+ * and a KTX2 tool.
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "CompressedTexture.h"
+#include "Etc2Codec.h"
+#include "MipGenerator.h"
+#include "PngImageDecoder.h"
+
+namespace {
+
+constexpr char kWriter[] = "cube-test texture_encoder";
+
+// from the Khronos data format specification, for the data format descriptor
+constexpr uint32_t kColorModelEtc2 = 161;
+constexpr uint32_t kPrimariesBt709 = 1;
+constexpr uint32_t kTransferLinear = 1;
+constexpr uint32_t kTransferSrgb = 2;
+constexpr uint32_t kChannelEtc2Color = 2;
+constexpr uint32_t kChannelEtc2Alpha = 15;
+constexpr uint32_t kSampleLinear = 0x10;
+
+struct Level {
+    DecodedImage image;
+    std::string blocks;
+    double colorPsnr;
+    double alphaPsnr;
+};
+
+uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+bool readFile(const std::string &path, std::string &contents) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    std::ostringstream buffer;
+    buffer << file.rdbuf();
+    contents = buffer.str();
+    return true;
+}
+
+double psnr(double squaredError, size_t samples) {
+    if (squaredError == 0.0) {
+        return INFINITY;
+    }
+    return 10.0 * std::log10(255.0 * 255.0 * samples / squaredError);
+}
+
+/*!
+ * Encodes @a level's image into its blocks, rows of blocks top row first, and measures the error
+ */
+void encode(Level &level, bool alpha) {
+    const DecodedImage &image = level.image;
+    const uint32_t blocksWide = (image.width + 3) / 4;
+    const uint32_t blocksHigh = (image.height + 3) / 4;
+    const size_t blockBytes = alpha ? 2 * Etc2Codec::kBlockBytes : Etc2Codec::kBlockBytes;
+    level.blocks.resize(size_t(blocksWide) * blocksHigh * blockBytes);
+
+    double colorError = 0.0;
+    double alphaError = 0.0;
+    for (uint32_t blockY = 0; blockY < blocksHigh; blockY++) {
+        for (uint32_t blockX = 0; blockX < blocksWide; blockX++) {
+            // blocks hanging over the edge repeat the last row and column, GL ignores those texels
+            uint8_t texels[Etc2Codec::kBlockTexels * 4];
+            for (uint32_t y = 0; y < 4; y++) {
+                for (uint32_t x = 0; x < 4; x++) {
+                    const uint32_t sourceX = std::min(blockX * 4 + x, image.width - 1);
+                    const uint32_t sourceY = std::min(blockY * 4 + y, image.height - 1);
+                    memcpy(texels + (y * 4 + x) * 4, &image.pixels[(size_t(sourceY) * image.width + sourceX) * 4], 4);
+                }
+            }
+            auto *block = reinterpret_cast<uint8_t *>(&level.blocks[(size_t(blockY) * blocksWide + blockX) * blockBytes]);
+            uint8_t *colorBlock = block;
+            if (alpha) {
+                Etc2Codec::encodeAlpha(texels, block);
+                colorBlock += Etc2Codec::kBlockBytes;
+            }
+            Etc2Codec::encodeColor(texels, colorBlock);
+
+            uint8_t decoded[Etc2Codec::kBlockTexels * 4];
+            memcpy(decoded, texels, sizeof(decoded));
+            Etc2Codec::decodeColor(colorBlock, decoded);
+            if (alpha) {
+                Etc2Codec::decodeAlpha(block, decoded);
+            }
+            for (uint32_t y = 0; y < 4 && blockY * 4 + y < image.height; y++) {
+                for (uint32_t x = 0; x < 4 && blockX * 4 + x < image.width; x++) {
+                    const uint8_t *in = texels + (y * 4 + x) * 4;
+                    const uint8_t *out = decoded + (y * 4 + x) * 4;
+                    for (int c = 0; c < 3; c++) {
+                        colorError += (in[c] - out[c]) * (in[c] - out[c]);
+                    }
+                    alphaError += (in[3] - out[3]) * (in[3] - out[3]);
+                }
+            }
+        }
+    }
+    const size_t texels = size_t(image.width) * image.height;
+    level.colorPsnr = psnr(colorError, texels * 3);
+    level.alphaPsnr = psnr(alphaError, texels);
+}
+
+/*!
+ * The data format descriptor KTX2 requires, a basic descriptor block for ETC2
+ */
+std::vector<uint32_t> dataFormatDescriptor(bool alpha, bool srgb) {
+    const uint32_t samples = alpha ? 2 : 1;
+    const uint32_t blockSize = 24 + 16 * samples;
+    std::vector<uint32_t> words = {
+            4 + blockSize,
+            0, // vendor and descriptor type, both Khronos basic
+            2 | blockSize << 16, // version 1.3
+            kColorModelEtc2 | kPrimariesBt709 << 8 | (srgb ? kTransferSrgb : kTransferLinear) << 16,
+            3 | 3 << 8, // 4x4 texel blocks
+            alpha ? 16u : 8u, // bytes in plane 0
+            0,
+    };
+    // each sample is 64 bits, the alpha block comes first. Alpha is never sRGB encoded
+    const auto addSample = [&words](uint32_t offset, uint32_t channel) {
+        words.insert(words.end(), {offset | 63 << 16 | channel << 24, 0, 0, UINT32_MAX});
+    };
+    if (alpha) {
+        addSample(0, kChannelEtc2Alpha | (srgb ? kSampleLinear : 0));
+    }
+    addSample(alpha ? 64 : 0, kChannelEtc2Color);
+    return words;
+}
+
+bool writeKtx2(const std::string &path, uint32_t vkFormat, bool alpha, bool srgb, const std::vector<Level> &levels) {
+    const auto levelCount = static_cast<uint32_t>(levels.size());
+    const std::vector<uint32_t> dfd = dataFormatDescriptor(alpha, srgb);
+    std::string kvd = "KTXwriter";
+    kvd += '\0';
+    kvd += kWriter;
+    kvd += '\0';
+    const auto kvdEntryLength = static_cast<uint32_t>(kvd.size());
+    kvd.insert(0, reinterpret_cast<const char *>(&kvdEntryLength), sizeof(kvdEntryLength));
+    kvd.resize(alignUp(kvd.size(), 4), '\0');
+
+    Ktx2Header header{};
+    memcpy(header.identifier, CompressedTexture::kIdentifier, sizeof(header.identifier));
+    header.vkFormat = vkFormat;
+    header.typeSize = 1;
+    header.pixelWidth = levels[0].image.width;
+    header.pixelHeight = levels[0].image.height;
+    header.faceCount = 1;
+    header.levelCount = levelCount;
+    header.dfdByteOffset = static_cast<uint32_t>(sizeof(header) + levelCount * sizeof(Ktx2Level));
+    header.dfdByteLength = static_cast<uint32_t>(dfd.size() * sizeof(uint32_t));
+    header.kvdByteOffset = header.dfdByteOffset + header.dfdByteLength;
+    header.kvdByteLength = static_cast<uint32_t>(kvd.size());
+
+    // the levels are padded to the block size, smallest first
+    const uint64_t alignment = alpha ? 16 : 8;
+    std::vector<Ktx2Level> index(levelCount);
+    uint64_t offset = header.kvdByteOffset + header.kvdByteLength;
+    for (uint32_t level = levelCount; level-- > 0;) {
+        index[level].byteOffset = alignUp(offset, alignment);
+        index[level].byteLength = levels[level].blocks.size();
+        index[level].uncompressedByteLength = levels[level].blocks.size();
+        offset = index[level].byteOffset + index[level].byteLength;
+    }
+
+    std::string file(offset, '\0');
+    memcpy(&file[0], &header, sizeof(header));
+    memcpy(&file[sizeof(header)], index.data(), index.size() * sizeof(Ktx2Level));
+    memcpy(&file[header.dfdByteOffset], dfd.data(), header.dfdByteLength);
+    memcpy(&file[header.kvdByteOffset], kvd.data(), kvd.size());
+    for (uint32_t level = 0; level < levelCount; level++) {
+        memcpy(&file[index[level].byteOffset], levels[level].blocks.data(), levels[level].blocks.size());
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(file.data(), file.size());
+    return static_cast<bool>(out);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: see the top of TextureEncoder.cpp\n");
+        return 2;
+    }
+    const std::string input = argv[1];
+    const std::string output = argv[2];
+    std::string format = "auto";
+    bool srgb = false;
+    bool mips = true;
+    std::string filter = "kaiser";
+    MipGenerator::Options mipOptions;
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            format = argv[++i];
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "--linear") == 0) {
+            mipOptions.srgb = false;
+        } else if (strcmp(argv[i], "--alpha-cutoff") == 0 && i + 1 < argc) {
+            mipOptions.alphaCutoff = static_cast<float>(atof(argv[++i]));
+        } else if (strcmp(argv[i], "--srgb") == 0) {
+            srgb = true;
+        } else if (strcmp(argv[i], "--no-mips") == 0) {
+            mips = false;
+        } else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+    if (format != "auto" && format != "etc2" && format != "etc2a") {
+        fprintf(stderr, "--format must be auto, etc2 or etc2a\n");
+        return 2;
+    }
+    if (filter == "box") {
+        mipOptions.filter = MipFilter::Box;
+    } else if (filter == "kaiser") {
+        mipOptions.filter = MipFilter::Kaiser;
+    } else if (filter == "lanczos") {
+        mipOptions.filter = MipFilter::Lanczos;
+    } else {
+        fprintf(stderr, "--filter must be box, kaiser or lanczos\n");
+        return 2;
+    }
+
+    std::string encoded;
+    std::vector<Level> levels(1);
+    if (!readFile(input, encoded) || !PngImageDecoder().decode(encoded, levels[0].image)
+        || levels[0].image.width == 0 || levels[0].image.height == 0) {
+        fprintf(stderr, "couldn't decode %s\n", input.c_str());
+        return 1;
+    }
+
+    bool alpha = format == "etc2a";
+    if (format == "auto") {
+        const auto &pixels = levels[0].image.pixels;
+        for (size_t i = 3; i < pixels.size() && !alpha; i += 4) {
+            alpha = pixels[i] != 255;
+        }
+    }
+    const uint32_t vkFormat = alpha ? (srgb ? CompressedTexture::kEtc2Rgba8Srgb : CompressedTexture::kEtc2Rgba8)
+                                    : (srgb ? CompressedTexture::kEtc2Rgb8Srgb : CompressedTexture::kEtc2Rgb8);
+
+    if (mips) {
+        for (auto &mip: MipGenerator(mipOptions).generate(levels[0].image)) {
+            Level next;
+            next.image = std::move(mip);
+            levels.push_back(std::move(next));
+        }
+    }
+
+    size_t compressedBytes = 0;
+    size_t uncompressedBytes = 0;
+    for (size_t i = 0; i < levels.size(); i++) {
+        Level &level = levels[i];
+        encode(level, alpha);
+        compressedBytes += level.blocks.size();
+        uncompressedBytes += level.image.pixels.size();
+        printf("level %zu: %ux%u, %zu bytes, PSNR %.2f dB", i, level.image.width, level.image.height,
+               level.blocks.size(), level.colorPsnr);
+        if (alpha) {
+            printf(", alpha %.2f dB", level.alphaPsnr);
+        }
+        printf("\n");
+    }
+
+    if (!writeKtx2(output, vkFormat, alpha, srgb, levels)) {
+        fprintf(stderr, "couldn't write %s\n", output.c_str());
+        return 1;
+    }
+    printf("wrote %s: %s%s, %zu levels, %zu bytes of blocks, %zu as RGBA8 (%.1fx smaller)\n", output.c_str(),
+           alpha ? "ETC2 RGBA" : "ETC2 RGB", srgb ? " sRGB" : "", levels.size(), compressedBytes,
+           uncompressedBytes, double(uncompressedBytes) / compressedBytes);
+    return 0;
+}
@@ -0,0 +1,112 @@
+/*!
+ * Host benchmark for TransformHierarchy. Builds a random 100k node forest and times full and
+ * partial world matrix updates against the 2 ms single core budget, after checking the world
+ * matrices against plain glm.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "TransformHierarchy.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t kNodeCount = 100000;
+constexpr int kRepeats = 50;
+constexpr double kBudgetMs = 2.0;
+
+double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+/*!
+ * Runs @a dirty then update() kRepeats times and prints the best and mean update time
+ */
+template<typename Dirty>
+void measure(const char *name, TransformHierarchy &hierarchy, Dirty dirty) {
+    double best = 1e9;
+    double total = 0.0;
+    size_t nodes = 0;
+    for (int repeat = 0; repeat < kRepeats; repeat++) {
+        dirty(repeat);
+        auto start = Clock::now();
+        hierarchy.update();
+        double elapsed = millisecondsSince(start);
+        best = std::min(best, elapsed);
+        total += elapsed;
+        nodes = hierarchy.getStats().nodesUpdated;
+    }
+    printf("%-28s %7zu nodes  best %.3f ms  mean %.3f ms  %s\n",
+           name, nodes, best, total / kRepeats, best <= kBudgetMs ? "within budget" : "OVER BUDGET");
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    // a forest of shallow trees: each node picks a parent among the last few hundred nodes, or
+    // starts a new tree
+    TransformHierarchy hierarchy;
+    std::vector<TransformHierarchy::Handle> handles;
+    handles.reserve(kNodeCount);
+    // what the world matrices should be, composed the slow way in creation order
+    std::vector<glm::mat4> expected;
+    expected.reserve(kNodeCount);
+    for (size_t i = 0; i < kNodeCount; i++) {
+        TransformHierarchy::Handle parent = TransformHierarchy::kNoParent;
+        if (i > 0 && random() % 16 != 0) {
+            size_t window = std::min<size_t>(i, 256);
+            parent = handles[i - 1 - random() % window];
+        }
+        const glm::vec3 translation(unit(random), unit(random), unit(random));
+        const glm::quat rotation = glm::normalize(glm::quat(unit(random), unit(random), unit(random), unit(random)));
+        const glm::vec3 scale(1.0f + 0.5f * unit(random));
+        handles.push_back(hierarchy.create(parent));
+        hierarchy.setLocal(handles.back(), translation, rotation, scale);
+        const glm::mat4 local = glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(rotation)
+                                * glm::scale(glm::mat4(1.0f), scale);
+        expected.push_back(parent == TransformHierarchy::kNoParent ? local : expected[parent] * local);
+    }
+    hierarchy.update();
+
+    float worst = 0.0f;
+    for (size_t i = 0; i < kNodeCount; i++) {
+        const glm::mat4 &world = hierarchy.getWorld(handles[i]);
+        for (int column = 0; column < 4; column++) {
+            const glm::vec4 difference = glm::abs(world[column] - expected[i][column]);
+            worst = std::max(worst, std::max(std::max(difference.x, difference.y), std::max(difference.z, difference.w)));
+        }
+    }
+    printf("world matrices vs glm: worst difference %g\n", worst);
+    if (worst > 1e-3f) {
+        printf("MISMATCH\n");
+        return 1;
+    }
+
+    measure("all nodes dirty", hierarchy, [&](int) {
+        for (auto handle: handles) {
+            hierarchy.setScale(handle, glm::vec3(1.0f));
+        }
+    });
+    measure("1% of nodes dirty", hierarchy, [&](int repeat) {
+        for (size_t i = repeat; i < handles.size(); i += 100) {
+            hierarchy.setTranslation(handles[i], glm::vec3(unit(random), 0.0f, 0.0f));
+        }
+    });
+    measure("nothing dirty", hierarchy, [](int) {});
+
+    // reparenting to a later node forces a re-sort before the next update
+    auto start = Clock::now();
+    hierarchy.setParent(handles[10], handles[kNodeCount - 1]);
+    hierarchy.update();
+    printf("%-28s %.3f ms\n", "reparent + re-sort + update", millisecondsSince(start));
+    return 0;
+}